@@ -28,6 +28,7 @@
 #include "vmime/text.hpp"
 
 #include "vmime/utility/random.hpp"
+#include "vmime/utility/countingOutputStream.hpp"
 
 #include "vmime/utility/seekableInputStreamRegionAdapter.hpp"
 
@@ -387,49 +388,10 @@ void body::generateImpl
 	// MIME-Multipart
 	if (getPartCount() != 0)
 	{
-		string boundary;
+		const string boundary = getGenerationBoundary();
 
-		if (m_header.acquire() == NULL)
-		{
-			boundary = generateRandomBoundaryString();
-		}
-		else
-		{
-			try
-			{
-				ref <const contentTypeField> ctf =
-					m_header.acquire()->findField(fields::CONTENT_TYPE)
-						.dynamicCast <const contentTypeField>();
-
-				boundary = ctf->getBoundary();
-			}
-			catch (exceptions::no_such_field&)
-			{
-				// Warning: no content-type and no boundary string specified!
-				boundary = generateRandomBoundaryString();
-			}
-			catch (exceptions::no_such_parameter&)
-			{
-				// Warning: no boundary string specified!
-				boundary = generateRandomBoundaryString();
-			}
-		}
-
-		const string& prologText =
-			m_prologText.empty()
-				? (isRootPart()
-					? ctx.getPrologText()
-					: NULL_STRING
-				  )
-				: m_prologText;
-
-		const string& epilogText =
-			m_epilogText.empty()
-				? (isRootPart()
-					? ctx.getEpilogText()
-					: NULL_STRING
-				  )
-				: m_epilogText;
+		const string prologText = getGenerationPrologText(ctx);
+		const string epilogText = getGenerationEpilogText(ctx);
 
 		if (!prologText.empty())
 		{
@@ -476,6 +438,128 @@ void body::generateImpl
 }
 
 
+utility::stream::size_type body::getGeneratedSize(const generationContext& ctx) const
+{
+	// MIME-Multipart
+	if (getPartCount() != 0)
+	{
+		// Only the prolog and the epilog need to be generated; the
+		// size of the parts is computed recursively
+		const string boundary = getGenerationBoundary();
+
+		const string prologText = getGenerationPrologText(ctx);
+		const string epilogText = getGenerationEpilogText(ctx);
+
+		utility::stream::size_type size = 0;
+
+		if (!prologText.empty())
+		{
+			utility::countingOutputStream count;
+			text prolog(prologText, vmime::charset("us-ascii"));
+
+			prolog.encodeAndFold(ctx, count, 0,
+				NULL, text::FORCE_NO_ENCODING | text::NO_NEW_LINE_SEQUENCE);
+
+			size += count.getCount() + 2;  // CRLF
+		}
+
+		size += 2 + boundary.length();  // "--" boundary
+
+		for (size_t p = 0 ; p < getPartCount() ; ++p)
+		{
+			size += 2;  // CRLF
+			size += getPartAt(p)->getGeneratedSize(ctx);
+			size += 2 + 2 + boundary.length();  // CRLF "--" boundary
+		}
+
+		size += 2 + 2;  // "--" CRLF
+
+		if (!epilogText.empty())
+		{
+			utility::countingOutputStream count;
+			text epilog(epilogText, vmime::charset("us-ascii"));
+
+			epilog.encodeAndFold(ctx, count, 0,
+				NULL, text::FORCE_NO_ENCODING | text::NO_NEW_LINE_SEQUENCE);
+
+			size += count.getCount() + 2;  // CRLF
+		}
+
+		return size;
+	}
+	// Simple body
+	else
+	{
+		return m_contents->getGeneratedSize(getEncoding(), ctx.getMaxLineLength());
+	}
+}
+
+
+bool body::isGeneratedSizeExact(const generationContext& ctx) const
+{
+	// MIME-Multipart
+	if (getPartCount() != 0)
+	{
+		for (size_t p = 0 ; p < getPartCount() ; ++p)
+		{
+			if (!getPartAt(p)->isGeneratedSizeExact(ctx))
+				return false;
+		}
+
+		return true;
+	}
+	// Simple body
+	else
+	{
+		return m_contents->isGeneratedSizeExact(getEncoding(), ctx.getMaxLineLength());
+	}
+}
+
+
+const string body::getGenerationBoundary() const
+{
+	if (m_header.acquire() == NULL)
+		return generateRandomBoundaryString();
+
+	try
+	{
+		ref <const contentTypeField> ctf =
+			m_header.acquire()->findField(fields::CONTENT_TYPE)
+				.dynamicCast <const contentTypeField>();
+
+		return ctf->getBoundary();
+	}
+	catch (exceptions::no_such_field&)
+	{
+		// Warning: no content-type and no boundary string specified!
+		return generateRandomBoundaryString();
+	}
+	catch (exceptions::no_such_parameter&)
+	{
+		// Warning: no boundary string specified!
+		return generateRandomBoundaryString();
+	}
+}
+
+
+const string body::getGenerationPrologText(const generationContext& ctx) const
+{
+	if (!m_prologText.empty())
+		return m_prologText;
+
+	return isRootPart() ? ctx.getPrologText() : NULL_STRING;
+}
+
+
+const string body::getGenerationEpilogText(const generationContext& ctx) const
+{
+	if (!m_epilogText.empty())
+		return m_epilogText;
+
+	return isRootPart() ? ctx.getEpilogText() : NULL_STRING;
+}
+
+
 /*
    RFC #1521, Page 32:
    7.2.1. Multipart: The common syntax
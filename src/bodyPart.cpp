@@ -82,6 +82,18 @@ void bodyPart::generateImpl
 }
 
 
+utility::stream::size_type bodyPart::getGeneratedSize(const generationContext& ctx) const
+{
+	return m_header->getGeneratedSize(ctx) + 2 /* CRLF */ + m_body->getGeneratedSize(ctx);
+}
+
+
+bool bodyPart::isGeneratedSizeExact(const generationContext& ctx) const
+{
+	return m_body->isGeneratedSizeExact(ctx);
+}
+
+
 ref <component> bodyPart::clone() const
 {
 	ref <bodyPart> p = vmime::create <bodyPart>();
@@ -27,6 +27,7 @@
 #include "vmime/utility/streamUtils.hpp"
 #include "vmime/utility/inputStreamStringAdapter.hpp"
 #include "vmime/utility/outputStreamAdapter.hpp"
+#include "vmime/utility/countingOutputStream.hpp"
 
 #include <sstream>
 
@@ -214,6 +215,15 @@ void component::generate
 }
 
 
+utility::stream::size_type component::getGeneratedSize(const generationContext& ctx) const
+{
+	utility::countingOutputStream count;
+	generateImpl(ctx, count, 0, NULL);
+
+	return count.getCount();
+}
+
+
 string::size_type component::getParsedOffset() const
 {
 	return (m_parsedOffset);
@@ -23,6 +23,8 @@
 
 #include "vmime/contentHandler.hpp"
 
+#include "vmime/utility/countingOutputStream.hpp"
+
 
 namespace vmime
 {
@@ -37,4 +39,72 @@ contentHandler::~contentHandler()
 }
 
 
+// Compute the generated size without reading data, if possible
+static bool contentHandler_computeGeneratedSize
+	(const contentHandler& handler, const vmime::encoding& enc,
+	 const string::size_type maxLineLength, utility::stream::size_type& size)
+{
+	if (handler.isEmpty())
+	{
+		size = 0;
+		return true;
+	}
+
+	const string::size_type length = handler.getLength();
+
+	// Length 0 means "unknown" here, as we are not empty
+	if (length == 0)
+		return false;
+
+	// Data will be copied as is
+	if (handler.isEncoded() && handler.getEncoding() == enc)
+	{
+		size = length;
+		return true;
+	}
+
+	if (!handler.isEncoded())
+	{
+		ref <utility::encoder::encoder> theEncoder = enc.getEncoder();
+		theEncoder->getProperties()["maxlinelength"] = maxLineLength;
+
+		size = theEncoder->getEncodedSize(length);
+
+		return (size != string::npos);
+	}
+
+	return false;
+}
+
+
+utility::stream::size_type contentHandler::getGeneratedSize
+	(const vmime::encoding& enc, const string::size_type maxLineLength) const
+{
+	utility::stream::size_type size = 0;
+
+	if (contentHandler_computeGeneratedSize(*this, enc, maxLineLength, size))
+		return size;
+
+	// Data can be read only once: estimate the size from its length
+	if (!isBuffered())
+		return getLength();
+
+	// The encoded length depends on data: generate and count
+	utility::countingOutputStream count;
+	generate(count, enc, maxLineLength);
+
+	return count.getCount();
+}
+
+
+bool contentHandler::isGeneratedSizeExact
+	(const vmime::encoding& enc, const string::size_type maxLineLength) const
+{
+	utility::stream::size_type size = 0;
+
+	return isBuffered() ||
+		contentHandler_computeGeneratedSize(*this, enc, maxLineLength, size);
+}
+
+
 } // vmime
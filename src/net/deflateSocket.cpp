@@ -0,0 +1,242 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002-2013 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+
+#include "vmime/config.hpp"
+
+
+#if VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_COMPRESSION_SUPPORT
+
+
+#include "vmime/net/deflateSocket.hpp"
+
+#include "vmime/exception.hpp"
+
+#include <zlib.h>
+
+
+namespace vmime {
+namespace net {
+
+
+deflateSocket::deflateSocket(ref <socket> wrapped)
+	: m_wrapped(wrapped), m_deflate(NULL), m_inflate(NULL), m_inflatePending(false)
+{
+	m_deflate = new z_stream;
+	m_deflate->zalloc = Z_NULL;
+	m_deflate->zfree = Z_NULL;
+	m_deflate->opaque = Z_NULL;
+
+	// Negative window bits: raw DEFLATE data, without zlib header (RFC 4978)
+	if (deflateInit2(m_deflate, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+			-MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+	{
+		delete m_deflate;
+		throw exceptions::net_exception("Cannot initialize DEFLATE compressor");
+	}
+
+	m_inflate = new z_stream;
+	m_inflate->zalloc = Z_NULL;
+	m_inflate->zfree = Z_NULL;
+	m_inflate->opaque = Z_NULL;
+	m_inflate->next_in = Z_NULL;
+	m_inflate->avail_in = 0;
+
+	if (inflateInit2(m_inflate, -MAX_WBITS) != Z_OK)
+	{
+		deflateEnd(m_deflate);
+
+		delete m_deflate;
+		delete m_inflate;
+
+		throw exceptions::net_exception("Cannot initialize DEFLATE decompressor");
+	}
+}
+
+
+deflateSocket::~deflateSocket()
+{
+	deflateEnd(m_deflate);
+	inflateEnd(m_inflate);
+
+	delete m_deflate;
+	delete m_inflate;
+}
+
+
+void deflateSocket::connect(const string& address, const port_t port)
+{
+	m_wrapped->connect(address, port);
+}
+
+
+void deflateSocket::disconnect()
+{
+	m_wrapped->disconnect();
+}
+
+
+bool deflateSocket::isConnected() const
+{
+	return m_wrapped->isConnected();
+}
+
+
+deflateSocket::size_type deflateSocket::getBlockSize() const
+{
+	return m_wrapped->getBlockSize();
+}
+
+
+void deflateSocket::setCorked(const bool corked)
+{
+	m_wrapped->setCorked(corked);
+}
+
+
+const string deflateSocket::getPeerName() const
+{
+	return m_wrapped->getPeerName();
+}
+
+
+const string deflateSocket::getPeerAddress() const
+{
+	return m_wrapped->getPeerAddress();
+}
+
+
+ref <socket> deflateSocket::getWrappedSocket()
+{
+	return m_wrapped;
+}
+
+
+void deflateSocket::receive(string& buffer)
+{
+	buffer.clear();
+
+	char chunk[16384];
+	size_type n = 0;
+
+	// Get all data which is available without blocking
+	do
+	{
+		n = receiveRaw(chunk, sizeof(chunk));
+		buffer.append(chunk, n);
+	}
+	while (n == static_cast <size_type>(sizeof(chunk)));
+}
+
+
+deflateSocket::size_type deflateSocket::receiveRaw(char* buffer, const size_type count)
+{
+	m_inflate->next_out = reinterpret_cast <Bytef*>(buffer);
+	m_inflate->avail_out = static_cast <uInt>(count);
+
+	while (true)
+	{
+		// Decompress data which has already been received
+		if (m_inflate->avail_in != 0 || m_inflatePending)
+		{
+			const int ret = inflate(m_inflate, Z_SYNC_FLUSH);
+
+			if (ret != Z_OK && ret != Z_BUF_ERROR && ret != Z_STREAM_END)
+				throw exceptions::socket_exception("Invalid compressed data received");
+
+			// Output buffer is full: more data may be pending in the decompressor
+			m_inflatePending = (m_inflate->avail_out == 0);
+
+			const size_type produced = count - static_cast <size_type>(m_inflate->avail_out);
+
+			if (produced != 0)
+				return produced;
+
+			// All input consumed without producing output (eg. sync marker)
+			if (m_inflate->avail_in != 0)
+				continue;
+		}
+
+		// Get more compressed data from the underlying socket
+		const size_type n = m_wrapped->receiveRaw(m_recvBuffer, sizeof(m_recvBuffer));
+
+		if (n == 0)
+			return 0;
+
+		m_inflate->next_in = reinterpret_cast <Bytef*>(m_recvBuffer);
+		m_inflate->avail_in = static_cast <uInt>(n);
+	}
+}
+
+
+void deflateSocket::send(const string& buffer)
+{
+	sendRaw(buffer.data(), buffer.length());
+}
+
+
+void deflateSocket::sendRaw(const char* buffer, const size_type count)
+{
+	m_deflate->next_in = reinterpret_cast <Bytef*>(const_cast <char*>(buffer));
+	m_deflate->avail_in = static_cast <uInt>(count);
+
+	// Compress and flush, so that the peer receives the whole data
+	do
+	{
+		m_deflate->next_out = reinterpret_cast <Bytef*>(m_sendBuffer);
+		m_deflate->avail_out = sizeof(m_sendBuffer);
+
+		if (deflate(m_deflate, Z_SYNC_FLUSH) == Z_STREAM_ERROR)
+			throw exceptions::socket_exception("Cannot compress data");
+
+		const size_type n = sizeof(m_sendBuffer) - static_cast <size_type>(m_deflate->avail_out);
+
+		if (n != 0)
+			m_wrapped->sendRaw(m_sendBuffer, n);
+	}
+	while (m_deflate->avail_out == 0);
+}
+
+
+deflateSocket::size_type deflateSocket::sendRawNonBlocking(const char* buffer, const size_type count)
+{
+	sendRaw(buffer, count);
+	return count;
+}
+
+
+unsigned int deflateSocket::getStatus() const
+{
+	// Some decompressed data may be available without reading from the socket
+	if (m_inflate->avail_in != 0 || m_inflatePending)
+		return m_wrapped->getStatus() & ~STATUS_WOULDBLOCK;
+
+	return m_wrapped->getStatus();
+}
+
+
+} // net
+} // vmime
+
+
+#endif // VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_COMPRESSION_SUPPORT
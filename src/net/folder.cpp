@@ -36,6 +36,129 @@ namespace vmime {
 namespace net {
 
 
+const searchResult folder::search(ref <const searchCriteria> criteria, const int /* options */)
+{
+	searchResult result;
+
+	const int count = getMessageCount();
+
+	if (count > 0)
+	{
+		std::vector <ref <message> > msgs = getMessages(1, count);
+
+		const int fetchOptions = criteria->getFetchOptions();
+
+		if (fetchOptions != 0)
+			fetchMessages(msgs, fetchOptions);
+
+		for (std::vector <ref <message> >::const_iterator it = msgs.begin() ; it != msgs.end() ; ++it)
+		{
+			if (criteria->matches(*it))
+				result.appendNumber(static_cast <unsigned int>((*it)->getNumber()));
+		}
+	}
+
+	result.setReturnOptions(searchResult::RETURN_MIN | searchResult::RETURN_MAX |
+		searchResult::RETURN_COUNT | searchResult::RETURN_ALL);
+
+	return result;
+}
+
+
+void folder::moveMessage(const folder::path& dest, const int num)
+{
+	std::vector <int> nums;
+	nums.push_back(num);
+
+	moveMessages(dest, nums);
+}
+
+
+void folder::moveMessages(const folder::path& dest, const int from, const int to)
+{
+	copyMessages(dest, from, to);
+	deleteMessages(from, to);
+	expunge();
+}
+
+
+void folder::moveMessages(const folder::path& dest, const std::vector <int>& nums)
+{
+	copyMessages(dest, nums);
+	deleteMessages(nums);
+	expunge();
+}
+
+
+// Number of messages for which objects are created and fetched at once
+static const unsigned int FETCH_BATCH_SIZE = 1000;
+
+
+static void folder_fetchBatch(folder* f, const std::vector <int>& nums,
+	const int options, messageFetchListener* listener)
+{
+	std::vector <ref <message> > msgs = f->getMessages(nums);
+
+	f->fetchMessages(msgs, options);
+
+	for (std::vector <ref <message> >::iterator it = msgs.begin() ; it != msgs.end() ; ++it)
+		listener->messageFetched(*it);
+}
+
+
+void folder::fetchMessages(const messageSet& msgs, const int options,
+	messageFetchListener* listener, utility::progressListener* progress)
+{
+	const int count = getMessageCount();
+	const int total = msgs.getCount(count);
+
+	if (progress)
+		progress->start(total);
+
+	std::vector <int> batch;
+	batch.reserve(FETCH_BATCH_SIZE);
+
+	int current = 0;
+	bool cancelled = false;
+
+	const std::vector <messageSet::range>& ranges = msgs.getRanges();
+
+	for (std::vector <messageSet::range>::const_iterator it = ranges.begin() ;
+	     !cancelled && it != ranges.end() && it->first <= count ; ++it)
+	{
+		const int last = (it->second == -1 || it->second > count) ? count : it->second;
+
+		for (int num = it->first ; !cancelled && num <= last ; ++num)
+		{
+			batch.push_back(num);
+
+			if (batch.size() == FETCH_BATCH_SIZE)
+			{
+				folder_fetchBatch(this, batch, options, listener);
+
+				current += static_cast <int>(batch.size());
+				batch.clear();
+
+				if (progress)
+				{
+					progress->progress(current, total);
+					cancelled = progress->cancel();
+				}
+			}
+		}
+	}
+
+	if (!cancelled && !batch.empty())
+	{
+		folder_fetchBatch(this, batch, options, listener);
+		current += static_cast <int>(batch.size());
+	}
+
+	if (progress)
+		progress->stop(current);
+}
+
+
 void folder::addMessageChangedListener(events::messageChangedListener* l)
 {
 	m_messageChangedListeners.push_back(l);
@@ -31,6 +31,7 @@
 #include "vmime/net/imap/IMAPConnection.hpp"
 #include "vmime/net/imap/IMAPUtils.hpp"
 #include "vmime/net/imap/IMAPStore.hpp"
+#include "vmime/net/imap/IMAPFolder.hpp"
 
 #include "vmime/exception.hpp"
 #include "vmime/platform.hpp"
@@ -46,6 +47,10 @@
 	#include "vmime/net/tls/TLSSecuredConnectionInfos.hpp"
 #endif // VMIME_HAVE_TLS_SUPPORT
 
+#if VMIME_HAVE_COMPRESSION_SUPPORT
+	#include "vmime/net/deflateSocket.hpp"
+#endif // VMIME_HAVE_COMPRESSION_SUPPORT
+
 #include <sstream>
 
 
@@ -66,7 +71,8 @@ namespace imap {
 IMAPConnection::IMAPConnection(ref <IMAPStore> store, ref <security::authenticator> auth)
 	: m_store(store), m_auth(auth), m_socket(NULL), m_parser(NULL), m_tag(NULL),
 	  m_hierarchySeparator('\0'), m_state(STATE_NONE), m_timeoutHandler(NULL),
-	  m_secured(false), m_firstTag(true)
+	  m_secured(false), m_firstTag(true), m_capabilitiesFetched(false),
+	  m_capabilitiesInResponses(false), m_idle(false), m_compressed(false)
 {
 }
 
@@ -95,6 +101,13 @@ void IMAPConnection::connect()
 	m_state = STATE_NONE;
 	m_hierarchySeparator = '\0';
 
+	m_capabilities.clear();
+	m_capabilitiesFetched = false;
+	m_capabilitiesInResponses = false;
+	m_idle = false;
+	m_compressed = false;
+	m_pendingTags.clear();
+
 	const string address = GET_PROPERTY(string, PROPERTY_SERVER_ADDRESS);
 	const port_t port = GET_PROPERTY(port_t, PROPERTY_SERVER_PORT);
 
@@ -131,6 +144,8 @@ void IMAPConnection::connect()
 
 
 	m_tag = vmime::create <IMAPTag>();
+	m_firstTag = true;
+
 	m_parser = vmime::create <IMAPParser>(m_tag, m_socket, m_timeoutHandler);
 
 
@@ -150,9 +165,17 @@ void IMAPConnection::connect()
 		internalDisconnect();
 		throw exceptions::connection_greeting_error(m_parser->lastLine());
 	}
-	else if (greet->resp_cond_auth()->condition() != IMAPParser::resp_cond_auth::PREAUTH)
+	else
 	{
-		needAuth = true;
+		if (greet->resp_cond_auth()->condition() != IMAPParser::resp_cond_auth::PREAUTH)
+			needAuth = true;
+
+		// Most servers send their capabilities along with the greeting
+		// (eg. "* OK [CAPABILITY IMAP4rev1 ...] ready"); those which do
+		// also send them in the response to LOGIN
+		processCapabilityResponseData(greet->resp_cond_auth()->resp_text());
+
+		m_capabilitiesInResponses = m_capabilitiesFetched;
 	}
 
 #if VMIME_HAVE_TLS_SUPPORT
@@ -204,8 +227,33 @@ void IMAPConnection::connect()
 		}
 	}
 
-	// Get the hierarchy separator character
-	initHierarchySeparator();
+	// Get the hierarchy separator character and, if not known, the new
+	// capabilities (unless these commands were pipelined with LOGIN)
+	if (m_hierarchySeparator == '\0')
+		readPostLoginResponses(sendPostLoginCommands(/* pipelined */ false, !m_capabilitiesFetched));
+
+#if VMIME_HAVE_COMPRESSION_SUPPORT
+	// Compress data exchanged with the server, if supported
+	if (GET_PROPERTY(bool, PROPERTY_OPTIONS_COMPRESS) &&
+	    hasCapability("COMPRESS=DEFLATE"))
+	{
+		try
+		{
+			startCompression();
+		}
+		// Non-fatal error
+		catch (exceptions::command_error&)
+		{
+			// Continue without compression
+		}
+		// Fatal error
+		catch (...)
+		{
+			m_state = STATE_NONE;
+			throw;
+		}
+	}
+#endif // VMIME_HAVE_COMPRESSION_SUPPORT
 
 	// Switch to state "Authenticated"
 	setState(STATE_AUTHENTICATED);
@@ -253,7 +301,15 @@ void IMAPConnection::authenticate()
 	send(true, "LOGIN " + IMAPUtils::quoteString(username)
 		+ " " + IMAPUtils::quoteString(password), true);
 
-	utility::auto_ptr <IMAPParser::response> resp(m_parser->readResponse());
+	// Capabilities may change once authenticated. Send the commands needed
+	// after login without waiting for the result, to save a round trip;
+	// if they fail because LOGIN failed, the connection is closed anyway.
+	m_capabilitiesFetched = false;
+
+	const bool capabilitySent =
+		sendPostLoginCommands(/* pipelined */ true, !m_capabilitiesInResponses);
+
+	utility::auto_ptr <IMAPParser::response> resp(readResponse());
 
 	if (resp->isBad())
 	{
@@ -266,6 +322,11 @@ void IMAPConnection::authenticate()
 		internalDisconnect();
 		throw exceptions::authentication_error(m_parser->lastLine());
 	}
+
+	// Eg. "a001 OK [CAPABILITY IMAP4rev1 ...] Logged in"
+	processCapabilityResponseData(resp);
+
+	readPostLoginResponses(capabilitySent);
 }
 
 
@@ -342,7 +403,40 @@ void IMAPConnection::authenticateSASL()
 
 		saslSession->init();
 
-		send(true, "AUTHENTICATE " + mech->getName(), true);
+		// Send the initial response along with the command, if the
+		// server supports it (SASL-IR, RFC 4959)
+		string initialResp;
+		bool hasInitialResp = false;
+
+		if (mech->hasInitialResponse() && hasCapability("SASL-IR"))
+		{
+			byte_t* resp = 0;
+			long respLen = 0;
+
+			try
+			{
+				saslSession->evaluateChallenge(NULL, 0, &resp, &respLen);
+
+				initialResp = saslContext->encodeB64(resp, respLen);
+				hasInitialResp = true;
+
+				// Zero-length initial response
+				if (initialResp.empty())
+					initialResp = "=";
+			}
+			catch (exceptions::sasl_exception&)
+			{
+				// Send the response when the server asks for it
+			}
+
+			if (resp)
+				delete [] resp;
+		}
+
+		if (hasInitialResp)
+			send(true, "AUTHENTICATE " + mech->getName() + " " + initialResp, true);
+		else
+			send(true, "AUTHENTICATE " + mech->getName(), true);
 
 		for (bool cont = true ; cont ; )
 		{
@@ -354,6 +448,11 @@ void IMAPConnection::authenticateSASL()
 			    	status() == IMAPParser::resp_cond_state::OK)
 			{
 				m_socket = saslSession->getSecuredSocket(m_socket);
+
+				// Capabilities may change once authenticated
+				m_capabilitiesFetched = false;
+				processCapabilityResponseData(resp);
+
 				return;
 			}
 			else
@@ -470,6 +569,8 @@ void IMAPConnection::startTLS()
 		m_socket = tlsSocket;
 		m_parser->setSocket(m_socket);
 
+		m_capabilitiesFetched = false;
+
 		m_secured = true;
 		m_cntInfos = vmime::create <tls::TLSSecuredConnectionInfos>
 			(m_cntInfos->getHost(), m_cntInfos->getPort(), tlsSession, tlsSocket);
@@ -491,43 +592,235 @@ void IMAPConnection::startTLS()
 
 
 const std::vector <string> IMAPConnection::getCapabilities()
+{
+	if (!m_capabilitiesFetched)
+		fetchCapabilities();
+
+	return m_capabilities;
+}
+
+
+void IMAPConnection::fetchCapabilities()
 {
 	send(true, "CAPABILITY", true);
 
-	utility::auto_ptr <IMAPParser::response> resp(m_parser->readResponse());
+	utility::auto_ptr <IMAPParser::response> resp(readResponse());
 
-	std::vector <string> res;
+	m_capabilities.clear();
+	m_capabilitiesFetched = true;
 
-	if (resp->response_done()->response_tagged()->
+	if (!resp->isBad() && resp->response_done()->response_tagged()->
 		resp_cond_state()->status() == IMAPParser::resp_cond_state::OK)
 	{
-		const std::vector <IMAPParser::continue_req_or_response_data*>& respDataList =
-			resp->continue_req_or_response_data();
+		processCapabilityResponseData(resp);
+	}
+}
 
-		for (unsigned int i = 0 ; i < respDataList.size() ; ++i)
-		{
-			if (respDataList[i]->response_data() == NULL)
-				continue;
 
-			const IMAPParser::capability_data* capaData =
-				respDataList[i]->response_data()->capability_data();
+void IMAPConnection::processCapabilityResponseData(const IMAPParser::response* resp)
+{
+	const std::vector <IMAPParser::continue_req_or_response_data*>& respDataList =
+		resp->continue_req_or_response_data();
+
+	for (unsigned int i = 0 ; i < respDataList.size() ; ++i)
+	{
+		const IMAPParser::response_data* respData = respDataList[i]->response_data();
 
-			if (capaData == NULL)
-				continue;
+		if (respData == NULL)
+			continue;
 
-			std::vector <IMAPParser::capability*> caps = capaData->capabilities();
+		// Eg. "* CAPABILITY IMAP4rev1 ..." (but not "* ENABLED ...")
+		if (respData->capability_data() && !respData->capability_data()->enabled())
+			setCapabilities(respData->capability_data()->capabilities());
+		// Eg. "* OK [CAPABILITY IMAP4rev1 ...]"
+		else if (respData->resp_cond_state())
+			processCapabilityResponseData(respData->resp_cond_state()->resp_text());
+	}
 
-			for (unsigned int j = 0 ; j < caps.size() ; ++j)
-			{
-				if (caps[j]->auth_type())
-					res.push_back("AUTH=" + caps[j]->auth_type()->name());
-				else
-					res.push_back(caps[j]->atom()->value());
-			}
-		}
+	// Eg. "a001 OK [CAPABILITY IMAP4rev1 ...]"
+	if (resp->response_done() && resp->response_done()->response_tagged())
+	{
+		processCapabilityResponseData
+			(resp->response_done()->response_tagged()->resp_cond_state()->resp_text());
+	}
+}
+
+
+void IMAPConnection::processCapabilityResponseData(const IMAPParser::resp_text* text)
+{
+	if (text && text->resp_text_code() &&
+	    text->resp_text_code()->type() == IMAPParser::resp_text_code::CAPABILITY)
+	{
+		setCapabilities(text->resp_text_code()->capabilities());
+	}
+}
+
+
+void IMAPConnection::setCapabilities(const std::vector <IMAPParser::capability*>& caps)
+{
+	m_capabilities.clear();
+
+	for (unsigned int i = 0 ; i < caps.size() ; ++i)
+	{
+		if (caps[i]->auth_type())
+			m_capabilities.push_back("AUTH=" + caps[i]->auth_type()->name());
+		else
+			m_capabilities.push_back(caps[i]->atom()->value());
+	}
+
+	m_capabilitiesFetched = true;
+}
+
+
+#if VMIME_HAVE_COMPRESSION_SUPPORT
+
+void IMAPConnection::startCompression()
+{
+	// Eg.  C: a003 COMPRESS DEFLATE
+	//      S: a003 OK DEFLATE active
+	send(true, "COMPRESS DEFLATE", true);
+
+	utility::auto_ptr <IMAPParser::response> resp(m_parser->readResponse());
+
+	if (resp->isBad() || resp->response_done()->response_tagged()->
+		resp_cond_state()->status() != IMAPParser::resp_cond_state::OK)
+	{
+		throw exceptions::command_error("COMPRESS", m_parser->lastLine(), "bad response");
+	}
+
+	// Data is compressed from now on, in both directions
+	m_socket = vmime::create <deflateSocket>(m_socket);
+	m_parser->setSocket(m_socket);
+
+	m_compressed = true;
+}
+
+#endif // VMIME_HAVE_COMPRESSION_SUPPORT
+
+
+bool IMAPConnection::isCompressed() const
+{
+	return m_compressed;
+}
+
+
+bool IMAPConnection::hasCapability(const string& capa)
+{
+	if (!m_capabilitiesFetched)
+		fetchCapabilities();
+
+	const string normCapa = utility::stringUtils::toUpper(capa);
+
+	for (unsigned int i = 0 ; i < m_capabilities.size() ; ++i)
+	{
+		if (utility::stringUtils::toUpper(m_capabilities[i]) == normCapa)
+			return true;
+	}
+
+	return false;
+}
+
+
+void IMAPConnection::setCurrentFolder(ref <IMAPFolder> folder)
+{
+	m_currentFolder = folder;
+}
+
+
+ref <IMAPFolder> IMAPConnection::getCurrentFolder()
+{
+	return m_currentFolder.acquire();
+}
+
+
+void IMAPConnection::startIdle()
+{
+	if (m_idle)
+		throw exceptions::illegal_state("Already idling");
+
+	if (!hasCapability("IDLE"))
+		throw exceptions::operation_not_supported();
+
+	// Eg.  C: a002 IDLE
+	//      S: + idling
+	//      S: * 4 EXISTS
+	//      C: DONE
+	//      S: a002 OK IDLE terminated
+
+	send(true, "IDLE", true);
+
+	utility::auto_ptr <IMAPParser::response> resp(m_parser->readResponse());
+
+	const std::vector <IMAPParser::continue_req_or_response_data*>& respDataList =
+		resp->continue_req_or_response_data();
+
+	bool ok = false;
+
+	for (unsigned int i = 0 ; i < respDataList.size() ; ++i)
+	{
+		if (respDataList[i]->continue_req())
+			ok = true;
+	}
+
+	if (!ok)
+		throw exceptions::command_error("IDLE", m_parser->lastLine(), "bad response");
+
+	m_idle = true;
+}
+
+
+void IMAPConnection::stopIdle()
+{
+	if (!m_idle)
+		throw exceptions::illegal_state("Not idling");
+
+	m_idle = false;
+
+	send(false, "DONE", true);
+
+	utility::auto_ptr <IMAPParser::response> resp(m_parser->readResponse());
+
+	ref <IMAPFolder> folder = m_currentFolder.acquire();
+
+	if (folder)
+		folder->processStatusUpdate(resp);
+
+	if (resp->isBad() || resp->response_done()->response_tagged()->
+		resp_cond_state()->status() != IMAPParser::resp_cond_state::OK)
+	{
+		throw exceptions::command_error("IDLE", m_parser->lastLine(), "bad response");
+	}
+}
+
+
+bool IMAPConnection::isIdle() const
+{
+	return m_idle;
+}
+
+
+IMAPParser::response_data* IMAPConnection::readIdleResponse()
+{
+	if (!m_idle)
+		throw exceptions::illegal_state("Not idling");
+
+	if (!m_parser->isResponseDataAvailable())
+		return NULL;
+
+	IMAPParser::response_data* respData = m_parser->readResponseData();
+
+	// Server is closing the connection
+	if (respData->resp_cond_bye())
+	{
+		delete respData;
+
+		m_idle = false;
+		internalDisconnect();
+
+		throw exceptions::not_connected();
 	}
 
-	return res;
+	return respData;
 }
 
 
@@ -584,11 +877,45 @@ void IMAPConnection::internalDisconnect()
 }
 
 
-void IMAPConnection::initHierarchySeparator()
+bool IMAPConnection::sendPostLoginCommands(const bool pipelined, const bool capability)
 {
-	send(true, "LIST \"\" \"\"", true);
+	// Eg.  C: a002 CAPABILITY
+	//      C: a003 LIST "" ""
+	if (capability)
+	{
+		if (pipelined)
+			sendPipelined("CAPABILITY");
+		else
+			send(true, "CAPABILITY", true);
+
+		sendPipelined("LIST \"\" \"\"");
+	}
+	else
+	{
+		if (pipelined)
+			sendPipelined("LIST \"\" \"\"");
+		else
+			send(true, "LIST \"\" \"\"", true);
+	}
+
+	return capability;
+}
+
 
-	vmime::utility::auto_ptr <IMAPParser::response> resp(m_parser->readResponse());
+void IMAPConnection::readPostLoginResponses(const bool capabilitySent)
+{
+	if (capabilitySent)
+	{
+		utility::auto_ptr <IMAPParser::response> resp(readResponse());
+
+		if (!resp->isBad() && resp->response_done()->response_tagged()->
+			resp_cond_state()->status() == IMAPParser::resp_cond_state::OK)
+		{
+			processCapabilityResponseData(resp);
+		}
+	}
+
+	utility::auto_ptr <IMAPParser::response> resp(readResponse());
 
 	if (resp->isBad() || resp->response_done()->response_tagged()->
 		resp_cond_state()->status() != IMAPParser::resp_cond_state::OK)
@@ -628,13 +955,39 @@ void IMAPConnection::initHierarchySeparator()
 
 void IMAPConnection::send(bool tag, const string& what, bool end)
 {
-	if (tag && !m_firstTag)
+	sendImpl(tag, what, end, false);
+}
+
+
+void IMAPConnection::sendPipelined(const string& what)
+{
+	sendImpl(true, what, true, true);
+}
+
+
+void IMAPConnection::sendImpl(bool tag, const string& what, bool end, bool pipelined)
+{
+	// A new command ends the IDLE state
+	if (tag && m_idle)
+		stopIdle();
+
+	if (tag)
 	{
-		++(*m_tag);
+		if (!m_firstTag)
+			++(*m_tag);
+
 		m_firstTag = false;
+
+		// Unless pipelining, the response to this command is the next
+		// one to be read
+		if (!pipelined)
+			m_pendingTags.clear();
+
+		m_pendingTags.push_back(string(*m_tag));
 	}
 
-#if VMIME_DEBUG
+	// Send the command in one go (when compression is enabled,
+	// output is flushed each time data is sent)
 	std::ostringstream oss;
 
 	if (tag)
@@ -649,20 +1002,6 @@ void IMAPConnection::send(bool tag, const string& what, bool end)
 		oss << "\r\n";
 
 	m_socket->send(oss.str());
-#else
-	if (tag)
-	{
-		m_socket->send(*m_tag);
-		m_socket->send(" ");
-	}
-
-	m_socket->send(what);
-
-	if (end)
-	{
-		m_socket->send("\r\n");
-	}
-#endif
 }
 
 
@@ -674,7 +1013,31 @@ void IMAPConnection::sendRaw(const char* buffer, const int count)
 
 IMAPParser::response* IMAPConnection::readResponse(IMAPParser::literalHandler* lh)
 {
-	return (m_parser->readResponse(lh));
+	// Responses to pipelined commands arrive in the order the commands were sent
+	if (!m_pendingTags.empty())
+		m_parser->setExpectedTag(m_pendingTags.front());
+
+	IMAPParser::response* resp = NULL;
+
+	try
+	{
+		resp = m_parser->readResponse(lh);
+	}
+	catch (...)
+	{
+		m_parser->setExpectedTag("");
+		m_pendingTags.clear();
+
+		throw;
+	}
+
+	m_parser->setExpectedTag("");
+
+	// The command is complete (not a continuation request)
+	if (resp->response_done() && !m_pendingTags.empty())
+		m_pendingTags.pop_front();
+
+	return (resp);
 }
 
 
@@ -732,6 +1095,12 @@ ref <const socket> IMAPConnection::getSocket() const
 }
 
 
+ref <socket> IMAPConnection::getSocket()
+{
+	return m_socket;
+}
+
+
 } // imap
 } // net
 } // vmime
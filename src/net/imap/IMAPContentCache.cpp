@@ -0,0 +1,274 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002-2013 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+
+#include "vmime/config.hpp"
+
+
+#if VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_IMAP
+
+
+#include "vmime/net/imap/IMAPContentCache.hpp"
+
+#include "vmime/utility/random.hpp"
+#include "vmime/utility/streamUtils.hpp"
+#include "vmime/utility/stringUtils.hpp"
+
+#include "vmime/exception.hpp"
+#include "vmime/platform.hpp"
+
+
+namespace vmime {
+namespace net {
+namespace imap {
+
+
+IMAPContentCache::IMAPContentCache(const size_t maxMemorySize, const size_t spillThreshold,
+	const utility::file::path& spillDir, const size_t maxDiskSize)
+	: m_maxMemorySize(maxMemorySize), m_spillThreshold(spillThreshold),
+	  m_spillDir(spillDir), m_maxDiskSize(maxDiskSize), m_memorySize(0), m_diskSize(0),
+	  m_filePrefix("vmime-" + utility::random::getString(12, "abcdefghijklmnopqrstuvwxyz0123456789") + "-"),
+	  m_fileCounter(0), m_lock(platform::getHandler()->createCriticalSection())
+{
+}
+
+
+IMAPContentCache::~IMAPContentCache()
+{
+	try
+	{
+		clear();
+	}
+	catch (vmime::exception&)
+	{
+		// Ignore
+	}
+}
+
+
+bool IMAPContentCache::isCacheable(const size_t size) const
+{
+	if (size <= m_spillThreshold)
+		return size <= m_maxMemorySize;
+	else
+		return !m_spillDir.isEmpty() && size <= m_maxDiskSize;
+}
+
+
+bool IMAPContentCache::get(const string& key, utility::outputStream& os)
+{
+	m_lock->lock();
+
+	try
+	{
+		std::map <string, item>::iterator it = m_items.find(key);
+
+		if (it == m_items.end())
+		{
+			m_lock->unlock();
+			return false;
+		}
+
+		item& i = (*it).second;
+
+		// Move to the front of the LRU list
+		std::list <string>& lru = (i.onDisk ? m_diskLRU : m_memoryLRU);
+		lru.splice(lru.begin(), lru, i.lruPos);
+
+		if (i.onDisk)
+		{
+			ref <utility::inputStream> is = i.file->getFileReader()->getInputStream();
+			utility::bufferedStreamCopy(*is, os);
+		}
+		else
+		{
+			os.write(i.data.data(), i.data.length());
+		}
+	}
+	catch (...)
+	{
+		m_lock->unlock();
+		throw;
+	}
+
+	m_lock->unlock();
+
+	return true;
+}
+
+
+void IMAPContentCache::put(const string& key, const string& data)
+{
+	const size_t size = data.length();
+
+	if (!isCacheable(size))
+		return;
+
+	const bool onDisk = (size > m_spillThreshold);
+
+	m_lock->lock();
+
+	try
+	{
+		std::map <string, item>::iterator it = m_items.find(key);
+
+		if (it != m_items.end())
+			removeItem(it);
+
+		evict(onDisk, size);
+
+		item i;
+		i.onDisk = onDisk;
+		i.size = size;
+
+		if (onDisk)
+		{
+			ref <utility::fileSystemFactory> fsf = platform::getHandler()->getFileSystemFactory();
+
+			ref <utility::file> dir = fsf->create(m_spillDir);
+
+			if (!dir->exists())
+				dir->createDirectory(true);
+
+			i.file = fsf->create(m_spillDir / utility::file::path::component
+				(m_filePrefix + utility::stringUtils::toString(m_fileCounter++)));
+
+			i.file->createFile();
+
+			ref <utility::outputStream> os = i.file->getFileWriter()->getOutputStream();
+
+			os->write(data.data(), data.length());
+			os->flush();
+
+			m_diskLRU.push_front(key);
+			i.lruPos = m_diskLRU.begin();
+
+			m_diskSize += size;
+		}
+		else
+		{
+			i.data = data;
+
+			m_memoryLRU.push_front(key);
+			i.lruPos = m_memoryLRU.begin();
+
+			m_memorySize += size;
+		}
+
+		m_items[key] = i;
+	}
+	catch (exceptions::filesystem_exception&)
+	{
+		// Contents will not be cached
+		m_lock->unlock();
+		return;
+	}
+	catch (...)
+	{
+		m_lock->unlock();
+		throw;
+	}
+
+	m_lock->unlock();
+}
+
+
+void IMAPContentCache::clear()
+{
+	m_lock->lock();
+
+	try
+	{
+		while (!m_items.empty())
+			removeItem(m_items.begin());
+	}
+	catch (...)
+	{
+		m_lock->unlock();
+		throw;
+	}
+
+	m_lock->unlock();
+}
+
+
+size_t IMAPContentCache::getMemorySize() const
+{
+	return m_memorySize;
+}
+
+
+size_t IMAPContentCache::getDiskSize() const
+{
+	return m_diskSize;
+}
+
+
+void IMAPContentCache::removeItem(std::map <string, item>::iterator it)
+{
+	item& i = (*it).second;
+
+	if (i.onDisk)
+	{
+		m_diskLRU.erase(i.lruPos);
+		m_diskSize -= i.size;
+
+		ref <utility::file> file = i.file;
+		m_items.erase(it);
+
+		try
+		{
+			file->remove();
+		}
+		catch (exceptions::filesystem_exception&)
+		{
+			// Ignore
+		}
+	}
+	else
+	{
+		m_memoryLRU.erase(i.lruPos);
+		m_memorySize -= i.size;
+
+		m_items.erase(it);
+	}
+}
+
+
+void IMAPContentCache::evict(const bool onDisk, const size_t size)
+{
+	std::list <string>& lru = (onDisk ? m_diskLRU : m_memoryLRU);
+	size_t& used = (onDisk ? m_diskSize : m_memorySize);
+	const size_t max = (onDisk ? m_maxDiskSize : m_maxMemorySize);
+
+	while (!lru.empty() && used + size > max)
+		removeItem(m_items.find(lru.back()));
+}
+
+
+} // imap
+} // net
+} // vmime
+
+
+#endif // VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_IMAP
@@ -33,6 +33,7 @@
 #include "vmime/net/imap/IMAPParser.hpp"
 #include "vmime/net/imap/IMAPMessage.hpp"
 #include "vmime/net/imap/IMAPUtils.hpp"
+#include "vmime/net/imap/IMAPMetadataCache.hpp"
 #include "vmime/net/imap/IMAPConnection.hpp"
 
 #include "vmime/message.hpp"
@@ -40,7 +41,11 @@
 #include "vmime/exception.hpp"
 #include "vmime/utility/smartPtr.hpp"
 
+#include "vmime/utility/inputStreamStringAdapter.hpp"
 #include "vmime/utility/outputStreamAdapter.hpp"
+#include "vmime/utility/outputStreamSocketAdapter.hpp"
+#include "vmime/utility/bufferedOutputStream.hpp"
+#include "vmime/utility/countingOutputStream.hpp"
 
 #include <algorithm>
 #include <sstream>
@@ -54,7 +59,8 @@ namespace imap {
 IMAPFolder::IMAPFolder(const folder::path& path, ref <IMAPStore> store, const int type, const int flags)
 	: m_store(store), m_connection(store->connection()), m_path(path),
 	  m_name(path.isEmpty() ? folder::path::component("") : path.getLastComponent()), m_mode(-1),
-	  m_open(false), m_type(type), m_flags(flags), m_messageCount(0), m_uidValidity(0)
+	  m_open(false), m_type(type), m_flags(flags), m_messageCount(0), m_uidValidity(0),
+	  m_qresync(false), m_pooled(false)
 {
 	store->registerFolder(this);
 }
@@ -67,7 +73,16 @@ IMAPFolder::~IMAPFolder()
 	if (store)
 	{
 		if (m_open)
-			close(false);
+		{
+			try
+			{
+				close(false);
+			}
+			catch (exception&)
+			{
+				// Ignore: the folder must be unregistered anyway
+			}
+		}
 
 		store->unregisterFolder(this);
 	}
@@ -141,19 +156,181 @@ const folder::path IMAPFolder::getFullPath() const
 
 
 void IMAPFolder::open(const int mode, bool failIfModeIsNotAvailable)
+{
+	openImpl(mode, failIfModeIsNotAvailable, "", NULL, NULL);
+}
+
+
+bool IMAPFolder::openAndResync(const int mode, const unsigned int uidValidity,
+	const string& modSeq, const string& knownUIDs,
+	std::vector <ref <message> >& changed, std::vector <message::uid>& vanished)
+{
+	ref <IMAPStore> store = m_store.acquire();
+
+	if (!store)
+		throw exceptions::illegal_state("Store disconnected");
+
+	changed.clear();
+	vanished.clear();
+
+	// Quick resynchronization, if supported by the server (QRESYNC)
+	if (uidValidity != 0 && !modSeq.empty() &&
+	    store->connection()->hasCapability("QRESYNC"))
+	{
+		std::ostringstream params;
+		params.imbue(std::locale::classic());
+
+		params << uidValidity << " " << modSeq;
+
+		if (!knownUIDs.empty())
+			params << " " << knownUIDs;
+
+		openImpl(mode, false, params.str(), &changed, &vanished);
+
+		// UIDs are not valid anymore: the server ignored the
+		// QRESYNC parameters, a full resynchronization is needed
+		if (m_uidValidity != uidValidity)
+		{
+			changed.clear();
+			vanished.clear();
+
+			return false;
+		}
+
+		return true;
+	}
+
+	openImpl(mode, false, "", NULL, NULL);
+
+	// Fall back on CONDSTORE (a non-empty HIGHESTMODSEQ means that the
+	// server supports mod-sequences for this folder); expunged messages
+	// can only be found if the client gave the list of UIDs it knows
+	if (uidValidity == 0 || m_uidValidity != uidValidity ||
+	    modSeq.empty() || m_highestModSeq.empty() || knownUIDs.empty())
+	{
+		return false;
+	}
+
+	fetchChangesSince(modSeq, changed, vanished);
+
+	// Find out which of the known messages still exist
+	m_connection->send(true, "UID SEARCH UID " + knownUIDs, true);
+
+	utility::auto_ptr <IMAPParser::response> resp(m_connection->readResponse());
+
+	if (resp->isBad() || resp->response_done()->response_tagged()->
+		resp_cond_state()->status() != IMAPParser::resp_cond_state::OK)
+	{
+		throw exceptions::command_error("UID SEARCH",
+			m_connection->getParser()->lastLine(), "bad response");
+	}
+
+	std::vector <unsigned int> existing;
+
+	const std::vector <IMAPParser::continue_req_or_response_data*>& respDataList =
+		resp->continue_req_or_response_data();
+
+	for (std::vector <IMAPParser::continue_req_or_response_data*>::const_iterator
+	     it = respDataList.begin() ; it != respDataList.end() ; ++it)
+	{
+		if ((*it)->response_data() == NULL)
+		{
+			throw exceptions::command_error("UID SEARCH",
+				m_connection->getParser()->lastLine(), "invalid response");
+		}
+
+		const IMAPParser::mailbox_data* mailboxData =
+			(*it)->response_data()->mailbox_data();
+
+		// We are only interested in responses of type "SEARCH"
+		if (mailboxData == NULL ||
+		    mailboxData->type() != IMAPParser::mailbox_data::SEARCH)
+		{
+			continue;
+		}
+
+		for (std::vector <IMAPParser::nz_number*>::const_iterator
+		     it = mailboxData->search_nz_number_list().begin() ;
+		     it != mailboxData->search_nz_number_list().end() ; ++it)
+		{
+			existing.push_back((*it)->value());
+		}
+	}
+
+	std::sort(existing.begin(), existing.end());
+
+	// Known UIDs are not expanded into a list, as the set may be very large
+	const std::vector <std::pair <unsigned int, unsigned int> > known =
+		IMAPUtils::setToRanges(knownUIDs);
+
+	std::vector <unsigned int>::const_iterator ex = existing.begin();
+
+	for (std::vector <std::pair <unsigned int, unsigned int> >::const_iterator
+	     it = known.begin() ; it != known.end() ; ++it)
+	{
+		for (unsigned int uid = (*it).first ; ; ++uid)
+		{
+			while (ex != existing.end() && *ex < uid)
+				++ex;
+
+			if (ex == existing.end() || *ex != uid)
+				vanished.push_back(IMAPUtils::makeGlobalUID(m_uidValidity, uid));
+
+			if (uid == (*it).second)
+				break;
+		}
+	}
+
+	return true;
+}
+
+
+void IMAPFolder::openImpl(const int mode, const bool failIfModeIsNotAvailable,
+	const string& qresyncParams, std::vector <ref <message> >* changed,
+	std::vector <message::uid>* vanished)
 {
 	ref <IMAPStore> store = m_store.acquire();
 
 	if (!store)
 		throw exceptions::illegal_state("Store disconnected");
 
-	// Open a connection for this folder
-	ref <IMAPConnection> connection =
-		vmime::create <IMAPConnection>(store, store->getAuthenticator());
+	// Open a connection for this folder, or reuse an idle one from the
+	// store pool (connections with QRESYNC enabled are never pooled)
+	const bool pooled = (store->getConnectionPoolSize() > 0 && qresyncParams.empty());
+
+	ref <IMAPConnection> connection;
+
+	if (pooled)
+	{
+		connection = store->acquireConnection();
+	}
+	else
+	{
+		connection = vmime::create <IMAPConnection>(store, store->getAuthenticator());
+	}
+
+	// Whether the server has rejected the SELECT command
+	bool rejected = false;
 
 	try
 	{
-		connection->connect();
+		if (!pooled)
+			connection->connect();
+
+		// Enable QRESYNC extension on this connection (RFC 5161)
+		if (!qresyncParams.empty())
+		{
+			connection->send(true, "ENABLE QRESYNC", true);
+
+			utility::auto_ptr <IMAPParser::response> resp(connection->readResponse());
+
+			if (resp->isBad() || resp->response_done()->response_tagged()->
+					resp_cond_state()->status() != IMAPParser::resp_cond_state::OK)
+			{
+				throw exceptions::command_error("ENABLE",
+					connection->getParser()->lastLine(), "bad response");
+			}
+		}
 
 		// Emit the "SELECT" command
 		//
@@ -176,6 +353,12 @@ void IMAPFolder::open(const int mode, bool failIfModeIsNotAvailable)
 		oss << IMAPUtils::quoteString(IMAPUtils::pathToString
 				(connection->hierarchySeparator(), getFullPath()));
 
+		// Eg.  C: A02 SELECT INBOX (QRESYNC (67890007 20050715194045000 41:211))
+		//      S: * VANISHED (EARLIER) 41,43:116,118,120:211
+		//      S: * 49 FETCH (UID 117 FLAGS (\Seen \Answered) MODSEQ (90060115194045001))
+		if (!qresyncParams.empty())
+			oss << " (QRESYNC (" << qresyncParams << "))";
+
 		connection->send(true, oss.str(), true);
 
 		// Read the response
@@ -184,6 +367,8 @@ void IMAPFolder::open(const int mode, bool failIfModeIsNotAvailable)
 		if (resp->isBad() || resp->response_done()->response_tagged()->
 				resp_cond_state()->status() != IMAPParser::resp_cond_state::OK)
 		{
+			rejected = true;
+
 			throw exceptions::command_error("SELECT",
 				connection->getParser()->lastLine(), "bad response");
 		}
@@ -191,6 +376,11 @@ void IMAPFolder::open(const int mode, bool failIfModeIsNotAvailable)
 		const std::vector <IMAPParser::continue_req_or_response_data*>& respDataList =
 			resp->continue_req_or_response_data();
 
+		std::vector <const IMAPParser::message_data*> changedData;
+		std::vector <std::pair <unsigned int, unsigned int> > vanishedUIDs;
+
+		m_highestModSeq.clear();
+
 		for (std::vector <IMAPParser::continue_req_or_response_data*>::const_iterator
 		     it = respDataList.begin() ; it != respDataList.end() ; ++it)
 		{
@@ -217,6 +407,16 @@ void IMAPFolder::open(const int mode, bool failIfModeIsNotAvailable)
 						m_uidValidity = static_cast <unsigned int>(code->nz_number()->value());
 						break;
 
+					case IMAPParser::resp_text_code::HIGHESTMODSEQ:
+
+						m_highestModSeq = code->mod_seq_value()->value();
+						break;
+
+					case IMAPParser::resp_text_code::NOMODSEQ:
+
+						m_highestModSeq.clear();
+						break;
+
 					default:
 
 						break;
@@ -250,9 +450,23 @@ void IMAPFolder::open(const int mode, bool failIfModeIsNotAvailable)
 					// TODO
 					break;
 				}
+				case IMAPParser::mailbox_data::VANISHED:
+				{
+					const std::vector <std::pair <unsigned int, unsigned int> > uids =
+						IMAPUtils::setToRanges(responseData->mailbox_data()->sequence_set()->value());
+
+					vanishedUIDs.insert(vanishedUIDs.end(), uids.begin(), uids.end());
+					break;
+				}
 
 				}
 			}
+			// Untagged responses: FETCH (changed messages, QRESYNC only)
+			else if (responseData->message_data())
+			{
+				if (responseData->message_data()->type() == IMAPParser::message_data::FETCH)
+					changedData.push_back(responseData->message_data());
+			}
 		}
 
 		// Check for access mode (read-only or read-write)
@@ -273,12 +487,71 @@ void IMAPFolder::open(const int mode, bool failIfModeIsNotAvailable)
 		}
 
 
+		connection->setState(IMAPConnection::STATE_SELECTED);
+
 		m_connection = connection;
 		m_open = true;
 		m_mode = mode;
+		m_qresync = !qresyncParams.empty();
+		m_pooled = pooled;
+
+		m_connection->setCurrentFolder(thisRef().dynamicCast <IMAPFolder>());
+
+		// Report changes since the last synchronization
+		if (changed)
+		{
+			for (std::vector <const IMAPParser::message_data*>::const_iterator
+			     it = changedData.begin() ; it != changedData.end() ; ++it)
+			{
+				ref <IMAPMessage> msg = vmime::create <IMAPMessage>
+					(thisRef().dynamicCast <IMAPFolder>(), static_cast <int>((*it)->number()));
+
+				msg->processFetchResponse(FETCH_FLAGS | FETCH_UID, *it);
+
+				changed->push_back(msg);
+			}
+		}
+
+		if (vanished)
+		{
+			for (std::vector <std::pair <unsigned int, unsigned int> >::const_iterator
+			     it = vanishedUIDs.begin() ; it != vanishedUIDs.end() ; ++it)
+			{
+				for (unsigned int uid = (*it).first ; ; ++uid)
+				{
+					vanished->push_back(IMAPUtils::makeGlobalUID(m_uidValidity, uid));
+
+					if (uid == (*it).second)
+						break;
+				}
+			}
+		}
 	}
 	catch (std::exception&)
 	{
+		// A rejected SELECT leaves the connection in the authenticated
+		// state, so it can be given back to the pool; after any other
+		// error (eg. parse error or time-out), the responses which are
+		// left unread would be received by the next command
+		if (pooled && !m_open)
+		{
+			if (rejected)
+			{
+				store->releaseConnection(connection);
+			}
+			else
+			{
+				try
+				{
+					connection->disconnect();
+				}
+				catch (exception&)
+				{
+					// Ignore
+				}
+			}
+		}
+
 		throw;
 	}
 }
@@ -304,10 +577,51 @@ void IMAPFolder::close(const bool expunge)
 			throw exceptions::operation_not_supported();
 
 		oldConnection->send(true, "CLOSE", true);
+
+		if (m_pooled)
+		{
+			utility::auto_ptr <IMAPParser::response> resp(oldConnection->readResponse());
+
+			if (!resp->isBad() && resp->response_done()->response_tagged()->
+					resp_cond_state()->status() == IMAPParser::resp_cond_state::OK)
+			{
+				oldConnection->setState(IMAPConnection::STATE_AUTHENTICATED);
+			}
+		}
+	}
+	else if (m_pooled)
+	{
+		// Leave the selected state without expunging anything, so that
+		// the connection can be reused: UNSELECT (RFC 3691) if available,
+		// or CLOSE on a folder opened read-only
+		string command;
+
+		if (oldConnection->hasCapability("UNSELECT"))
+			command = "UNSELECT";
+		else if (m_mode == MODE_READ_ONLY)
+			command = "CLOSE";
+
+		if (!command.empty())
+		{
+			oldConnection->send(true, command, true);
+
+			utility::auto_ptr <IMAPParser::response> resp(oldConnection->readResponse());
+
+			if (!resp->isBad() && resp->response_done()->response_tagged()->
+					resp_cond_state()->status() == IMAPParser::resp_cond_state::OK)
+			{
+				oldConnection->setState(IMAPConnection::STATE_AUTHENTICATED);
+			}
+		}
 	}
 
-	// Close this folder connection
-	oldConnection->disconnect();
+	// Close this folder connection, or give it back to the pool
+	oldConnection->setCurrentFolder(NULL);
+
+	if (m_pooled)
+		store->releaseConnection(oldConnection);
+	else if (oldConnection->isConnected())  // may have been dropped after an error
+		oldConnection->disconnect();
 
 	// Now use default store connection
 	m_connection = m_store.acquire()->connection();
@@ -316,6 +630,9 @@ void IMAPFolder::close(const bool expunge)
 	m_mode = -1;
 
 	m_uidValidity = 0;
+	m_highestModSeq.clear();
+	m_qresync = false;
+	m_pooled = false;
 
 	onClose();
 }
@@ -323,8 +640,11 @@ void IMAPFolder::close(const bool expunge)
 
 void IMAPFolder::onClose()
 {
-	for (std::vector <IMAPMessage*>::iterator it = m_messages.begin() ;
-	     it != m_messages.end() ; ++it)
+	std::vector <IMAPMessage*> msgs;
+	m_messages.getAll(msgs);
+
+	for (std::vector <IMAPMessage*>::iterator it = msgs.begin() ;
+	     it != msgs.end() ; ++it)
 	{
 		(*it)->onFolderClosed();
 	}
@@ -333,6 +653,31 @@ void IMAPFolder::onClose()
 }
 
 
+ref <IMAPConnection> IMAPFolder::acquireCommandConnection()
+{
+	ref <IMAPStore> store = m_store.acquire();
+
+	if (!isOpen() && store && store->getConnectionPoolSize() > 0)
+		return store->acquireConnection();
+
+	return m_connection;
+}
+
+
+void IMAPFolder::releaseCommandConnection(ref <IMAPConnection> cnt)
+{
+	if (cnt == m_connection)
+		return;
+
+	ref <IMAPStore> store = m_store.acquire();
+
+	if (store)
+		store->releaseConnection(cnt);
+	else
+		cnt->disconnect();
+}
+
+
 void IMAPFolder::create(const int type)
 {
 	ref <IMAPStore> store = m_store.acquire();
@@ -693,77 +1038,90 @@ std::vector <ref <folder> > IMAPFolder::getFolders(const bool recursive)
 	//     S: * LIST (\NoInferiors) "/" foo/bar/zap
 	//     S: a005 OK LIST completed
 
-	std::ostringstream oss;
-	oss << "LIST ";
+	// Use a pooled connection if the folder is not open, so that the
+	// store connection stays available for other commands
+	ref <IMAPConnection> cnt = acquireCommandConnection();
 
-	const string pathString = IMAPUtils::pathToString
-		(m_connection->hierarchySeparator(), getFullPath());
+	std::vector <ref <folder> > v;
 
-	if (recursive)
-	{
-		oss << IMAPUtils::quoteString(pathString);
-		oss << " *";
-	}
-	else
+	try
 	{
-		if (pathString.empty()) // don't add sep for root folder
-			oss << "\"\"";
-		else
-			oss << IMAPUtils::quoteString(pathString + m_connection->hierarchySeparator());
+		std::ostringstream oss;
+		oss << "LIST ";
 
-		oss << " %";
-	}
+		const string pathString = IMAPUtils::pathToString
+			(cnt->hierarchySeparator(), getFullPath());
 
-	m_connection->send(true, oss.str(), true);
+		if (recursive)
+		{
+			oss << IMAPUtils::quoteString(pathString);
+			oss << " *";
+		}
+		else
+		{
+			if (pathString.empty()) // don't add sep for root folder
+				oss << "\"\"";
+			else
+				oss << IMAPUtils::quoteString(pathString + cnt->hierarchySeparator());
 
+			oss << " %";
+		}
 
-	utility::auto_ptr <IMAPParser::response> resp(m_connection->readResponse());
+		cnt->send(true, oss.str(), true);
 
-	if (resp->isBad() || resp->response_done()->response_tagged()->
-			resp_cond_state()->status() != IMAPParser::resp_cond_state::OK)
-	{
-		throw exceptions::command_error("LIST", m_connection->getParser()->lastLine(), "bad response");
-	}
 
-	const std::vector <IMAPParser::continue_req_or_response_data*>& respDataList =
-		resp->continue_req_or_response_data();
+		utility::auto_ptr <IMAPParser::response> resp(cnt->readResponse());
 
+		if (resp->isBad() || resp->response_done()->response_tagged()->
+				resp_cond_state()->status() != IMAPParser::resp_cond_state::OK)
+		{
+			throw exceptions::command_error("LIST", cnt->getParser()->lastLine(), "bad response");
+		}
 
-	std::vector <ref <folder> > v;
+		const std::vector <IMAPParser::continue_req_or_response_data*>& respDataList =
+			resp->continue_req_or_response_data();
 
-	for (std::vector <IMAPParser::continue_req_or_response_data*>::const_iterator
-	     it = respDataList.begin() ; it != respDataList.end() ; ++it)
-	{
-		if ((*it)->response_data() == NULL)
+		for (std::vector <IMAPParser::continue_req_or_response_data*>::const_iterator
+		     it = respDataList.begin() ; it != respDataList.end() ; ++it)
 		{
-			throw exceptions::command_error("LIST",
-				m_connection->getParser()->lastLine(), "invalid response");
-		}
+			if ((*it)->response_data() == NULL)
+			{
+				throw exceptions::command_error("LIST",
+					cnt->getParser()->lastLine(), "invalid response");
+			}
 
-		const IMAPParser::mailbox_data* mailboxData =
-			(*it)->response_data()->mailbox_data();
+			const IMAPParser::mailbox_data* mailboxData =
+				(*it)->response_data()->mailbox_data();
 
-		if (mailboxData == NULL || mailboxData->type() != IMAPParser::mailbox_data::LIST)
-			continue;
+			if (mailboxData == NULL || mailboxData->type() != IMAPParser::mailbox_data::LIST)
+				continue;
 
-		// Get folder path
-		const class IMAPParser::mailbox* mailbox =
-			mailboxData->mailbox_list()->mailbox();
+			// Get folder path
+			const class IMAPParser::mailbox* mailbox =
+				mailboxData->mailbox_list()->mailbox();
 
-		folder::path path = IMAPUtils::stringToPath
-			(mailboxData->mailbox_list()->quoted_char(), mailbox->name());
+			folder::path path = IMAPUtils::stringToPath
+				(mailboxData->mailbox_list()->quoted_char(), mailbox->name());
 
-		if (recursive || m_path.isDirectParentOf(path))
-		{
-			// Append folder to list
-			const class IMAPParser::mailbox_flag_list* mailbox_flag_list =
-				mailboxData->mailbox_list()->mailbox_flag_list();
+			if (recursive || m_path.isDirectParentOf(path))
+			{
+				// Append folder to list
+				const class IMAPParser::mailbox_flag_list* mailbox_flag_list =
+					mailboxData->mailbox_list()->mailbox_flag_list();
 
-			v.push_back(vmime::create <IMAPFolder>(path, store,
-				IMAPUtils::folderTypeFromFlags(mailbox_flag_list),
-				IMAPUtils::folderFlagsFromFlags(mailbox_flag_list)));
+				v.push_back(vmime::create <IMAPFolder>(path, store,
+					IMAPUtils::folderTypeFromFlags(mailbox_flag_list),
+					IMAPUtils::folderFlagsFromFlags(mailbox_flag_list)));
+			}
 		}
 	}
+	catch (std::exception&)
+	{
+		releaseCommandConnection(cnt);
+		throw;
+	}
+
+	releaseCommandConnection(cnt);
 
 	return (v);
 }
@@ -779,39 +1137,115 @@ void IMAPFolder::fetchMessages(std::vector <ref <message> >& msg, const int opti
 	else if (!isOpen())
 		throw exceptions::illegal_state("Folder not open");
 
-	// Build message numbers list
-	std::vector <int> list;
-	list.reserve(msg.size());
-
-	std::map <int, ref <IMAPMessage> > numberToMsg;
+	ref <IMAPMetadataCache> cache = store->getMetadataCache();
 
-	for (std::vector <ref <message> >::iterator it = msg.begin() ; it != msg.end() ; ++it)
+	if (!cache || m_uidValidity == 0 || !(options & IMAPMetadataCache::CACHEABLE_OPTIONS))
 	{
-		list.push_back((*it)->getNumber());
-		numberToMsg[(*it)->getNumber()] = (*it).dynamicCast <IMAPMessage>();
+		fetchMessagesImpl(msg, options, progress);
+		return;
 	}
 
-	// Send the request
-	const string command = IMAPUtils::buildFetchRequest(list, options);
-	m_connection->send(true, command, true);
+	const string mailbox = IMAPUtils::pathToString
+		(m_connection->hierarchySeparator(), getFullPath());
 
-	// Get the response
-	utility::auto_ptr <IMAPParser::response> resp(m_connection->readResponse());
+	// Flags may change, so they are always fetched from the server, along
+	// with the UIDs which are needed to look up the cache
+	std::vector <ref <message> > uidsToFetch;
 
-	if (resp->isBad() || resp->response_done()->response_tagged()->
-		resp_cond_state()->status() != IMAPParser::resp_cond_state::OK)
+	for (std::vector <ref <message> >::iterator it = msg.begin() ; it != msg.end() ; ++it)
 	{
-		throw exceptions::command_error("FETCH",
-			m_connection->getParser()->lastLine(), "bad response");
+		if ((options & FETCH_FLAGS) || (*it)->getUniqueId().empty())
+			uidsToFetch.push_back(*it);
 	}
 
-	const std::vector <IMAPParser::continue_req_or_response_data*>& respDataList =
-		resp->continue_req_or_response_data();
+	if (!uidsToFetch.empty())
+		fetchMessagesImpl(uidsToFetch, (options & FETCH_FLAGS) | FETCH_UID, NULL);
 
-	const int total = msg.size();
-	int current = 0;
+	// Use cached metadata when available
+	std::vector <ref <message> > missing;
 
-	if (progress)
+	for (std::vector <ref <message> >::iterator it = msg.begin() ; it != msg.end() ; ++it)
+	{
+		ref <IMAPMessage> imapMsg = (*it).dynamicCast <IMAPMessage>();
+		const unsigned int uid = IMAPUtils::extractUIDFromGlobalUID(imapMsg->getUniqueId());
+
+		IMAPMetadataCache::entry entry;
+
+		if (uid != 0 && cache->getEntry(mailbox, m_uidValidity, uid, entry) &&
+		    IMAPMetadataCache::covers(entry, options))
+		{
+			imapMsg->processCacheEntry(options, entry);
+		}
+		else
+		{
+			missing.push_back(*it);
+		}
+	}
+
+	if (missing.empty())
+		return;
+
+	// Fetch the other messages from the server, and cache the results
+	const int missingOptions = (options & ~FETCH_FLAGS) | FETCH_UID;
+
+	fetchMessagesImpl(missing, missingOptions, progress);
+
+	for (std::vector <ref <message> >::iterator it = missing.begin() ; it != missing.end() ; ++it)
+	{
+		ref <IMAPMessage> imapMsg = (*it).dynamicCast <IMAPMessage>();
+		const unsigned int uid = IMAPUtils::extractUIDFromGlobalUID(imapMsg->getUniqueId());
+
+		if (uid != 0)
+			cache->putEntry(mailbox, m_uidValidity, uid, imapMsg->makeCacheEntry(missingOptions));
+	}
+
+	try
+	{
+		cache->flush();
+	}
+	catch (exceptions::filesystem_exception&)
+	{
+		// Ignore: entries will be fetched again next time
+	}
+}
+
+
+void IMAPFolder::fetchMessagesImpl(std::vector <ref <message> >& msg, const int options,
+                                   utility::progressListener* progress)
+{
+	// Build message numbers list
+	std::vector <int> list;
+	list.reserve(msg.size());
+
+	std::map <int, ref <IMAPMessage> > numberToMsg;
+
+	for (std::vector <ref <message> >::iterator it = msg.begin() ; it != msg.end() ; ++it)
+	{
+		list.push_back((*it)->getNumber());
+		numberToMsg[(*it)->getNumber()] = (*it).dynamicCast <IMAPMessage>();
+	}
+
+	// Send the request
+	const string command = IMAPUtils::buildFetchRequest(list, options);
+	m_connection->send(true, command, true);
+
+	// Get the response
+	utility::auto_ptr <IMAPParser::response> resp(m_connection->readResponse());
+
+	if (resp->isBad() || resp->response_done()->response_tagged()->
+		resp_cond_state()->status() != IMAPParser::resp_cond_state::OK)
+	{
+		throw exceptions::command_error("FETCH",
+			m_connection->getParser()->lastLine(), "bad response");
+	}
+
+	const std::vector <IMAPParser::continue_req_or_response_data*>& respDataList =
+		resp->continue_req_or_response_data();
+
+	const int total = msg.size();
+	int current = 0;
+
+	if (progress)
 		progress->start(total);
 
 	try
@@ -901,29 +1335,20 @@ ref <store> IMAPFolder::getStore()
 }
 
 
-void IMAPFolder::registerMessage(IMAPMessage* msg)
-{
-	m_messages.push_back(msg);
-}
-
-
-void IMAPFolder::unregisterMessage(IMAPMessage* msg)
+const string IMAPFolder::getHighestModSequence() const
 {
-	std::vector <IMAPMessage*>::iterator it =
-		std::find(m_messages.begin(), m_messages.end(), msg);
-
-	if (it != m_messages.end())
-		m_messages.erase(it);
+	return m_highestModSeq;
 }
 
 
-void IMAPFolder::onStoreDisconnected()
+unsigned int IMAPFolder::getUIDValidity() const
 {
-	m_store = NULL;
+	return m_uidValidity;
 }
 
 
-void IMAPFolder::deleteMessage(const int num)
+void IMAPFolder::fetchChangesSince(const string& modSeq,
+	std::vector <ref <message> >& changed, std::vector <message::uid>& vanished)
 {
 	ref <IMAPStore> store = m_store.acquire();
 
@@ -931,218 +1356,629 @@ void IMAPFolder::deleteMessage(const int num)
 		throw exceptions::illegal_state("Store disconnected");
 	else if (!isOpen())
 		throw exceptions::illegal_state("Folder not open");
-	else if (m_mode == MODE_READ_ONLY)
-		throw exceptions::illegal_state("Folder is read-only");
+	else if (m_highestModSeq.empty())
+		throw exceptions::operation_not_supported();
 
-	// Build the request text
+	// Eg.  C: s100 UID FETCH 1:* (FLAGS) (CHANGEDSINCE 12345 VANISHED)
+	//      S: * VANISHED (EARLIER) 1:2,4
+	//      S: * 3 FETCH (UID 5 FLAGS (\Seen) MODSEQ (12390))
+	//      S: s100 OK FETCH completed
 	std::ostringstream command;
 	command.imbue(std::locale::classic());
 
-	command << "STORE " << num << " +FLAGS.SILENT (\\Deleted)";
+	command << "UID FETCH 1:* (FLAGS) (CHANGEDSINCE " << modSeq;
+
+	if (m_qresync)
+		command << " VANISHED";
+
+	command << ")";
 
-	// Send the request
 	m_connection->send(true, command.str(), true);
 
-	// Get the response
 	utility::auto_ptr <IMAPParser::response> resp(m_connection->readResponse());
 
 	if (resp->isBad() || resp->response_done()->response_tagged()->
 		resp_cond_state()->status() != IMAPParser::resp_cond_state::OK)
 	{
-		throw exceptions::command_error("STORE",
+		throw exceptions::command_error("UID FETCH",
 			m_connection->getParser()->lastLine(), "bad response");
 	}
 
-	// Update local flags
-	for (std::vector <IMAPMessage*>::iterator it =
-	     m_messages.begin() ; it != m_messages.end() ; ++it)
+	const std::vector <IMAPParser::continue_req_or_response_data*>& respDataList =
+		resp->continue_req_or_response_data();
+
+	for (std::vector <IMAPParser::continue_req_or_response_data*>::const_iterator
+	     it = respDataList.begin() ; it != respDataList.end() ; ++it)
 	{
-		if ((*it)->getNumber() == num &&
-			(*it)->m_flags != message::FLAG_UNDEFINED)
+		if ((*it)->response_data() == NULL)
 		{
-			(*it)->m_flags |= message::FLAG_DELETED;
+			throw exceptions::command_error("UID FETCH",
+				m_connection->getParser()->lastLine(), "invalid response");
 		}
-	}
 
-	// Notify message flags changed
-	std::vector <int> nums;
-	nums.push_back(num);
+		const IMAPParser::response_data* respData = (*it)->response_data();
 
-	events::messageChangedEvent event
-		(thisRef().dynamicCast <folder>(),
-		 events::messageChangedEvent::TYPE_FLAGS, nums);
+		if (respData->message_data() &&
+		    respData->message_data()->type() == IMAPParser::message_data::FETCH)
+		{
+			ref <IMAPMessage> msg = vmime::create <IMAPMessage>
+				(thisRef().dynamicCast <IMAPFolder>(),
+				 static_cast <int>(respData->message_data()->number()));
 
-	notifyMessageChanged(event);
+			msg->processFetchResponse(FETCH_FLAGS | FETCH_UID, respData->message_data());
+
+			changed.push_back(msg);
+		}
+		else if (respData->mailbox_data() &&
+		         respData->mailbox_data()->type() == IMAPParser::mailbox_data::VANISHED)
+		{
+			const std::vector <std::pair <unsigned int, unsigned int> > uids =
+				IMAPUtils::setToRanges(respData->mailbox_data()->sequence_set()->value());
+
+			for (std::vector <std::pair <unsigned int, unsigned int> >::const_iterator
+			     jt = uids.begin() ; jt != uids.end() ; ++jt)
+			{
+				for (unsigned int uid = (*jt).first ; ; ++uid)
+				{
+					vanished.push_back(IMAPUtils::makeGlobalUID(m_uidValidity, uid));
+
+					if (uid == (*jt).second)
+						break;
+				}
+			}
+		}
+	}
 }
 
 
-void IMAPFolder::deleteMessages(const int from, const int to)
+void IMAPFolder::startIdle()
 {
-	ref <IMAPStore> store = m_store.acquire();
+	if (!m_store.acquire())
+		throw exceptions::illegal_state("Store disconnected");
+	else if (!isOpen())
+		throw exceptions::illegal_state("Folder not open");
 
-	if (from < 1 || (to < from && to != -1))
-		throw exceptions::invalid_argument();
+	m_connection->startIdle();
+}
 
-	if (!store)
+
+bool IMAPFolder::pollIdle()
+{
+	if (!m_store.acquire())
 		throw exceptions::illegal_state("Store disconnected");
 	else if (!isOpen())
 		throw exceptions::illegal_state("Folder not open");
-	else if (m_mode == MODE_READ_ONLY)
-		throw exceptions::illegal_state("Folder is read-only");
 
-	// Build the request text
-	std::ostringstream command;
-	command.imbue(std::locale::classic());
+	bool updated = false;
 
-	command << "STORE " << from << ":";
+	while (true)
+	{
+		utility::auto_ptr <IMAPParser::response_data>
+			respData(m_connection->readIdleResponse());
 
-	if (to == -1) command << m_messageCount;
-	else command << to;
+		if (respData == NULL)
+			break;
 
-	command << " +FLAGS.SILENT (\\Deleted)";
+		processStatusUpdate(respData);
+		updated = true;
+	}
 
-	// Send the request
-	m_connection->send(true, command.str(), true);
+	return updated;
+}
 
-	// Get the response
-	utility::auto_ptr <IMAPParser::response> resp(m_connection->readResponse());
 
-	if (resp->isBad() || resp->response_done()->response_tagged()->
-		resp_cond_state()->status() != IMAPParser::resp_cond_state::OK)
-	{
-		throw exceptions::command_error("STORE",
-			m_connection->getParser()->lastLine(), "bad response");
-	}
+void IMAPFolder::stopIdle()
+{
+	if (!m_store.acquire())
+		throw exceptions::illegal_state("Store disconnected");
+	else if (!isOpen())
+		throw exceptions::illegal_state("Folder not open");
 
-	// Update local flags
-	const int to2 = (to == -1) ? m_messageCount : to;
-	const int count = to - from + 1;
+	m_connection->stopIdle();
+}
 
-	for (std::vector <IMAPMessage*>::iterator it =
-	     m_messages.begin() ; it != m_messages.end() ; ++it)
-	{
-		if ((*it)->getNumber() >= from && (*it)->getNumber() <= to2 &&
-		    (*it)->m_flags != message::FLAG_UNDEFINED)
-		{
-			(*it)->m_flags |= message::FLAG_DELETED;
-		}
-	}
 
-	// Notify message flags changed
-	std::vector <int> nums;
-	nums.resize(count);
+bool IMAPFolder::isIdle() const
+{
+	return m_open && m_connection && m_connection->isIdle();
+}
 
-	for (int i = from, j = 0 ; i <= to2 ; ++i, ++j)
-		nums[j] = i;
 
-	events::messageChangedEvent event
-		(thisRef().dynamicCast <folder>(),
-		 events::messageChangedEvent::TYPE_FLAGS, nums);
+void IMAPFolder::processStatusUpdate(const IMAPParser::response* resp)
+{
+	const std::vector <IMAPParser::continue_req_or_response_data*>& respDataList =
+		resp->continue_req_or_response_data();
 
-	notifyMessageChanged(event);
+	for (std::vector <IMAPParser::continue_req_or_response_data*>::const_iterator
+	     it = respDataList.begin() ; it != respDataList.end() ; ++it)
+	{
+		if ((*it)->response_data() != NULL)
+			processStatusUpdate((*it)->response_data());
+	}
 }
 
 
-void IMAPFolder::deleteMessages(const std::vector <int>& nums)
+void IMAPFolder::processStatusUpdate(const IMAPParser::response_data* respData)
 {
 	ref <IMAPStore> store = m_store.acquire();
 
-	if (nums.empty())
-		throw exceptions::invalid_argument();
-
 	if (!store)
-		throw exceptions::illegal_state("Store disconnected");
-	else if (!isOpen())
-		throw exceptions::illegal_state("Folder not open");
-	else if (m_mode == MODE_READ_ONLY)
-		throw exceptions::illegal_state("Folder is read-only");
+		return;
 
-	// Sort the list of message numbers
-	std::vector <int> list;
+	// Highest mod-sequence changed: "* OK [HIGHESTMODSEQ n]"
+	if (respData->resp_cond_state() &&
+	    respData->resp_cond_state()->resp_text()->resp_text_code() &&
+	    respData->resp_cond_state()->resp_text()->resp_text_code()->type()
+	        == IMAPParser::resp_text_code::HIGHESTMODSEQ)
+	{
+		m_highestModSeq = respData->resp_cond_state()->resp_text()->
+			resp_text_code()->mod_seq_value()->value();
+	}
+	// Messages expunged, when QRESYNC is enabled: "* VANISHED uid-set"
+	else if (respData->mailbox_data() &&
+	         respData->mailbox_data()->type() == IMAPParser::mailbox_data::VANISHED)
+	{
+		if (respData->mailbox_data()->earlier())
+			return;
 
-	list.resize(nums.size());
-	std::copy(nums.begin(), nums.end(), list.begin());
+		// Ranges are not expanded, as the set may be very large
+		const std::vector <std::pair <unsigned int, unsigned int> > uids =
+			IMAPUtils::setToRanges(respData->mailbox_data()->sequence_set()->value());
 
-	std::sort(list.begin(), list.end());
+		// Only the sequence numbers of the messages known by the client
+		// can be determined, as the server only sends UIDs
+		std::vector <int> nums;
 
-	// Build the request text
-	std::ostringstream command;
-	command.imbue(std::locale::classic());
+		std::vector <IMAPMessage*> msgs;
+		m_messages.getAll(msgs);
 
-	command << "STORE ";
-	command << IMAPUtils::listToSet(list, m_messageCount, true);
-	command << " +FLAGS.SILENT (\\Deleted)";
+		for (std::vector <IMAPMessage*>::iterator jt =
+		     msgs.begin() ; jt != msgs.end() ; ++jt)
+		{
+			if ((*jt)->isExpunged() || (*jt)->m_uid.empty())
+				continue;
 
-	// Send the request
-	m_connection->send(true, command.str(), true);
+			const unsigned int uid = IMAPUtils::extractUIDFromGlobalUID((*jt)->m_uid);
 
-	// Get the response
-	utility::auto_ptr <IMAPParser::response> resp(m_connection->readResponse());
+			if (IMAPUtils::isInRanges(uids, uid))
+				nums.push_back((*jt)->getNumber());
+		}
 
-	if (resp->isBad() || resp->response_done()->response_tagged()->
-		resp_cond_state()->status() != IMAPParser::resp_cond_state::OK)
-	{
-		throw exceptions::command_error("STORE",
-			m_connection->getParser()->lastLine(), "bad response");
-	}
+		std::sort(nums.begin(), nums.end());
+		nums.erase(std::unique(nums.begin(), nums.end()), nums.end());
 
-	// Update local flags
-	for (std::vector <IMAPMessage*>::iterator it =
-	     m_messages.begin() ; it != m_messages.end() ; ++it)
-	{
-		if (std::binary_search(list.begin(), list.end(), (*it)->getNumber()))
+		// Renumber, starting from the highest number
+		for (std::vector <int>::reverse_iterator nt = nums.rbegin() ; nt != nums.rend() ; ++nt)
+			m_messages.expunge(*nt);
+
+		for (std::vector <std::pair <unsigned int, unsigned int> >::const_iterator
+		     rt = uids.begin() ; rt != uids.end() && m_messageCount > 0 ; ++rt)
 		{
-			if ((*it)->m_flags != message::FLAG_UNDEFINED)
-				(*it)->m_flags |= message::FLAG_DELETED;
+			const unsigned int count = (*rt).second - (*rt).first + 1;
+
+			if (count >= static_cast <unsigned int>(m_messageCount))
+				m_messageCount = 0;
+			else
+				m_messageCount -= static_cast <int>(count);
 		}
-	}
 
-	// Notify message flags changed
-	events::messageChangedEvent event
-		(thisRef().dynamicCast <folder>(),
-		 events::messageChangedEvent::TYPE_FLAGS, list);
+		if (nums.empty())
+			return;
 
-	notifyMessageChanged(event);
-}
+		// Notify message expunged
+		events::messageCountEvent event
+			(thisRef().dynamicCast <folder>(),
+			 events::messageCountEvent::TYPE_REMOVED, nums);
 
+		notifyFolders(m_path, event, m_messageCount);
+	}
+	// New messages: "* n EXISTS"
+	else if (respData->mailbox_data() &&
+	         respData->mailbox_data()->type() == IMAPParser::mailbox_data::EXISTS)
+	{
+		const int count = static_cast <int>
+			(respData->mailbox_data()->number()->value());
 
-void IMAPFolder::setMessageFlags(const int from, const int to, const int flags, const int mode)
-{
-	ref <IMAPStore> store = m_store.acquire();
+		if (count <= m_messageCount)
+		{
+			m_messageCount = count;
+			return;
+		}
 
-	if (from < 1 || (to < from && to != -1))
-		throw exceptions::invalid_argument();
+		std::vector <int> nums;
+		nums.reserve(count - m_messageCount);
 
-	if (!store)
-		throw exceptions::illegal_state("Store disconnected");
-	else if (!isOpen())
-		throw exceptions::illegal_state("Folder not open");
-	else if (m_mode == MODE_READ_ONLY)
-		throw exceptions::illegal_state("Folder is read-only");
+		for (int i = m_messageCount + 1 ; i <= count ; ++i)
+			nums.push_back(i);
 
-	std::ostringstream oss;
-	oss.imbue(std::locale::classic());
+		m_messageCount = count;
 
-	if (to == -1)
-		oss << from << ":*";
-	else
-		oss << from << ":" << to;
+		// Notify message count changed
+		events::messageCountEvent event
+			(thisRef().dynamicCast <folder>(),
+			 events::messageCountEvent::TYPE_ADDED, nums);
 
-	setMessageFlags(oss.str(), flags, mode);
+		notifyFolders(m_path, event, m_messageCount);
+	}
+	else if (respData->message_data())
+	{
+		const IMAPParser::message_data* messageData = respData->message_data();
+		const int number = static_cast <int>(messageData->number());
 
-	// Update local flags
-	const int to2 = (to == -1) ? m_messageCount : to;
-	const int count = to - from + 1;
+		// Message expunged: "* n EXPUNGE"
+		if (messageData->type() == IMAPParser::message_data::EXPUNGE)
+		{
+			m_messages.expunge(number);
 
-	switch (mode)
-	{
+			if (m_messageCount > 0)
+				m_messageCount--;
+
+			std::vector <int> nums;
+			nums.push_back(number);
+
+			// Notify message expunged
+			events::messageCountEvent event
+				(thisRef().dynamicCast <folder>(),
+				 events::messageCountEvent::TYPE_REMOVED, nums);
+
+			notifyFolders(m_path, event, m_messageCount);
+		}
+		// Flags changed: "* n FETCH (FLAGS (...))"
+		else if (messageData->type() == IMAPParser::message_data::FETCH)
+		{
+			const std::vector <IMAPParser::msg_att_item*> atts =
+				messageData->msg_att()->items();
+
+			bool hasFlags = false;
+			int flags = 0;
+			string modseq;
+
+			for (std::vector <IMAPParser::msg_att_item*>::const_iterator
+			     it = atts.begin() ; it != atts.end() ; ++it)
+			{
+				if ((*it)->type() == IMAPParser::msg_att_item::FLAGS)
+				{
+					flags |= IMAPUtils::messageFlagsFromFlags((*it)->flag_list());
+					hasFlags = true;
+				}
+				else if ((*it)->type() == IMAPParser::msg_att_item::MODSEQ)
+				{
+					modseq = (*it)->mod_seq_value()->value();
+				}
+			}
+
+			if (!hasFlags)
+				return;
+
+			std::vector <IMAPMessage*> msgs;
+			m_messages.find(number, number, msgs);
+
+			for (std::vector <IMAPMessage*>::iterator jt =
+			     msgs.begin() ; jt != msgs.end() ; ++jt)
+			{
+				(*jt)->m_flags = flags;
+
+				if (!modseq.empty())
+					(*jt)->m_modseq = modseq;
+			}
+
+			std::vector <int> nums;
+			nums.push_back(number);
+
+			// Notify message flags changed
+			events::messageChangedEvent event
+				(thisRef().dynamicCast <folder>(),
+				 events::messageChangedEvent::TYPE_FLAGS, nums);
+
+			notifyFolders(m_path, event);
+		}
+	}
+}
+
+
+void IMAPFolder::notifyFolders(const folder::path& path,
+	const events::messageCountEvent& event, const int count)
+{
+	ref <IMAPStore> store = m_store.acquire();
+
+	if (!store)
+		return;
+
+	std::vector <ref <IMAPFolder> > folders;
+	store->getFolders(folders);
+
+	for (std::vector <ref <IMAPFolder> >::iterator it = folders.begin() ;
+	     it != folders.end() ; ++it)
+	{
+		if ((*it)->getFullPath() != path)
+			continue;
+
+		if (count >= 0)
+			(*it)->m_messageCount = count;
+		else
+			(*it)->m_messageCount += static_cast <int>(event.getNumbers().size());
+
+		events::messageCountEvent folderEvent
+			((*it)->thisRef().dynamicCast <folder>(),
+			 event.getType(), event.getNumbers());
+
+		(*it)->notifyMessageCount(folderEvent);
+	}
+}
+
+
+void IMAPFolder::notifyFolders(const folder::path& path,
+	const events::messageChangedEvent& event)
+{
+	ref <IMAPStore> store = m_store.acquire();
+
+	if (!store)
+		return;
+
+	std::vector <ref <IMAPFolder> > folders;
+	store->getFolders(folders);
+
+	for (std::vector <ref <IMAPFolder> >::iterator it = folders.begin() ;
+	     it != folders.end() ; ++it)
+	{
+		if ((*it)->getFullPath() != path)
+			continue;
+
+		events::messageChangedEvent folderEvent
+			((*it)->thisRef().dynamicCast <folder>(),
+			 event.getType(), event.getNumbers());
+
+		(*it)->notifyMessageChanged(folderEvent);
+	}
+}
+
+
+void IMAPFolder::registerMessage(IMAPMessage* msg)
+{
+	msg->m_slot = m_messages.add(msg, msg->m_num);
+}
+
+
+void IMAPFolder::unregisterMessage(IMAPMessage* msg)
+{
+	m_messages.remove(msg, msg->m_slot);
+}
+
+
+void IMAPFolder::onStoreDisconnected()
+{
+	m_store = NULL;
+}
+
+
+void IMAPFolder::deleteMessage(const int num)
+{
+	ref <IMAPStore> store = m_store.acquire();
+
+	if (!store)
+		throw exceptions::illegal_state("Store disconnected");
+	else if (!isOpen())
+		throw exceptions::illegal_state("Folder not open");
+	else if (m_mode == MODE_READ_ONLY)
+		throw exceptions::illegal_state("Folder is read-only");
+
+	// Build the request text
+	std::ostringstream command;
+	command.imbue(std::locale::classic());
+
+	command << "STORE " << num << " +FLAGS.SILENT (\\Deleted)";
+
+	// Send the request
+	m_connection->send(true, command.str(), true);
+
+	// Get the response
+	utility::auto_ptr <IMAPParser::response> resp(m_connection->readResponse());
+
+	if (resp->isBad() || resp->response_done()->response_tagged()->
+		resp_cond_state()->status() != IMAPParser::resp_cond_state::OK)
+	{
+		throw exceptions::command_error("STORE",
+			m_connection->getParser()->lastLine(), "bad response");
+	}
+
+	// Update local flags
+	std::vector <IMAPMessage*> msgs;
+	m_messages.find(num, num, msgs);
+
+	for (std::vector <IMAPMessage*>::iterator it =
+	     msgs.begin() ; it != msgs.end() ; ++it)
+	{
+		if ((*it)->m_flags != message::FLAG_UNDEFINED)
+		{
+			(*it)->m_flags |= message::FLAG_DELETED;
+		}
+	}
+
+	// Notify message flags changed
+	std::vector <int> nums;
+	nums.push_back(num);
+
+	events::messageChangedEvent event
+		(thisRef().dynamicCast <folder>(),
+		 events::messageChangedEvent::TYPE_FLAGS, nums);
+
+	notifyMessageChanged(event);
+}
+
+
+void IMAPFolder::deleteMessages(const int from, const int to)
+{
+	ref <IMAPStore> store = m_store.acquire();
+
+	if (from < 1 || (to < from && to != -1))
+		throw exceptions::invalid_argument();
+
+	if (!store)
+		throw exceptions::illegal_state("Store disconnected");
+	else if (!isOpen())
+		throw exceptions::illegal_state("Folder not open");
+	else if (m_mode == MODE_READ_ONLY)
+		throw exceptions::illegal_state("Folder is read-only");
+
+	// Build the request text
+	std::ostringstream command;
+	command.imbue(std::locale::classic());
+
+	command << "STORE " << from << ":";
+
+	if (to == -1) command << m_messageCount;
+	else command << to;
+
+	command << " +FLAGS.SILENT (\\Deleted)";
+
+	// Send the request
+	m_connection->send(true, command.str(), true);
+
+	// Get the response
+	utility::auto_ptr <IMAPParser::response> resp(m_connection->readResponse());
+
+	if (resp->isBad() || resp->response_done()->response_tagged()->
+		resp_cond_state()->status() != IMAPParser::resp_cond_state::OK)
+	{
+		throw exceptions::command_error("STORE",
+			m_connection->getParser()->lastLine(), "bad response");
+	}
+
+	// Update local flags
+	const int to2 = (to == -1) ? m_messageCount : to;
+	const int count = to - from + 1;
+
+	std::vector <IMAPMessage*> msgs;
+	m_messages.find(from, to2, msgs);
+
+	for (std::vector <IMAPMessage*>::iterator it =
+	     msgs.begin() ; it != msgs.end() ; ++it)
+	{
+		if ((*it)->m_flags != message::FLAG_UNDEFINED)
+		{
+			(*it)->m_flags |= message::FLAG_DELETED;
+		}
+	}
+
+	// Notify message flags changed
+	std::vector <int> nums;
+	nums.resize(count);
+
+	for (int i = from, j = 0 ; i <= to2 ; ++i, ++j)
+		nums[j] = i;
+
+	events::messageChangedEvent event
+		(thisRef().dynamicCast <folder>(),
+		 events::messageChangedEvent::TYPE_FLAGS, nums);
+
+	notifyMessageChanged(event);
+}
+
+
+void IMAPFolder::deleteMessages(const std::vector <int>& nums)
+{
+	ref <IMAPStore> store = m_store.acquire();
+
+	if (nums.empty())
+		throw exceptions::invalid_argument();
+
+	if (!store)
+		throw exceptions::illegal_state("Store disconnected");
+	else if (!isOpen())
+		throw exceptions::illegal_state("Folder not open");
+	else if (m_mode == MODE_READ_ONLY)
+		throw exceptions::illegal_state("Folder is read-only");
+
+	// Sort the list of message numbers
+	std::vector <int> list;
+
+	list.resize(nums.size());
+	std::copy(nums.begin(), nums.end(), list.begin());
+
+	std::sort(list.begin(), list.end());
+
+	// Build the request text
+	std::ostringstream command;
+	command.imbue(std::locale::classic());
+
+	command << "STORE ";
+	command << IMAPUtils::listToSet(list, m_messageCount, true);
+	command << " +FLAGS.SILENT (\\Deleted)";
+
+	// Send the request
+	m_connection->send(true, command.str(), true);
+
+	// Get the response
+	utility::auto_ptr <IMAPParser::response> resp(m_connection->readResponse());
+
+	if (resp->isBad() || resp->response_done()->response_tagged()->
+		resp_cond_state()->status() != IMAPParser::resp_cond_state::OK)
+	{
+		throw exceptions::command_error("STORE",
+			m_connection->getParser()->lastLine(), "bad response");
+	}
+
+	// Update local flags
+	std::vector <IMAPMessage*> msgs;
+
+	for (std::vector <int>::const_iterator nt = list.begin() ; nt != list.end() ; ++nt)
+		m_messages.find(*nt, *nt, msgs);
+
+	for (std::vector <IMAPMessage*>::iterator it =
+	     msgs.begin() ; it != msgs.end() ; ++it)
+	{
+		if ((*it)->m_flags != message::FLAG_UNDEFINED)
+			(*it)->m_flags |= message::FLAG_DELETED;
+	}
+
+	// Notify message flags changed
+	events::messageChangedEvent event
+		(thisRef().dynamicCast <folder>(),
+		 events::messageChangedEvent::TYPE_FLAGS, list);
+
+	notifyMessageChanged(event);
+}
+
+
+void IMAPFolder::setMessageFlags(const int from, const int to, const int flags, const int mode)
+{
+	ref <IMAPStore> store = m_store.acquire();
+
+	if (from < 1 || (to < from && to != -1))
+		throw exceptions::invalid_argument();
+
+	if (!store)
+		throw exceptions::illegal_state("Store disconnected");
+	else if (!isOpen())
+		throw exceptions::illegal_state("Folder not open");
+	else if (m_mode == MODE_READ_ONLY)
+		throw exceptions::illegal_state("Folder is read-only");
+
+	std::ostringstream oss;
+	oss.imbue(std::locale::classic());
+
+	if (to == -1)
+		oss << from << ":*";
+	else
+		oss << from << ":" << to;
+
+	setMessageFlags(oss.str(), flags, mode);
+
+	// Update local flags
+	const int to2 = (to == -1) ? m_messageCount : to;
+	const int count = to - from + 1;
+
+	std::vector <IMAPMessage*> msgs;
+	m_messages.find(from, to2, msgs);
+
+	switch (mode)
+	{
 	case message::FLAG_MODE_ADD:
 	{
 		for (std::vector <IMAPMessage*>::iterator it =
-		     m_messages.begin() ; it != m_messages.end() ; ++it)
+		     msgs.begin() ; it != msgs.end() ; ++it)
 		{
-			if ((*it)->getNumber() >= from && (*it)->getNumber() <= to2 &&
-			    (*it)->m_flags != message::FLAG_UNDEFINED)
+			if ((*it)->m_flags != message::FLAG_UNDEFINED)
 			{
 				(*it)->m_flags |= flags;
 			}
@@ -1153,10 +1989,9 @@ void IMAPFolder::setMessageFlags(const int from, const int to, const int flags,
 	case message::FLAG_MODE_REMOVE:
 	{
 		for (std::vector <IMAPMessage*>::iterator it =
-		     m_messages.begin() ; it != m_messages.end() ; ++it)
+		     msgs.begin() ; it != msgs.end() ; ++it)
 		{
-			if ((*it)->getNumber() >= from && (*it)->getNumber() <= to2 &&
-			    (*it)->m_flags != message::FLAG_UNDEFINED)
+			if ((*it)->m_flags != message::FLAG_UNDEFINED)
 			{
 				(*it)->m_flags &= ~flags;
 			}
@@ -1168,10 +2003,9 @@ void IMAPFolder::setMessageFlags(const int from, const int to, const int flags,
 	case message::FLAG_MODE_SET:
 	{
 		for (std::vector <IMAPMessage*>::iterator it =
-		     m_messages.begin() ; it != m_messages.end() ; ++it)
+		     msgs.begin() ; it != msgs.end() ; ++it)
 		{
-			if ((*it)->getNumber() >= from && (*it)->getNumber() <= to2 &&
-			    (*it)->m_flags != message::FLAG_UNDEFINED)
+			if ((*it)->m_flags != message::FLAG_UNDEFINED)
 			{
 				(*it)->m_flags = flags;
 			}
@@ -1220,15 +2054,19 @@ void IMAPFolder::setMessageFlags(const std::vector <int>& nums, const int flags,
 	setMessageFlags(IMAPUtils::listToSet(list, m_messageCount, true), flags, mode);
 
 	// Update local flags
+	std::vector <IMAPMessage*> msgs;
+
+	for (std::vector <int>::const_iterator nt = list.begin() ; nt != list.end() ; ++nt)
+		m_messages.find(*nt, *nt, msgs);
+
 	switch (mode)
 	{
 	case message::FLAG_MODE_ADD:
 	{
 		for (std::vector <IMAPMessage*>::iterator it =
-		     m_messages.begin() ; it != m_messages.end() ; ++it)
+		     msgs.begin() ; it != msgs.end() ; ++it)
 		{
-			if (std::binary_search(list.begin(), list.end(), (*it)->getNumber()) &&
-			    (*it)->m_flags != message::FLAG_UNDEFINED)
+			if ((*it)->m_flags != message::FLAG_UNDEFINED)
 			{
 				(*it)->m_flags |= flags;
 			}
@@ -1239,10 +2077,9 @@ void IMAPFolder::setMessageFlags(const std::vector <int>& nums, const int flags,
 	case message::FLAG_MODE_REMOVE:
 	{
 		for (std::vector <IMAPMessage*>::iterator it =
-		     m_messages.begin() ; it != m_messages.end() ; ++it)
+		     msgs.begin() ; it != msgs.end() ; ++it)
 		{
-			if (std::binary_search(list.begin(), list.end(), (*it)->getNumber()) &&
-			    (*it)->m_flags != message::FLAG_UNDEFINED)
+			if ((*it)->m_flags != message::FLAG_UNDEFINED)
 			{
 				(*it)->m_flags &= ~flags;
 			}
@@ -1254,10 +2091,9 @@ void IMAPFolder::setMessageFlags(const std::vector <int>& nums, const int flags,
 	case message::FLAG_MODE_SET:
 	{
 		for (std::vector <IMAPMessage*>::iterator it =
-		     m_messages.begin() ; it != m_messages.end() ; ++it)
+		     msgs.begin() ; it != msgs.end() ; ++it)
 		{
-			if (std::binary_search(list.begin(), list.end(), (*it)->getNumber()) &&
-			    (*it)->m_flags != message::FLAG_UNDEFINED)
+			if ((*it)->m_flags != message::FLAG_UNDEFINED)
 			{
 				(*it)->m_flags = flags;
 			}
@@ -1318,20 +2154,60 @@ void IMAPFolder::setMessageFlags(const string& set, const int flags, const int m
 void IMAPFolder::addMessage(ref <vmime::message> msg, const int flags,
                             vmime::datetime* date, utility::progressListener* progress)
 {
-	std::ostringstream oss;
-	utility::outputStreamAdapter ossAdapter(oss);
+	std::vector <messageToAdd> msgs;
+	msgs.push_back(messageToAdd(msg, flags, date));
 
-	msg->generate(ossAdapter);
-
-	const string& str = oss.str();
-	utility::inputStreamStringAdapter strAdapter(str);
-
-	addMessage(strAdapter, str.length(), flags, date, progress);
+	addMessages(msgs, progress);
 }
 
 
 void IMAPFolder::addMessage(utility::inputStream& is, const int size, const int flags,
                             vmime::datetime* date, utility::progressListener* progress)
+{
+	std::vector <messageToAdd> msgs;
+	msgs.push_back(messageToAdd(is, size, flags, date));
+
+	addMessages(msgs, progress);
+}
+
+
+IMAPFolder::messageToAdd::messageToAdd(utility::inputStream& is, const int size,
+                                       const int flags, vmime::datetime* date)
+	: stream(&is), size(size), flags(flags), date(date)
+{
+}
+
+
+IMAPFolder::messageToAdd::messageToAdd(ref <vmime::message> msg,
+                                       const int flags, vmime::datetime* date)
+	: stream(NULL), msg(msg), size(0), flags(flags), date(date)
+{
+	const generationContext& ctx = generationContext::getDefaultContext();
+
+	if (msg->isGeneratedSizeExact(ctx))
+	{
+		size = static_cast <int>(msg->getGeneratedSize(ctx));
+	}
+	else
+	{
+		// The literal size must be known before sending data, which
+		// can be read only once: generate the message now
+		std::ostringstream oss;
+		utility::outputStreamAdapter ossAdapter(oss);
+
+		msg->generate(ctx, ossAdapter);
+
+		const string data = oss.str();
+
+		buffer = vmime::create <utility::inputStreamStringAdapter>(data);
+		stream = buffer.get();
+		size = static_cast <int>(data.length());
+	}
+}
+
+
+std::vector <message::uid> IMAPFolder::addMessages
+	(const std::vector <messageToAdd>& msgs, utility::progressListener* progress)
 {
 	ref <IMAPStore> store = m_store.acquire();
 
@@ -1342,119 +2218,261 @@ void IMAPFolder::addMessage(utility::inputStream& is, const int size, const int
 	else if (m_mode == MODE_READ_ONLY)
 		throw exceptions::illegal_state("Folder is read-only");
 
-	// Build the request text
-	std::ostringstream command;
-	command.imbue(std::locale::classic());
+	std::vector <message::uid> uids;
+
+	if (msgs.empty())
+		return uids;
+
+	// Use as few round trips as the server allows
+	const bool multiAppend = m_connection->hasCapability("MULTIAPPEND");
+	const bool literalPlus = m_connection->hasCapability("LITERAL+");
+	const bool literalMinus = m_connection->hasCapability("LITERAL-");
+
+	int total = 0;
+	int current = 0;
+
+	for (std::vector <messageToAdd>::size_type i = 0 ; i < msgs.size() ; ++i)
+		total += msgs[i].size;
+
+	if (progress)
+		progress->start(total);
+
+	const string mailbox = IMAPUtils::quoteString(IMAPUtils::pathToString
+		(m_connection->hierarchySeparator(), getFullPath()));
+
+	socket::size_type blockSize = m_connection->getSocket()->getBlockSize();
+
+	for (std::vector <messageToAdd>::size_type i = 0 ; i < msgs.size() ; ++i)
+	{
+		if (msgs[i].stream != NULL)
+		{
+			blockSize = std::min(blockSize,
+				static_cast <socket::size_type>(msgs[i].stream->getBlockSize()));
+		}
+	}
+
+	blockSize = std::max(static_cast <socket::size_type>(1), blockSize);
+
+	std::vector <char> vbuffer(blockSize);
+	char* buffer = &vbuffer.front();
+
+	for (std::vector <messageToAdd>::size_type first = 0 ; first < msgs.size() ; )
+	{
+		// With MULTIAPPEND, all messages are sent in a single command;
+		// otherwise, one APPEND command is sent for each message
+		const std::vector <messageToAdd>::size_type count = (multiAppend ? msgs.size() - first : 1);
+
+		// Build the request text
+		std::ostringstream command;
+		command.imbue(std::locale::classic());
+
+		command << "APPEND " << mailbox;
+
+		// Set while the command is being sent: if an error occurs, the
+		// server is still waiting for literal data, so the connection
+		// cannot be used anymore
+		bool inCommand = false;
+
+		try
+		{
+			for (std::vector <messageToAdd>::size_type i = first ; i < first + count ; ++i)
+			{
+				const messageToAdd& msg = msgs[i];
+
+				command << ' ';
+
+				const string flagList = IMAPUtils::messageFlagList(msg.flags);
+
+				if (msg.flags != message::FLAG_UNDEFINED && !flagList.empty())
+				{
+					command << flagList;
+					command << ' ';
+				}
+
+				if (msg.date != NULL)
+				{
+					command << IMAPUtils::dateTime(*msg.date);
+					command << ' ';
+				}
+
+				// Non-synchronizing literal: the server does not send a
+				// continuation request before accepting the message data
+				// (LITERAL- only allows this for literals up to 4096 octets)
+				const bool nonSync = literalPlus || (literalMinus && msg.size <= 4096);
+
+				command << '{' << msg.size << (nonSync ? "+" : "") << '}';
+
+				// Send the request
+				m_connection->send(i == first, command.str(), true);
+				inCommand = true;
+
+				command.str("");
+
+				if (!nonSync)
+				{
+					// Wait for the server to be ready
+					utility::auto_ptr <IMAPParser::response> resp(m_connection->readResponse());
+
+					bool ok = false;
+					const std::vector <IMAPParser::continue_req_or_response_data*>& respList
+						= resp->continue_req_or_response_data();
+
+					for (std::vector <IMAPParser::continue_req_or_response_data*>::const_iterator
+					     it = respList.begin() ; !ok && (it != respList.end()) ; ++it)
+					{
+						if ((*it)->continue_req())
+							ok = true;
+					}
+
+					if (!ok)
+					{
+						// The server has rejected the whole command
+						inCommand = false;
+
+						throw exceptions::command_error("APPEND",
+							m_connection->getParser()->lastLine(), "bad response");
+					}
+				}
+
+				// Generate the message directly to the connection
+				if (msg.stream == NULL)
+				{
+					utility::outputStreamSocketAdapter sos(*m_connection->getSocket(), /* cork */ true);
+					utility::bufferedOutputStream bos(sos);
+					// Notifications from the stream are relative to this message
+					// only, so they can be used if it is the only one
+					utility::countingOutputStream cos(bos, total,
+						msgs.size() == 1 ? progress : NULL);
+
+					msg.msg->generate(cos);
+
+					bos.flush();
+
+					if (static_cast <int>(cos.getCount()) != msg.size)
+						throw exceptions::invalid_argument();
 
-	command << "APPEND " << IMAPUtils::quoteString(IMAPUtils::pathToString
-			(m_connection->hierarchySeparator(), getFullPath())) << ' ';
+					current += msg.size;
 
-	const string flagList = IMAPUtils::messageFlagList(flags);
+					if (progress)
+						progress->progress(current, total);
 
-	if (flags != message::FLAG_UNDEFINED && !flagList.empty())
-	{
-		command << flagList;
-		command << ' ';
-	}
+					continue;
+				}
 
-	if (date != NULL)
-	{
-		command << IMAPUtils::dateTime(*date);
-		command << ' ';
-	}
+				// Send message data, as it is read from the input stream
+				utility::inputStream& is = *msg.stream;
+				int remaining = msg.size;
 
-	command << '{' << size << '}';
+				while (remaining > 0 && !is.eof())
+				{
+					const int read = static_cast <int>(is.read(buffer,
+						std::min(blockSize, static_cast <socket::size_type>(remaining))));
 
-	// Send the request
-	m_connection->send(true, command.str(), true);
+					if (read == 0)
+						break;
 
-	// Get the response
-	utility::auto_ptr <IMAPParser::response> resp(m_connection->readResponse());
+					m_connection->sendRaw(buffer, read);
 
-	bool ok = false;
-	const std::vector <IMAPParser::continue_req_or_response_data*>& respList
-		= resp->continue_req_or_response_data();
+					remaining -= read;
+					current += read;
 
-	for (std::vector <IMAPParser::continue_req_or_response_data*>::const_iterator
-	     it = respList.begin() ; !ok && (it != respList.end()) ; ++it)
-	{
-		if ((*it)->continue_req())
-			ok = true;
-	}
+					// Notify progress
+					if (progress)
+						progress->progress(current, total);
+				}
 
-	if (!ok)
-	{
-		throw exceptions::command_error("APPEND",
-			m_connection->getParser()->lastLine(), "bad response");
-	}
+				if (remaining != 0)
+				{
+					throw exceptions::invalid_argument();
+				}
+			}
 
-	// Send message data
-	const int total = size;
-	int current = 0;
+			m_connection->send(false, "", true);
+		}
+		catch (...)
+		{
+			// Close the socket without logging out, as the server would
+			// read the LOGOUT command as literal data
+			if (inCommand)
+			{
+				try
+				{
+					m_connection->getSocket()->disconnect();
+				}
+				catch (exception&)
+				{
+					// Ignore
+				}
+			}
 
-	if (progress)
-		progress->start(total);
+			throw;
+		}
 
-      const socket::size_type blockSize = std::min(is.getBlockSize(),
-		static_cast <size_t>(m_connection->getSocket()->getBlockSize()));
+		// Get the response
+		utility::auto_ptr <IMAPParser::response> finalResp(m_connection->readResponse());
 
-	std::vector <char> vbuffer(blockSize);
-	char* buffer = &vbuffer.front();
+		if (finalResp->isBad() || finalResp->response_done()->response_tagged()->
+			resp_cond_state()->status() != IMAPParser::resp_cond_state::OK)
+		{
+			throw exceptions::command_error("APPEND",
+				m_connection->getParser()->lastLine(), "bad response");
+		}
 
-	while (!is.eof())
-	{
-		// Read some data from the input stream
-		const int read = is.read(buffer, sizeof(buffer));
-		current += read;
+		// Get the UIDs of the new messages (UIDPLUS)
+		std::vector <unsigned int> newUIDs;
+		unsigned int uidValidity = 0;
 
-		// Put read data into socket output stream
-		m_connection->sendRaw(buffer, read);
+		const IMAPParser::resp_text_code* code = finalResp->response_done()->
+			response_tagged()->resp_cond_state()->resp_text()->resp_text_code();
 
-		// Notify progress
-		if (progress)
-			progress->progress(current, total);
-	}
+		if (code && code->type() == IMAPParser::resp_text_code::APPENDUID)
+		{
+			uidValidity = code->nz_number()->value();
 
-	m_connection->send(false, "", true);
+			// Check the number of UIDs before expanding the set, as a
+			// (broken) server may send a very large range
+			const std::vector <std::pair <unsigned int, unsigned int> > ranges =
+				IMAPUtils::setToRanges(code->uid_set()->value());
 
-	if (progress)
-		progress->stop(total);
+			std::vector <messageToAdd>::size_type uidCount = 0;
 
-	// Get the response
-	utility::auto_ptr <IMAPParser::response> finalResp(m_connection->readResponse());
+			for (std::vector <std::pair <unsigned int, unsigned int> >::const_iterator
+			     rt = ranges.begin() ; rt != ranges.end() && uidCount <= count ; ++rt)
+			{
+				uidCount += (*rt).second - (*rt).first + 1;
+			}
 
-	if (finalResp->isBad() || finalResp->response_done()->response_tagged()->
-		resp_cond_state()->status() != IMAPParser::resp_cond_state::OK)
-	{
-		throw exceptions::command_error("APPEND",
-			m_connection->getParser()->lastLine(), "bad response");
+			if (uidCount == count)
+				newUIDs = IMAPUtils::setToList(code->uid_set()->value());
+		}
+
+		for (std::vector <messageToAdd>::size_type i = 0 ; i < count ; ++i)
+		{
+			if (newUIDs.size() == count)
+				uids.push_back(IMAPUtils::makeGlobalUID(uidValidity, newUIDs[i]));
+			else
+				uids.push_back(message::uid());
+		}
+
+		first += count;
 	}
 
-	// Notify message added
+	if (progress)
+		progress->stop(total);
+
+	// Notify messages added
 	std::vector <int> nums;
-	nums.push_back(m_messageCount + 1);
+
+	for (std::vector <messageToAdd>::size_type i = 0 ; i < msgs.size() ; ++i)
+		nums.push_back(m_messageCount + 1 + static_cast <int>(i));
 
 	events::messageCountEvent event
 		(thisRef().dynamicCast <folder>(),
 		 events::messageCountEvent::TYPE_ADDED, nums);
 
-	m_messageCount++;
-	notifyMessageCount(event);
-
-	// Notify folders with the same path
-	for (std::list <IMAPFolder*>::iterator it = store->m_folders.begin() ;
-	     it != store->m_folders.end() ; ++it)
-	{
-		if ((*it) != this && (*it)->getFullPath() == m_path)
-		{
-			events::messageCountEvent event
-				((*it)->thisRef().dynamicCast <folder>(),
-				 events::messageCountEvent::TYPE_ADDED, nums);
+	notifyFolders(m_path, event, -1);
 
-			(*it)->m_messageCount++;
-			(*it)->notifyMessageCount(event);
-		}
-	}
+	return uids;
 }
 
 
@@ -1497,6 +2515,18 @@ void IMAPFolder::expunge()
 				m_connection->getParser()->lastLine(), "invalid response");
 		}
 
+		// When QRESYNC is enabled, the server sends VANISHED instead
+		// of EXPUNGE responses
+		const IMAPParser::mailbox_data* mailboxData =
+			(*it)->response_data()->mailbox_data();
+
+		if (mailboxData != NULL &&
+		    mailboxData->type() == IMAPParser::mailbox_data::VANISHED)
+		{
+			processStatusUpdate((*it)->response_data());
+			continue;
+		}
+
 		const IMAPParser::message_data* messageData =
 			(*it)->response_data()->message_data();
 
@@ -1511,16 +2541,12 @@ void IMAPFolder::expunge()
 
 		nums.push_back(number);
 
-		for (std::vector <IMAPMessage*>::iterator jt =
-		     m_messages.begin() ; jt != m_messages.end() ; ++jt)
-		{
-			if ((*jt)->m_num == number)
-				(*jt)->m_expunged = true;
-			else if ((*jt)->m_num > number)
-				(*jt)->m_num--;
-		}
+		m_messages.expunge(number);
 	}
 
+	if (nums.empty())
+		return;
+
 	m_messageCount -= nums.size();
 
 	// Notify message expunged
@@ -1528,23 +2554,7 @@ void IMAPFolder::expunge()
 		(thisRef().dynamicCast <folder>(),
 		 events::messageCountEvent::TYPE_REMOVED, nums);
 
-	notifyMessageCount(event);
-
-	// Notify folders with the same path
-	for (std::list <IMAPFolder*>::iterator it = store->m_folders.begin() ;
-	     it != store->m_folders.end() ; ++it)
-	{
-		if ((*it) != this && (*it)->getFullPath() == m_path)
-		{
-			(*it)->m_messageCount = m_messageCount;
-
-			events::messageCountEvent event
-				((*it)->thisRef().dynamicCast <folder>(),
-				 events::messageCountEvent::TYPE_REMOVED, nums);
-
-			(*it)->notifyMessageCount(event);
-		}
-	}
+	notifyFolders(m_path, event, m_messageCount);
 }
 
 
@@ -1597,8 +2607,11 @@ void IMAPFolder::rename(const folder::path& newPath)
 	notifyFolder(event);
 
 	// Notify folders with the same path and sub-folders
-	for (std::list <IMAPFolder*>::iterator it = store->m_folders.begin() ;
-	     it != store->m_folders.end() ; ++it)
+	std::vector <ref <IMAPFolder> > folders;
+	store->getFolders(folders);
+
+	for (std::vector <ref <IMAPFolder> >::iterator it = folders.begin() ;
+	     it != folders.end() ; ++it)
 	{
 		if ((*it) != this && (*it)->getFullPath() == oldPath)
 		{
@@ -1649,19 +2662,11 @@ void IMAPFolder::copyMessage(const folder::path& dest, const int num)
 	std::vector <int> nums;
 	nums.push_back(num);
 
-	for (std::list <IMAPFolder*>::iterator it = store->m_folders.begin() ;
-	     it != store->m_folders.end() ; ++it)
-	{
-		if ((*it)->getFullPath() == dest)
-		{
-			events::messageCountEvent event
-				((*it)->thisRef().dynamicCast <folder>(),
-				 events::messageCountEvent::TYPE_ADDED, nums);
+	events::messageCountEvent event
+		(thisRef().dynamicCast <folder>(),
+		 events::messageCountEvent::TYPE_ADDED, nums);
 
-			(*it)->m_messageCount++;
-			(*it)->notifyMessageCount(event);
-		}
-	}
+	notifyFolders(dest, event, -1);
 }
 
 
@@ -1680,93 +2685,282 @@ void IMAPFolder::copyMessages(const folder::path& dest, const int from, const in
 	std::ostringstream set;
 	set.imbue(std::locale::classic());
 
-	if (to == -1)
-		set << from << ":*";
-	else
-		set << from << ":" << to;
+	if (to == -1)
+		set << from << ":*";
+	else
+		set << from << ":" << to;
+
+	// Delegate message copy
+	copyMessages(set.str(), dest);
+
+	// Notify message count changed
+	const int to2 = (to == -1) ? m_messageCount : to;
+	const int count = to2 - from + 1;
+
+	std::vector <int> nums;
+	nums.resize(count);
+
+	for (int i = from, j = 0 ; i <= to2 ; ++i, ++j)
+		nums[j] = i;
+
+	events::messageCountEvent event
+		(thisRef().dynamicCast <folder>(),
+		 events::messageCountEvent::TYPE_ADDED, nums);
+
+	notifyFolders(dest, event, -1);
+}
+
+
+void IMAPFolder::copyMessages(const folder::path& dest, const std::vector <int>& nums)
+{
+	ref <IMAPStore> store = m_store.acquire();
+
+	if (!store)
+		throw exceptions::illegal_state("Store disconnected");
+	else if (!isOpen())
+		throw exceptions::illegal_state("Folder not open");
+
+	// Delegate message copy
+	copyMessages(IMAPUtils::listToSet(nums, m_messageCount), dest);
+
+	// Notify message count changed
+	events::messageCountEvent event
+		(thisRef().dynamicCast <folder>(),
+		 events::messageCountEvent::TYPE_ADDED, nums);
+
+	notifyFolders(dest, event, -1);
+}
+
+
+void IMAPFolder::copyMessages(const string& set, const folder::path& dest)
+{
+	// Build the request text
+	std::ostringstream command;
+	command.imbue(std::locale::classic());
+
+	command << "COPY " << set << " ";
+	command << IMAPUtils::quoteString(IMAPUtils::pathToString
+			(m_connection->hierarchySeparator(), dest));
+
+	// Send the request
+	m_connection->send(true, command.str(), true);
+
+	// Get the response
+	utility::auto_ptr <IMAPParser::response> resp(m_connection->readResponse());
+
+	if (resp->isBad() || resp->response_done()->response_tagged()->
+		resp_cond_state()->status() != IMAPParser::resp_cond_state::OK)
+	{
+		throw exceptions::command_error("COPY",
+			m_connection->getParser()->lastLine(), "bad response");
+	}
+}
+
+
+void IMAPFolder::moveMessage(const folder::path& dest, const int num)
+{
+	std::vector <int> nums;
+	nums.push_back(num);
+
+	moveMessages(dest, nums);
+}
+
+
+void IMAPFolder::moveMessages(const folder::path& dest, const int from, const int to)
+{
+	if (from < 1 || (to < from && to != -1))
+		throw exceptions::invalid_argument();
+
+	const int to2 = (to == -1) ? m_messageCount : to;
+
+	std::vector <int> nums;
+
+	for (int i = from ; i <= to2 ; ++i)
+		nums.push_back(i);
+
+	moveMessages(dest, nums);
+}
+
+
+void IMAPFolder::moveMessages(const folder::path& dest, const std::vector <int>& nums)
+{
+	ref <IMAPStore> store = m_store.acquire();
+
+	if (nums.empty())
+		throw exceptions::invalid_argument();
+
+	if (!store)
+		throw exceptions::illegal_state("Store disconnected");
+	else if (!isOpen())
+		throw exceptions::illegal_state("Folder not open");
+	else if (m_mode == MODE_READ_ONLY)
+		throw exceptions::illegal_state("Folder is read-only");
+
+	// Sort the list of message numbers
+	std::vector <int> list;
+
+	list.resize(nums.size());
+	std::copy(nums.begin(), nums.end(), list.begin());
+
+	std::sort(list.begin(), list.end());
+	list.erase(std::unique(list.begin(), list.end()), list.end());
+
+	const string set = IMAPUtils::listToSet(list, m_messageCount, true);
+	const string destName = IMAPUtils::quoteString(IMAPUtils::pathToString
+		(m_connection->hierarchySeparator(), dest));
+
+	if (m_connection->hasCapability("MOVE"))
+	{
+		// Eg. C: a005 MOVE 2:4 foo
+		//     S: * OK [COPYUID 432432 42:44 10:12] Moved
+		//     S: * 4 EXPUNGE
+		//     S: * 3 EXPUNGE
+		//     S: * 2 EXPUNGE
+		//     S: a005 OK Done
+		std::ostringstream command;
+		command.imbue(std::locale::classic());
+
+		command << "MOVE " << set << " " << destName;
+
+		m_connection->send(true, command.str(), true);
+
+		utility::auto_ptr <IMAPParser::response> resp(m_connection->readResponse());
+
+		if (resp->isBad() || resp->response_done()->response_tagged()->
+			resp_cond_state()->status() != IMAPParser::resp_cond_state::OK)
+		{
+			throw exceptions::command_error("MOVE",
+				m_connection->getParser()->lastLine(), "bad response");
+		}
+
+		// Renumber the remaining messages
+		processStatusUpdate(resp);
+	}
+	else
+	{
+		const bool uidPlus = m_connection->hasCapability("UIDPLUS");
+
+		std::ostringstream command;
+		command.imbue(std::locale::classic());
+
+		std::vector <message::uid> uids;
+
+		// With UIDPLUS, get the UIDs of the messages before copying them:
+		// nothing must have been copied if they cannot be expunged
+		if (uidPlus)
+		{
+			m_connection->send(true, "FETCH " + set + " (UID)", true);
+
+			utility::auto_ptr <IMAPParser::response> fetchResp(m_connection->readResponse());
+
+			if (fetchResp->isBad() || fetchResp->response_done()->response_tagged()->
+				resp_cond_state()->status() != IMAPParser::resp_cond_state::OK)
+			{
+				throw exceptions::command_error("FETCH",
+					m_connection->getParser()->lastLine(), "bad response");
+			}
+
+			const std::vector <IMAPParser::continue_req_or_response_data*>& respDataList =
+				fetchResp->continue_req_or_response_data();
+
+			for (std::vector <IMAPParser::continue_req_or_response_data*>::const_iterator
+			     it = respDataList.begin() ; it != respDataList.end() ; ++it)
+			{
+				if ((*it)->response_data() == NULL)
+					continue;
+
+				const IMAPParser::message_data* messageData =
+					(*it)->response_data()->message_data();
+
+				// Ignore unsolicited FETCH responses for other messages
+				if (messageData == NULL || messageData->type() != IMAPParser::message_data::FETCH ||
+				    !std::binary_search(list.begin(), list.end(), static_cast <int>(messageData->number())))
+				{
+					continue;
+				}
+
+				const std::vector <IMAPParser::msg_att_item*> atts =
+					messageData->msg_att()->items();
+
+				for (std::vector <IMAPParser::msg_att_item*>::const_iterator
+				     jt = atts.begin() ; jt != atts.end() ; ++jt)
+				{
+					if ((*jt)->type() == IMAPParser::msg_att_item::UID)
+					{
+						uids.push_back(IMAPUtils::makeGlobalUID
+							(m_uidValidity, (*jt)->unique_id()->value()));
+					}
+				}
+			}
+
+			// A plain EXPUNGE would also remove the other messages marked
+			// as deleted: leave the source messages untouched instead
+			std::sort(uids.begin(), uids.end());
+			uids.erase(std::unique(uids.begin(), uids.end()), uids.end());
 
-	// Delegate message copy
-	copyMessages(set.str(), dest);
+			if (uids.size() != list.size())
+			{
+				throw exceptions::command_error("FETCH",
+					m_connection->getParser()->lastLine(), "missing UIDs");
+			}
+		}
 
-	// Notify message count changed
-	const int to2 = (to == -1) ? m_messageCount : to;
-	const int count = to - from + 1;
+		// Copy the messages
+		command << "COPY " << set << " " << destName;
 
-	std::vector <int> nums;
-	nums.resize(count);
+		m_connection->send(true, command.str(), true);
 
-	for (int i = from, j = 0 ; i <= to2 ; ++i, ++j)
-		nums[j] = i;
+		utility::auto_ptr <IMAPParser::response> copyResp(m_connection->readResponse());
 
-	for (std::list <IMAPFolder*>::iterator it = store->m_folders.begin() ;
-	     it != store->m_folders.end() ; ++it)
-	{
-		if ((*it)->getFullPath() == dest)
+		if (copyResp->isBad() || copyResp->response_done()->response_tagged()->
+			resp_cond_state()->status() != IMAPParser::resp_cond_state::OK)
 		{
-			events::messageCountEvent event
-				((*it)->thisRef().dynamicCast <folder>(),
-				 events::messageCountEvent::TYPE_ADDED, nums);
-
-			(*it)->m_messageCount += count;
-			(*it)->notifyMessageCount(event);
+			throw exceptions::command_error("COPY",
+				m_connection->getParser()->lastLine(), "bad response");
 		}
-	}
-}
-
 
-void IMAPFolder::copyMessages(const folder::path& dest, const std::vector <int>& nums)
-{
-	ref <IMAPStore> store = m_store.acquire();
+		// Mark the messages as deleted
+		command.str("");
+		command << "STORE " << set << " +FLAGS.SILENT (\\Deleted)";
 
-	if (!store)
-		throw exceptions::illegal_state("Store disconnected");
-	else if (!isOpen())
-		throw exceptions::illegal_state("Folder not open");
+		m_connection->send(true, command.str(), true);
 
-	// Delegate message copy
-	copyMessages(IMAPUtils::listToSet(nums, m_messageCount), dest);
+		utility::auto_ptr <IMAPParser::response> storeResp(m_connection->readResponse());
 
-	// Notify message count changed
-	const int count = nums.size();
+		processStatusUpdate(storeResp);
 
-	for (std::list <IMAPFolder*>::iterator it = store->m_folders.begin() ;
-	     it != store->m_folders.end() ; ++it)
-	{
-		if ((*it)->getFullPath() == dest)
+		if (storeResp->isBad() || storeResp->response_done()->response_tagged()->
+			resp_cond_state()->status() != IMAPParser::resp_cond_state::OK)
 		{
-			events::messageCountEvent event
-				((*it)->thisRef().dynamicCast <folder>(),
-				 events::messageCountEvent::TYPE_ADDED, nums);
-
-			(*it)->m_messageCount += count;
-			(*it)->notifyMessageCount(event);
+			throw exceptions::command_error("STORE",
+				m_connection->getParser()->lastLine(), "bad response");
 		}
-	}
-}
 
+		// Expunge them, only if they all have been marked
+		if (uidPlus)
+			m_connection->send(true, "UID EXPUNGE " + IMAPUtils::listToSet(uids), true);
+		else
+			m_connection->send(true, "EXPUNGE", true);
 
-void IMAPFolder::copyMessages(const string& set, const folder::path& dest)
-{
-	// Build the request text
-	std::ostringstream command;
-	command.imbue(std::locale::classic());
+		utility::auto_ptr <IMAPParser::response> expungeResp(m_connection->readResponse());
 
-	command << "COPY " << set << " ";
-	command << IMAPUtils::quoteString(IMAPUtils::pathToString
-			(m_connection->hierarchySeparator(), dest));
+		// Renumber the remaining messages
+		processStatusUpdate(expungeResp);
 
-	// Send the request
-	m_connection->send(true, command.str(), true);
+		if (expungeResp->isBad() || expungeResp->response_done()->response_tagged()->
+			resp_cond_state()->status() != IMAPParser::resp_cond_state::OK)
+		{
+			throw exceptions::command_error(uidPlus ? "UID EXPUNGE" : "EXPUNGE",
+				m_connection->getParser()->lastLine(), "bad response");
+		}
+	}
 
-	// Get the response
-	utility::auto_ptr <IMAPParser::response> resp(m_connection->readResponse());
+	// Notify message count changed
+	events::messageCountEvent event
+		(thisRef().dynamicCast <folder>(),
+		 events::messageCountEvent::TYPE_ADDED, list);
 
-	if (resp->isBad() || resp->response_done()->response_tagged()->
-		resp_cond_state()->status() != IMAPParser::resp_cond_state::OK)
-	{
-		throw exceptions::command_error("COPY",
-			m_connection->getParser()->lastLine(), "bad response");
-	}
+	notifyFolders(dest, event, -1);
 }
 
 
@@ -1777,70 +2971,84 @@ void IMAPFolder::status(int& count, int& unseen)
 	count = 0;
 	unseen = 0;
 
-	// Build the request text
-	std::ostringstream command;
-	command.imbue(std::locale::classic());
-
-	command << "STATUS ";
-	command << IMAPUtils::quoteString(IMAPUtils::pathToString
-			(m_connection->hierarchySeparator(), getFullPath()));
-	command << " (MESSAGES UNSEEN)";
+	// Use a pooled connection if the folder is not open, so that the
+	// store connection stays available for other commands
+	ref <IMAPConnection> cnt = acquireCommandConnection();
 
-	// Send the request
-	m_connection->send(true, command.str(), true);
+	try
+	{
+		// Build the request text
+		std::ostringstream command;
+		command.imbue(std::locale::classic());
 
-	// Get the response
-	utility::auto_ptr <IMAPParser::response> resp(m_connection->readResponse());
+		command << "STATUS ";
+		command << IMAPUtils::quoteString(IMAPUtils::pathToString
+				(cnt->hierarchySeparator(), getFullPath()));
+		command << " (MESSAGES UNSEEN)";
 
-	if (resp->isBad() || resp->response_done()->response_tagged()->
-		resp_cond_state()->status() != IMAPParser::resp_cond_state::OK)
-	{
-		throw exceptions::command_error("STATUS",
-			m_connection->getParser()->lastLine(), "bad response");
-	}
+		// Send the request
+		cnt->send(true, command.str(), true);
 
-	const std::vector <IMAPParser::continue_req_or_response_data*>& respDataList =
-		resp->continue_req_or_response_data();
+		// Get the response
+		utility::auto_ptr <IMAPParser::response> resp(cnt->readResponse());
 
-	for (std::vector <IMAPParser::continue_req_or_response_data*>::const_iterator
-	     it = respDataList.begin() ; it != respDataList.end() ; ++it)
-	{
-		if ((*it)->response_data() == NULL)
+		if (resp->isBad() || resp->response_done()->response_tagged()->
+			resp_cond_state()->status() != IMAPParser::resp_cond_state::OK)
 		{
 			throw exceptions::command_error("STATUS",
-				m_connection->getParser()->lastLine(), "invalid response");
+				cnt->getParser()->lastLine(), "bad response");
 		}
 
-		const IMAPParser::response_data* responseData = (*it)->response_data();
+		const std::vector <IMAPParser::continue_req_or_response_data*>& respDataList =
+			resp->continue_req_or_response_data();
 
-		if (responseData->mailbox_data() &&
-			responseData->mailbox_data()->type() == IMAPParser::mailbox_data::STATUS)
+		for (std::vector <IMAPParser::continue_req_or_response_data*>::const_iterator
+		     it = respDataList.begin() ; it != respDataList.end() ; ++it)
 		{
-			const std::vector <IMAPParser::status_info*>& statusList =
-				responseData->mailbox_data()->status_info_list();
+			if ((*it)->response_data() == NULL)
+			{
+				throw exceptions::command_error("STATUS",
+					cnt->getParser()->lastLine(), "invalid response");
+			}
+
+			const IMAPParser::response_data* responseData = (*it)->response_data();
 
-			for (std::vector <IMAPParser::status_info*>::const_iterator
-			     jt = statusList.begin() ; jt != statusList.end() ; ++jt)
+			if (responseData->mailbox_data() &&
+				responseData->mailbox_data()->type() == IMAPParser::mailbox_data::STATUS)
 			{
-				switch ((*jt)->status_att()->type())
+				const std::vector <IMAPParser::status_info*>& statusList =
+					responseData->mailbox_data()->status_info_list();
+
+				for (std::vector <IMAPParser::status_info*>::const_iterator
+				     jt = statusList.begin() ; jt != statusList.end() ; ++jt)
 				{
-				case IMAPParser::status_att::MESSAGES:
+					switch ((*jt)->status_att()->type())
+					{
+					case IMAPParser::status_att::MESSAGES:
 
-					count = (*jt)->number()->value();
-					break;
+						count = (*jt)->number()->value();
+						break;
 
-				case IMAPParser::status_att::UNSEEN:
+					case IMAPParser::status_att::UNSEEN:
 
-					unseen = (*jt)->number()->value();
-					break;
+						unseen = (*jt)->number()->value();
+						break;
 
-				default:
+					default:
 
-					break;
+						break;
+					}
 				}
 			}
 		}
 	}
+	catch (std::exception&)
+	{
+		releaseCommandConnection(cnt);
+		throw;
+	}
+
+	releaseCommandConnection(cnt);
 
 	// Notify message count changed (new messages)
 	if (m_messageCount != count)
@@ -1861,23 +3069,7 @@ void IMAPFolder::status(int& count, int& unseen)
 				(thisRef().dynamicCast <folder>(),
 				 events::messageCountEvent::TYPE_ADDED, nums);
 
-			notifyMessageCount(event);
-
-			// Notify folders with the same path
-			for (std::list <IMAPFolder*>::iterator it = store->m_folders.begin() ;
-			     it != store->m_folders.end() ; ++it)
-			{
-				if ((*it) != this && (*it)->getFullPath() == m_path)
-				{
-					(*it)->m_messageCount = count;
-
-					events::messageCountEvent event
-						((*it)->thisRef().dynamicCast <folder>(),
-						 events::messageCountEvent::TYPE_ADDED, nums);
-
-					(*it)->notifyMessageCount(event);
-				}
-			}
+			notifyFolders(m_path, event, m_messageCount);
 		}
 	}
 }
@@ -1939,6 +3131,223 @@ std::vector <int> IMAPFolder::getMessageNumbersStartingOnUID(const message::uid&
 }
 
 
+const searchResult IMAPFolder::search(ref <const searchCriteria> criteria, const int options)
+{
+	return searchImpl(criteria, options, false);
+}
+
+
+const searchResult IMAPFolder::searchUIDs(ref <const searchCriteria> criteria, const int options)
+{
+	return searchImpl(criteria, options, true);
+}
+
+
+const searchResult IMAPFolder::searchImpl
+	(ref <const searchCriteria> criteria, const int options, const bool uid)
+{
+	ref <IMAPStore> store = m_store.acquire();
+
+	if (!store)
+		throw exceptions::illegal_state("Store disconnected");
+	else if (!isOpen())
+		throw exceptions::illegal_state("Folder not open");
+
+	std::vector <string> parts;
+	IMAPUtils::buildSearchKeys(*criteria, parts);
+
+	// Strings containing 8-bit characters are sent in UTF-8
+	bool utf8 = false;
+
+	for (std::vector <string>::size_type i = 1 ; !utf8 && i < parts.size() ; i += 2)
+	{
+		for (string::const_iterator it = parts[i].begin() ; !utf8 && it != parts[i].end() ; ++it)
+			utf8 = (static_cast <unsigned char>(*it) >= 0x80);
+	}
+
+	const bool esearch = m_connection->hasCapability("ESEARCH");
+	const bool literalPlus = m_connection->hasCapability("LITERAL+");
+	const bool literalMinus = m_connection->hasCapability("LITERAL-");
+
+	// Build the request text
+	std::ostringstream command;
+	command.imbue(std::locale::classic());
+
+	if (uid)
+		command << "UID ";
+
+	command << "SEARCH";
+
+	int returnOptions = options;
+
+	if (esearch)
+	{
+		// An empty RETURN list is equivalent to "RETURN (ALL)"
+		if ((returnOptions & (searchResult::RETURN_MIN | searchResult::RETURN_MAX |
+		                      searchResult::RETURN_COUNT | searchResult::RETURN_ALL)) == 0)
+		{
+			returnOptions = searchResult::RETURN_ALL;
+		}
+
+		std::vector <string> items;
+
+		if (returnOptions & searchResult::RETURN_MIN) items.push_back("MIN");
+		if (returnOptions & searchResult::RETURN_MAX) items.push_back("MAX");
+		if (returnOptions & searchResult::RETURN_COUNT) items.push_back("COUNT");
+		if (returnOptions & searchResult::RETURN_ALL) items.push_back("ALL");
+
+		command << " RETURN (";
+
+		for (std::vector <string>::size_type i = 0 ; i < items.size() ; ++i)
+		{
+			if (i != 0)
+				command << ' ';
+
+			command << items[i];
+		}
+
+		command << ')';
+	}
+
+	if (utf8)
+		command << " CHARSET UTF-8";
+
+	command << ' ';
+
+	// Send the request, and the strings which must be sent as literals
+	bool first = true;
+
+	for (std::vector <string>::size_type i = 0 ; i < parts.size() ; i += 2)
+	{
+		command << parts[i];
+
+		if (i + 1 == parts.size())
+			break;
+
+		const string& literal = parts[i + 1];
+		const bool nonSync = literalPlus || (literalMinus && literal.length() <= 4096);
+
+		command << '{' << literal.length() << (nonSync ? "+" : "") << '}';
+
+		m_connection->send(first, command.str(), true);
+
+		first = false;
+		command.str("");
+
+		if (!nonSync)
+		{
+			// Wait for the server to be ready
+			utility::auto_ptr <IMAPParser::response> resp(m_connection->readResponse());
+
+			bool ok = false;
+			const std::vector <IMAPParser::continue_req_or_response_data*>& respList
+				= resp->continue_req_or_response_data();
+
+			for (std::vector <IMAPParser::continue_req_or_response_data*>::const_iterator
+			     it = respList.begin() ; !ok && (it != respList.end()) ; ++it)
+			{
+				if ((*it)->continue_req())
+					ok = true;
+			}
+
+			if (!ok)
+			{
+				throw exceptions::command_error("SEARCH",
+					m_connection->getParser()->lastLine(), "bad response");
+			}
+		}
+
+		m_connection->sendRaw(literal.data(), static_cast <int>(literal.length()));
+	}
+
+	m_connection->send(first, command.str(), true);
+
+	// Get the response
+	utility::auto_ptr <IMAPParser::response> resp(m_connection->readResponse());
+
+	if (resp->isBad() ||
+	    resp->response_done()->response_tagged()->resp_cond_state()->status() != IMAPParser::resp_cond_state::OK)
+	{
+		throw exceptions::command_error("SEARCH",
+			m_connection->getParser()->lastLine(), "bad response");
+	}
+
+	searchResult result;
+	std::vector <unsigned int> numbers;
+
+	const std::vector <IMAPParser::continue_req_or_response_data*>& respDataList =
+		resp->continue_req_or_response_data();
+
+	for (std::vector <IMAPParser::continue_req_or_response_data*>::const_iterator
+	     it = respDataList.begin() ; it != respDataList.end() ; ++it)
+	{
+		if ((*it)->response_data() == NULL)
+		{
+			throw exceptions::command_error("SEARCH",
+				m_connection->getParser()->lastLine(), "invalid response");
+		}
+
+		const IMAPParser::mailbox_data* mailboxData =
+			(*it)->response_data()->mailbox_data();
+
+		if (mailboxData == NULL)
+		{
+			processStatusUpdate((*it)->response_data());
+		}
+		// "* SEARCH 2 5 6"
+		else if (mailboxData->type() == IMAPParser::mailbox_data::SEARCH)
+		{
+			for (std::vector <IMAPParser::nz_number*>::const_iterator
+			     nit = mailboxData->search_nz_number_list().begin() ;
+			     nit != mailboxData->search_nz_number_list().end() ; ++nit)
+			{
+				numbers.push_back((*nit)->value());
+			}
+		}
+		// "* ESEARCH (TAG "a1") [UID] MIN 2 MAX 6 COUNT 3 ALL 2,5:6"
+		else if (mailboxData->type() == IMAPParser::mailbox_data::ESEARCH)
+		{
+			if (mailboxData->sequence_set())
+				result.setSet(mailboxData->sequence_set()->value());
+
+			if (mailboxData->esearch_min())
+				result.setMin(mailboxData->esearch_min()->value());
+
+			if (mailboxData->esearch_max())
+				result.setMax(mailboxData->esearch_max()->value());
+
+			if (mailboxData->esearch_count())
+				result.setCount(mailboxData->esearch_count()->value());
+		}
+		else
+		{
+			processStatusUpdate((*it)->response_data());
+		}
+	}
+
+	if (esearch)
+	{
+		// Items which are not returned by the server have no value
+		// (eg. MIN and MAX when nothing matched)
+		result.setReturnOptions(returnOptions);
+	}
+	else
+	{
+		// Plain SEARCH: compute the result locally
+		std::sort(numbers.begin(), numbers.end());
+		numbers.erase(std::unique(numbers.begin(), numbers.end()), numbers.end());
+
+		for (std::vector <unsigned int>::const_iterator it = numbers.begin() ; it != numbers.end() ; ++it)
+			result.appendNumber(*it);
+
+		result.setReturnOptions(searchResult::RETURN_MIN | searchResult::RETURN_MAX |
+			searchResult::RETURN_COUNT | searchResult::RETURN_ALL);
+	}
+
+	return result;
+}
+
+
 } // imap
 } // net
 } // vmime
@@ -36,9 +36,12 @@
 #include "vmime/net/imap/IMAPStructure.hpp"
 #include "vmime/net/imap/IMAPPart.hpp"
 #include "vmime/net/imap/IMAPMessagePartContentHandler.hpp"
+#include "vmime/net/imap/IMAPContentCache.hpp"
 
 #include "vmime/utility/outputStreamAdapter.hpp"
+#include "vmime/utility/countingOutputStream.hpp"
 
+#include <algorithm>
 #include <sstream>
 #include <iterator>
 #include <typeinfo>
@@ -72,6 +75,7 @@ public:
 				<const IMAPParser::msg_att_item&>(comp).type();
 
 			if (type == IMAPParser::msg_att_item::BODY_SECTION ||
+			    type == IMAPParser::msg_att_item::BINARY_SECTION ||
 			    type == IMAPParser::msg_att_item::RFC822_TEXT)
 			{
 				return new targetStream(m_progress, m_os);
@@ -97,7 +101,7 @@ private:
 
 
 IMAPMessage::IMAPMessage(ref <IMAPFolder> folder, const int num)
-	: m_folder(folder), m_num(num), m_size(-1), m_flags(FLAG_UNDEFINED),
+	: m_folder(folder), m_num(num), m_slot(0), m_size(-1), m_flags(FLAG_UNDEFINED),
 	  m_expunged(false), m_structure(NULL)
 {
 	folder->registerMessage(this);
@@ -105,7 +109,7 @@ IMAPMessage::IMAPMessage(ref <IMAPFolder> folder, const int num)
 
 
 IMAPMessage::IMAPMessage(ref <IMAPFolder> folder, const int num, const uid& uniqueId)
-	: m_folder(folder), m_num(num), m_size(-1), m_flags(FLAG_UNDEFINED),
+	: m_folder(folder), m_num(num), m_slot(0), m_size(-1), m_flags(FLAG_UNDEFINED),
 	  m_expunged(false), m_uid(uniqueId), m_structure(NULL)
 {
 	folder->registerMessage(this);
@@ -123,12 +127,21 @@ IMAPMessage::~IMAPMessage()
 
 void IMAPMessage::onFolderClosed()
 {
+	// Keep the last known number
+	m_num = getNumber();
+	m_expunged = isExpunged();
+
 	m_folder = NULL;
 }
 
 
 int IMAPMessage::getNumber() const
 {
+	ref <const IMAPFolder> folder = m_folder.acquire();
+
+	if (folder && m_slot != 0)
+		return folder->m_messages.getNumber(m_slot);
+
 	return (m_num);
 }
 
@@ -150,6 +163,11 @@ int IMAPMessage::getSize() const
 
 bool IMAPMessage::isExpunged() const
 {
+	ref <const IMAPFolder> folder = m_folder.acquire();
+
+	if (folder && m_slot != 0)
+		return folder->m_messages.isExpunged(m_slot);
+
 	return (m_expunged);
 }
 
@@ -163,6 +181,12 @@ int IMAPMessage::getFlags() const
 }
 
 
+const string IMAPMessage::getModSequence() const
+{
+	return (m_modseq);
+}
+
+
 ref <const structure> IMAPMessage::getStructure() const
 {
 	if (m_structure == NULL)
@@ -254,7 +278,32 @@ void IMAPMessage::extractImpl(ref <const part> p, utility::outputStream& os,
 
 	IMAPMessage_literalHandler literalHandler(os, progress);
 
-	// Construct section identifier
+	// Send the request
+	folder.constCast <IMAPFolder>()->m_connection->send
+		(true, makeExtractRequest(p, start, length, extractFlags), true);
+
+	// Get the response
+	utility::auto_ptr <IMAPParser::response> resp
+		(folder.constCast <IMAPFolder>()->m_connection->readResponse(&literalHandler));
+
+	if (resp->isBad() || resp->response_done()->response_tagged()->
+		resp_cond_state()->status() != IMAPParser::resp_cond_state::OK)
+	{
+		throw exceptions::command_error("FETCH",
+			folder.constCast <IMAPFolder>()->m_connection->getParser()->lastLine(), "bad response");
+	}
+
+
+	if (extractFlags & EXTRACT_BODY)
+	{
+		// TODO: update the flags (eg. flag "\Seen" may have been set)
+	}
+}
+
+
+// static
+const string IMAPMessage::makeSection(ref <const part> p)
+{
 	std::ostringstream section;
 	section.imbue(std::locale::classic());
 
@@ -281,14 +330,164 @@ void IMAPMessage::extractImpl(ref <const part> p, utility::outputStream& os,
 		}
 	}
 
+	return section.str();
+}
+
+
+void IMAPMessage::extractPartContents(ref <const part> p, utility::outputStream& os,
+	utility::progressListener* progress) const
+{
+	extractPartContentsImpl(p, os, progress, EXTRACT_BODY);
+}
+
+
+bool IMAPMessage::extractDecodedPartContents(ref <const part> p, utility::outputStream& os,
+	utility::progressListener* progress) const
+{
+	ref <const IMAPFolder> folder = m_folder.acquire();
+
+	if (!folder)
+		throw exceptions::folder_not_found();
+
+	if (!folder.constCast <IMAPFolder>()->m_connection->hasCapability("BINARY"))
+		return false;
+
+	try
+	{
+		extractPartContentsImpl(p, os, progress, EXTRACT_BODY | EXTRACT_BINARY);
+	}
+	catch (exceptions::command_error&)
+	{
+		// The server cannot decode this part (eg. "NO [UNKNOWN-CTE]"):
+		// no data has been sent, the caller will decode it
+		return false;
+	}
+
+	return true;
+}
+
+
+int IMAPMessage::getDecodedPartSize(ref <const part> p) const
+{
+	ref <const IMAPFolder> folder = m_folder.acquire();
+
+	if (!folder)
+		throw exceptions::folder_not_found();
+
+	ref <IMAPConnection> cnt = folder.constCast <IMAPFolder>()->m_connection;
+
+	if (!cnt->hasCapability("BINARY"))
+		return -1;
+
+	// Build the request text
+	std::ostringstream command;
+	command.imbue(std::locale::classic());
+
+	if (m_uid.empty())
+		command << "FETCH " << getNumber();
+	else
+		command << "UID FETCH " << IMAPUtils::extractUIDFromGlobalUID(m_uid);
+
+	command << " BINARY.SIZE[" << makeSection(p) << "]";
+
+	// Send the request
+	cnt->send(true, command.str(), true);
+
+	// Get the response
+	utility::auto_ptr <IMAPParser::response> resp(cnt->readResponse());
+
+	if (resp->isBad() || resp->response_done()->response_tagged()->
+		resp_cond_state()->status() != IMAPParser::resp_cond_state::OK)
+	{
+		// Eg. "NO [UNKNOWN-CTE]"
+		return -1;
+	}
+
+	int size = -1;
+
+	const std::vector <IMAPParser::continue_req_or_response_data*>& respDataList =
+		resp->continue_req_or_response_data();
+
+	for (std::vector <IMAPParser::continue_req_or_response_data*>::const_iterator
+	     it = respDataList.begin() ; it != respDataList.end() ; ++it)
+	{
+		if ((*it)->response_data() == NULL ||
+		    (*it)->response_data()->message_data() == NULL ||
+		    (*it)->response_data()->message_data()->msg_att() == NULL)
+		{
+			continue;
+		}
+
+		const std::vector <IMAPParser::msg_att_item*>& atts =
+			(*it)->response_data()->message_data()->msg_att()->items();
+
+		for (std::vector <IMAPParser::msg_att_item*>::const_iterator
+		     ait = atts.begin() ; ait != atts.end() ; ++ait)
+		{
+			if ((*ait)->type() == IMAPParser::msg_att_item::BINARY_SIZE)
+				size = static_cast <int>((*ait)->number()->value());
+		}
+	}
+
+	return size;
+}
+
+
+void IMAPMessage::extractPartContentsImpl(ref <const part> p, utility::outputStream& os,
+	utility::progressListener* progress, const int extractFlags) const
+{
+	ref <const IMAPFolder> folder = m_folder.acquire();
+
+	if (!folder)
+		throw exceptions::folder_not_found();
+
+	ref <IMAPStore> store = folder.constCast <IMAPFolder>()->m_store.acquire();
+	ref <IMAPContentCache> cache = (store ? store->getContentCache() : NULL);
+
+	if (!cache || m_uid.empty() || p->getSize() < 0 ||
+	    !cache->isCacheable(static_cast <size_t>(p->getSize())))
+	{
+		extractImpl(p, os, progress, 0, -1, extractFlags);
+		return;
+	}
+
+	// Contents are identified by mailbox, UID (which includes the
+	// UIDVALIDITY) and section; decoded contents are kept separately
+	const string key = IMAPUtils::pathToString
+		(folder->m_connection->hierarchySeparator(), folder->getFullPath())
+		+ '\n' + m_uid + '\n' + makeSection(p)
+		+ ((extractFlags & EXTRACT_BINARY) ? "\nBINARY" : "");
+
+	if (cache->get(key, os))
+		return;
+
+	std::ostringstream oss;
+	utility::outputStreamAdapter tmp(oss);
+
+	extractImpl(p, tmp, progress, 0, -1, extractFlags);
+
+	const string data = oss.str();
+
+	cache->put(key, data);
+
+	os.write(data.data(), data.length());
+}
+
+
+const string IMAPMessage::makeExtractRequest(ref <const part> p,
+	const int start, const int length, const int extractFlags) const
+{
+	// Construct section identifier
+	const string section = makeSection(p);
+
 	// Build the request text
 	std::ostringstream command;
 	command.imbue(std::locale::classic());
 
 	if (m_uid.empty())
-		command << "FETCH " << m_num << " BODY";
+		command << "FETCH " << getNumber();
 	else
-		command << "UID FETCH " << IMAPUtils::extractUIDFromGlobalUID(m_uid) << " BODY";
+		command << "UID FETCH " << IMAPUtils::extractUIDFromGlobalUID(m_uid);
 
 	/*
 	   BODY[]               header + body
@@ -297,14 +496,28 @@ void IMAPMessage::extractImpl(ref <const part> p, utility::outputStream& os,
 	   BODY.PEEK[HEADER]    header (peek)
 	   BODY[TEXT]           body
 	   BODY.PEEK[TEXT]      body (peek)
+	   BINARY[section]      decoded body of a part (RFC 3516)
 	*/
 
+	if (extractFlags & EXTRACT_BINARY)
+	{
+		// Only the contents of a part can be decoded by the server
+		if (section.empty() || (extractFlags & EXTRACT_HEADER))
+			throw exceptions::operation_not_supported();
+
+		command << " BINARY";
+	}
+	else
+	{
+		command << " BODY";
+	}
+
 	if (extractFlags & EXTRACT_PEEK)
 		command << ".PEEK";
 
 	command << "[";
 
-	if (section.str().empty())
+	if (section.empty())
 	{
 		// header + body
 		if ((extractFlags & EXTRACT_HEADER) && (extractFlags & EXTRACT_BODY))
@@ -318,14 +531,15 @@ void IMAPMessage::extractImpl(ref <const part> p, utility::outputStream& os,
 	}
 	else
 	{
-		command << section.str();
+		command << section;
 
 		// header + body
 		if ((extractFlags & EXTRACT_HEADER) && (extractFlags & EXTRACT_BODY))
 			throw exceptions::operation_not_supported();
-		// body only
+		// body only: "BODY[section]" is the contents of the part
+		// ("TEXT" is only valid for message/rfc822 parts)
 		else if (extractFlags & EXTRACT_BODY)
-			command << ".TEXT";
+			command << "";
 		// header only
 		else if (extractFlags & EXTRACT_HEADER)
 			command << ".MIME";   // "MIME" not "HEADER" for parts
@@ -336,25 +550,91 @@ void IMAPMessage::extractImpl(ref <const part> p, utility::outputStream& os,
 	if (start != 0 || length != -1)
 		command << "<" << start << "." << length << ">";
 
-	// Send the request
-	folder.constCast <IMAPFolder>()->m_connection->send(true, command.str(), true);
+	return command.str();
+}
 
-	// Get the response
-	utility::auto_ptr <IMAPParser::response> resp
-		(folder.constCast <IMAPFolder>()->m_connection->readResponse(&literalHandler));
 
-	if (resp->isBad() || resp->response_done()->response_tagged()->
-		resp_cond_state()->status() != IMAPParser::resp_cond_state::OK)
+int IMAPMessage::extractChunked(ref <const part> p, utility::outputStream& os,
+	utility::progressListener* progress, const int offset, const int chunkSize,
+	const bool prefetch, const bool peek) const
+{
+	ref <const IMAPFolder> folder = m_folder.acquire();
+
+	if (!folder)
+		throw exceptions::folder_not_found();
+
+	if (offset < 0 || chunkSize <= 0)
+		throw exceptions::invalid_argument();
+
+	ref <IMAPConnection> cnt = folder.constCast <IMAPFolder>()->m_connection;
+
+	// Whole message (header + body), or the part contents
+	const int flags = (peek ? EXTRACT_PEEK : 0);
+
+	// Total size, if known (only used for progress notification)
+	const int total = (p != NULL ? p->getSize() : m_size);
+
+	int current = offset;
+	bool complete = false;
+	bool failed = false;
+
+	if (progress)
+		progress->start(std::max(total, 0));
+
+	cnt->send(true, makeExtractRequest(p, current, chunkSize, flags), true);
+
+	while (!complete && !failed)
 	{
-		throw exceptions::command_error("FETCH",
-			folder.constCast <IMAPFolder>()->m_connection->getParser()->lastLine(), "bad response");
+		// Request the next chunk, so that the server can send it
+		// while the current one is being received
+		if (prefetch)
+			cnt->sendPipelined(makeExtractRequest(p, current + chunkSize, chunkSize, flags));
+
+		utility::countingOutputStream counter(os);
+		IMAPMessage_literalHandler literalHandler(counter, NULL);
+
+		utility::auto_ptr <IMAPParser::response> resp(cnt->readResponse(&literalHandler));
+
+		if (resp->isBad() || resp->response_done()->response_tagged()->
+			resp_cond_state()->status() != IMAPParser::resp_cond_state::OK)
+		{
+			failed = true;
+		}
+		else
+		{
+			const int received = static_cast <int>(counter.getCount());
+
+			current += received;
+
+			if (progress)
+				progress->progress(current, std::max(total, current));
+
+			// A short chunk means there is no more data
+			if (received < chunkSize)
+				complete = true;
+			else if (!prefetch)
+				cnt->send(true, makeExtractRequest(p, current, chunkSize, flags), true);
+		}
 	}
 
+	const string lastLine = cnt->getParser()->lastLine();
 
-	if (extractFlags & EXTRACT_BODY)
+	// Discard the chunk which has been requested in advance
+	if (prefetch)
 	{
-		// TODO: update the flags (eg. flag "\Seen" may have been set)
+		utility::countingOutputStream nullStream;
+		IMAPMessage_literalHandler literalHandler(nullStream, NULL);
+
+		utility::auto_ptr <IMAPParser::response> resp(cnt->readResponse(&literalHandler));
 	}
+
+	if (failed)
+		throw exceptions::command_error("FETCH", lastLine, "bad response");
+
+	if (progress)
+		progress->stop(std::max(total, current));
+
+	return current;
 }
 
 
@@ -367,7 +647,7 @@ void IMAPMessage::fetch(ref <IMAPFolder> msgFolder, const int options)
 
 	// Send the request
 	std::vector <int> list;
-	list.push_back(m_num);
+	list.push_back(getNumber());
 
 	const string command = IMAPUtils::buildFetchRequest(list, options);
 
@@ -402,7 +682,7 @@ void IMAPMessage::fetch(ref <IMAPFolder> msgFolder, const int options)
 		if (messageData == NULL || messageData->type() != IMAPParser::message_data::FETCH)
 			continue;
 
-		if (static_cast <int>(messageData->number()) != m_num)
+		if (static_cast <int>(messageData->number()) != getNumber())
 			continue;
 
 		// Process fetch response for this message
@@ -436,6 +716,11 @@ void IMAPMessage::processFetchResponse
 			m_uid = IMAPUtils::makeGlobalUID(folder->m_uidValidity, (*it)->unique_id()->value());
 			break;
 		}
+		case IMAPParser::msg_att_item::MODSEQ:
+		{
+			m_modseq = (*it)->mod_seq_value()->value();
+			break;
+		}
 		case IMAPParser::msg_att_item::ENVELOPE:
 		{
 			if (!(options & folder::FETCH_FULL_HEADER))
@@ -539,6 +824,8 @@ void IMAPMessage::processFetchResponse
 		case IMAPParser::msg_att_item::RFC822:
 		case IMAPParser::msg_att_item::RFC822_TEXT:
 		case IMAPParser::msg_att_item::BODY:
+		case IMAPParser::msg_att_item::BINARY_SECTION:
+		case IMAPParser::msg_att_item::BINARY_SIZE:
 		{
 			break;
 		}
@@ -551,6 +838,77 @@ void IMAPMessage::processFetchResponse
 }
 
 
+void IMAPMessage::processCacheEntry(const int options, const IMAPMetadataCache::entry& entry)
+{
+	if (options & folder::FETCH_SIZE)
+		m_size = entry.size;
+
+	if (options & folder::FETCH_STRUCTURE)
+	{
+		ref <IMAPStructure> str = IMAPMetadataCache::deserializeStructure(entry.structure);
+
+		if (str != NULL)
+			m_structure = str;
+	}
+
+	if ((options & (folder::FETCH_ENVELOPE | folder::FETCH_CONTENT_INFO |
+	                folder::FETCH_FULL_HEADER | folder::FETCH_IMPORTANCE)) &&
+	    !entry.header.empty())
+	{
+		header tempHeader;
+		tempHeader.parse(entry.header);
+
+		vmime::header& hdr = *getOrCreateHeader();
+		std::vector <ref <headerField> > fields = tempHeader.getFieldList();
+
+		// Cached fields replace the existing ones
+		for (std::vector <ref <headerField> >::const_iterator it = fields.begin() ;
+		     it != fields.end() ; ++it)
+		{
+			hdr.removeAllFields((*it)->getName());
+		}
+
+		for (std::vector <ref <headerField> >::const_iterator it = fields.begin() ;
+		     it != fields.end() ; ++it)
+		{
+			hdr.appendField((*it)->clone().dynamicCast <headerField>());
+		}
+	}
+}
+
+
+const IMAPMetadataCache::entry IMAPMessage::makeCacheEntry(const int options) const
+{
+	const int headerOptions =
+		folder::FETCH_ENVELOPE | folder::FETCH_CONTENT_INFO |
+		folder::FETCH_FULL_HEADER | folder::FETCH_IMPORTANCE;
+
+	IMAPMetadataCache::entry entry;
+	entry.options = options & IMAPMetadataCache::CACHEABLE_OPTIONS;
+
+	if (options & folder::FETCH_SIZE)
+		entry.size = m_size;
+
+	if (options & folder::FETCH_STRUCTURE)
+	{
+		if (m_structure != NULL)
+			entry.structure = IMAPMetadataCache::serializeStructure(m_structure);
+		else
+			entry.options &= ~folder::FETCH_STRUCTURE;
+	}
+
+	if (options & headerOptions)
+	{
+		if (m_header != NULL)
+			entry.header = m_header->generate();
+		else
+			entry.options &= ~headerOptions;
+	}
+
+	return entry;
+}
+
+
 ref <header> IMAPMessage::getOrCreateHeader()
 {
 	if (m_header != NULL)
@@ -573,7 +931,7 @@ void IMAPMessage::setFlags(const int flags, const int mode)
 	std::ostringstream command;
 	command.imbue(std::locale::classic());
 
-	command << "STORE " << m_num;
+	command << "STORE " << getNumber();
 
 	switch (mode)
 	{
@@ -659,17 +1017,12 @@ void IMAPMessage::setFlags(const int flags, const int mode)
 
 		// Notify message flags changed
 		std::vector <int> nums;
-		nums.push_back(m_num);
+		nums.push_back(getNumber());
 
 		events::messageChangedEvent event
 			(folder, events::messageChangedEvent::TYPE_FLAGS, nums);
 
-		for (std::list <IMAPFolder*>::iterator it = folder->m_store.acquire()->m_folders.begin() ;
-		     it != folder->m_store.acquire()->m_folders.end() ; ++it)
-		{
-			if ((*it)->getFullPath() == folder->m_path)
-				(*it)->notifyMessageChanged(event);
-		}
+		folder->notifyFolders(folder->m_path, event);
 	}
 }
 
@@ -69,20 +69,23 @@ void IMAPMessagePartContentHandler::generate
 		// buffer, and then re-encode to output stream...
 		if (m_encoding != enc)
 		{
-			// Extract part contents to temporary buffer
-			std::ostringstream oss;
-			utility::outputStreamAdapter tmp(oss);
+			std::ostringstream oss2;
+			utility::outputStreamAdapter tmp2(oss2);
 
-			msg->extractPart(part, tmp, NULL);
+			// Let the server decode data, if it can; otherwise, extract
+			// part contents to temporary buffer and decode them
+			if (!msg->extractDecodedPartContents(part, tmp2, NULL))
+			{
+				std::ostringstream oss;
+				utility::outputStreamAdapter tmp(oss);
 
-			// Decode to another temporary buffer
-			utility::inputStreamStringProxyAdapter in(oss.str());
+				msg->extractPartContents(part, tmp, NULL);
 
-			std::ostringstream oss2;
-			utility::outputStreamAdapter tmp2(oss2);
+				utility::inputStreamStringProxyAdapter in(oss.str());
 
-			ref <utility::encoder::encoder> theDecoder = m_encoding.getEncoder();
-			theDecoder->decode(in, tmp2);
+				ref <utility::encoder::encoder> theDecoder = m_encoding.getEncoder();
+				theDecoder->decode(in, tmp2);
+			}
 
 			// Reencode to output stream
 			string str = oss2.str();
@@ -95,7 +98,7 @@ void IMAPMessagePartContentHandler::generate
 		// No encoding to perform
 		else
 		{
-			msg->extractPart(part, os);
+			msg->extractPartContents(part, os, NULL);
 		}
 	}
 	// Need to encode data before
@@ -105,7 +108,7 @@ void IMAPMessagePartContentHandler::generate
 		std::ostringstream oss;
 		utility::outputStreamAdapter tmp(oss);
 
-		msg->extractPart(part, tmp, NULL);
+		msg->extractPartContents(part, tmp, NULL);
 
 		// Encode temporary buffer to output stream
 		ref <utility::encoder::encoder> theEncoder = enc.getEncoder();
@@ -127,7 +130,12 @@ void IMAPMessagePartContentHandler::extract
 	// No decoding to perform
 	if (!isEncoded())
 	{
-		msg->extractImpl(part, os, progress, 0, -1, IMAPMessage::EXTRACT_BODY);
+		msg->extractPartContents(part, os, progress);
+	}
+	// Let the server decode data, if it can (BINARY extension)
+	else if (msg->extractDecodedPartContents(part, os, progress))
+	{
+		// Nothing more to do
 	}
 	// Need to decode data
 	else
@@ -136,7 +144,7 @@ void IMAPMessagePartContentHandler::extract
 		std::ostringstream oss;
 		utility::outputStreamAdapter tmp(oss);
 
-		msg->extractImpl(part, tmp, NULL, 0, -1, IMAPMessage::EXTRACT_BODY);
+		msg->extractPartContents(part, tmp, NULL);
 
 		// Encode temporary buffer to output stream
 		utility::inputStreamStringAdapter is(oss.str());
@@ -154,7 +162,7 @@ void IMAPMessagePartContentHandler::extractRaw
 	ref <IMAPMessage> msg = m_message.acquire().constCast <IMAPMessage>();
 	ref <part> part = m_part.acquire().constCast <class part>();
 
-	msg->extractPart(part, os, progress);
+	msg->extractPartContents(part, os, progress);
 }
 
 
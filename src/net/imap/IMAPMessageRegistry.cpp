@@ -0,0 +1,239 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002-2013 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+
+#include "vmime/config.hpp"
+
+
+#if VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_IMAP
+
+
+#include "vmime/net/imap/IMAPMessageRegistry.hpp"
+
+
+namespace vmime {
+namespace net {
+namespace imap {
+
+
+// Lowest bit set in a slot index
+static inline IMAPMessageRegistry::slot IMAPMessageRegistry_lowBit(const IMAPMessageRegistry::slot s)
+{
+	return (s & (~s + 1));
+}
+
+
+IMAPMessageRegistry::IMAPMessageRegistry()
+	: m_aliveCount(0)
+{
+	m_tree.push_back(0);
+	m_alive.push_back(false);
+}
+
+
+IMAPMessageRegistry::slot IMAPMessageRegistry::add(IMAPMessage* msg, const int num)
+{
+	// Invalid number: the message is kept, but it is not renumbered
+	if (num < 1)
+	{
+		m_messages.insert(std::multimap <slot, IMAPMessage*>::value_type(0, msg));
+		return 0;
+	}
+
+	grow(num);
+
+	const slot s = findSlot(num);
+
+	m_messages.insert(std::multimap <slot, IMAPMessage*>::value_type(s, msg));
+
+	return s;
+}
+
+
+void IMAPMessageRegistry::remove(IMAPMessage* msg, const slot s)
+{
+	std::pair <std::multimap <slot, IMAPMessage*>::iterator,
+	           std::multimap <slot, IMAPMessage*>::iterator> range = m_messages.equal_range(s);
+
+	for (std::multimap <slot, IMAPMessage*>::iterator it = range.first ; it != range.second ; ++it)
+	{
+		if ((*it).second == msg)
+		{
+			m_messages.erase(it);
+			break;
+		}
+	}
+
+	// No message refers to a slot anymore: start again from scratch, so
+	// that slots of expunged messages do not accumulate
+	if (m_messages.empty())
+		clear();
+}
+
+
+void IMAPMessageRegistry::clear()
+{
+	m_messages.clear();
+
+	m_tree.clear();
+	m_tree.push_back(0);
+
+	m_alive.clear();
+	m_alive.push_back(false);
+
+	m_aliveCount = 0;
+}
+
+
+void IMAPMessageRegistry::expunge(const int num)
+{
+	// No slot has been allocated for this number yet: the numbers of
+	// the messages which will be registered later are already correct
+	if (num < 1 || num > m_aliveCount)
+		return;
+
+	const slot s = findSlot(num);
+
+	m_alive[s] = false;
+
+	for (slot i = s ; i < m_tree.size() ; i += IMAPMessageRegistry_lowBit(i))
+		--m_tree[i];
+
+	--m_aliveCount;
+}
+
+
+int IMAPMessageRegistry::getNumber(const slot s) const
+{
+	if (s == 0 || s >= m_alive.size())
+		return 0;
+
+	return prefixCount(s) + (m_alive[s] ? 0 : 1);
+}
+
+
+bool IMAPMessageRegistry::isExpunged(const slot s) const
+{
+	if (s == 0 || s >= m_alive.size())
+		return false;
+
+	return !m_alive[s];
+}
+
+
+void IMAPMessageRegistry::find(const int from, const int to, std::vector <IMAPMessage*>& msgs) const
+{
+	const int last = (to == -1 || to > m_aliveCount) ? m_aliveCount : to;
+	const int first = (from < 1) ? 1 : from;
+
+	if (first > last)
+		return;
+
+	std::multimap <slot, IMAPMessage*>::const_iterator it = m_messages.lower_bound(findSlot(first));
+	const std::multimap <slot, IMAPMessage*>::const_iterator end = m_messages.upper_bound(findSlot(last));
+
+	for ( ; it != end ; ++it)
+	{
+		if (m_alive[(*it).first])
+			msgs.push_back((*it).second);
+	}
+}
+
+
+void IMAPMessageRegistry::getAll(std::vector <IMAPMessage*>& msgs) const
+{
+	msgs.reserve(msgs.size() + m_messages.size());
+
+	for (std::multimap <slot, IMAPMessage*>::const_iterator it = m_messages.begin() ;
+	     it != m_messages.end() ; ++it)
+	{
+		msgs.push_back((*it).second);
+	}
+}
+
+
+size_t IMAPMessageRegistry::size() const
+{
+	return m_messages.size();
+}
+
+
+void IMAPMessageRegistry::grow(const int num)
+{
+	while (m_aliveCount < num)
+	{
+		// A node covers the slots (s - lowbit(s), s]
+		const slot s = static_cast <slot>(m_tree.size());
+
+		m_tree.push_back(1 + prefixCount(s - 1) - prefixCount(s - IMAPMessageRegistry_lowBit(s)));
+		m_alive.push_back(true);
+
+		++m_aliveCount;
+	}
+}
+
+
+int IMAPMessageRegistry::prefixCount(const slot s) const
+{
+	int count = 0;
+
+	for (slot i = s ; i != 0 ; i &= i - 1)
+		count += m_tree[i];
+
+	return count;
+}
+
+
+IMAPMessageRegistry::slot IMAPMessageRegistry::findSlot(const int num) const
+{
+	const slot size = static_cast <slot>(m_tree.size() - 1);
+
+	slot step = 1;
+
+	while (step <= size / 2)
+		step <<= 1;
+
+	// Find the last slot before which there are less than 'num'
+	// alive slots
+	slot pos = 0;
+	int remaining = num;
+
+	for ( ; step != 0 ; step >>= 1)
+	{
+		if (pos + step <= size && m_tree[pos + step] < remaining)
+		{
+			pos += step;
+			remaining -= m_tree[pos];
+		}
+	}
+
+	return pos + 1;
+}
+
+
+} // imap
+} // net
+} // vmime
+
+
+#endif // VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_IMAP
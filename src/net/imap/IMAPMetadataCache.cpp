@@ -0,0 +1,622 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002-2013 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+
+#include "vmime/config.hpp"
+
+
+#if VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_IMAP
+
+
+#include "vmime/net/imap/IMAPMetadataCache.hpp"
+#include "vmime/net/imap/IMAPStructure.hpp"
+#include "vmime/net/imap/IMAPPart.hpp"
+
+#include "vmime/net/folder.hpp"
+
+#include "vmime/utility/stringUtils.hpp"
+
+#include "vmime/exception.hpp"
+#include "vmime/platform.hpp"
+
+
+namespace vmime {
+namespace net {
+namespace imap {
+
+
+// Identifies a segment file (format version 1)
+static const char IMAPMetadataCache_magic[8] = { 'V', 'M', 'I', 'M', 'E', 'M', 'C', '1' };
+
+// Number of segments after which a mailbox is compacted into one segment
+static const unsigned int IMAPMetadataCache_maxSegments = 16;
+
+// Maximum nesting level of a serialized structure
+static const int IMAPMetadataCache_maxLevel = 64;
+
+
+static void IMAPMetadataCache_putInt(string& out, const unsigned int n)
+{
+	out += static_cast <char>((n >> 24) & 0xff);
+	out += static_cast <char>((n >> 16) & 0xff);
+	out += static_cast <char>((n >>  8) & 0xff);
+	out += static_cast <char>( n        & 0xff);
+}
+
+
+static bool IMAPMetadataCache_getInt(const string& in, string::size_type& pos, unsigned int& n)
+{
+	if (in.length() < 4 || pos > in.length() - 4)
+		return false;
+
+	const unsigned char* p = reinterpret_cast <const unsigned char*>(in.data() + pos);
+
+	n = (static_cast <unsigned int>(p[0]) << 24) |
+	    (static_cast <unsigned int>(p[1]) << 16) |
+	    (static_cast <unsigned int>(p[2]) <<  8) |
+	     static_cast <unsigned int>(p[3]);
+
+	pos += 4;
+
+	return true;
+}
+
+
+static void IMAPMetadataCache_putString(string& out, const string& str)
+{
+	IMAPMetadataCache_putInt(out, static_cast <unsigned int>(str.length()));
+	out += str;
+}
+
+
+static bool IMAPMetadataCache_getString(const string& in, string::size_type& pos, string& str)
+{
+	unsigned int length = 0;
+
+	if (!IMAPMetadataCache_getInt(in, pos, length) || length > in.length() - pos)
+		return false;
+
+	str.assign(in, pos, length);
+	pos += length;
+
+	return true;
+}
+
+
+static void IMAPMetadataCache_serializeStructure(string& out, ref <const structure> str)
+{
+	const size_t count = str->getPartCount();
+
+	IMAPMetadataCache_putInt(out, static_cast <unsigned int>(count));
+
+	for (size_t i = 0 ; i < count ; ++i)
+	{
+		ref <const part> p = str->getPartAt(i);
+
+		IMAPMetadataCache_putString(out, p->getType().generate());
+		IMAPMetadataCache_putInt(out, static_cast <unsigned int>(p->getSize()));
+
+		IMAPMetadataCache_serializeStructure(out, p->getStructure());
+	}
+}
+
+
+static const string IMAPMetadataCache_hexEncode(const string& str)
+{
+	static const char hexChars[] = "0123456789abcdef";
+
+	string res;
+	res.reserve(str.length() * 2);
+
+	for (string::const_iterator it = str.begin() ; it != str.end() ; ++it)
+	{
+		const unsigned char c = static_cast <unsigned char>(*it);
+
+		res += hexChars[c >> 4];
+		res += hexChars[c & 0xf];
+	}
+
+	return res;
+}
+
+
+static const string IMAPMetadataCache_readFile(ref <utility::file> file)
+{
+	ref <utility::inputStream> is = file->getFileReader()->getInputStream();
+
+	string data;
+	utility::stream::value_type buffer[65536];
+
+	while (!is->eof())
+	{
+		const utility::stream::size_type read = is->read(buffer, sizeof(buffer));
+
+		if (read == 0)
+			break;
+
+		data.append(buffer, read);
+	}
+
+	return data;
+}
+
+
+// Parse the segment number from a file name (eg. "12")
+static bool IMAPMetadataCache_parseSegmentName(const string& name, unsigned int& n)
+{
+	if (name.empty() || name.length() > 9)
+		return false;
+
+	n = 0;
+
+	for (string::const_iterator it = name.begin() ; it != name.end() ; ++it)
+	{
+		if (*it < '0' || *it > '9')
+			return false;
+
+		n = n * 10 + static_cast <unsigned int>(*it - '0');
+	}
+
+	return true;
+}
+
+
+
+// static
+const int IMAPMetadataCache::CACHEABLE_OPTIONS =
+	folder::FETCH_ENVELOPE | folder::FETCH_CONTENT_INFO |
+	folder::FETCH_STRUCTURE | folder::FETCH_SIZE |
+	folder::FETCH_FULL_HEADER | folder::FETCH_IMPORTANCE;
+
+
+
+IMAPMetadataCache::entry::entry()
+	: options(0), size(0)
+{
+}
+
+
+IMAPMetadataCache::mailboxEntries::mailboxEntries()
+	: uidValidity(0), nextSegment(0), segmentCount(0)
+{
+}
+
+
+
+IMAPMetadataCache::IMAPMetadataCache(const utility::file::path& dir)
+	: m_dir(dir), m_lock(platform::getHandler()->createCriticalSection())
+{
+}
+
+
+bool IMAPMetadataCache::getEntry(const string& mailbox, const unsigned int uidValidity,
+	const unsigned int uid, entry& e)
+{
+	m_lock->lock();
+
+	try
+	{
+		mailboxEntries& mbox = getMailbox(mailbox, uidValidity);
+
+		std::map <unsigned int, entry>::const_iterator it = mbox.entries.find(uid);
+
+		if (it != mbox.entries.end())
+		{
+			e = (*it).second;
+
+			m_lock->unlock();
+			return true;
+		}
+	}
+	catch (...)
+	{
+		m_lock->unlock();
+		throw;
+	}
+
+	m_lock->unlock();
+
+	return false;
+}
+
+
+void IMAPMetadataCache::putEntry(const string& mailbox, const unsigned int uidValidity,
+	const unsigned int uid, const entry& e)
+{
+	const int headerOptions =
+		folder::FETCH_ENVELOPE | folder::FETCH_CONTENT_INFO |
+		folder::FETCH_FULL_HEADER | folder::FETCH_IMPORTANCE;
+
+	m_lock->lock();
+
+	try
+	{
+		mailboxEntries& mbox = getMailbox(mailbox, uidValidity);
+
+		entry merged = e;
+		merged.options &= CACHEABLE_OPTIONS;
+
+		// Keep the items which were cached previously and are
+		// not present in the new entry
+		std::map <unsigned int, entry>::const_iterator it = mbox.entries.find(uid);
+
+		if (it != mbox.entries.end())
+		{
+			const entry& old = (*it).second;
+
+			if (!(merged.options & folder::FETCH_STRUCTURE) && (old.options & folder::FETCH_STRUCTURE))
+			{
+				merged.structure = old.structure;
+				merged.options |= folder::FETCH_STRUCTURE;
+			}
+
+			if (!(merged.options & folder::FETCH_SIZE) && (old.options & folder::FETCH_SIZE))
+			{
+				merged.size = old.size;
+				merged.options |= folder::FETCH_SIZE;
+			}
+
+			if (!(merged.options & headerOptions) && (old.options & headerOptions))
+			{
+				merged.header = old.header;
+				merged.options |= (old.options & headerOptions);
+			}
+		}
+
+		mbox.entries[uid] = merged;
+		mbox.dirty[uid] = merged;
+	}
+	catch (...)
+	{
+		m_lock->unlock();
+		throw;
+	}
+
+	m_lock->unlock();
+}
+
+
+void IMAPMetadataCache::flush()
+{
+	m_lock->lock();
+
+	try
+	{
+		for (std::map <string, mailboxEntries>::iterator it = m_mailboxes.begin() ;
+		     it != m_mailboxes.end() ; ++it)
+		{
+			mailboxEntries& mbox = (*it).second;
+
+			if (mbox.dirty.empty())
+				continue;
+
+			if (mbox.segmentCount >= IMAPMetadataCache_maxSegments)
+			{
+				// Compact: write all the entries in a new segment,
+				// then remove the older ones
+				const unsigned int first = mbox.nextSegment;
+
+				writeSegment((*it).first, mbox, mbox.entries);
+
+				ref <utility::fileSystemFactory> fsf = platform::getHandler()->getFileSystemFactory();
+				ref <utility::fileIterator> files = fsf->create(getMailboxPath((*it).first))->getFiles();
+
+				while (files->hasMoreElements())
+				{
+					ref <utility::file> file = files->nextElement();
+					unsigned int n = 0;
+
+					if (IMAPMetadataCache_parseSegmentName
+							(file->getFullPath().getLastComponent().getBuffer(), n) && n < first)
+					{
+						file->remove();
+					}
+				}
+
+				mbox.segmentCount = 1;
+			}
+			else
+			{
+				writeSegment((*it).first, mbox, mbox.dirty);
+			}
+
+			mbox.dirty.clear();
+		}
+	}
+	catch (...)
+	{
+		m_lock->unlock();
+		throw;
+	}
+
+	m_lock->unlock();
+}
+
+
+// static
+bool IMAPMetadataCache::covers(const entry& e, const int options)
+{
+	int available = e.options;
+
+	// A full header contains the fields of the envelope
+	if (available & folder::FETCH_FULL_HEADER)
+		available |= folder::FETCH_ENVELOPE | folder::FETCH_CONTENT_INFO | folder::FETCH_IMPORTANCE;
+
+	return ((options & CACHEABLE_OPTIONS) & ~available) == 0;
+}
+
+
+// static
+const string IMAPMetadataCache::serializeStructure(ref <const structure> str)
+{
+	string data;
+	IMAPMetadataCache_serializeStructure(data, str);
+
+	return data;
+}
+
+
+// static
+ref <IMAPStructure> IMAPMetadataCache::deserializeStructure(const string& data)
+{
+	string::size_type pos = 0;
+	return deserializeStructureImpl(data, pos, NULL, 0);
+}
+
+
+// static
+ref <IMAPStructure> IMAPMetadataCache::deserializeStructureImpl(const string& data,
+	string::size_type& pos, ref <IMAPPart> parent, const int level)
+{
+	unsigned int count = 0;
+
+	if (level > IMAPMetadataCache_maxLevel ||
+	    !IMAPMetadataCache_getInt(data, pos, count) || count > data.length() - pos)
+	{
+		return NULL;
+	}
+
+	std::vector <ref <IMAPPart> > parts;
+
+	for (unsigned int i = 0 ; i < count ; ++i)
+	{
+		string type;
+		unsigned int size = 0;
+
+		if (!IMAPMetadataCache_getString(data, pos, type) ||
+		    !IMAPMetadataCache_getInt(data, pos, size))
+		{
+			return NULL;
+		}
+
+		ref <IMAPPart> part = vmime::create <IMAPPart>
+			(parent, static_cast <int>(i), mediaType(type), static_cast <int>(size));
+
+		ref <IMAPStructure> subStructure =
+			deserializeStructureImpl(data, pos, part, level + 1);
+
+		if (subStructure == NULL)
+			return NULL;
+
+		if (subStructure->getPartCount() != 0)
+			part->m_structure = subStructure;
+
+		parts.push_back(part);
+	}
+
+	return vmime::create <IMAPStructure>(parts);
+}
+
+
+IMAPMetadataCache::mailboxEntries& IMAPMetadataCache::getMailbox
+	(const string& mailbox, const unsigned int uidValidity)
+{
+	std::map <string, mailboxEntries>::iterator it = m_mailboxes.find(mailbox);
+
+	if (it == m_mailboxes.end())
+	{
+		mailboxEntries& mbox = m_mailboxes[mailbox];
+		mbox.uidValidity = uidValidity;
+
+		try
+		{
+			loadMailbox(mailbox, mbox);
+		}
+		catch (exceptions::filesystem_exception&)
+		{
+			// Start with an empty cache
+			mbox.entries.clear();
+		}
+
+		return mbox;
+	}
+	else if ((*it).second.uidValidity != uidValidity)
+	{
+		// UIDs are not valid anymore
+		clearMailbox(mailbox, (*it).second);
+		(*it).second.uidValidity = uidValidity;
+	}
+
+	return (*it).second;
+}
+
+
+void IMAPMetadataCache::loadMailbox(const string& mailbox, mailboxEntries& mbox)
+{
+	ref <utility::fileSystemFactory> fsf = platform::getHandler()->getFileSystemFactory();
+	ref <utility::file> dir = fsf->create(getMailboxPath(mailbox));
+
+	if (!dir->exists() || !dir->isDirectory())
+		return;
+
+	// Enumerate segments, in the order they were written
+	std::map <unsigned int, ref <utility::file> > segments;
+	ref <utility::fileIterator> files = dir->getFiles();
+
+	while (files->hasMoreElements())
+	{
+		ref <utility::file> file = files->nextElement();
+		unsigned int n = 0;
+
+		if (IMAPMetadataCache_parseSegmentName
+				(file->getFullPath().getLastComponent().getBuffer(), n))
+		{
+			segments[n] = file;
+		}
+		else
+		{
+			// Segment which was not completely written
+			file->remove();
+		}
+	}
+
+	for (std::map <unsigned int, ref <utility::file> >::iterator
+	     it = segments.begin() ; it != segments.end() ; ++it)
+	{
+		const string data = IMAPMetadataCache_readFile((*it).second);
+
+		string::size_type pos = sizeof(IMAPMetadataCache_magic);
+		unsigned int uidValidity = 0;
+
+		if (data.length() < pos ||
+		    data.compare(0, pos, IMAPMetadataCache_magic, pos) != 0 ||
+		    !IMAPMetadataCache_getInt(data, pos, uidValidity) ||
+		    uidValidity != mbox.uidValidity)
+		{
+			// Invalid segment, or UIDVALIDITY has changed
+			(*it).second->remove();
+			continue;
+		}
+
+		while (pos < data.length())
+		{
+			unsigned int uid = 0, options = 0, size = 0;
+			entry e;
+
+			if (!IMAPMetadataCache_getInt(data, pos, uid) ||
+			    !IMAPMetadataCache_getInt(data, pos, options) ||
+			    !IMAPMetadataCache_getInt(data, pos, size) ||
+			    !IMAPMetadataCache_getString(data, pos, e.header) ||
+			    !IMAPMetadataCache_getString(data, pos, e.structure))
+			{
+				// Truncated record
+				break;
+			}
+
+			e.options = static_cast <int>(options);
+			e.size = static_cast <int>(size);
+
+			mbox.entries[uid] = e;
+		}
+
+		mbox.nextSegment = (*it).first + 1;
+		++mbox.segmentCount;
+	}
+}
+
+
+void IMAPMetadataCache::clearMailbox(const string& mailbox, mailboxEntries& mbox)
+{
+	mbox.entries.clear();
+	mbox.dirty.clear();
+	mbox.segmentCount = 0;
+
+	ref <utility::fileSystemFactory> fsf = platform::getHandler()->getFileSystemFactory();
+	ref <utility::file> dir = fsf->create(getMailboxPath(mailbox));
+
+	if (!dir->exists() || !dir->isDirectory())
+		return;
+
+	ref <utility::fileIterator> files = dir->getFiles();
+
+	while (files->hasMoreElements())
+		files->nextElement()->remove();
+}
+
+
+void IMAPMetadataCache::writeSegment(const string& mailbox, mailboxEntries& mbox,
+	const std::map <unsigned int, entry>& entries)
+{
+	// Build segment data
+	string data;
+	data.append(IMAPMetadataCache_magic, sizeof(IMAPMetadataCache_magic));
+
+	IMAPMetadataCache_putInt(data, mbox.uidValidity);
+
+	for (std::map <unsigned int, entry>::const_iterator
+	     it = entries.begin() ; it != entries.end() ; ++it)
+	{
+		const entry& e = (*it).second;
+
+		IMAPMetadataCache_putInt(data, (*it).first);
+		IMAPMetadataCache_putInt(data, static_cast <unsigned int>(e.options));
+		IMAPMetadataCache_putInt(data, static_cast <unsigned int>(e.size));
+		IMAPMetadataCache_putString(data, e.header);
+		IMAPMetadataCache_putString(data, e.structure);
+	}
+
+	// Write it to a temporary file, then give it its final name, so
+	// that a partially written segment is never loaded
+	ref <utility::fileSystemFactory> fsf = platform::getHandler()->getFileSystemFactory();
+
+	const utility::file::path dirPath = getMailboxPath(mailbox);
+	ref <utility::file> dir = fsf->create(dirPath);
+
+	if (!dir->exists())
+		dir->createDirectory(true);
+
+	const string name = utility::stringUtils::toString(mbox.nextSegment);
+
+	ref <utility::file> file = fsf->create
+		(dirPath / utility::file::path::component(name + ".tmp"));
+
+	file->createFile();
+
+	{
+		ref <utility::outputStream> os = file->getFileWriter()->getOutputStream();
+
+		os->write(data.data(), data.length());
+		os->flush();
+	}
+
+	file->rename(dirPath / utility::file::path::component(name));
+
+	++mbox.nextSegment;
+	++mbox.segmentCount;
+}
+
+
+const utility::file::path IMAPMetadataCache::getMailboxPath(const string& mailbox) const
+{
+	// Mailbox names may contain characters which are not allowed
+	// in file names, so they are hex-encoded
+	return m_dir / utility::file::path::component("m" + IMAPMetadataCache_hexEncode(mailbox));
+}
+
+
+} // imap
+} // net
+} // vmime
+
+
+#endif // VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_IMAP
@@ -74,6 +74,12 @@ IMAPPart::IMAPPart(ref <IMAPPart> parent, const int number, const IMAPParser::bo
 }
 
 
+IMAPPart::IMAPPart(ref <IMAPPart> parent, const int number, const mediaType& type, const int size)
+	: m_parent(parent), m_header(NULL), m_number(number), m_size(size), m_mediaType(type)
+{
+}
+
+
 ref <const structure> IMAPPart::getStructure() const
 {
 	if (m_structure != NULL)
@@ -59,6 +59,15 @@ const IMAPServiceInfos::props& IMAPServiceInfos::getProperties() const
 		property("options.sasl", serviceInfos::property::TYPE_BOOLEAN, "true"),
 		property("options.sasl.fallback", serviceInfos::property::TYPE_BOOLEAN, "true"),
 #endif // VMIME_HAVE_SASL_SUPPORT
+#if VMIME_HAVE_COMPRESSION_SUPPORT
+		property("options.compress", serviceInfos::property::TYPE_BOOLEAN, "true"),
+#endif // VMIME_HAVE_COMPRESSION_SUPPORT
+		property("connection.pool.size", serviceInfos::property::TYPE_INTEGER, "0"),
+		property("cache.metadata.path", serviceInfos::property::TYPE_STRING, ""),
+		property("cache.content.size", serviceInfos::property::TYPE_INTEGER, "0"),
+		property("cache.content.threshold", serviceInfos::property::TYPE_INTEGER, "65536"),
+		property("cache.content.path", serviceInfos::property::TYPE_STRING, ""),
+		property("cache.content.disk.size", serviceInfos::property::TYPE_INTEGER, "67108864"),
 
 		// Common properties
 		property(serviceInfos::property::AUTH_USERNAME, serviceInfos::property::FLAG_REQUIRED),
@@ -80,6 +89,15 @@ const IMAPServiceInfos::props& IMAPServiceInfos::getProperties() const
 		property("options.sasl", serviceInfos::property::TYPE_BOOLEAN, "true"),
 		property("options.sasl.fallback", serviceInfos::property::TYPE_BOOLEAN, "true"),
 #endif // VMIME_HAVE_SASL_SUPPORT
+#if VMIME_HAVE_COMPRESSION_SUPPORT
+		property("options.compress", serviceInfos::property::TYPE_BOOLEAN, "true"),
+#endif // VMIME_HAVE_COMPRESSION_SUPPORT
+		property("connection.pool.size", serviceInfos::property::TYPE_INTEGER, "0"),
+		property("cache.metadata.path", serviceInfos::property::TYPE_STRING, ""),
+		property("cache.content.size", serviceInfos::property::TYPE_INTEGER, "0"),
+		property("cache.content.threshold", serviceInfos::property::TYPE_INTEGER, "65536"),
+		property("cache.content.path", serviceInfos::property::TYPE_STRING, ""),
+		property("cache.content.disk.size", serviceInfos::property::TYPE_INTEGER, "67108864"),
 
 		// Common properties
 		property(serviceInfos::property::AUTH_USERNAME, serviceInfos::property::FLAG_REQUIRED),
@@ -108,6 +126,15 @@ const std::vector <serviceInfos::property> IMAPServiceInfos::getAvailablePropert
 	list.push_back(p.PROPERTY_OPTIONS_SASL);
 	list.push_back(p.PROPERTY_OPTIONS_SASL_FALLBACK);
 #endif // VMIME_HAVE_SASL_SUPPORT
+#if VMIME_HAVE_COMPRESSION_SUPPORT
+	list.push_back(p.PROPERTY_OPTIONS_COMPRESS);
+#endif // VMIME_HAVE_COMPRESSION_SUPPORT
+	list.push_back(p.PROPERTY_CONNECTION_POOL_SIZE);
+	list.push_back(p.PROPERTY_CACHE_METADATA_PATH);
+	list.push_back(p.PROPERTY_CACHE_CONTENT_SIZE);
+	list.push_back(p.PROPERTY_CACHE_CONTENT_THRESHOLD);
+	list.push_back(p.PROPERTY_CACHE_CONTENT_PATH);
+	list.push_back(p.PROPERTY_CACHE_CONTENT_DISK_SIZE);
 
 	// Common properties
 	list.push_back(p.PROPERTY_AUTH_USERNAME);
@@ -30,6 +30,7 @@
 #include "vmime/net/imap/IMAPStore.hpp"
 #include "vmime/net/imap/IMAPFolder.hpp"
 #include "vmime/net/imap/IMAPConnection.hpp"
+#include "vmime/net/imap/IMAPUtils.hpp"
 
 #include "vmime/exception.hpp"
 #include "vmime/platform.hpp"
@@ -43,7 +44,9 @@ namespace imap {
 
 
 IMAPStore::IMAPStore(ref <session> sess, ref <security::authenticator> auth, const bool secured)
-	: store(sess, getInfosInstance(), auth), m_connection(NULL), m_isIMAPS(secured)
+	: store(sess, getInfosInstance(), auth), m_connection(NULL),
+	  m_metadataCache(NULL), m_contentCache(NULL),
+	  m_lock(platform::getHandler()->createCriticalSection()), m_isIMAPS(secured)
 {
 }
 
@@ -108,6 +111,46 @@ void IMAPStore::connect()
 	if (isConnected())
 		throw exceptions::already_connected();
 
+	// Metadata cache
+	const string cachePath = getInfos().getPropertyValue <string>(getSession(),
+		sm_infos.getProperties().PROPERTY_CACHE_METADATA_PATH);
+
+	if (!cachePath.empty())
+	{
+		m_metadataCache = vmime::create <IMAPMetadataCache>
+			(platform::getHandler()->getFileSystemFactory()->stringToPath(cachePath));
+	}
+	else
+	{
+		m_metadataCache = NULL;
+	}
+
+	// Content cache
+	const int contentCacheSize = getInfos().getPropertyValue <int>(getSession(),
+		sm_infos.getProperties().PROPERTY_CACHE_CONTENT_SIZE);
+
+	if (contentCacheSize > 0)
+	{
+		const string contentCachePath = getInfos().getPropertyValue <string>(getSession(),
+			sm_infos.getProperties().PROPERTY_CACHE_CONTENT_PATH);
+
+		const int threshold = getInfos().getPropertyValue <int>(getSession(),
+			sm_infos.getProperties().PROPERTY_CACHE_CONTENT_THRESHOLD);
+		const int diskSize = getInfos().getPropertyValue <int>(getSession(),
+			sm_infos.getProperties().PROPERTY_CACHE_CONTENT_DISK_SIZE);
+
+		m_contentCache = vmime::create <IMAPContentCache>
+			(static_cast <size_t>(contentCacheSize),
+			 static_cast <size_t>(threshold > 0 ? threshold : 0),
+			 contentCachePath.empty() ? utility::file::path()
+				: platform::getHandler()->getFileSystemFactory()->stringToPath(contentCachePath),
+			 static_cast <size_t>(diskSize > 0 ? diskSize : 0));
+	}
+	else
+	{
+		m_contentCache = NULL;
+	}
+
 	m_connection = vmime::create <IMAPConnection>
 		(thisRef().dynamicCast <IMAPStore>(), getAuthenticator());
 
@@ -158,18 +201,47 @@ void IMAPStore::disconnect()
 	if (!isConnected())
 		throw exceptions::not_connected();
 
-	for (std::list <IMAPFolder*>::iterator it = m_folders.begin() ;
-	     it != m_folders.end() ; ++it)
+	std::vector <ref <IMAPFolder> > folders;
+	getFolders(folders);
+
+	for (std::vector <ref <IMAPFolder> >::iterator it = folders.begin() ;
+	     it != folders.end() ; ++it)
 	{
 		(*it)->onStoreDisconnected();
 	}
 
+	m_lock->lock();
+
 	m_folders.clear();
 
+	std::vector <ref <IMAPConnection> > pool;
+	pool.swap(m_pool);
+
+	m_lock->unlock();
+
+	for (unsigned int i = 0 ; i < pool.size() ; ++i)
+	{
+		try
+		{
+			pool[i]->disconnect();
+		}
+		catch (vmime::exception&)
+		{
+			// Ignore
+		}
+	}
+
 
 	m_connection->disconnect();
 
 	m_connection = NULL;
+
+	// Remove cached contents (and temporary files)
+	if (m_contentCache)
+	{
+		m_contentCache->clear();
+		m_contentCache = NULL;
+	}
 }
 
 
@@ -190,22 +262,387 @@ void IMAPStore::noop()
 }
 
 
+IMAPStore::folderStatus::folderStatus()
+	: mailbox(NULL), hasStatus(false), messageCount(0), unseenCount(0), uidNext(0)
+{
+}
+
+
+// Copy the values of a STATUS response into a folder status
+static void IMAPStore_setFolderStatus
+	(const IMAPParser::mailbox_data* mailboxData, IMAPStore::folderStatus& status)
+{
+	const std::vector <IMAPParser::status_info*>& statusList =
+		mailboxData->status_info_list();
+
+	for (std::vector <IMAPParser::status_info*>::const_iterator
+	     it = statusList.begin() ; it != statusList.end() ; ++it)
+	{
+		switch ((*it)->status_att()->type())
+		{
+		case IMAPParser::status_att::MESSAGES:
+
+			status.messageCount = (*it)->number()->value();
+			break;
+
+		case IMAPParser::status_att::UNSEEN:
+
+			status.unseenCount = (*it)->number()->value();
+			break;
+
+		case IMAPParser::status_att::UIDNEXT:
+
+			status.uidNext = (*it)->number()->value();
+			break;
+
+		default:
+
+			break;
+		}
+	}
+
+	status.hasStatus = true;
+}
+
+
+const std::vector <IMAPStore::folderStatus> IMAPStore::getFoldersStatus
+	(const folder::path& path, const bool recursive)
+{
+	if (!isConnected())
+		throw exceptions::not_connected();
+
+	// Eg. with LIST-STATUS:
+	//
+	//     C: a005 LIST "" "*" RETURN (STATUS (MESSAGES UNSEEN UIDNEXT))
+	//     S: * LIST (\Noselect) "/" foo
+	//     S: * LIST () "/" foo/bar
+	//     S: * STATUS foo/bar (MESSAGES 17 UNSEEN 2 UIDNEXT 351)
+	//     S: a005 OK LIST completed
+	//
+	// Otherwise, a STATUS command is sent for each folder after the LIST
+	// command, without waiting for the previous response.
+
+	const bool listStatus = m_connection->hasCapability("LIST-STATUS");
+
+	ref <IMAPConnection> cnt =
+		(getConnectionPoolSize() > 0 ? acquireConnection() : m_connection);
+
+	std::vector <folderStatus> v;
+
+	// Pipelined STATUS commands sent, and responses read
+	std::vector <folderStatus>::size_type sent = 0, received = 0;
+
+	// Whether the server has rejected the LIST command
+	bool rejected = false;
+
+	try
+	{
+		const string pathString = IMAPUtils::pathToString
+			(cnt->hierarchySeparator(), path);
+
+		std::ostringstream oss;
+		oss << "LIST ";
+
+		if (recursive)
+		{
+			oss << IMAPUtils::quoteString(pathString);
+			oss << " *";
+		}
+		else
+		{
+			if (pathString.empty()) // don't add sep for root folder
+				oss << "\"\"";
+			else
+				oss << IMAPUtils::quoteString(pathString + cnt->hierarchySeparator());
+
+			oss << " %";
+		}
+
+		if (listStatus)
+			oss << " RETURN (STATUS (MESSAGES UNSEEN UIDNEXT))";
+
+		cnt->send(true, oss.str(), true);
+
+
+		utility::auto_ptr <IMAPParser::response> resp(cnt->readResponse());
+
+		if (resp->isBad() || resp->response_done()->response_tagged()->
+				resp_cond_state()->status() != IMAPParser::resp_cond_state::OK)
+		{
+			rejected = true;
+
+			throw exceptions::command_error("LIST", cnt->getParser()->lastLine(), "bad response");
+		}
+
+		const std::vector <IMAPParser::continue_req_or_response_data*>& respDataList =
+			resp->continue_req_or_response_data();
+
+		// Mailbox names, as sent by the server
+		std::vector <string> names;
+		std::map <string, std::vector <folderStatus>::size_type> indices;
+
+		// Folders which can be selected
+		std::vector <std::vector <folderStatus>::size_type> selectable;
+
+		for (std::vector <IMAPParser::continue_req_or_response_data*>::const_iterator
+		     it = respDataList.begin() ; it != respDataList.end() ; ++it)
+		{
+			if ((*it)->response_data() == NULL)
+			{
+				throw exceptions::command_error("LIST",
+					cnt->getParser()->lastLine(), "invalid response");
+			}
+
+			const IMAPParser::mailbox_data* mailboxData =
+				(*it)->response_data()->mailbox_data();
+
+			if (mailboxData == NULL || mailboxData->type() != IMAPParser::mailbox_data::LIST)
+				continue;
+
+			const string name = mailboxData->mailbox_list()->mailbox()->name();
+
+			folder::path folderPath = IMAPUtils::stringToPath
+				(mailboxData->mailbox_list()->quoted_char(), name);
+
+			if (recursive || path.isDirectParentOf(folderPath))
+			{
+				const class IMAPParser::mailbox_flag_list* mailbox_flag_list =
+					mailboxData->mailbox_list()->mailbox_flag_list();
+
+				const int type = IMAPUtils::folderTypeFromFlags(mailbox_flag_list);
+
+				folderStatus status;
+				status.mailbox = vmime::create <IMAPFolder>
+					(folderPath, thisRef().dynamicCast <IMAPStore>(),
+					 type, IMAPUtils::folderFlagsFromFlags(mailbox_flag_list));
+
+				if (type & folder::TYPE_CONTAINS_MESSAGES)
+					selectable.push_back(v.size());
+
+				indices[name] = v.size();
+				names.push_back(name);
+				v.push_back(status);
+			}
+		}
+
+		if (listStatus)
+		{
+			// STATUS responses are sent along with the LIST responses
+			for (std::vector <IMAPParser::continue_req_or_response_data*>::const_iterator
+			     it = respDataList.begin() ; it != respDataList.end() ; ++it)
+			{
+				const IMAPParser::mailbox_data* mailboxData =
+					(*it)->response_data()->mailbox_data();
+
+				if (mailboxData == NULL || mailboxData->type() != IMAPParser::mailbox_data::STATUS)
+					continue;
+
+				std::map <string, std::vector <folderStatus>::size_type>::const_iterator
+					idx = indices.find(mailboxData->mailbox()->name());
+
+				if (idx != indices.end())
+					IMAPStore_setFolderStatus(mailboxData, v[(*idx).second]);
+			}
+		}
+		else
+		{
+			// Limit the number of commands waiting for a response, so that
+			// neither side blocks on writing while the other one is writing
+			static const std::vector <folderStatus>::size_type MAX_PENDING = 32;
+
+			while (received < selectable.size())
+			{
+				for ( ; sent < selectable.size() && sent - received < MAX_PENDING ; ++sent)
+				{
+					std::ostringstream command;
+					command.imbue(std::locale::classic());
+
+					command << "STATUS ";
+					command << IMAPUtils::quoteString(names[selectable[sent]]);
+					command << " (MESSAGES UNSEEN UIDNEXT)";
+
+					if (sent == received)
+						cnt->send(true, command.str(), true);
+					else
+						cnt->sendPipelined(command.str());
+				}
+
+				utility::auto_ptr <IMAPParser::response> statusResp(cnt->readResponse());
+
+				// The folder may have been deleted in the meantime: just
+				// leave its status unset
+				if (!statusResp->isBad() && statusResp->response_done()->response_tagged()->
+					resp_cond_state()->status() == IMAPParser::resp_cond_state::OK)
+				{
+					const std::vector <IMAPParser::continue_req_or_response_data*>& statusDataList =
+						statusResp->continue_req_or_response_data();
+
+					for (std::vector <IMAPParser::continue_req_or_response_data*>::const_iterator
+					     it = statusDataList.begin() ; it != statusDataList.end() ; ++it)
+					{
+						if ((*it)->response_data() == NULL)
+							continue;
+
+						const IMAPParser::mailbox_data* mailboxData =
+							(*it)->response_data()->mailbox_data();
+
+						if (mailboxData != NULL && mailboxData->type() == IMAPParser::mailbox_data::STATUS)
+							IMAPStore_setFolderStatus(mailboxData, v[selectable[received]]);
+					}
+				}
+
+				++received;
+			}
+		}
+	}
+	catch (std::exception&)
+	{
+		// Unless the server has rejected the LIST command, some responses
+		// may have been left unread: the next commands sent on this
+		// connection would get them, so it cannot be used anymore (the
+		// store connection is only dropped if STATUS responses are pending)
+		if (!rejected && (cnt != m_connection || sent > received))
+		{
+			try
+			{
+				cnt->disconnect();
+			}
+			catch (exception&)
+			{
+				// Ignore
+			}
+		}
+
+		if (cnt != m_connection)
+			releaseConnection(cnt);
+
+		throw;
+	}
+
+	if (cnt != m_connection)
+		releaseConnection(cnt);
+
+	return (v);
+}
+
+
 ref <IMAPConnection> IMAPStore::connection()
 {
 	return (m_connection);
 }
 
 
+int IMAPStore::getConnectionPoolSize() const
+{
+	const int size = getInfos().getPropertyValue <int>
+		(const_cast <IMAPStore*>(this)->getSession(),
+		sm_infos.getProperties().PROPERTY_CONNECTION_POOL_SIZE);
+
+	return (size > 0 ? size : 0);
+}
+
+
+ref <IMAPMetadataCache> IMAPStore::getMetadataCache()
+{
+	return m_metadataCache;
+}
+
+
+ref <IMAPContentCache> IMAPStore::getContentCache()
+{
+	return m_contentCache;
+}
+
+
+ref <IMAPConnection> IMAPStore::acquireConnection()
+{
+	ref <IMAPConnection> cnt;
+
+	m_lock->lock();
+
+	while (!cnt && !m_pool.empty())
+	{
+		cnt = m_pool.back();
+		m_pool.pop_back();
+
+		// The server may have closed the connection in the meantime
+		if (!cnt->isConnected())
+			cnt = NULL;
+	}
+
+	m_lock->unlock();
+
+	if (!cnt)
+	{
+		cnt = vmime::create <IMAPConnection>
+			(thisRef().dynamicCast <IMAPStore>(), getAuthenticator());
+
+		cnt->connect();
+	}
+
+	return cnt;
+}
+
+
+void IMAPStore::releaseConnection(ref <IMAPConnection> cnt)
+{
+	if (!cnt->isConnected())
+		return;
+
+	// Only reuse connections which are in a well-known state
+	if (cnt->state() == IMAPConnection::STATE_AUTHENTICATED && !cnt->isIdle())
+	{
+		cnt->setCurrentFolder(NULL);
+
+		m_lock->lock();
+
+		if (static_cast <int>(m_pool.size()) < getConnectionPoolSize())
+		{
+			m_pool.push_back(cnt);
+			m_lock->unlock();
+
+			return;
+		}
+
+		m_lock->unlock();
+	}
+
+	cnt->disconnect();
+}
+
+
 void IMAPStore::registerFolder(IMAPFolder* folder)
 {
+	m_lock->lock();
 	m_folders.push_back(folder);
+	m_lock->unlock();
 }
 
 
 void IMAPStore::unregisterFolder(IMAPFolder* folder)
 {
+	m_lock->lock();
+
 	std::list <IMAPFolder*>::iterator it = std::find(m_folders.begin(), m_folders.end(), folder);
 	if (it != m_folders.end()) m_folders.erase(it);
+
+	m_lock->unlock();
+}
+
+
+void IMAPStore::getFolders(std::vector <ref <IMAPFolder> >& folders)
+{
+	m_lock->lock();
+
+	for (std::list <IMAPFolder*>::iterator it = m_folders.begin() ;
+	     it != m_folders.end() ; ++it)
+	{
+		// Skip the folders which are being destroyed
+		if ((*it)->getRefManager()->addStrong())
+			folders.push_back(ref <IMAPFolder>::fromPtr(*it));
+	}
+
+	m_lock->unlock();
 }
 
 
@@ -59,6 +59,12 @@ IMAPStructure::IMAPStructure(ref <IMAPPart> parent, const std::vector <IMAPParse
 }
 
 
+IMAPStructure::IMAPStructure(const std::vector <ref <IMAPPart> >& parts)
+	: m_parts(parts)
+{
+}
+
+
 ref <const part> IMAPStructure::getPartAt(const size_t x) const
 {
 	return m_parts[x];
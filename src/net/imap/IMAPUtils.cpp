@@ -31,6 +31,8 @@
 #include "vmime/net/message.hpp"
 #include "vmime/net/folder.hpp"
 
+#include "vmime/utility/stringUtils.hpp"
+
 #include <sstream>
 #include <iterator>
 #include <algorithm>
@@ -563,6 +565,118 @@ const string IMAPUtils::listToSet(const std::vector <message::uid>& list)
 }
 
 
+// static
+const std::vector <std::pair <unsigned int, unsigned int> > IMAPUtils::setToRanges(const string& set)
+{
+	std::vector <std::pair <unsigned int, unsigned int> > ranges;
+
+	string::size_type pos = 0;
+
+	while (pos < set.length())
+	{
+		string::size_type end = set.find(',', pos);
+
+		if (end == string::npos)
+			end = set.length();
+
+		const string item(set.begin() + pos, set.begin() + end);
+		const string::size_type colon = item.find(':');
+
+		if (item.find('*') == string::npos)
+		{
+			std::istringstream iss(item);
+			iss.imbue(std::locale::classic());
+
+			unsigned int first = 0, last = 0;
+			iss >> first;
+
+			if (colon != string::npos)
+			{
+				iss.ignore(1);
+				iss >> last;
+
+				if (first > last)
+					std::swap(first, last);
+			}
+			else
+			{
+				last = first;
+			}
+
+			if (!iss.fail() && first != 0)
+				ranges.push_back(std::make_pair(first, last));
+		}
+
+		pos = end + 1;
+	}
+
+	// Sort and merge ranges
+	std::sort(ranges.begin(), ranges.end());
+
+	std::vector <std::pair <unsigned int, unsigned int> >::size_type count = 0;
+
+	for (std::vector <std::pair <unsigned int, unsigned int> >::size_type i = 0 ; i < ranges.size() ; ++i)
+	{
+		if (count != 0 && (ranges[count - 1].second == static_cast <unsigned int>(-1) ||
+		                   ranges[i].first <= ranges[count - 1].second + 1))
+		{
+			if (ranges[i].second > ranges[count - 1].second)
+				ranges[count - 1].second = ranges[i].second;
+		}
+		else
+		{
+			ranges[count++] = ranges[i];
+		}
+	}
+
+	ranges.resize(count);
+
+	return ranges;
+}
+
+
+// static
+const std::vector <unsigned int> IMAPUtils::setToList(const string& set)
+{
+	const std::vector <std::pair <unsigned int, unsigned int> > ranges = setToRanges(set);
+
+	std::vector <unsigned int> list;
+
+	for (std::vector <std::pair <unsigned int, unsigned int> >::const_iterator
+	     it = ranges.begin() ; it != ranges.end() ; ++it)
+	{
+		for (unsigned int n = (*it).first ; ; ++n)
+		{
+			list.push_back(n);
+
+			if (n == (*it).second)
+				break;
+		}
+	}
+
+	return list;
+}
+
+
+// static
+bool IMAPUtils::isInRanges(const std::vector <std::pair <unsigned int, unsigned int> >& ranges,
+	const unsigned int n)
+{
+	// Find the first range which starts after n; the previous one
+	// is the only one which may contain n
+	std::vector <std::pair <unsigned int, unsigned int> >::const_iterator it =
+		std::upper_bound(ranges.begin(), ranges.end(),
+			std::make_pair(n, static_cast <unsigned int>(-1)));
+
+	if (it == ranges.begin())
+		return false;
+
+	--it;
+
+	return n <= (*it).second;
+}
+
+
 // static
 const string IMAPUtils::dateTime(const vmime::datetime& date)
 {
@@ -728,6 +842,246 @@ const string IMAPUtils::buildFetchRequest(const std::vector <message::uid>& list
 }
 
 
+// static
+void IMAPUtils::buildSearchKeys(const searchCriteria& criteria, std::vector <string>& parts)
+{
+	parts.clear();
+	parts.push_back("");
+
+	buildSearchKeysImpl(criteria, true, parts);
+}
+
+
+// static
+void IMAPUtils::buildSearchKeysImpl
+	(const searchCriteria& criteria, const bool topLevel, std::vector <string>& parts)
+{
+	const std::vector <ref <const searchCriteria> >& children = criteria.getChildren();
+
+	switch (criteria.getType())
+	{
+	case searchCriteria::TYPE_ALL:
+
+		parts.back() += "ALL";
+		break;
+
+	case searchCriteria::TYPE_AND:
+
+		// No condition: all messages match
+		if (children.empty())
+		{
+			parts.back() += "ALL";
+			break;
+		}
+
+		// Search keys are implicitly ANDed: no parentheses are
+		// needed at the top level
+		if (!topLevel)
+			parts.back() += '(';
+
+		for (std::vector <ref <const searchCriteria> >::size_type i = 0 ; i < children.size() ; ++i)
+		{
+			if (i != 0)
+				parts.back() += ' ';
+
+			buildSearchKeysImpl(*children[i], topLevel, parts);
+		}
+
+		if (!topLevel)
+			parts.back() += ')';
+
+		break;
+
+	case searchCriteria::TYPE_OR:
+
+		// No alternative: no message matches
+		if (children.empty())
+		{
+			parts.back() += "NOT ALL";
+			break;
+		}
+
+		// "OR" only takes two keys: (a OR b OR c) is sent as "OR a OR b c"
+		for (std::vector <ref <const searchCriteria> >::size_type i = 0 ; i < children.size() ; ++i)
+		{
+			if (i + 1 < children.size())
+				parts.back() += "OR ";
+
+			buildSearchKeysImpl(*children[i], false, parts);
+
+			if (i + 1 < children.size())
+				parts.back() += ' ';
+		}
+
+		break;
+
+	case searchCriteria::TYPE_NOT:
+
+		parts.back() += "NOT ";
+		buildSearchKeysImpl(*children.front(), false, parts);
+
+		break;
+
+	case searchCriteria::TYPE_FLAGS_SET:
+	case searchCriteria::TYPE_FLAGS_UNSET:
+	{
+		const bool set = (criteria.getType() == searchCriteria::TYPE_FLAGS_SET);
+		const int flags = criteria.getFlags();
+
+		// FLAG_PASSED has no IMAP equivalent (see messageFlagList())
+		std::vector <string> keys;
+
+		if (flags & message::FLAG_SEEN) keys.push_back(set ? "SEEN" : "UNSEEN");
+		if (flags & message::FLAG_RECENT) keys.push_back(set ? "RECENT" : "NOT RECENT");
+		if (flags & message::FLAG_DELETED) keys.push_back(set ? "DELETED" : "UNDELETED");
+		if (flags & message::FLAG_REPLIED) keys.push_back(set ? "ANSWERED" : "UNANSWERED");
+		if (flags & message::FLAG_MARKED) keys.push_back(set ? "FLAGGED" : "UNFLAGGED");
+		if (flags & message::FLAG_DRAFT) keys.push_back(set ? "DRAFT" : "UNDRAFT");
+
+		if (keys.empty())
+		{
+			parts.back() += "ALL";
+		}
+		else if (keys.size() == 1 || topLevel)
+		{
+			for (std::vector <string>::size_type i = 0 ; i < keys.size() ; ++i)
+			{
+				if (i != 0)
+					parts.back() += ' ';
+
+				parts.back() += keys[i];
+			}
+		}
+		else
+		{
+			parts.back() += '(';
+
+			for (std::vector <string>::size_type i = 0 ; i < keys.size() ; ++i)
+			{
+				if (i != 0)
+					parts.back() += ' ';
+
+				parts.back() += keys[i];
+			}
+
+			parts.back() += ')';
+		}
+
+		break;
+	}
+	case searchCriteria::TYPE_HEADER:
+	{
+		const string& name = criteria.getFieldName();
+
+		if (utility::stringUtils::isStringEqualNoCase(name, string("from")) ||
+		    utility::stringUtils::isStringEqualNoCase(name, string("to")) ||
+		    utility::stringUtils::isStringEqualNoCase(name, string("cc")) ||
+		    utility::stringUtils::isStringEqualNoCase(name, string("bcc")) ||
+		    utility::stringUtils::isStringEqualNoCase(name, string("subject")))
+		{
+			parts.back() += utility::stringUtils::toUpper(name);
+		}
+		else
+		{
+			parts.back() += "HEADER ";
+			appendSearchString(name, parts);
+		}
+
+		parts.back() += ' ';
+		appendSearchString(criteria.getValue(), parts);
+
+		break;
+	}
+	case searchCriteria::TYPE_BODY:
+
+		parts.back() += "BODY ";
+		appendSearchString(criteria.getValue(), parts);
+
+		break;
+
+	case searchCriteria::TYPE_TEXT:
+
+		parts.back() += "TEXT ";
+		appendSearchString(criteria.getValue(), parts);
+
+		break;
+
+	case searchCriteria::TYPE_SENT_SINCE:
+	case searchCriteria::TYPE_SENT_BEFORE:
+	{
+		// date ::= date_day "-" date_month "-" date_year
+		static const char* monthNames[12] =
+			{ "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+			  "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+
+		const datetime& date = criteria.getDate();
+
+		std::ostringstream key;
+		key.imbue(std::locale::classic());
+
+		key << (criteria.getType() == searchCriteria::TYPE_SENT_SINCE ? "SENTSINCE " : "SENTBEFORE ")
+		    << date.getDay() << '-'
+		    << monthNames[std::min(std::max(date.getMonth() - 1, 0), 11)] << '-'
+		    << date.getYear();
+
+		parts.back() += key.str();
+		break;
+	}
+	case searchCriteria::TYPE_LARGER:
+	case searchCriteria::TYPE_SMALLER:
+	{
+		std::ostringstream key;
+		key.imbue(std::locale::classic());
+
+		key << (criteria.getType() == searchCriteria::TYPE_LARGER ? "LARGER " : "SMALLER ")
+		    << std::max(criteria.getSize(), 0);
+
+		parts.back() += key.str();
+		break;
+	}
+
+	}
+}
+
+
+// static
+void IMAPUtils::appendSearchString(const string& str, std::vector <string>& parts)
+{
+	bool literal = false;
+
+	for (string::const_iterator it = str.begin() ; !literal && it != str.end() ; ++it)
+	{
+		const unsigned char c = *it;
+
+		if (c == 0x00 || c == 0x0d || c == 0x0a || c >= 0x80)
+			literal = true;
+	}
+
+	if (literal)
+	{
+		parts.push_back(str);
+		parts.push_back("");
+	}
+	else
+	{
+		// Always quote, as an atom could be mistaken for a search key
+		string& out = parts.back();
+
+		out += '"';
+
+		for (string::const_iterator it = str.begin() ; it != str.end() ; ++it)
+		{
+			if (*it == '"' || *it == '\\')
+				out += '\\';
+
+			out += *it;
+		}
+
+		out += '"';
+	}
+}
+
+
 // static
 void IMAPUtils::convertAddressList
 	(const IMAPParser::address_list& src, mailboxList& dest)
@@ -0,0 +1,198 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002-2013 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+#include "vmime/config.hpp"
+
+
+#if VMIME_HAVE_MESSAGING_FEATURES
+
+
+#include "vmime/net/messageSet.hpp"
+
+#include <algorithm>
+
+
+namespace vmime {
+namespace net {
+
+
+messageSet::messageSet()
+{
+}
+
+
+// static
+const messageSet messageSet::byNumber(const int from, const int to)
+{
+	messageSet set;
+	set.addRange(from, to);
+
+	return set;
+}
+
+
+// static
+const messageSet messageSet::byNumber(const std::vector <int>& nums)
+{
+	std::vector <int> sorted(nums);
+	std::sort(sorted.begin(), sorted.end());
+
+	messageSet set;
+
+	for (std::vector <int>::const_iterator it = sorted.begin() ; it != sorted.end() ; ++it)
+		set.addNumber(*it);
+
+	return set;
+}
+
+
+// static
+const messageSet messageSet::byNumber(const searchResult& result)
+{
+	const std::vector <searchResult::range>& ranges = result.getRanges();
+
+	messageSet set;
+
+	for (std::vector <searchResult::range>::const_iterator it = ranges.begin() ; it != ranges.end() ; ++it)
+		set.addRange(static_cast <int>(it->first), static_cast <int>(it->second));
+
+	return set;
+}
+
+
+void messageSet::addNumber(const int num)
+{
+	addRange(num, num);
+}
+
+
+void messageSet::addRange(const int from, const int to)
+{
+	int first = from;
+	int last = to;
+
+	if (last != -1 && last < first)
+		std::swap(first, last);
+
+	if (first < 1)
+		first = 1;
+
+	if (last != -1 && last < first)
+		return;
+
+	// Common case: numbers added in ascending order
+	if (m_ranges.empty() || (m_ranges.back().second != -1 && first > m_ranges.back().second + 1))
+	{
+		m_ranges.push_back(range(first, last));
+	}
+	// Adjacent to or overlapping the last range: extend it in place
+	else if (first >= m_ranges.back().first)
+	{
+		range& back = m_ranges.back();
+
+		if (back.second != -1 && (last == -1 || last > back.second))
+			back.second = last;
+	}
+	else
+	{
+		m_ranges.push_back(range(first, last));
+		normalize();
+	}
+}
+
+
+void messageSet::normalize()
+{
+	std::vector <range> ranges;
+	ranges.swap(m_ranges);
+
+	std::sort(ranges.begin(), ranges.end());
+
+	for (std::vector <range>::const_iterator it = ranges.begin() ; it != ranges.end() ; ++it)
+	{
+		if (!m_ranges.empty() &&
+		    (m_ranges.back().second == -1 || it->first <= m_ranges.back().second + 1))
+		{
+			range& last = m_ranges.back();
+
+			if (it->second == -1 || (last.second != -1 && it->second > last.second))
+				last.second = it->second;
+		}
+		else
+		{
+			m_ranges.push_back(*it);
+		}
+	}
+}
+
+
+bool messageSet::isEmpty() const
+{
+	return m_ranges.empty();
+}
+
+
+bool messageSet::contains(const int num) const
+{
+	for (std::vector <range>::const_iterator it = m_ranges.begin() ; it != m_ranges.end() ; ++it)
+	{
+		if (num < it->first)
+			return false;
+		else if (it->second == -1 || num <= it->second)
+			return true;
+	}
+
+	return false;
+}
+
+
+int messageSet::getCount(const int messageCount) const
+{
+	int count = 0;
+
+	for (std::vector <range>::const_iterator it = m_ranges.begin() ; it != m_ranges.end() ; ++it)
+	{
+		if (it->first > messageCount)
+			break;
+
+		const int last = (it->second == -1 || it->second > messageCount)
+			? messageCount : it->second;
+
+		count += last - it->first + 1;
+	}
+
+	return count;
+}
+
+
+const std::vector <messageSet::range>& messageSet::getRanges() const
+{
+	return m_ranges;
+}
+
+
+} // net
+} // vmime
+
+
+#endif // VMIME_HAVE_MESSAGING_FEATURES
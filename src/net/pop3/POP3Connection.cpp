@@ -33,10 +33,14 @@
 #include "vmime/exception.hpp"
 #include "vmime/platform.hpp"
 
+#include "vmime/utility/stringUtils.hpp"
+
 #include "vmime/security/digest/messageDigestFactory.hpp"
 
 #include "vmime/net/defaultConnectionInfos.hpp"
 
+#include <algorithm>
+
 #if VMIME_HAVE_SASL_SUPPORT
 	#include "vmime/security/sasl/SASLContext.hpp"
 #endif // VMIME_HAVE_SASL_SUPPORT
@@ -65,7 +69,7 @@ namespace pop3 {
 
 POP3Connection::POP3Connection(ref <POP3Store> store, ref <security::authenticator> auth)
 	: m_store(store), m_auth(auth), m_socket(NULL), m_timeoutHandler(NULL),
-	  m_authenticated(false), m_secured(false)
+	  m_authenticated(false), m_secured(false), m_capabilitiesFetched(false)
 {
 }
 
@@ -174,6 +178,9 @@ void POP3Connection::connect()
 
 	// Start authentication process
 	authenticate(messageId(response->getText()));
+
+	// Capabilities may have changed after authentication
+	m_capabilitiesFetched = false;
 }
 
 
@@ -207,12 +214,17 @@ void POP3Connection::internalDisconnect()
 	m_secured = false;
 
 	m_cntInfos = NULL;
+
+	m_capabilities.clear();
+	m_capabilitiesFetched = false;
+
+	m_receiveBuffer.clear();
 }
 
 
 void POP3Connection::authenticate(const messageId& randomMID)
 {
-	getAuthenticator()->setService(thisRef().dynamicCast <service>());
+	getAuthenticator()->setService(m_store.acquire());
 
 #if VMIME_HAVE_SASL_SUPPORT
 	// First, try SASL authentication
@@ -537,6 +549,9 @@ void POP3Connection::startTLS()
 		if (!response->isSuccess())
 			throw exceptions::command_error("STLS", response->getFirstLine());
 
+		// Capabilities may have changed
+		m_capabilitiesFetched = false;
+
 		ref <tls::TLSSession> tlsSession =
 			tls::TLSSession::create(m_store.acquire()->getCertificateVerifier());
 
@@ -569,6 +584,9 @@ void POP3Connection::startTLS()
 
 const std::vector <string> POP3Connection::getCapabilities()
 {
+	if (m_capabilitiesFetched)
+		return m_capabilities;
+
 	POP3Command::CAPA()->send(thisRef().dynamicCast <POP3Connection>());
 
 	ref <POP3Response> response =
@@ -582,10 +600,63 @@ const std::vector <string> POP3Connection::getCapabilities()
 			res.push_back(response->getLineAt(i));
 	}
 
+	m_capabilities = res;
+	m_capabilitiesFetched = true;
+
 	return res;
 }
 
 
+bool POP3Connection::hasCapability(const string& capa)
+{
+	const std::vector <string> capabilities = getCapabilities();
+
+	for (size_t i = 0 ; i < capabilities.size() ; ++i)
+	{
+		// Capability name may be followed by parameters
+		const string& line = capabilities[i];
+		const string name(line.begin(), std::find(line.begin(), line.end(), ' '));
+
+		if (utility::stringUtils::isStringEqualNoCase(name, capa))
+			return true;
+	}
+
+	return false;
+}
+
+
+void POP3Connection::sendCommands(const std::vector <ref <POP3Command> >& commands,
+	size_t& sent, const size_t received)
+{
+	// Maximum number of commands waiting for their response: commands
+	// are short, so they will not fill the server's receive buffer
+	static const size_t MAX_PIPELINED_COMMANDS = 256;
+
+	if (sent >= commands.size())
+		return;
+
+	size_t max = received + 1;
+
+	if (hasCapability("PIPELINING"))
+	{
+		// Wait until half of the window is free, so that commands
+		// are sent by groups
+		if (sent > received + MAX_PIPELINED_COMMANDS / 2)
+			return;
+
+		max = received + MAX_PIPELINED_COMMANDS;
+	}
+
+	string text;
+
+	for ( ; sent < commands.size() && sent < max ; ++sent)
+		text += commands[sent]->getText() + "\r\n";
+
+	if (!text.empty())
+		getSocket()->send(text);
+}
+
+
 bool POP3Connection::isConnected() const
 {
 	return m_socket && m_socket->isConnected() && m_authenticated;
@@ -349,16 +349,61 @@ void POP3Folder::fetchMessages(std::vector <ref <message> >& msg, const int opti
 	if (progress)
 		progress->start(total);
 
+	// Find messages whose header must be fetched
+	std::vector <ref <POP3Message> > headerMsgs;
+	std::vector <ref <POP3Command> > commands;
+
 	for (std::vector <ref <message> >::iterator it = msg.begin() ;
 	     it != msg.end() ; ++it)
 	{
-		(*it).dynamicCast <POP3Message>()->fetch
-			(thisRef().dynamicCast <POP3Folder>(), options);
+		ref <POP3Message> m = (*it).dynamicCast <POP3Message>();
+
+		if (m->isHeaderFetchRequired(thisRef().dynamicCast <POP3Folder>(), options))
+		{
+			headerMsgs.push_back(m);
+			commands.push_back(POP3Command::TOP(m->m_num, 0));
+		}
+		else if (progress)
+		{
+			progress->progress(++current, total);
+		}
+	}
+
+	// Send the "TOP" commands, ahead of reading the responses
+	// if the server supports pipelining
+	ref <POP3Connection> conn = store->getConnection();
+
+	string error;
+	bool failed = false;
+	size_t sent = 0;
+
+	for (size_t i = 0 ; i < commands.size() ; ++i)
+	{
+		// After an error, only read responses to commands already sent
+		if (!failed)
+			conn->sendCommands(commands, sent, i);
+		else if (i >= sent)
+			break;
+
+		try
+		{
+			headerMsgs[i]->readHeader(conn);
+		}
+		catch (exceptions::command_error& e)
+		{
+			if (!failed)
+				error = e.response();
+
+			failed = true;
+		}
 
 		if (progress)
 			progress->progress(++current, total);
 	}
 
+	if (failed)
+		throw exceptions::command_error("TOP", error);
+
 	if (options & FETCH_SIZE)
 	{
 		// Send the "LIST" command
@@ -612,38 +657,12 @@ void POP3Folder::deleteMessages(const int from, const int to)
 
 	const int to2 = (to == -1 ? m_messageCount : to);
 
-	for (int i = from ; i <= to2 ; ++i)
-	{
-		POP3Command::DELE(i)->send(store->getConnection());
-
-		ref <POP3Response> response =
-			POP3Response::readResponse(store->getConnection());
-
-		if (!response->isSuccess())
-			throw exceptions::command_error("DELE", response->getFirstLine());
-	}
-
-	// Update local flags
-	for (std::map <POP3Message*, int>::iterator it =
-	     m_messages.begin() ; it != m_messages.end() ; ++it)
-	{
-		POP3Message* msg = (*it).first;
-
-		if (msg->getNumber() >= from && msg->getNumber() <= to2)
-			msg->m_deleted = true;
-	}
-
-	// Notify message flags changed
 	std::vector <int> nums;
 
 	for (int i = from ; i <= to2 ; ++i)
 		nums.push_back(i);
 
-	events::messageChangedEvent event
-		(thisRef().dynamicCast <folder>(),
-		 events::messageChangedEvent::TYPE_FLAGS, nums);
-
-	notifyMessageChanged(event);
+	deleteMessagesImpl(store, nums);
 }
 
 
@@ -659,18 +678,6 @@ void POP3Folder::deleteMessages(const std::vector <int>& nums)
 	else if (!isOpen())
 		throw exceptions::illegal_state("Folder not open");
 
-	for (std::vector <int>::const_iterator
-	     it = nums.begin() ; it != nums.end() ; ++it)
-	{
-		POP3Command::DELE(*it)->send(store->getConnection());
-
-		ref <POP3Response> response =
-			POP3Response::readResponse(store->getConnection());
-
-		if (!response->isSuccess())
-			throw exceptions::command_error("DELE", response->getFirstLine());
-	}
-
 	// Sort message list
 	std::vector <int> list;
 
@@ -679,22 +686,75 @@ void POP3Folder::deleteMessages(const std::vector <int>& nums)
 
 	std::sort(list.begin(), list.end());
 
-	// Update local flags
-	for (std::map <POP3Message*, int>::iterator it =
-	     m_messages.begin() ; it != m_messages.end() ; ++it)
+	deleteMessagesImpl(store, list);
+}
+
+
+void POP3Folder::deleteMessagesImpl(ref <POP3Store> store, const std::vector <int>& nums)
+{
+	std::vector <ref <POP3Command> > commands;
+
+	for (std::vector <int>::const_iterator
+	     it = nums.begin() ; it != nums.end() ; ++it)
 	{
-		POP3Message* msg = (*it).first;
+		commands.push_back(POP3Command::DELE(*it));
+	}
 
-		if (std::binary_search(list.begin(), list.end(), msg->getNumber()))
-			msg->m_deleted = true;
+	// Send the "DELE" commands, ahead of reading the responses
+	// if the server supports pipelining
+	ref <POP3Connection> conn = store->getConnection();
+
+	std::vector <int> deleted;
+	string error;
+	bool failed = false;
+	size_t sent = 0;
+
+	for (size_t i = 0 ; i < commands.size() ; ++i)
+	{
+		// After an error, only read responses to commands already sent
+		if (!failed)
+			conn->sendCommands(commands, sent, i);
+		else if (i >= sent)
+			break;
+
+		ref <POP3Response> response = POP3Response::readResponse(conn);
+
+		if (response->isSuccess())
+		{
+			deleted.push_back(nums[i]);
+		}
+		else if (!failed)
+		{
+			error = response->getFirstLine();
+			failed = true;
+		}
 	}
 
-	// Notify message flags changed
-	events::messageChangedEvent event
-		(thisRef().dynamicCast <folder>(),
-		 events::messageChangedEvent::TYPE_FLAGS, list);
+	if (!deleted.empty())
+	{
+		// Update local flags
+		std::vector <int> list(deleted);
+		std::sort(list.begin(), list.end());
 
-	notifyMessageChanged(event);
+		for (std::map <POP3Message*, int>::iterator it =
+		     m_messages.begin() ; it != m_messages.end() ; ++it)
+		{
+			POP3Message* msg = (*it).first;
+
+			if (std::binary_search(list.begin(), list.end(), msg->getNumber()))
+				msg->m_deleted = true;
+		}
+
+		// Notify message flags changed
+		events::messageChangedEvent event
+			(thisRef().dynamicCast <folder>(),
+			 events::messageChangedEvent::TYPE_FLAGS, deleted);
+
+		notifyMessageChanged(event);
+	}
+
+	if (failed)
+		throw exceptions::command_error("DELE", error);
 }
 
 
@@ -827,6 +887,95 @@ std::vector <int> POP3Folder::getMessageNumbersStartingOnUID(const message::uid&
 }
 
 
+std::vector <ref <message> > POP3Folder::getNewMessages()
+{
+	ref <POP3Store> store = m_store.acquire();
+
+	if (!store)
+		throw exceptions::illegal_state("Store disconnected");
+	else if (!isOpen())
+		throw exceptions::illegal_state("Folder not open");
+
+	ref <POP3SeenUIDStore> seen = store->getSeenUIDStore();
+
+	if (!seen)
+		throw exceptions::illegal_state("Seen UID store disabled");
+
+	// Send the "UIDL" command
+	POP3Command::UIDL()->send(store->getConnection());
+
+	// Get the response
+	ref <POP3Response> response =
+		POP3Response::readMultilineResponse(store->getConnection());
+
+	if (!response->isSuccess())
+		throw exceptions::command_error("UIDL", response->getFirstLine());
+
+	// C: UIDL
+	// S: +OK
+	// S: 1 whqtswO00WBw418f9t5JxYwZ
+	// S: 2 QhdPYR:00WBw1Ph7x7
+	// S: .
+	std::map <int, string> result;
+	POP3Utils::parseMultiListOrUidlResponse(response, result);
+
+	std::vector <ref <message> > v;
+	std::vector <message::uid> uids;
+
+	ref <POP3Folder> thisFolder = thisRef().dynamicCast <POP3Folder>();
+
+	for (std::map <int, string>::const_iterator it = result.begin() ; it != result.end() ; ++it)
+	{
+		uids.push_back((*it).second);
+
+		if (!seen->isSeen((*it).second))
+		{
+			ref <POP3Message> msg = vmime::create <POP3Message>(thisFolder, (*it).first);
+			msg->m_uid = (*it).second;
+
+			v.push_back(msg);
+		}
+	}
+
+	// Forget messages which have been removed from the server
+	seen->retain(uids);
+	seen->flush();
+
+	return (v);
+}
+
+
+void POP3Folder::markMessagesSeen(const std::vector <ref <message> >& msgs)
+{
+	ref <POP3Store> store = m_store.acquire();
+
+	if (!store)
+		throw exceptions::illegal_state("Store disconnected");
+
+	ref <POP3SeenUIDStore> seen = store->getSeenUIDStore();
+
+	if (!seen)
+		throw exceptions::illegal_state("Seen UID store disabled");
+
+	std::vector <message::uid> uids;
+
+	for (std::vector <ref <message> >::const_iterator it = msgs.begin() ; it != msgs.end() ; ++it)
+	{
+		const message::uid uid = (*it)->getUniqueId();
+
+		if (uid.empty())
+			throw exceptions::unfetched_object();
+
+		uids.push_back(uid);
+	}
+
+	for (std::vector <message::uid>::const_iterator it = uids.begin() ; it != uids.end() ; ++it)
+		seen->setSeen(*it);
+
+	seen->flush();
+}
+
+
 } // pop3
 } // net
 } // vmime
@@ -173,6 +173,20 @@ void POP3Message::fetchPartHeader(ref <part> /* p */)
 
 
 void POP3Message::fetch(ref <POP3Folder> msgFolder, const int options)
+{
+	if (!isHeaderFetchRequired(msgFolder, options))
+		return;
+
+	// Emit the "TOP" command
+	ref <POP3Store> store = msgFolder->m_store.acquire();
+
+	POP3Command::TOP(m_num, 0)->send(store->getConnection());
+
+	readHeader(store->getConnection());
+}
+
+
+bool POP3Message::isHeaderFetchRequired(ref <POP3Folder> msgFolder, const int options)
 {
 	ref <POP3Folder> folder = m_folder.acquire();
 
@@ -188,24 +202,21 @@ void POP3Message::fetch(ref <POP3Folder> msgFolder, const int options)
 		folder::FETCH_ENVELOPE | folder::FETCH_CONTENT_INFO |
 		folder::FETCH_FULL_HEADER | folder::FETCH_IMPORTANCE;
 
-	if (!(options & optionsRequiringHeader))
-		return;
-
 	// No need to differenciate between FETCH_ENVELOPE,
 	// FETCH_CONTENT_INFO, ... since POP3 only permits to
 	// retrieve the whole header and not fields in particular.
+	return (options & optionsRequiringHeader) != 0;
+}
 
-	// Emit the "TOP" command
-	ref <POP3Store> store = folder->m_store.acquire();
-
-	POP3Command::TOP(m_num, 0)->send(store->getConnection());
 
+void POP3Message::readHeader(ref <POP3Connection> conn)
+{
 	try
 	{
 		string buffer;
 		utility::outputStreamStringAdapter bufferStream(buffer);
 
-		POP3Response::readLargeResponse(store->getConnection(),
+		POP3Response::readLargeResponse(conn,
 			bufferStream, /* progress */ NULL, /* predictedSize */ 0);
 
 		m_header = vmime::create <header>();
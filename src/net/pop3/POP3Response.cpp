@@ -35,7 +35,6 @@
 #include "vmime/utility/stringUtils.hpp"
 #include "vmime/utility/filteredStream.hpp"
 #include "vmime/utility/stringUtils.hpp"
-#include "vmime/utility/inputStreamSocketAdapter.hpp"
 
 #include "vmime/net/socket.hpp"
 #include "vmime/net/timeoutHandler.hpp"
@@ -46,8 +45,70 @@ namespace net {
 namespace pop3 {
 
 
-POP3Response::POP3Response(ref <socket> sok, ref <timeoutHandler> toh)
-	: m_socket(sok), m_timeoutHandler(toh)
+/** Input stream which returns data already received from the
+  * server, then data read from the socket.
+  */
+class POP3ResponseInputStream : public utility::inputStream
+{
+public:
+
+	POP3ResponseInputStream(const string& received, socket& sok)
+		: m_received(received), m_pos(0), m_socket(sok)
+	{
+	}
+
+	bool eof() const
+	{
+		return false;  // can't know
+	}
+
+	void reset()
+	{
+		// Not supported
+	}
+
+	size_type read(value_type* const data, const size_type count)
+	{
+		if (m_pos < m_received.length())
+		{
+			const size_type n = std::min(count, m_received.length() - m_pos);
+
+			std::copy(m_received.begin() + m_pos, m_received.begin() + m_pos + n, data);
+			m_pos += n;
+
+			return n;
+		}
+
+		return m_socket.receiveRaw(data, count);
+	}
+
+	size_type skip(const size_type /* count */)
+	{
+		// Not supported
+		return 0;
+	}
+
+	/** Return the received data which has not been read yet.
+	  *
+	  * @return data not read
+	  */
+	const string getUnreadData() const
+	{
+		return m_received.substr(m_pos);
+	}
+
+private:
+
+	const string m_received;
+	string::size_type m_pos;
+
+	socket& m_socket;
+};
+
+
+
+POP3Response::POP3Response(ref <socket> sok, ref <timeoutHandler> toh, string* receiveBuffer)
+	: m_socket(sok), m_timeoutHandler(toh), m_receiveBuffer(receiveBuffer)
 {
 }
 
@@ -56,7 +117,7 @@ POP3Response::POP3Response(ref <socket> sok, ref <timeoutHandler> toh)
 ref <POP3Response> POP3Response::readResponse(ref <POP3Connection> conn)
 {
 	ref <POP3Response> resp = vmime::create <POP3Response>
-		(conn->getSocket(), conn->getTimeoutHandler());
+		(conn->getSocket(), conn->getTimeoutHandler(), &conn->m_receiveBuffer);
 
 	string buffer;
 	resp->readResponseImpl(buffer, /* multiLine */ false);
@@ -73,7 +134,7 @@ ref <POP3Response> POP3Response::readResponse(ref <POP3Connection> conn)
 ref <POP3Response> POP3Response::readMultilineResponse(ref <POP3Connection> conn)
 {
 	ref <POP3Response> resp = vmime::create <POP3Response>
-		(conn->getSocket(), conn->getTimeoutHandler());
+		(conn->getSocket(), conn->getTimeoutHandler(), &conn->m_receiveBuffer);
 
 	string buffer;
 	resp->readResponseImpl(buffer, /* multiLine */ true);
@@ -101,7 +162,7 @@ ref <POP3Response> POP3Response::readLargeResponse
 	 utility::progressListener* progress, const long predictedSize)
 {
 	ref <POP3Response> resp = vmime::create <POP3Response>
-		(conn->getSocket(), conn->getTimeoutHandler());
+		(conn->getSocket(), conn->getTimeoutHandler(), &conn->m_receiveBuffer);
 
 	string firstLine;
 	resp->readResponseImpl(firstLine, os, progress, predictedSize);
@@ -152,77 +213,34 @@ size_t POP3Response::getLineCount() const
 
 void POP3Response::readResponseImpl(string& buffer, const bool multiLine)
 {
-	bool foundTerminator = false;
-
 	if (m_timeoutHandler)
 		m_timeoutHandler->resetTimeOut();
 
+	// Start with data received along with a previous response
 	buffer.clear();
+	buffer.swap(*m_receiveBuffer);
 
-	string::value_type last1 = '\0', last2 = '\0';
-
-	for ( ; !foundTerminator ; )
-	{
-		// Check whether the time-out delay is elapsed
-		if (m_timeoutHandler && m_timeoutHandler->isTimeOut())
-		{
-			if (!m_timeoutHandler->handleTimeOut())
-				throw exceptions::operation_timed_out();
-
-			m_timeoutHandler->resetTimeOut();
-		}
-
-		// Receive data from the socket
-		string receiveBuffer;
-		m_socket->receive(receiveBuffer);
-
-		if (receiveBuffer.empty())   // buffer is empty
-		{
-			platform::getHandler()->wait();
-			continue;
-		}
-
-		// We have received data: reset the time-out counter
-		if (m_timeoutHandler)
-			m_timeoutHandler->resetTimeOut();
-
-		// Check for transparent characters: '\n..' becomes '\n.'
-		const string::value_type first = receiveBuffer[0];
-
-		if (first == '.' && last2 == '\n' && last1 == '.')
-		{
-			receiveBuffer.erase(receiveBuffer.begin());
-		}
-		else if (receiveBuffer.length() >= 2 && first == '.' &&
-		         receiveBuffer[1] == '.' && last1 == '\n')
-		{
-			receiveBuffer.erase(receiveBuffer.begin());
-		}
-
-		for (string::size_type trans ;
-		     string::npos != (trans = receiveBuffer.find("\n..")) ; )
-		{
-			receiveBuffer.replace(trans, 3, "\n.");
-		}
-
-		last1 = receiveBuffer[receiveBuffer.length() - 1];
-		last2 = static_cast <char>((receiveBuffer.length() >= 2) ? receiveBuffer[receiveBuffer.length() - 2] : 0);
+	string::size_type end, scanPos = 0;
 
-		// Append the data to the response buffer
-		buffer += receiveBuffer;
+	while ((end = findResponseEnd(buffer, multiLine, scanPos)) == string::npos)
+		receive(buffer);
 
-		// Check for terminator string (and strip it if present)
-		foundTerminator = checkTerminator(buffer, multiLine);
+	// Keep data of the following responses (pipelining)
+	m_receiveBuffer->assign(buffer, end, string::npos);
+	buffer.erase(end);
 
-		// If there is an error (-ERR) when executing a command that
-		// requires a multi-line response, the error response will
-		// include only one line, so we stop waiting for a multi-line
-		// terminator and check for a "normal" one.
-		if (multiLine && !foundTerminator && buffer.length() >= 4 && buffer[0] == '-')
-		{
-			foundTerminator = checkTerminator(buffer, false);
-		}
+	// Check for transparent characters: '\n..' becomes '\n.'
+	for (string::size_type trans = 0 ;
+	     string::npos != (trans = buffer.find("\n..", trans)) ; ++trans)
+	{
+		buffer.erase(trans + 1, 1);
 	}
+
+	// Strip terminator. If there is an error (-ERR) when executing
+	// a command that requires a multi-line response, the error
+	// response will include only one line.
+	if (!checkTerminator(buffer, multiLine) && multiLine)
+		checkTerminator(buffer, false);
 }
 
 
@@ -232,19 +250,32 @@ void POP3Response::readResponseImpl
 {
 	long current = 0, total = predictedSize;
 
-	string temp;
-	bool codeDone = false;
-
 	if (progress)
 		progress->start(total);
 
 	if (m_timeoutHandler)
 		m_timeoutHandler->resetTimeOut();
 
-	utility::inputStreamSocketAdapter sis(*m_socket);
-	utility::stopSequenceFilteredInputStream <5> sfis1(sis, "\r\n.\r\n");
-	utility::stopSequenceFilteredInputStream <3> sfis2(sfis1, "\n.\n");
-	utility::dotFilteredInputStream dfis(sfis2);   // "\n.." --> "\n."
+	// Read the first line
+	string buffer;
+	buffer.swap(*m_receiveBuffer);
+
+	string::size_type lineEnd;
+
+	while ((lineEnd = buffer.find('\n')) == string::npos)
+		receive(buffer);
+
+	firstLine = utility::stringUtils::trim(buffer.substr(0, lineEnd));
+
+	if (getResponseCode(firstLine) != CODE_OK)
+	{
+		m_receiveBuffer->assign(buffer, lineEnd + 1, string::npos);
+		throw exceptions::command_error("?", firstLine);
+	}
+
+	// Read response data, until the terminator
+	POP3ResponseInputStream ris(buffer.substr(lineEnd + 1), *m_socket);
+	utility::dotTerminatedFilteredInputStream dfis(ris);   // "\n.." --> "\n.", stop at "\n.\n"
 
 	utility::inputStream& is = dfis;
 
@@ -286,35 +317,77 @@ void POP3Response::readResponseImpl
 			progress->progress(current, total);
 		}
 
-		// If we don't have extracted the response code yet
-		if (!codeDone)
-		{
-			temp.append(buffer, read);
+		// Inject the data into the output stream
+		os.write(buffer, read);
+	}
 
-			string responseData;
+	// Keep data of the following responses (pipelining)
+	*m_receiveBuffer = dfis.getTrailingData() + ris.getUnreadData();
 
-			if (stripFirstLine(temp, responseData, &firstLine) == true)
-			{
-				if (getResponseCode(firstLine) != CODE_OK)
-					throw exceptions::command_error("?", firstLine);
+	if (progress)
+		progress->stop(total);
+}
 
-				codeDone = true;
 
-				os.write(responseData.data(), responseData.length());
-				temp.clear();
+void POP3Response::receive(string& buffer)
+{
+	// Check whether the time-out delay is elapsed
+	if (m_timeoutHandler && m_timeoutHandler->isTimeOut())
+	{
+		if (!m_timeoutHandler->handleTimeOut())
+			throw exceptions::operation_timed_out();
 
-				continue;
-			}
-		}
-		else
-		{
-			// Inject the data into the output stream
-			os.write(buffer, read);
-		}
+		m_timeoutHandler->resetTimeOut();
 	}
 
-	if (progress)
-		progress->stop(total);
+	// Receive data from the socket
+	string receiveBuffer;
+	m_socket->receive(receiveBuffer);
+
+	if (receiveBuffer.empty())   // buffer is empty
+	{
+		platform::getHandler()->wait();
+		return;
+	}
+
+	// We have received data: reset the time-out counter
+	if (m_timeoutHandler)
+		m_timeoutHandler->resetTimeOut();
+
+	buffer += receiveBuffer;
+}
+
+
+// static
+string::size_type POP3Response::findResponseEnd
+	(const string& buffer, const bool multiLine, string::size_type& scanPos)
+{
+	const string::size_type firstLineEnd = buffer.find('\n');
+
+	if (firstLineEnd == string::npos)
+		return string::npos;
+
+	// Single-line response, or error response to a command
+	// which requires a multi-line response
+	if (!multiLine || buffer[0] == '-')
+		return firstLineEnd + 1;
+
+	// Multi-line response ends with a line containing a single dot
+	const string::size_type length = buffer.length();
+
+	for (string::size_type pos = std::max(firstLineEnd, scanPos) ;
+	     (pos = buffer.find("\n.", pos)) != string::npos ; ++pos)
+	{
+		if (pos + 2 < length && buffer[pos + 2] == '\n')
+			return pos + 3;
+		else if (pos + 3 < length && buffer[pos + 2] == '\r' && buffer[pos + 3] == '\n')
+			return pos + 4;
+	}
+
+	// The terminator may begin in the last bytes
+	scanPos = (length >= 3 ? length - 3 : 0);
+
+	return string::npos;
 }
 
 
@@ -0,0 +1,251 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002-2013 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+
+#include "vmime/config.hpp"
+
+
+#if VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_POP3
+
+
+#include "vmime/net/pop3/POP3SeenUIDStore.hpp"
+
+#include "vmime/exception.hpp"
+#include "vmime/platform.hpp"
+
+#include <algorithm>
+
+
+namespace vmime {
+namespace net {
+namespace pop3 {
+
+
+// Identifies a store file (format version 1)
+static const char POP3SeenUIDStore_magic[] = "VMIMEPU1\n";
+
+
+static const string POP3SeenUIDStore_hexEncode(const string& str)
+{
+	static const char hexChars[] = "0123456789abcdef";
+
+	string res;
+	res.reserve(str.length() * 2);
+
+	for (string::const_iterator it = str.begin() ; it != str.end() ; ++it)
+	{
+		const unsigned char c = static_cast <unsigned char>(*it);
+
+		res += hexChars[c >> 4];
+		res += hexChars[c & 0xf];
+	}
+
+	return res;
+}
+
+
+static const string POP3SeenUIDStore_readFile(ref <utility::file> file)
+{
+	ref <utility::inputStream> is = file->getFileReader()->getInputStream();
+
+	string data;
+	utility::stream::value_type buffer[65536];
+
+	while (!is->eof())
+	{
+		const utility::stream::size_type read = is->read(buffer, sizeof(buffer));
+
+		if (read == 0)
+			break;
+
+		data.append(buffer, read);
+	}
+
+	return data;
+}
+
+
+
+POP3SeenUIDStore::POP3SeenUIDStore(const utility::file::path& dir, const string& account)
+	: m_dir(dir), m_account(account), m_loaded(false), m_modified(false)
+{
+}
+
+
+bool POP3SeenUIDStore::isSeen(const message::uid& uid)
+{
+	load();
+
+	return m_uids.find(uid) != m_uids.end();
+}
+
+
+void POP3SeenUIDStore::setSeen(const message::uid& uid)
+{
+	load();
+
+	if (m_uids.insert(uid).second)
+		m_modified = true;
+}
+
+
+void POP3SeenUIDStore::retain(const std::vector <message::uid>& uids)
+{
+	load();
+
+	std::vector <message::uid> sorted(uids);
+	std::sort(sorted.begin(), sorted.end());
+
+	for (std::set <message::uid>::iterator it = m_uids.begin() ; it != m_uids.end() ; )
+	{
+		if (!std::binary_search(sorted.begin(), sorted.end(), *it))
+		{
+			m_uids.erase(it++);
+			m_modified = true;
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+
+int POP3SeenUIDStore::getCount()
+{
+	load();
+
+	return static_cast <int>(m_uids.size());
+}
+
+
+void POP3SeenUIDStore::flush()
+{
+	if (!m_modified)
+		return;
+
+	// One UID per line: UIDs are made of printable characters only
+	string data(POP3SeenUIDStore_magic);
+
+	for (std::set <message::uid>::const_iterator it = m_uids.begin() ; it != m_uids.end() ; ++it)
+	{
+		data += *it;
+		data += '\n';
+	}
+
+	// Write it to a temporary file, then give it its final name, so
+	// that a partially written file never replaces the previous one
+	ref <utility::fileSystemFactory> fsf = platform::getHandler()->getFileSystemFactory();
+
+	ref <utility::file> dir = fsf->create(m_dir);
+
+	if (!dir->exists())
+		dir->createDirectory(true);
+
+	ref <utility::file> tmpFile = fsf->create(getTempFilePath());
+
+	if (tmpFile->exists())
+		tmpFile->remove();
+
+	tmpFile->createFile();
+
+	{
+		ref <utility::outputStream> os = tmpFile->getFileWriter()->getOutputStream();
+
+		os->write(data.data(), data.length());
+		os->flush();
+	}
+
+	ref <utility::file> file = fsf->create(getFilePath());
+
+	if (file->exists())
+		file->remove();
+
+	tmpFile->rename(getFilePath());
+
+	m_modified = false;
+}
+
+
+void POP3SeenUIDStore::load()
+{
+	if (m_loaded)
+		return;
+
+	m_loaded = true;
+
+	ref <utility::fileSystemFactory> fsf = platform::getHandler()->getFileSystemFactory();
+	ref <utility::file> file = fsf->create(getFilePath());
+
+	if (!file->exists())
+	{
+		// The previous file has been removed, but the new one has not
+		// been renamed yet: the temporary file has been fully written
+		file = fsf->create(getTempFilePath());
+
+		if (!file->exists())
+			return;
+	}
+
+	const string data = POP3SeenUIDStore_readFile(file);
+	const string::size_type magicLength = sizeof(POP3SeenUIDStore_magic) - 1;
+
+	if (data.compare(0, magicLength, POP3SeenUIDStore_magic) != 0)
+		return;  // Invalid file
+
+	// Lines are sorted, so each UID is inserted at the end of the set
+	for (string::size_type pos = magicLength ; pos < data.length() ; )
+	{
+		const string::size_type end = data.find('\n', pos);
+
+		if (end == string::npos)
+			break;  // Incomplete line
+
+		if (end != pos)
+			m_uids.insert(m_uids.end(), string(data.begin() + pos, data.begin() + end));
+
+		pos = end + 1;
+	}
+}
+
+
+const utility::file::path POP3SeenUIDStore::getFilePath() const
+{
+	// Account names may contain characters which are not allowed
+	// in file names, so they are hex-encoded
+	return m_dir / utility::file::path::component("a" + POP3SeenUIDStore_hexEncode(m_account));
+}
+
+
+const utility::file::path POP3SeenUIDStore::getTempFilePath() const
+{
+	return m_dir / utility::file::path::component("a" + POP3SeenUIDStore_hexEncode(m_account) + ".tmp");
+}
+
+
+} // pop3
+} // net
+} // vmime
+
+
+#endif // VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_POP3
@@ -61,6 +61,7 @@ const POP3ServiceInfos::props& POP3ServiceInfos::getProperties() const
 		property("options.sasl", serviceInfos::property::TYPE_BOOLEAN, "true"),
 		property("options.sasl.fallback", serviceInfos::property::TYPE_BOOLEAN, "true"),
 #endif // VMIME_HAVE_SASL_SUPPORT
+		property("seen.path", serviceInfos::property::TYPE_STRING, ""),
 
 		// Common properties
 		property(serviceInfos::property::AUTH_USERNAME, serviceInfos::property::FLAG_REQUIRED),
@@ -84,6 +85,7 @@ const POP3ServiceInfos::props& POP3ServiceInfos::getProperties() const
 		property("options.sasl", serviceInfos::property::TYPE_BOOLEAN, "true"),
 		property("options.sasl.fallback", serviceInfos::property::TYPE_BOOLEAN, "true"),
 #endif // VMIME_HAVE_SASL_SUPPORT
+		property("seen.path", serviceInfos::property::TYPE_STRING, ""),
 
 		// Common properties
 		property(serviceInfos::property::AUTH_USERNAME, serviceInfos::property::FLAG_REQUIRED),
@@ -114,6 +116,7 @@ const std::vector <serviceInfos::property> POP3ServiceInfos::getAvailablePropert
 	list.push_back(p.PROPERTY_OPTIONS_SASL);
 	list.push_back(p.PROPERTY_OPTIONS_SASL_FALLBACK);
 #endif // VMIME_HAVE_SASL_SUPPORT
+	list.push_back(p.PROPERTY_SEEN_PATH);
 
 	// Common properties
 	list.push_back(p.PROPERTY_AUTH_USERNAME);
@@ -33,8 +33,10 @@
 #include "vmime/net/pop3/POP3Response.hpp"
 
 #include "vmime/exception.hpp"
+#include "vmime/platform.hpp"
 
 #include <algorithm>
+#include <sstream>
 
 
 namespace vmime {
@@ -109,6 +111,33 @@ void POP3Store::connect()
 	if (isConnected())
 		throw exceptions::already_connected();
 
+	// Seen UID store, keyed by server and user name
+	const string seenPath = getInfos().getPropertyValue <string>(getSession(),
+		sm_infos.getProperties().PROPERTY_SEEN_PATH);
+
+	if (!seenPath.empty())
+	{
+		std::ostringstream account;
+
+		if (getInfos().hasProperty(getSession(), sm_infos.getProperties().PROPERTY_AUTH_USERNAME))
+		{
+			account << getInfos().getPropertyValue <string>(getSession(),
+				sm_infos.getProperties().PROPERTY_AUTH_USERNAME) << '@';
+		}
+
+		account << getInfos().getPropertyValue <string>(getSession(),
+				sm_infos.getProperties().PROPERTY_SERVER_ADDRESS)
+			<< ':' << getInfos().getPropertyValue <port_t>(getSession(),
+				sm_infos.getProperties().PROPERTY_SERVER_PORT);
+
+		m_seenUIDStore = vmime::create <POP3SeenUIDStore>
+			(platform::getHandler()->getFileSystemFactory()->stringToPath(seenPath), account.str());
+	}
+	else
+	{
+		m_seenUIDStore = NULL;
+	}
+
 	m_connection = vmime::create <POP3Connection>
 		(thisRef().dynamicCast <POP3Store>(), getAuthenticator());
 
@@ -179,6 +208,12 @@ void POP3Store::disconnect()
 }
 
 
+ref <POP3SeenUIDStore> POP3Store::getSeenUIDStore()
+{
+	return m_seenUIDStore;
+}
+
+
 void POP3Store::noop()
 {
 	if (!m_connection)
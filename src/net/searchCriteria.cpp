@@ -0,0 +1,671 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002-2013 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+
+#include "vmime/config.hpp"
+
+
+#if VMIME_HAVE_MESSAGING_FEATURES
+
+
+#include "vmime/net/searchCriteria.hpp"
+#include "vmime/net/folder.hpp"
+
+#include "vmime/header.hpp"
+#include "vmime/message.hpp"
+#include "vmime/body.hpp"
+#include "vmime/text.hpp"
+#include "vmime/charset.hpp"
+#include "vmime/constants.hpp"
+
+#include "vmime/utility/stringUtils.hpp"
+#include "vmime/utility/outputStreamStringAdapter.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+
+namespace vmime {
+namespace net {
+
+
+//
+// searchCriteria
+//
+
+searchCriteria::searchCriteria(const Types type)
+	: m_type(type), m_flags(0), m_size(0)
+{
+}
+
+
+// static
+ref <searchCriteria> searchCriteria::all()
+{
+	return vmime::create <searchCriteria>(TYPE_ALL);
+}
+
+
+// static
+ref <searchCriteria> searchCriteria::allOf(ref <const searchCriteria> a, ref <const searchCriteria> b)
+{
+	ref <searchCriteria> c = vmime::create <searchCriteria>(TYPE_AND);
+
+	c->m_children.push_back(a);
+	c->m_children.push_back(b);
+
+	return c;
+}
+
+
+// static
+ref <searchCriteria> searchCriteria::allOf(const std::vector <ref <const searchCriteria> >& list)
+{
+	if (list.empty())
+		return all();
+
+	ref <searchCriteria> c = vmime::create <searchCriteria>(TYPE_AND);
+	c->m_children = list;
+
+	return c;
+}
+
+
+// static
+ref <searchCriteria> searchCriteria::anyOf(ref <const searchCriteria> a, ref <const searchCriteria> b)
+{
+	ref <searchCriteria> c = vmime::create <searchCriteria>(TYPE_OR);
+
+	c->m_children.push_back(a);
+	c->m_children.push_back(b);
+
+	return c;
+}
+
+
+// static
+ref <searchCriteria> searchCriteria::negate(ref <const searchCriteria> c)
+{
+	ref <searchCriteria> n = vmime::create <searchCriteria>(TYPE_NOT);
+	n->m_children.push_back(c);
+
+	return n;
+}
+
+
+// static
+ref <searchCriteria> searchCriteria::flagsSet(const int flags)
+{
+	ref <searchCriteria> c = vmime::create <searchCriteria>(TYPE_FLAGS_SET);
+	c->m_flags = flags;
+
+	return c;
+}
+
+
+// static
+ref <searchCriteria> searchCriteria::flagsUnset(const int flags)
+{
+	ref <searchCriteria> c = vmime::create <searchCriteria>(TYPE_FLAGS_UNSET);
+	c->m_flags = flags;
+
+	return c;
+}
+
+
+// static
+ref <searchCriteria> searchCriteria::headerContains(const string& fieldName, const string& value)
+{
+	ref <searchCriteria> c = vmime::create <searchCriteria>(TYPE_HEADER);
+	c->m_fieldName = fieldName;
+	c->m_value = value;
+
+	return c;
+}
+
+
+// static
+ref <searchCriteria> searchCriteria::bodyContains(const string& value)
+{
+	ref <searchCriteria> c = vmime::create <searchCriteria>(TYPE_BODY);
+	c->m_value = value;
+
+	return c;
+}
+
+
+// static
+ref <searchCriteria> searchCriteria::textContains(const string& value)
+{
+	ref <searchCriteria> c = vmime::create <searchCriteria>(TYPE_TEXT);
+	c->m_value = value;
+
+	return c;
+}
+
+
+// static
+ref <searchCriteria> searchCriteria::sentSince(const datetime& date)
+{
+	ref <searchCriteria> c = vmime::create <searchCriteria>(TYPE_SENT_SINCE);
+	c->m_date = date;
+
+	return c;
+}
+
+
+// static
+ref <searchCriteria> searchCriteria::sentBefore(const datetime& date)
+{
+	ref <searchCriteria> c = vmime::create <searchCriteria>(TYPE_SENT_BEFORE);
+	c->m_date = date;
+
+	return c;
+}
+
+
+// static
+ref <searchCriteria> searchCriteria::sizeLarger(const int size)
+{
+	ref <searchCriteria> c = vmime::create <searchCriteria>(TYPE_LARGER);
+	c->m_size = size;
+
+	return c;
+}
+
+
+// static
+ref <searchCriteria> searchCriteria::sizeSmaller(const int size)
+{
+	ref <searchCriteria> c = vmime::create <searchCriteria>(TYPE_SMALLER);
+	c->m_size = size;
+
+	return c;
+}
+
+
+searchCriteria::Types searchCriteria::getType() const
+{
+	return m_type;
+}
+
+
+const std::vector <ref <const searchCriteria> >& searchCriteria::getChildren() const
+{
+	return m_children;
+}
+
+
+int searchCriteria::getFlags() const
+{
+	return m_flags;
+}
+
+
+const string& searchCriteria::getFieldName() const
+{
+	return m_fieldName;
+}
+
+
+const string& searchCriteria::getValue() const
+{
+	return m_value;
+}
+
+
+const datetime& searchCriteria::getDate() const
+{
+	return m_date;
+}
+
+
+int searchCriteria::getSize() const
+{
+	return m_size;
+}
+
+
+int searchCriteria::getFetchOptions() const
+{
+	int options = 0;
+
+	switch (m_type)
+	{
+	case TYPE_FLAGS_SET:
+	case TYPE_FLAGS_UNSET:
+
+		options = folder::FETCH_FLAGS;
+		break;
+
+	case TYPE_HEADER:
+	case TYPE_SENT_SINCE:
+	case TYPE_SENT_BEFORE:
+
+		options = folder::FETCH_FULL_HEADER;
+		break;
+
+	case TYPE_LARGER:
+	case TYPE_SMALLER:
+
+		options = folder::FETCH_SIZE;
+		break;
+
+	default:
+
+		break;
+	}
+
+	for (std::vector <ref <const searchCriteria> >::const_iterator
+	     it = m_children.begin() ; it != m_children.end() ; ++it)
+	{
+		options |= (*it)->getFetchOptions();
+	}
+
+	return options;
+}
+
+
+bool searchCriteria::matches(ref <const message> msg) const
+{
+	// Message contents are extracted at most once, and only if needed
+	ref <vmime::message> contents;
+
+	return matchesImpl(msg, contents);
+}
+
+
+bool searchCriteria::matchesImpl(ref <const message> msg, ref <vmime::message>& contents) const
+{
+	switch (m_type)
+	{
+	case TYPE_ALL:
+
+		return true;
+
+	case TYPE_AND:
+
+		for (std::vector <ref <const searchCriteria> >::const_iterator
+		     it = m_children.begin() ; it != m_children.end() ; ++it)
+		{
+			if (!(*it)->matchesImpl(msg, contents))
+				return false;
+		}
+
+		return true;
+
+	case TYPE_OR:
+
+		for (std::vector <ref <const searchCriteria> >::const_iterator
+		     it = m_children.begin() ; it != m_children.end() ; ++it)
+		{
+			if ((*it)->matchesImpl(msg, contents))
+				return true;
+		}
+
+		return false;
+
+	case TYPE_NOT:
+
+		return !m_children.front()->matchesImpl(msg, contents);
+
+	case TYPE_FLAGS_SET:
+
+		return (msg->getFlags() & m_flags) == m_flags;
+
+	case TYPE_FLAGS_UNSET:
+
+		return (msg->getFlags() & m_flags) == 0;
+
+	case TYPE_HEADER:
+
+		return headerContains(*msg->getHeader(), m_fieldName, m_value);
+
+	case TYPE_BODY:
+	case TYPE_TEXT:
+	{
+		if (contents == NULL)
+		{
+			string data;
+			utility::outputStreamStringAdapter os(data);
+
+			msg->extract(os, NULL, 0, -1, true);
+
+			contents = vmime::create <vmime::message>();
+			contents->parse(data);
+		}
+
+		if (m_type == TYPE_TEXT &&
+		    (containsNoCase(contents->getHeader()->generate(), m_value) ||
+		     headerContains(*contents->getHeader(), "", m_value)))
+		{
+			return true;
+		}
+
+		return bodyContains(*contents, m_value);
+	}
+	case TYPE_SENT_SINCE:
+	case TYPE_SENT_BEFORE:
+	{
+		ref <const headerField> field;
+
+		try
+		{
+			field = msg->getHeader()->findField(fields::DATE);
+		}
+		catch (exceptions::no_such_field&)
+		{
+			return false;
+		}
+
+		const datetime& date = *field->getValue().dynamicCast <const datetime>();
+
+		// Only the day is significant, in the zone of the message
+		const int msgDay = (date.getYear() * 12 + date.getMonth()) * 31 + date.getDay();
+		const int day = (m_date.getYear() * 12 + m_date.getMonth()) * 31 + m_date.getDay();
+
+		return (m_type == TYPE_SENT_SINCE) ? (msgDay >= day) : (msgDay < day);
+	}
+	case TYPE_LARGER:
+
+		return msg->getSize() > m_size;
+
+	case TYPE_SMALLER:
+
+		return msg->getSize() < m_size;
+	}
+
+	return false;
+}
+
+
+// static
+bool searchCriteria::headerContains(const header& hdr, const string& fieldName, const string& value)
+{
+	const std::vector <ref <const headerField> > fields = hdr.getFieldList();
+
+	for (std::vector <ref <const headerField> >::const_iterator
+	     it = fields.begin() ; it != fields.end() ; ++it)
+	{
+		if (!fieldName.empty() &&
+		    !utility::stringUtils::isStringEqualNoCase((*it)->getName(), fieldName))
+		{
+			continue;
+		}
+
+		if (value.empty())
+			return true;
+
+		const text decoded = *text::decodeAndUnfold((*it)->getValue()->generate());
+
+		if (containsNoCase(decoded.getConvertedText(charsets::UTF_8), value))
+			return true;
+	}
+
+	return false;
+}
+
+
+// static
+bool searchCriteria::bodyContains(const bodyPart& part, const string& value)
+{
+	ref <const body> bdy = part.getBody();
+
+	if (bdy->getPartCount() != 0)
+	{
+		for (size_t i = 0 ; i < bdy->getPartCount() ; ++i)
+		{
+			if (bodyContains(*bdy->getPartAt(i), value))
+				return true;
+		}
+
+		return false;
+	}
+
+	// Only text parts are searched, once decoded (as IMAP servers do)
+	if (bdy->getContentType().getType() != mediaTypes::TEXT)
+		return false;
+
+	string data;
+	utility::outputStreamStringAdapter os(data);
+
+	bdy->getContents()->extract(os);
+	os.flush();
+
+	string converted;
+
+	try
+	{
+		charset::convert(data, converted, bdy->getCharset(), charsets::UTF_8);
+	}
+	catch (exceptions::charset_conv_error&)
+	{
+		converted = data;
+	}
+
+	return containsNoCase(converted, value);
+}
+
+
+// static
+bool searchCriteria::containsNoCase(const string& str, const string& what)
+{
+	if (what.empty())
+		return true;
+
+	return utility::stringUtils::toLower(str).find
+		(utility::stringUtils::toLower(what)) != string::npos;
+}
+
+
+
+//
+// searchResult
+//
+
+searchResult::searchResult()
+	: m_options(0), m_count(0), m_min(0), m_max(0)
+{
+}
+
+
+int searchResult::getReturnOptions() const
+{
+	return m_options;
+}
+
+
+unsigned int searchResult::getCount() const
+{
+	return m_count;
+}
+
+
+unsigned int searchResult::getMin() const
+{
+	return m_min;
+}
+
+
+unsigned int searchResult::getMax() const
+{
+	return m_max;
+}
+
+
+const std::vector <searchResult::range>& searchResult::getRanges() const
+{
+	return m_ranges;
+}
+
+
+const std::vector <int> searchResult::getNumbers() const
+{
+	std::vector <int> numbers;
+	numbers.reserve(m_count);
+
+	for (std::vector <range>::const_iterator it = m_ranges.begin() ; it != m_ranges.end() ; ++it)
+	{
+		for (unsigned int n = it->first ; n <= it->second && n != 0 ; ++n)
+			numbers.push_back(static_cast <int>(n));
+	}
+
+	return numbers;
+}
+
+
+const string searchResult::getSet() const
+{
+	std::ostringstream oss;
+	oss.imbue(std::locale::classic());
+
+	for (std::vector <range>::const_iterator it = m_ranges.begin() ; it != m_ranges.end() ; ++it)
+	{
+		if (it != m_ranges.begin())
+			oss << ',';
+
+		oss << it->first;
+
+		if (it->second != it->first)
+			oss << ':' << it->second;
+	}
+
+	return oss.str();
+}
+
+
+void searchResult::appendNumber(const unsigned int num)
+{
+	if (!m_ranges.empty() && m_ranges.back().second + 1 == num)
+		m_ranges.back().second = num;
+	else
+		m_ranges.push_back(range(num, num));
+
+	if (m_count == 0)
+		m_min = num;
+
+	m_max = num;
+	++m_count;
+
+	m_options |= RETURN_MIN | RETURN_MAX | RETURN_COUNT | RETURN_ALL;
+}
+
+
+void searchResult::setSet(const string& set)
+{
+	std::vector <range> ranges;
+
+	string::size_type pos = 0;
+
+	while (pos < set.length())
+	{
+		string::size_type end = set.find(',', pos);
+
+		if (end == string::npos)
+			end = set.length();
+
+		const string item(set.begin() + pos, set.begin() + end);
+
+		std::istringstream iss(item);
+		iss.imbue(std::locale::classic());
+
+		unsigned int first = 0, last = 0;
+		iss >> first;
+
+		if (item.find(':') != string::npos)
+		{
+			iss.ignore(1);
+			iss >> last;
+
+			if (first > last)
+				std::swap(first, last);
+		}
+		else
+		{
+			last = first;
+		}
+
+		if (!iss.fail() && first != 0)
+			ranges.push_back(range(first, last));
+
+		pos = end + 1;
+	}
+
+	// Normalize: sort and merge overlapping or adjacent ranges
+	std::sort(ranges.begin(), ranges.end());
+
+	m_ranges.clear();
+	m_count = 0;
+
+	for (std::vector <range>::const_iterator it = ranges.begin() ; it != ranges.end() ; ++it)
+	{
+		if (!m_ranges.empty() && it->first <= m_ranges.back().second + 1)
+		{
+			if (it->second > m_ranges.back().second)
+				m_ranges.back().second = it->second;
+		}
+		else
+		{
+			m_ranges.push_back(*it);
+		}
+	}
+
+	for (std::vector <range>::const_iterator it = m_ranges.begin() ; it != m_ranges.end() ; ++it)
+		m_count += it->second - it->first + 1;
+
+	m_min = m_ranges.empty() ? 0 : m_ranges.front().first;
+	m_max = m_ranges.empty() ? 0 : m_ranges.back().second;
+
+	m_options |= RETURN_MIN | RETURN_MAX | RETURN_COUNT | RETURN_ALL;
+}
+
+
+void searchResult::setReturnOptions(const int options)
+{
+	m_options = options;
+}
+
+
+void searchResult::setCount(const unsigned int count)
+{
+	m_count = count;
+}
+
+
+void searchResult::setMin(const unsigned int min)
+{
+	m_min = min;
+}
+
+
+void searchResult::setMax(const unsigned int max)
+{
+	m_max = max;
+}
+
+
+} // net
+} // vmime
+
+
+#endif // VMIME_HAVE_MESSAGING_FEATURES
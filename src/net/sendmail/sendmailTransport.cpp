@@ -39,6 +39,7 @@
 #include "vmime/utility/smartPtr.hpp"
 
 #include "vmime/utility/streamUtils.hpp"
+#include "vmime/utility/bufferedOutputStream.hpp"
 
 #include "vmime/net/defaultConnectionInfos.hpp"
 
@@ -191,15 +192,21 @@ void sendmailTransport::internalSend
 	// Copy message data from input stream to output pipe
 	utility::outputStream& os = *(proc->getStdIn());
 
+	// The filter below writes each line separately: collect
+	// them, so that the pipe is not written line by line
+	utility::bufferedOutputStream bos(os);
+
 	// Workaround for lame sendmail implementations that
 	// can't handle CRLF eoln sequences: we transform CRLF
 	// sequences into LF characters.
-	utility::CRLFToLFFilteredOutputStream fos(os);
+	utility::CRLFToLFFilteredOutputStream fos(bos);
 
 	// TODO: remove 'Bcc:' field from message header
 
 	utility::bufferedStreamCopy(is, fos, size, progress);
 
+	fos.flush();
+
 	// Wait for sendmail to exit
 	proc->waitForFinish();
 }
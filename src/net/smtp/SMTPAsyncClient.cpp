@@ -0,0 +1,566 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002-2013 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+#include "vmime/config.hpp"
+
+
+#if VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_SMTP
+
+
+#include "vmime/net/smtp/SMTPAsyncClient.hpp"
+#include "vmime/net/smtp/SMTPCommand.hpp"
+#include "vmime/net/smtp/SMTPTransport.hpp"
+
+#include "vmime/exception.hpp"
+#include "vmime/platform.hpp"
+
+#include "vmime/utility/inputStreamStringAdapter.hpp"
+
+
+namespace vmime {
+namespace net {
+namespace smtp {
+
+
+SMTPAsyncClient::delivery::delivery(const mailbox& expeditor, const mailboxList& recipients,
+	ref <utility::inputStream> is, const utility::stream::size_type size)
+	: expeditor(expeditor), recipients(recipients), stream(is), size(size),
+	  eightBit(false), done(false), sent(false)
+{
+}
+
+
+
+SMTPAsyncClient::SMTPAsyncClient(ref <socket> sok, const string& hostName)
+	: m_socket(sok), m_hostName(hostName), m_state(STATE_GREETING),
+	  m_quitRequested(false), m_needReset(false), m_commandsWritten(0),
+	  m_responsesRead(0), m_resetSent(false), m_mailAccepted(false),
+	  m_acceptedCount(0), m_outputAdapter(m_output), m_dataFilter(NULL)
+{
+	if (m_hostName.empty())
+		m_hostName = platform::getHandler()->getHostName();
+}
+
+
+SMTPAsyncClient::~SMTPAsyncClient()
+{
+	delete m_dataFilter;
+}
+
+
+ref <SMTPAsyncClient::delivery> SMTPAsyncClient::send
+	(const mailbox& expeditor, const mailboxList& recipients,
+	 ref <utility::inputStream> is, const utility::stream::size_type size)
+{
+	return queueDelivery(vmime::create <delivery>(expeditor, recipients, is, size));
+}
+
+
+ref <SMTPAsyncClient::delivery> SMTPAsyncClient::send
+	(ref <vmime::message> msg, const mailbox& expeditor, const mailboxList& recipients)
+{
+	// Generate the message now: content handlers may block
+	string data;
+	utility::outputStreamStringAdapter os(data);
+
+	msg->generate(os);
+	os.flush();
+
+	ref <utility::inputStream> is =
+		vmime::create <utility::inputStreamStringAdapter>(data);
+
+	ref <delivery> d = vmime::create <delivery>(expeditor, recipients, is, data.length());
+
+	bool has8Bit = false, hasBinary = false;
+	SMTPTransport::findEncodings(msg, has8Bit, hasBinary);
+
+	// Binary data can only be sent with BDAT, which is not supported:
+	// as SMTPTransport does in this case, declare it as 8-bit data
+	d->eightBit = (has8Bit || hasBinary);
+
+	return queueDelivery(d);
+}
+
+
+ref <SMTPAsyncClient::delivery> SMTPAsyncClient::queueDelivery(ref <delivery> d)
+{
+	if (isFinished())
+	{
+		d->done = true;
+		d->error = (m_error.empty() ? exceptions::not_connected().what() : m_error);
+
+		return d;
+	}
+
+	m_deliveries.push_back(d);
+
+	if (m_state == STATE_READY)
+		startDelivery();
+
+	return d;
+}
+
+
+void SMTPAsyncClient::quit()
+{
+	m_quitRequested = true;
+
+	if (m_state == STATE_READY)
+		startDelivery();
+}
+
+
+bool SMTPAsyncClient::wantRead() const
+{
+	switch (m_state)
+	{
+	case STATE_GREETING:
+	case STATE_EHLO:
+	case STATE_HELO:
+	case STATE_ENVELOPE:
+	case STATE_DATA_END:
+	case STATE_QUIT:
+
+		return true;
+
+	default:
+
+		return false;
+	}
+}
+
+
+bool SMTPAsyncClient::wantWrite() const
+{
+	return !isFinished() && (!m_output.empty() || m_state == STATE_DATA);
+}
+
+
+void SMTPAsyncClient::onReadable()
+{
+	try
+	{
+		string data;
+		m_socket->receive(data);
+
+		m_responseState.responseBuffer += data;
+
+		ref <SMTPResponse> resp;
+
+		while (wantRead() && (resp = SMTPResponse::parseResponse(m_responseState)) != NULL)
+			processResponse(resp);
+	}
+	catch (vmime::exception& e)
+	{
+		fail(e.what());
+	}
+}
+
+
+void SMTPAsyncClient::onWritable()
+{
+	try
+	{
+		while (!isFinished())
+		{
+			if (m_output.empty() && m_state == STATE_DATA)
+				fillData();
+
+			if (m_output.empty())
+				break;
+
+			const socket::size_type n = m_socket->sendRawNonBlocking
+				(m_output.data(), static_cast <socket::size_type>(m_output.length()));
+
+			if (n <= 0)
+				break;  // would block
+
+			m_output.erase(0, static_cast <string::size_type>(n));
+		}
+	}
+	catch (vmime::exception& e)
+	{
+		fail(e.what());
+	}
+}
+
+
+void SMTPAsyncClient::run()
+{
+	while (!isFinished() && (wantRead() || wantWrite()))
+	{
+		if (wantWrite())
+		{
+			onWritable();
+
+			// The socket does not accept more data, or the message
+			// stream has no data available yet
+			if (!isFinished() && wantWrite())
+			{
+				platform::getHandler()->wait();
+				continue;
+			}
+		}
+
+		if (!isFinished() && wantRead() && m_output.empty())
+		{
+			onReadable();
+
+			if (m_socket->getStatus() & socket::STATUS_WOULDBLOCK)
+				platform::getHandler()->wait();
+		}
+	}
+}
+
+
+SMTPAsyncClient::State SMTPAsyncClient::getState() const
+{
+	return m_state;
+}
+
+
+bool SMTPAsyncClient::isFinished() const
+{
+	return m_state == STATE_CLOSED || m_state == STATE_ERROR;
+}
+
+
+const string SMTPAsyncClient::getError() const
+{
+	return m_error;
+}
+
+
+bool SMTPAsyncClient::hasExtension(const string& name) const
+{
+	return m_extensions.find(name) != m_extensions.end();
+}
+
+
+void SMTPAsyncClient::processResponse(ref <SMTPResponse> resp)
+{
+	switch (m_state)
+	{
+	case STATE_GREETING:
+
+		if (resp->getCode() != 220)
+		{
+			fail(exceptions::connection_greeting_error(resp->getText()).what());
+			break;
+		}
+
+		writeCommand(SMTPCommand::EHLO(m_hostName));
+		m_state = STATE_EHLO;
+
+		break;
+
+	case STATE_EHLO:
+
+		if (resp->getCode() != 250)
+		{
+			// Try "Basic" SMTP
+			writeCommand(SMTPCommand::HELO(m_hostName));
+			m_state = STATE_HELO;
+
+			break;
+		}
+
+		SMTPTransport::parseExtensions(resp, m_extensions);
+
+		m_state = STATE_READY;
+		startDelivery();
+
+		break;
+
+	case STATE_HELO:
+
+		if (resp->getCode() != 250)
+		{
+			fail(exceptions::connection_greeting_error(resp->getText()).what());
+			break;
+		}
+
+		m_state = STATE_READY;
+		startDelivery();
+
+		break;
+
+	case STATE_ENVELOPE:
+
+		processEnvelopeResponse(resp);
+		break;
+
+	case STATE_DATA_END:
+	{
+		ref <delivery> d = m_deliveries.front();
+
+		if (resp->getCode() == 250 && d->error.empty())
+			d->sent = true;
+		else if (d->error.empty())
+			d->error = resp->getText();
+
+		finishDelivery();
+		break;
+	}
+	case STATE_QUIT:
+
+		m_state = STATE_CLOSED;
+		m_socket->disconnect();
+
+		break;
+
+	default:
+
+		// Unexpected response (eg. "421 Service not available")
+		fail(resp->getText());
+		break;
+	}
+}
+
+
+void SMTPAsyncClient::processEnvelopeResponse(ref <SMTPResponse> resp)
+{
+	ref <delivery> d = m_deliveries.front();
+
+	const size_t index = m_responsesRead++;
+	const size_t mailIndex = (m_resetSent ? 1 : 0);
+	const size_t dataIndex = m_commands.size() - 1;
+
+	if (index < mailIndex)
+	{
+		// Response to RSET
+		if (resp->getCode() != 250)
+		{
+			fail(exceptions::command_error("RSET", resp->getText()).what());
+			return;
+		}
+	}
+	else if (index == mailIndex)
+	{
+		// Response to MAIL
+		m_mailAccepted = (resp->getCode() == 250);
+
+		if (!m_mailAccepted)
+			d->error = resp->getText();
+	}
+	else if (index < dataIndex)
+	{
+		// Response to RCPT
+		if (SMTPTransport::processRecipientResponse(resp, m_mailAccepted,
+				d->recipientStatuses[index - mailIndex - 1]))
+		{
+			++m_acceptedCount;
+		}
+	}
+	else
+	{
+		// Response to DATA
+		if (d->error.empty() && m_acceptedCount == 0)
+			d->error = exceptions::no_recipient().what();
+
+		if (resp->getCode() != 354)
+		{
+			if (d->error.empty())
+				d->error = resp->getText();
+
+			finishDelivery();
+		}
+		else if (!d->error.empty())
+		{
+			// The server should not have accepted DATA: send an
+			// empty message, which has no recipient anyway
+			m_output += ".\r\n";
+			m_state = STATE_DATA_END;
+		}
+		else
+		{
+			m_dataFilter = new utility::dotFilteredOutputStream(m_outputAdapter);
+			m_state = STATE_DATA;
+		}
+
+		return;
+	}
+
+	if (m_commandsWritten < m_commands.size())
+	{
+		// Without pipelining, stop as soon as the message cannot be sent
+		if (!m_mailAccepted && index >= mailIndex)
+		{
+			finishDelivery();
+		}
+		else if (m_commandsWritten == dataIndex && m_acceptedCount == 0)
+		{
+			d->error = exceptions::no_recipient().what();
+			finishDelivery();
+		}
+		else
+		{
+			writeCommand(m_commands[m_commandsWritten++]);
+		}
+	}
+}
+
+
+void SMTPAsyncClient::startDelivery()
+{
+	if (m_deliveries.empty())
+	{
+		if (m_quitRequested)
+		{
+			writeCommand(SMTPCommand::QUIT());
+			m_state = STATE_QUIT;
+		}
+
+		return;
+	}
+
+	ref <delivery> d = m_deliveries.front();
+
+	for (size_t i = 0 ; i < d->recipients.getMailboxCount() ; ++i)
+		d->recipientStatuses.push_back(transport::recipientStatus(*d->recipients.getMailboxAt(i)));
+
+	if (d->recipients.isEmpty())
+	{
+		d->error = exceptions::no_recipient().what();
+		finishDelivery();
+
+		return;
+	}
+
+	const bool utf8 = hasExtension("SMTPUTF8");
+
+	m_commands.clear();
+	m_commandsWritten = 0;
+	m_responsesRead = 0;
+	m_resetSent = m_needReset;
+	m_mailAccepted = false;
+	m_acceptedCount = 0;
+
+	if (m_needReset)
+		m_commands.push_back(SMTPCommand::RSET());
+
+	const string bodyType =
+		(d->eightBit && hasExtension("8BITMIME")) ? "8BITMIME" : "";
+
+	m_commands.push_back(SMTPCommand::MAIL
+		(d->expeditor, utf8, hasExtension("SIZE") ? d->size : 0, bodyType));
+
+	for (size_t i = 0 ; i < d->recipients.getMailboxCount() ; ++i)
+		m_commands.push_back(SMTPCommand::RCPT(*d->recipients.getMailboxAt(i), utf8));
+
+	m_commands.push_back(SMTPCommand::DATA());
+
+	m_needReset = true;
+	m_state = STATE_ENVELOPE;
+
+	// Send all commands at once if the server supports pipelining
+	const size_t count = (hasExtension("PIPELINING") ? m_commands.size() : 1);
+
+	while (m_commandsWritten < count)
+		writeCommand(m_commands[m_commandsWritten++]);
+}
+
+
+void SMTPAsyncClient::finishDelivery()
+{
+	ref <delivery> d = m_deliveries.front();
+	m_deliveries.pop_front();
+
+	d->done = true;
+	d->stream = NULL;
+
+	delete m_dataFilter;
+	m_dataFilter = NULL;
+	m_state = STATE_READY;
+
+	startDelivery();
+}
+
+
+void SMTPAsyncClient::writeCommand(ref <SMTPCommand> cmd)
+{
+	m_output += cmd->getText();
+	m_output += "\r\n";
+}
+
+
+void SMTPAsyncClient::fillData()
+{
+	ref <delivery> d = m_deliveries.front();
+
+	utility::stream::value_type buffer[16384];
+	const utility::stream::size_type n = d->stream->read(buffer, sizeof(buffer));
+
+	if (n != 0)
+		m_dataFilter->write(buffer, n);
+
+	if (d->stream->eof())
+	{
+		m_dataFilter->flush();
+		delete m_dataFilter;
+		m_dataFilter = NULL;
+
+		m_output += "\r\n.\r\n";
+		m_state = STATE_DATA_END;
+	}
+}
+
+
+void SMTPAsyncClient::fail(const string& error)
+{
+	m_state = STATE_ERROR;
+	m_error = error;
+
+	m_output.clear();
+
+	for (std::deque <ref <delivery> >::iterator it = m_deliveries.begin() ;
+	     it != m_deliveries.end() ; ++it)
+	{
+		(*it)->done = true;
+
+		if ((*it)->error.empty())
+			(*it)->error = error;
+	}
+
+	m_deliveries.clear();
+	delete m_dataFilter;
+	m_dataFilter = NULL;
+
+	try
+	{
+		if (m_socket->isConnected())
+			m_socket->disconnect();
+	}
+	catch (vmime::exception&)
+	{
+		// Ignore
+	}
+}
+
+
+} // smtp
+} // net
+} // vmime
+
+
+#endif // VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_SMTP
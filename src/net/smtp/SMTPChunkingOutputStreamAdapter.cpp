@@ -0,0 +1,163 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002-2013 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+#include "vmime/config.hpp"
+
+
+#if VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_SMTP
+
+
+#include "vmime/net/smtp/SMTPChunkingOutputStreamAdapter.hpp"
+#include "vmime/net/smtp/SMTPTransport.hpp"
+#include "vmime/net/smtp/SMTPCommand.hpp"
+#include "vmime/net/smtp/SMTPResponse.hpp"
+
+#include "vmime/exception.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+
+namespace vmime {
+namespace net {
+namespace smtp {
+
+
+// Maximum number of chunks sent before the responses are read,
+// when pipelining is used
+static const unsigned int MAX_PENDING_RESPONSES = 16;
+
+
+SMTPChunkingOutputStreamAdapter::SMTPChunkingOutputStreamAdapter
+	(SMTPTransport& transport, const bool pipelining)
+	: m_transport(transport), m_pipelining(pipelining),
+	  m_buffer(getBlockSize()), m_bufferUsed(0), m_pendingResponses(0)
+{
+}
+
+
+void SMTPChunkingOutputStreamAdapter::write
+	(const value_type* const data, const size_type count)
+{
+	const value_type* curData = data;
+	size_type curCount = count;
+
+	while (curCount != 0)
+	{
+		// Large write: send data directly, without copying
+		if (m_bufferUsed == 0 && curCount >= m_buffer.size())
+		{
+			sendChunk(curData, m_buffer.size(), false);
+
+			curData += m_buffer.size();
+			curCount -= m_buffer.size();
+
+			continue;
+		}
+
+		const size_type n = std::min(m_buffer.size() - m_bufferUsed, curCount);
+		std::memcpy(&m_buffer[m_bufferUsed], curData, n);
+
+		m_bufferUsed += n;
+		curData += n;
+		curCount -= n;
+
+		if (m_bufferUsed == m_buffer.size())
+		{
+			sendChunk(&m_buffer[0], m_bufferUsed, false);
+			m_bufferUsed = 0;
+		}
+	}
+}
+
+
+void SMTPChunkingOutputStreamAdapter::flush()
+{
+	if (m_bufferUsed != 0)
+	{
+		sendChunk(&m_buffer[0], m_bufferUsed, false);
+		m_bufferUsed = 0;
+	}
+}
+
+
+void SMTPChunkingOutputStreamAdapter::finish(const bool readLastResponse)
+{
+	sendChunk(&m_buffer[0], m_bufferUsed, true);
+	m_bufferUsed = 0;
+
+	const unsigned int keep = (readLastResponse ? 0 : 1);
+
+	while (m_pendingResponses > keep)
+		readChunkResponse();
+
+	m_pendingResponses = 0;
+}
+
+
+utility::stream::size_type SMTPChunkingOutputStreamAdapter::getBlockSize()
+{
+	return utility::outputStream::getBlockSize();
+}
+
+
+void SMTPChunkingOutputStreamAdapter::sendChunk
+	(const value_type* const data, const size_type count, const bool last)
+{
+	m_transport.sendRequest(SMTPCommand::BDAT(count, last));
+
+	if (count != 0)
+		m_transport.m_socket->sendRaw(data, count);
+
+	++m_pendingResponses;
+
+	// Without pipelining, wait for the server to accept the chunk
+	// before sending the next one (the response to the last chunk
+	// is read by finish())
+	if (!last && (!m_pipelining || m_pendingResponses > MAX_PENDING_RESPONSES))
+		readChunkResponse();
+}
+
+
+void SMTPChunkingOutputStreamAdapter::readChunkResponse()
+{
+	ref <SMTPResponse> resp = m_transport.readResponse();
+
+	--m_pendingResponses;
+
+	if (resp->getCode() != 250)
+	{
+		m_pendingResponses = 0;
+
+		m_transport.internalDisconnect();
+		throw exceptions::command_error("BDAT", resp->getText());
+	}
+}
+
+
+} // smtp
+} // net
+} // vmime
+
+
+#endif // VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_SMTP
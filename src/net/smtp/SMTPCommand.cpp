@@ -87,7 +87,8 @@ ref <SMTPCommand> SMTPCommand::STARTTLS()
 
 
 // static
-ref <SMTPCommand> SMTPCommand::MAIL(const mailbox& mbox, const bool utf8)
+ref <SMTPCommand> SMTPCommand::MAIL(const mailbox& mbox, const bool utf8,
+	const string::size_type size, const string& bodyType)
 {
 	std::ostringstream cmd;
 	cmd.imbue(std::locale::classic());
@@ -108,6 +109,14 @@ ref <SMTPCommand> SMTPCommand::MAIL(const mailbox& mbox, const bool utf8)
 	if (utf8)
 		cmd << " SMTPUTF8";
 
+	// Message size declaration (RFC 1870)
+	if (size != 0)
+		cmd << " SIZE=" << size;
+
+	// Body type: 8BITMIME (RFC 6152) or BINARYMIME (RFC 3030)
+	if (!bodyType.empty())
+		cmd << " BODY=" << bodyType;
+
 	return createCommand(cmd.str());
 }
 
@@ -149,6 +158,20 @@ ref <SMTPCommand> SMTPCommand::DATA()
 }
 
 
+// static
+ref <SMTPCommand> SMTPCommand::BDAT(const string::size_type chunkSize, const bool last)
+{
+	std::ostringstream cmd;
+	cmd.imbue(std::locale::classic());
+	cmd << "BDAT " << chunkSize;
+
+	if (last)
+		cmd << " LAST";
+
+	return createCommand(cmd.str());
+}
+
+
 // static
 ref <SMTPCommand> SMTPCommand::NOOP()
 {
@@ -43,7 +43,7 @@ namespace smtp {
 
 SMTPResponse::SMTPResponse(ref <socket> sok, ref <timeoutHandler> toh, const state& st)
 	: m_socket(sok), m_timeoutHandler(toh),
-	  m_responseBuffer(st.responseBuffer), m_responseContinues(false)
+	  m_responseBuffer(st.responseBuffer)
 {
 }
 
@@ -89,66 +89,30 @@ const string SMTPResponse::getText() const
 ref <SMTPResponse> SMTPResponse::readResponse
 	(ref <socket> sok, ref <timeoutHandler> toh, const state& st)
 {
-	ref <SMTPResponse> resp = vmime::create <SMTPResponse>(sok, toh, st);
+	state currentState = st;
 
-	resp->readResponse();
-
-	return resp;
-}
-
-
-void SMTPResponse::readResponse()
-{
-	responseLine line = getNextResponse();
-	m_lines.push_back(line);
-
-	while (m_responseContinues)
-	{
-		line = getNextResponse();
-		m_lines.push_back(line);
-	}
-}
-
-
-const string SMTPResponse::readResponseLine()
-{
-	string currentBuffer = m_responseBuffer;
-
-	if (m_timeoutHandler)
-		m_timeoutHandler->resetTimeOut();
+	if (toh)
+		toh->resetTimeOut();
 
 	while (true)
 	{
-		// Get a line from the response buffer
-		const string::size_type lineEnd = currentBuffer.find_first_of('\n');
-
-		if (lineEnd != string::npos)
-		{
-			string::size_type actualLineEnd = lineEnd;
-
-			if (actualLineEnd != 0 && currentBuffer[actualLineEnd - 1] == '\r')  // CRLF case
-				actualLineEnd--;
-
-			const string line(currentBuffer.begin(), currentBuffer.begin() + actualLineEnd);
+		ref <SMTPResponse> resp = parseResponse(currentState);
 
-			currentBuffer.erase(currentBuffer.begin(), currentBuffer.begin() + lineEnd + 1);
-			m_responseBuffer = currentBuffer;
-
-			return line;
-		}
+		if (resp)
+			return resp;
 
 		// Check whether the time-out delay is elapsed
-		if (m_timeoutHandler && m_timeoutHandler->isTimeOut())
+		if (toh && toh->isTimeOut())
 		{
-			if (!m_timeoutHandler->handleTimeOut())
+			if (!toh->handleTimeOut())
 				throw exceptions::operation_timed_out();
 
-			m_timeoutHandler->resetTimeOut();
+			toh->resetTimeOut();
 		}
 
 		// Receive data from the socket
 		string receiveBuffer;
-		m_socket->receive(receiveBuffer);
+		sok->receive(receiveBuffer);
 
 		if (receiveBuffer.empty())   // buffer is empty
 		{
@@ -156,26 +120,65 @@ const string SMTPResponse::readResponseLine()
 			continue;
 		}
 
-		currentBuffer += receiveBuffer;
+		if (toh)
+			toh->resetTimeOut();
+
+		currentState.responseBuffer += receiveBuffer;
 	}
 }
 
 
-const SMTPResponse::responseLine SMTPResponse::getNextResponse()
+// static
+ref <SMTPResponse> SMTPResponse::parseResponse(state& st)
 {
-	string line = readResponseLine();
+	const string& buffer = st.responseBuffer;
+
+	// Look for the last line of the response: a multi-line
+	// response has a '-' after the code on all other lines
+	string::size_type lineStart = 0;
+	string::size_type lineEnd = 0;
+
+	while (true)
+	{
+		lineEnd = buffer.find('\n', lineStart);
+
+		if (lineEnd == string::npos)
+			return NULL;  // incomplete response
 
-	const int code = extractResponseCode(line);
-	string text;
+		if (lineEnd - lineStart < 4 || buffer[lineStart + 3] != '-')
+			break;
 
-	m_responseContinues = (line.length() >= 4 && line[3] == '-');
+		lineStart = lineEnd + 1;
+	}
 
-	if (line.length() > 4)
-		text = utility::stringUtils::trim(line.substr(4));
-	else
-		text = "";
+	ref <SMTPResponse> resp = vmime::create <SMTPResponse>
+		(ref <socket>(), ref <timeoutHandler>(), state());
+
+	for (lineStart = 0 ; lineStart <= lineEnd ; )
+	{
+		const string::size_type end = buffer.find('\n', lineStart);
+		string::size_type actualEnd = end;
 
-	return responseLine(code, text);
+		if (actualEnd != lineStart && buffer[actualEnd - 1] == '\r')  // CRLF case
+			actualEnd--;
+
+		const string line(buffer.begin() + lineStart, buffer.begin() + actualEnd);
+
+		const int code = extractResponseCode(line);
+		string text;
+
+		if (line.length() > 4)
+			text = utility::stringUtils::trim(line.substr(4));
+
+		resp->m_lines.push_back(responseLine(code, text));
+
+		lineStart = end + 1;
+	}
+
+	st.responseBuffer.erase(0, lineEnd + 1);
+	resp->m_responseBuffer = st.responseBuffer;
+
+	return resp;
 }
 
 
@@ -56,6 +56,7 @@ const SMTPServiceInfos::props& SMTPServiceInfos::getProperties() const
 	{
 		// SMTP-specific options
 		property("options.need-authentication", serviceInfos::property::TYPE_BOOLEAN, "false"),
+		property("options.chunking", serviceInfos::property::TYPE_BOOLEAN, "true"),
 #if VMIME_HAVE_SASL_SUPPORT
 		property("options.sasl", serviceInfos::property::TYPE_BOOLEAN, "true"),
 		property("options.sasl.fallback", serviceInfos::property::TYPE_BOOLEAN, "false"),
@@ -78,6 +79,7 @@ const SMTPServiceInfos::props& SMTPServiceInfos::getProperties() const
 	{
 		// SMTP-specific options
 		property("options.need-authentication", serviceInfos::property::TYPE_BOOLEAN, "false"),
+		property("options.chunking", serviceInfos::property::TYPE_BOOLEAN, "true"),
 #if VMIME_HAVE_SASL_SUPPORT
 		property("options.sasl", serviceInfos::property::TYPE_BOOLEAN, "true"),
 		property("options.sasl.fallback", serviceInfos::property::TYPE_BOOLEAN, "false"),
@@ -107,6 +109,7 @@ const std::vector <serviceInfos::property> SMTPServiceInfos::getAvailablePropert
 
 	// SMTP-specific options
 	list.push_back(p.PROPERTY_OPTIONS_NEEDAUTH);
+	list.push_back(p.PROPERTY_OPTIONS_CHUNKING);
 #if VMIME_HAVE_SASL_SUPPORT
 	list.push_back(p.PROPERTY_OPTIONS_SASL);
 	list.push_back(p.PROPERTY_OPTIONS_SASL_FALLBACK);
@@ -31,15 +31,19 @@
 #include "vmime/net/smtp/SMTPResponse.hpp"
 #include "vmime/net/smtp/SMTPCommand.hpp"
 #include "vmime/net/smtp/SMTPCommandSet.hpp"
+#include "vmime/net/smtp/SMTPChunkingOutputStreamAdapter.hpp"
 
 #include "vmime/exception.hpp"
 #include "vmime/platform.hpp"
 #include "vmime/mailboxList.hpp"
+#include "vmime/message.hpp"
 
 #include "vmime/utility/filteredStream.hpp"
 #include "vmime/utility/stringUtils.hpp"
 #include "vmime/utility/outputStreamSocketAdapter.hpp"
+#include "vmime/utility/bufferedOutputStream.hpp"
 #include "vmime/utility/streamUtils.hpp"
+#include "vmime/utility/countingOutputStream.hpp"
 
 #include "vmime/net/defaultConnectionInfos.hpp"
 
@@ -229,37 +233,60 @@ void SMTPTransport::helo()
 	else
 	{
 		m_extendedSMTP = true;
-		m_extensions.clear();
 
-		// Get supported extensions from SMTP response
-		// One extension per line, format is: EXT PARAM1 PARAM2...
-		for (size_t i = 1, n = resp->getLineCount() ; i < n ; ++i)
-		{
-			const string line = resp->getLineAt(i).getText();
-			std::istringstream iss(line);
+		parseExtensions(resp, m_extensions);
+	}
+}
 
-			string ext;
-			iss >> ext;
 
-			std::vector <string> params;
-			string param;
+// static
+void SMTPTransport::parseExtensions(ref <SMTPResponse> resp,
+	std::map <string, std::vector <string> >& extensions)
+{
+	extensions.clear();
 
-			// Special case: some servers send "AUTH=MECH [MECH MECH...]"
-			if (ext.length() >= 5 && utility::stringUtils::toUpper(ext.substr(0, 5)) == "AUTH=")
-			{
-				params.push_back(utility::stringUtils::toUpper(ext.substr(5)));
-				ext = "AUTH";
-			}
+	// Get supported extensions from SMTP response
+	// One extension per line, format is: EXT PARAM1 PARAM2...
+	for (size_t i = 1, n = resp->getLineCount() ; i < n ; ++i)
+	{
+		const string line = resp->getLineAt(i).getText();
+		std::istringstream iss(line);
+
+		string ext;
+		iss >> ext;
 
-			while (iss >> param)
-				params.push_back(utility::stringUtils::toUpper(param));
+		ext = utility::stringUtils::toUpper(ext);
 
-			m_extensions[ext] = params;
+		std::vector <string> params;
+		string param;
+
+		// Special case: some servers send "AUTH=MECH [MECH MECH...]"
+		if (ext.length() >= 5 && ext.substr(0, 5) == "AUTH=")
+		{
+			params.push_back(ext.substr(5));
+			ext = "AUTH";
 		}
+
+		while (iss >> param)
+			params.push_back(utility::stringUtils::toUpper(param));
+
+		extensions[ext] = params;
 	}
 }
 
 
+// static
+bool SMTPTransport::processRecipientResponse(ref <SMTPResponse> resp,
+	const bool mailAccepted, recipientStatus& status)
+{
+	status.response = resp->getText();
+	status.accepted = mailAccepted &&
+		(resp->getCode() == 250 || resp->getCode() == 251);
+
+	return status.accepted;
+}
+
+
 void SMTPTransport::authenticate()
 {
 	if (!m_extendedSMTP)
@@ -521,16 +548,23 @@ void SMTPTransport::disconnect()
 }
 
 
-void SMTPTransport::internalDisconnect()
+void SMTPTransport::internalDisconnect(const bool sendQuit)
 {
-	try
-	{
-		sendRequest(SMTPCommand::QUIT());
-		readResponse();
-	}
-	catch (exception&)
+	// Already closed (eg. when a chunk has been rejected)
+	if (!m_socket)
+		return;
+
+	if (sendQuit)
 	{
-		// Not important
+		try
+		{
+			sendRequest(SMTPCommand::QUIT());
+			readResponse();
+		}
+		catch (exception&)
+		{
+			// Not important
+		}
 	}
 
 	m_socket->disconnect();
@@ -560,10 +594,59 @@ void SMTPTransport::noop()
 }
 
 
-void SMTPTransport::send
+bool SMTPTransport::hasExtension(const string& name) const
+{
+	return m_extensions.find(name) != m_extensions.end();
+}
+
+
+bool SMTPTransport::canUseChunking()
+{
+	return hasExtension("CHUNKING") &&
+		GET_PROPERTY(bool, PROPERTY_OPTIONS_CHUNKING);
+}
+
+
+// static
+void SMTPTransport::findEncodings
+	(ref <const bodyPart> part, bool& has8Bit, bool& hasBinary)
+{
+	ref <const body> bdy = part->getBody();
+
+	if (bdy->getPartCount() == 0)
+	{
+		const string enc = bdy->getEncoding().getName();
+
+		if (utility::stringUtils::isStringEqualNoCase(enc, encodingTypes::BINARY))
+			hasBinary = true;
+		else if (utility::stringUtils::isStringEqualNoCase(enc, encodingTypes::EIGHT_BIT))
+			has8Bit = true;
+	}
+
+	for (size_t i = 0 ; i < bdy->getPartCount() ; ++i)
+		findEncodings(bdy->getPartAt(i), has8Bit, hasBinary);
+}
+
+
+const string SMTPTransport::getBodyType(ref <const vmime::message> msg, const bool chunking) const
+{
+	bool has8Bit = false, hasBinary = false;
+	findEncodings(msg, has8Bit, hasBinary);
+
+	// Binary data can only be sent with BDAT
+	if (hasBinary && chunking && hasExtension("BINARYMIME"))
+		return "BINARYMIME";
+	else if ((has8Bit || hasBinary) && hasExtension("8BITMIME"))
+		return "8BITMIME";
+
+	return "";
+}
+
+
+void SMTPTransport::sendEnvelope
 	(const mailbox& expeditor, const mailboxList& recipients,
-	 utility::inputStream& is, const utility::stream::size_type size,
-	 utility::progressListener* progress, const mailbox& sender)
+	 const mailbox& sender, const utility::stream::size_type size,
+	 const string& bodyType, const bool chunking)
 {
 	if (!isConnected())
 		throw exceptions::not_connected();
@@ -576,8 +659,7 @@ void SMTPTransport::send
 
 
 	const bool needReset = m_needReset;
-	const bool hasPipelining =
-		m_extensions.find("PIPELINING") != m_extensions.end();
+	const bool hasPipelining = hasExtension("PIPELINING");
 
 	ref <SMTPResponse> resp;
 	ref <SMTPCommandSet> commands = SMTPCommandSet::create(hasPipelining);
@@ -587,13 +669,13 @@ void SMTPTransport::send
 		commands->addCommand(SMTPCommand::RSET());
 
 	// Emit the "MAIL" command
-	const bool hasSMTPUTF8 =
-		m_extensions.find("SMTPUTF8") != m_extensions.end();
+	const bool hasSMTPUTF8 = hasExtension("SMTPUTF8");
+	const bool hasSize = hasExtension("SIZE");
 
 	if (!sender.isEmpty())
-		commands->addCommand(SMTPCommand::MAIL(sender, hasSMTPUTF8));
+		commands->addCommand(SMTPCommand::MAIL(sender, hasSMTPUTF8, hasSize ? size : 0, bodyType));
 	else
-		commands->addCommand(SMTPCommand::MAIL(expeditor, hasSMTPUTF8));
+		commands->addCommand(SMTPCommand::MAIL(expeditor, hasSMTPUTF8, hasSize ? size : 0, bodyType));
 
 	// Now, we will need to reset next time
 	m_needReset = true;
@@ -605,8 +687,10 @@ void SMTPTransport::send
 		commands->addCommand(SMTPCommand::RCPT(mbox, hasSMTPUTF8));
 	}
 
-	// Prepare sending of message data
-	commands->addCommand(SMTPCommand::DATA());
+	// Prepare sending of message data (BDAT commands are sent
+	// along with the data itself)
+	if (!chunking)
+		commands->addCommand(SMTPCommand::DATA());
 
 	// Read response for "RSET" command
 	if (needReset)
@@ -620,17 +704,26 @@ void SMTPTransport::send
 		}
 	}
 
+	// When MAIL or RCPT is rejected, the transaction is dropped but the
+	// connection is kept (it will be reset before the next message)
+	const unsigned int recipientCount = static_cast <unsigned int>(recipients.getMailboxCount());
+	const unsigned int dataCommandCount = (chunking ? 0 : 1);
+
 	// Read response for "MAIL" command
 	commands->writeToSocket(m_socket);
 
 	if ((resp = readResponse())->getCode() != 250)
 	{
-		internalDisconnect();
-		throw exceptions::command_error(commands->getLastCommandSent()->getText(), resp->getText());
+		const string commandText = commands->getLastCommandSent()->getText();
+
+		if (hasPipelining)
+			cancelEnvelope(recipientCount + dataCommandCount, !chunking);
+
+		throw exceptions::command_error(commandText, resp->getText());
 	}
 
 	// Read responses for "RCPT TO" commands
-	for (size_t i = 0 ; i < recipients.getMailboxCount() ; ++i)
+	for (unsigned int i = 0 ; i < recipientCount ; ++i)
 	{
 		commands->writeToSocket(m_socket);
 
@@ -639,31 +732,175 @@ void SMTPTransport::send
 		if (resp->getCode() != 250 &&
 		    resp->getCode() != 251)
 		{
-			internalDisconnect();
-			throw exceptions::command_error(commands->getLastCommandSent()->getText(), resp->getText());
+			const string commandText = commands->getLastCommandSent()->getText();
+
+			if (hasPipelining)
+				cancelEnvelope(recipientCount - i - 1 + dataCommandCount, !chunking);
+
+			throw exceptions::command_error(commandText, resp->getText());
 		}
 	}
 
+	if (chunking)
+		return;
+
 	// Read response for "DATA" command
 	commands->writeToSocket(m_socket);
 
 	if ((resp = readResponse())->getCode() != 354)
-	{
-		internalDisconnect();
 		throw exceptions::command_error(commands->getLastCommandSent()->getText(), resp->getText());
+}
+
+
+void SMTPTransport::cancelEnvelope(const unsigned int count, const bool dataSent)
+{
+	for (unsigned int i = 0 ; i < count ; ++i)
+	{
+		ref <SMTPResponse> resp = readResponse();
+
+		// The server is waiting for message data, and there is
+		// no way to cancel it: we have to close the connection
+		if (dataSent && i == count - 1 && resp->getCode() == 354)
+			internalDisconnect();
+	}
+}
+
+
+void SMTPTransport::send
+	(const mailbox& expeditor, const mailboxList& recipients,
+	 utility::inputStream& is, const utility::stream::size_type size,
+	 utility::progressListener* progress, const mailbox& sender)
+{
+	const bool chunking = canUseChunking();
+
+	sendEnvelope(expeditor, recipients, sender, size, NULL_STRING, chunking);
+
+	// Send the message data in chunks, as is
+	if (chunking)
+	{
+		SMTPChunkingOutputStreamAdapter chos(*this, hasExtension("PIPELINING"));
+
+		try
+		{
+			utility::bufferedStreamCopy(is, chos, size, progress);
+		}
+		catch (...)
+		{
+			// Responses to the chunks already sent are left unread
+			internalDisconnect(false);
+			throw;
+		}
+
+		chos.finish();
+		return;
 	}
 
 	// Send the message data
 	// Stream copy with "\n." to "\n.." transformation
-	utility::outputStreamSocketAdapter sos(*m_socket);
-	utility::dotFilteredOutputStream fos(sos);
+	utility::outputStreamSocketAdapter sos(*m_socket, /* cork */ true);
+	utility::bufferedOutputStream bos(sos);
+	utility::dotFilteredOutputStream fos(bos);
+
+	try
+	{
+		utility::bufferedStreamCopy(is, fos, size, progress);
+	}
+	catch (...)
+	{
+		// The server is still reading message data, and the
+		// transfer cannot be cancelled
+		internalDisconnect(false);
+		throw;
+	}
+
+	// Send end-of-data delimiter, along with the end of data
+	bos.write("\r\n.\r\n", 5);
+	bos.flush();
+
+	ref <SMTPResponse> resp;
+
+	if ((resp = readResponse())->getCode() != 250)
+	{
+		internalDisconnect();
+		throw exceptions::command_error("DATA", resp->getText());
+	}
+}
+
+
+void SMTPTransport::send
+	(ref <vmime::message> msg, const mailbox& expeditor, const mailboxList& recipients,
+	 utility::progressListener* progress, const mailbox& sender)
+{
+	const generationContext& ctx = generationContext::getDefaultContext();
+
+	// Compute the message size, without generating the message; only
+	// declare it if it is exact, as unbuffered data is not read for this
+	const utility::stream::size_type size = msg->getGeneratedSize(ctx);
+	const bool sizeExact = msg->isGeneratedSizeExact(ctx);
+
+	const bool chunking = canUseChunking();
+
+	sendEnvelope(expeditor, recipients, sender, sizeExact ? size : 0,
+		getBodyType(msg, chunking), chunking);
+
+	// Generate the message directly to the socket, in chunks
+	if (chunking)
+	{
+		SMTPChunkingOutputStreamAdapter chos(*this, hasExtension("PIPELINING"));
+		utility::countingOutputStream cos(chos, size, progress);
+
+		if (progress)
+			progress->start(static_cast <long>(size));
+
+		try
+		{
+			msg->generate(cos);
+		}
+		catch (...)
+		{
+			// Responses to the chunks already sent are left unread
+			internalDisconnect(false);
+			throw;
+		}
+
+		chos.finish();
+
+		if (progress)
+			progress->stop(static_cast <long>(cos.getCount()));
+
+		return;
+	}
+
+	// Generate the message directly to the socket,
+	// with "\n." to "\n.." transformation
+	utility::outputStreamSocketAdapter sos(*m_socket, /* cork */ true);
+	utility::bufferedOutputStream bos(sos);
+	utility::dotFilteredOutputStream fos(bos);
+	utility::countingOutputStream cos(fos, size, progress);
+
+	if (progress)
+		progress->start(static_cast <long>(size));
+
+	try
+	{
+		msg->generate(cos);
+	}
+	catch (...)
+	{
+		// The server is still reading message data, and the
+		// transfer cannot be cancelled
+		internalDisconnect(false);
+		throw;
+	}
 
-	utility::bufferedStreamCopy(is, fos, size, progress);
+	// Send end-of-data delimiter, along with the end of data
+	bos.write("\r\n.\r\n", 5);
+	bos.flush();
 
-	fos.flush();
+	if (progress)
+		progress->stop(static_cast <long>(cos.getCount()));
 
-	// Send end-of-data delimiter
-	m_socket->sendRaw("\r\n.\r\n", 5);
+	ref <SMTPResponse> resp;
 
 	if ((resp = readResponse())->getCode() != 250)
 	{
@@ -673,6 +910,258 @@ void SMTPTransport::send
 }
 
 
+void SMTPTransport::sendBatch(std::vector <messageToSend>& msgs, utility::progressListener* progress)
+{
+	if (!isConnected())
+		throw exceptions::not_connected();
+
+	const int total = static_cast <int>(msgs.size());
+
+	if (progress)
+		progress->start(total);
+
+	// Message whose data has been sent, but for which the server
+	// has not acknowledged the data yet
+	messageToSend* pending = NULL;
+
+	for (std::vector <messageToSend>::size_type i = 0 ; i < msgs.size() ; ++i)
+	{
+		messageToSend& m = msgs[i];
+
+		m.sent = false;
+		m.size = 0;
+		m.error.clear();
+		m.recipientStatuses.clear();
+
+		mailbox expeditor = m.expeditor;
+		mailboxList recipients = m.recipients;
+		mailbox sender = m.sender;
+
+		if (m.expeditor.isEmpty())
+		{
+			recipients.removeAllMailboxes();
+
+			try
+			{
+				extractEnvelope(m.msg, expeditor, recipients, sender);
+			}
+			catch (exceptions::no_expeditor& e)
+			{
+				m.error = e.what();
+			}
+		}
+
+		if (m.error.empty() && recipients.isEmpty())
+			m.error = exceptions::no_recipient().what();
+
+		if (m.error.empty())
+		{
+			for (size_t j = 0 ; j < recipients.getMailboxCount() ; ++j)
+				m.recipientStatuses.push_back(recipientStatus(*recipients.getMailboxAt(j)));
+
+			if (m.expeditor.isEmpty())
+			{
+				headerExchanger exchanger(*this, m.msg);
+				sendBatchMessage(m, expeditor, recipients, sender, pending);
+			}
+			else
+			{
+				sendBatchMessage(m, expeditor, recipients, sender, pending);
+			}
+		}
+
+		if (progress)
+			progress->progress(static_cast <int>(i) + 1, total);
+	}
+
+	if (pending != NULL)
+		readBatchResponse(*pending);
+
+	if (progress)
+		progress->stop(total);
+}
+
+
+void SMTPTransport::sendBatchMessage
+	(messageToSend& m, const mailbox& expeditor, const mailboxList& recipients,
+	 const mailbox& sender, messageToSend*& pending)
+{
+	const bool hasPipelining = hasExtension("PIPELINING");
+	const bool hasSMTPUTF8 = hasExtension("SMTPUTF8");
+	const bool hasSize = hasExtension("SIZE");
+	const bool chunking = canUseChunking();
+
+	const generationContext& ctx = generationContext::getDefaultContext();
+
+	// Only declare the size if it is exact, as unbuffered data is not read for this
+	const utility::stream::size_type size = (hasSize && m.msg->isGeneratedSizeExact(ctx))
+		? m.msg->getGeneratedSize(ctx) : 0;
+
+	// Without pipelining, the previous message must be acknowledged
+	// before the envelope of this one is sent
+	if (pending != NULL && !hasPipelining)
+	{
+		readBatchResponse(*pending);
+		pending = NULL;
+	}
+
+	const bool needReset = m_needReset;
+
+	ref <SMTPCommandSet> commands = SMTPCommandSet::create(hasPipelining);
+
+	if (needReset)
+		commands->addCommand(SMTPCommand::RSET());
+
+	commands->addCommand(SMTPCommand::MAIL(sender.isEmpty() ? expeditor : sender,
+		hasSMTPUTF8, size, getBodyType(m.msg, chunking)));
+
+	for (size_t i = 0 ; i < recipients.getMailboxCount() ; ++i)
+		commands->addCommand(SMTPCommand::RCPT(*recipients.getMailboxAt(i), hasSMTPUTF8));
+
+	if (!chunking)
+		commands->addCommand(SMTPCommand::DATA());
+
+	m_needReset = true;
+
+	// Send the envelope (all commands at once if pipelining), then read
+	// the response to the previous message, which comes first
+	commands->writeToSocket(m_socket);
+
+	if (pending != NULL)
+	{
+		readBatchResponse(*pending);
+		pending = NULL;
+	}
+
+	ref <SMTPResponse> resp;
+
+	// Read response for "RSET" command
+	if (needReset)
+	{
+		if ((resp = readResponse())->getCode() != 250)
+		{
+			internalDisconnect();
+			throw exceptions::command_error("RSET", resp->getText());
+		}
+
+		commands->writeToSocket(m_socket);
+	}
+
+	// Read response for "MAIL" command
+	resp = readResponse();
+
+	const bool mailAccepted = (resp->getCode() == 250);
+
+	if (!mailAccepted)
+		m.error = resp->getText();
+
+	// Read responses for "RCPT TO" commands; without pipelining,
+	// they are not sent if MAIL has been rejected
+	unsigned int acceptedCount = 0;
+
+	for (size_t i = 0 ; i < recipients.getMailboxCount() && (mailAccepted || hasPipelining) ; ++i)
+	{
+		commands->writeToSocket(m_socket);
+		resp = readResponse();
+
+		if (processRecipientResponse(resp, mailAccepted, m.recipientStatuses[i]))
+			++acceptedCount;
+	}
+
+	if (mailAccepted && acceptedCount == 0)
+		m.error = exceptions::no_recipient().what();
+
+	const bool canSendData = (mailAccepted && acceptedCount != 0);
+
+	// Read response for "DATA" command
+	if (!chunking && (canSendData || hasPipelining))
+	{
+		commands->writeToSocket(m_socket);
+		resp = readResponse();
+
+		if (resp->getCode() == 354 && !canSendData)
+		{
+			// The server should not have accepted DATA: send an empty
+			// message, which has no recipient anyway
+			m_socket->sendRaw(".\r\n", 3);
+			readResponse();
+
+			return;
+		}
+		else if (resp->getCode() != 354)
+		{
+			if (m.error.empty())
+				m.error = resp->getText();
+
+			return;
+		}
+	}
+
+	if (!canSendData)
+		return;
+
+	// Send message data; the final response will be read once the
+	// envelope of the next message has been sent
+	if (chunking)
+	{
+		SMTPChunkingOutputStreamAdapter chos(*this, hasPipelining);
+		utility::countingOutputStream cos(chos);
+
+		try
+		{
+			m.msg->generate(cos);
+		}
+		catch (...)
+		{
+			// Responses to the chunks already sent are left unread
+			internalDisconnect(false);
+			throw;
+		}
+
+		chos.finish(false);
+
+		m.size = cos.getCount();
+	}
+	else
+	{
+		utility::outputStreamSocketAdapter sos(*m_socket, /* cork */ true);
+		utility::bufferedOutputStream bos(sos);
+		utility::dotFilteredOutputStream fos(bos);
+		utility::countingOutputStream cos(fos);
+
+		try
+		{
+			m.msg->generate(cos);
+		}
+		catch (...)
+		{
+			// The server is still reading message data, and the
+			// transfer cannot be cancelled
+			internalDisconnect(false);
+			throw;
+		}
+
+		bos.write("\r\n.\r\n", 5);
+		bos.flush();
+
+		m.size = cos.getCount();
+	}
+
+	pending = &m;
+}
+
+
+void SMTPTransport::readBatchResponse(messageToSend& m)
+{
+	ref <SMTPResponse> resp = readResponse();
+
+	if (resp->getCode() == 250)
+		m.sent = true;
+	else
+		m.error = resp->getText();
+}
+
+
 void SMTPTransport::sendRequest(ref <SMTPCommand> cmd)
 {
 	cmd->writeToSocket(m_socket);
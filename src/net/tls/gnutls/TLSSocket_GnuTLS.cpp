@@ -116,6 +116,12 @@ TLSSocket::size_type TLSSocket_GnuTLS::getBlockSize() const
 }
 
 
+void TLSSocket_GnuTLS::setCorked(const bool corked)
+{
+	m_wrapped->setCorked(corked);
+}
+
+
 const string TLSSocket_GnuTLS::getPeerName() const
 {
 	return m_wrapped->getPeerName();
@@ -166,6 +166,12 @@ TLSSocket::size_type TLSSocket_OpenSSL::getBlockSize() const
 }
 
 
+void TLSSocket_OpenSSL::setCorked(const bool corked)
+{
+	m_wrapped->setCorked(corked);
+}
+
+
 const string TLSSocket_OpenSSL::getPeerName() const
 {
 	return m_wrapped->getPeerName();
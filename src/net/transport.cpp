@@ -122,11 +122,10 @@ static void extractMailboxes
 }
 
 
-void transport::send(ref <vmime::message> msg, utility::progressListener* progress)
+void transport::extractEnvelope(ref <const vmime::message> msg,
+	mailbox& expeditor, mailboxList& recipients, mailbox& sender)
 {
 	// Extract expeditor
-	mailbox expeditor;
-
 	try
 	{
 		const mailbox& mbox = *msg->getHeader()->findField(fields::FROM)->
@@ -140,8 +139,6 @@ void transport::send(ref <vmime::message> msg, utility::progressListener* progre
 	}
 
 	// Extract sender
-	mailbox sender;
-
 	try
 	{
 		const mailbox& mbox = *msg->getHeader()->findField(fields::SENDER)->
@@ -155,8 +152,6 @@ void transport::send(ref <vmime::message> msg, utility::progressListener* progre
 	}
 
 	// Extract recipients
-	mailboxList recipients;
-
 	try
 	{
 		const addressList& to = *msg->getHeader()->findField(fields::TO)->
@@ -183,38 +178,50 @@ void transport::send(ref <vmime::message> msg, utility::progressListener* progre
 		extractMailboxes(recipients, bcc);
 	}
 	catch (exceptions::no_such_field&) { }
+}
+
 
+transport::headerExchanger::headerExchanger(transport& tr, ref <vmime::message> msg)
+	: m_msg(msg), m_header(msg->getHeader())
+{
 	// Process message header by removing fields that should be removed
 	// before transmitting the message to MSA, and adding missing fields
 	// which are required/recommended by the RFCs.
-	ref <header> hdr = msg->getHeader()->clone().dynamicCast <header>();
-	processHeader(hdr);
+	ref <header> hdr = m_header->clone().dynamicCast <header>();
+	tr.processHeader(hdr);
+
+	// Set new header
+	m_msg->setHeader(hdr);
+}
+
+
+transport::headerExchanger::~headerExchanger()
+{
+	// Revert original header
+	m_msg->setHeader(m_header);
+}
+
+
+void transport::send(ref <vmime::message> msg, utility::progressListener* progress)
+{
+	mailbox expeditor;
+	mailboxList recipients;
+	mailbox sender;
+
+	extractEnvelope(msg, expeditor, recipients, sender);
 
 	// To avoid cloning message body (too much overhead), use processed
 	// header during the time we are generating the message to a stream.
-	// Revert it back to original header after.
-	struct XChangeMsgHeader
-	{
-		XChangeMsgHeader(vmime::ref <vmime::message> _msg,
-		                 vmime::ref <vmime::header> _hdr)
-			: msg(_msg), hdr(msg->getHeader())
-		{
-			// Set new header
-			msg->setHeader(_hdr);
-		}
+	headerExchanger exchanger(*this, msg);
 
-		~XChangeMsgHeader()
-		{
-			// Revert original header
-			msg->setHeader(hdr);
-		}
-
-	private:
+	send(msg, expeditor, recipients, progress, sender);
+}
 
-		vmime::ref <vmime::message> msg;
-		vmime::ref <vmime::header> hdr;
-	} headerExchanger(msg, hdr);
 
+void transport::send(ref <vmime::message> msg, const mailbox& expeditor,
+	const mailboxList& recipients, utility::progressListener* progress,
+	const mailbox& sender)
+{
 	// Generate the message, "stream" it and delegate the sending
 	// to the generic send() function.
 	std::ostringstream oss;
@@ -230,6 +237,116 @@ void transport::send(ref <vmime::message> msg, utility::progressListener* progre
 }
 
 
+// Record the number of bytes sent by send()
+class transport_sizeListener : public utility::progressListener
+{
+public:
+
+	transport_sizeListener() : size(0) { }
+
+	bool cancel() const { return false; }
+	void start(const long /* predictedTotal */) { size = 0; }
+	void progress(const long current, const long /* currentTotal */) { size = current; }
+	void stop(const long total) { size = total; }
+
+	long size;
+};
+
+
+void transport::sendBatch(std::vector <messageToSend>& msgs, utility::progressListener* progress)
+{
+	const int total = static_cast <int>(msgs.size());
+
+	if (progress)
+		progress->start(total);
+
+	for (std::vector <messageToSend>::size_type i = 0 ; i < msgs.size() ; ++i)
+	{
+		messageToSend& m = msgs[i];
+
+		m.sent = false;
+		m.size = 0;
+		m.error.clear();
+		m.recipientStatuses.clear();
+
+		try
+		{
+			mailbox expeditor = m.expeditor;
+			mailboxList recipients = m.recipients;
+			mailbox sender = m.sender;
+
+			if (m.expeditor.isEmpty())
+			{
+				recipients.removeAllMailboxes();
+				extractEnvelope(m.msg, expeditor, recipients, sender);
+			}
+
+			for (size_t j = 0 ; j < recipients.getMailboxCount() ; ++j)
+				m.recipientStatuses.push_back(recipientStatus(*recipients.getMailboxAt(j)));
+
+			transport_sizeListener sizeListener;
+
+			if (m.expeditor.isEmpty())
+			{
+				headerExchanger exchanger(*this, m.msg);
+				send(m.msg, expeditor, recipients, &sizeListener, sender);
+			}
+			else
+			{
+				send(m.msg, expeditor, recipients, &sizeListener, sender);
+			}
+
+			// We do not know more than "all or nothing"
+			for (std::vector <recipientStatus>::size_type j = 0 ; j < m.recipientStatuses.size() ; ++j)
+				m.recipientStatuses[j].accepted = true;
+
+			m.sent = true;
+			m.size = static_cast <utility::stream::size_type>(sizeListener.size);
+		}
+		catch (exceptions::command_error& e)
+		{
+			m.error = e.response();
+
+			if (!isConnected())
+				throw;
+		}
+		catch (exception& e)
+		{
+			m.error = e.what();
+
+			// The error is not specific to this message
+			if (!isConnected())
+				throw;
+		}
+
+		if (progress)
+			progress->progress(static_cast <int>(i) + 1, total);
+	}
+
+	if (progress)
+		progress->stop(total);
+}
+
+
+transport::recipientStatus::recipientStatus(const mailbox& recipient)
+	: recipient(recipient), accepted(false)
+{
+}
+
+
+transport::messageToSend::messageToSend(ref <vmime::message> msg)
+	: msg(msg), sent(false), size(0)
+{
+}
+
+
+transport::messageToSend::messageToSend(ref <vmime::message> msg,
+	const mailbox& expeditor, const mailboxList& recipients, const mailbox& sender)
+	: msg(msg), expeditor(expeditor), recipients(recipients), sender(sender), sent(false), size(0)
+{
+}
+
+
 transport::Type transport::getType() const
 {
 	return (TYPE_TRANSPORT);
@@ -0,0 +1,418 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002-2013 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+#include "vmime/config.hpp"
+
+
+#if VMIME_HAVE_MESSAGING_FEATURES
+
+
+#include "vmime/net/transportPool.hpp"
+
+#include "vmime/message.hpp"
+#include "vmime/platform.hpp"
+
+
+namespace vmime {
+namespace net {
+
+
+transportPool::statistics::statistics()
+	: sentCount(0), failedCount(0), sentBytes(0), connectionCount(0), elapsedTime(0)
+{
+}
+
+
+transportPool::transportPool(ref <session> sess, const utility::url& url,
+	const unsigned int maxConnections, ref <security::authenticator> auth)
+	: m_session(sess), m_url(url), m_auth(auth),
+	  m_maxConnections(maxConnections > 0 ? maxConnections : 1),
+	  m_maxMessagesPerConnection(0), m_batchSize(16),
+	  m_lock(platform::getHandler()->createCriticalSection()),
+	  m_openCount(0), m_startTime(0)
+{
+}
+
+
+transportPool::~transportPool()
+{
+	try
+	{
+		disconnect();
+	}
+	catch (vmime::exception&)
+	{
+		// Ignore
+	}
+}
+
+
+unsigned int transportPool::getMaxConnections() const
+{
+	return m_maxConnections;
+}
+
+
+void transportPool::setMaxMessagesPerConnection(const unsigned int count)
+{
+	m_maxMessagesPerConnection = count;
+}
+
+
+void transportPool::setBatchSize(const unsigned int count)
+{
+	m_batchSize = (count > 0 ? count : 1);
+}
+
+
+void transportPool::setSocketFactory(ref <socketFactory> sf)
+{
+	m_socketFactory = sf;
+}
+
+
+void transportPool::setTimeoutHandlerFactory(ref <timeoutHandlerFactory> thf)
+{
+	m_toHandlerFactory = thf;
+}
+
+
+void transportPool::addListener(listener* l)
+{
+	m_lock->lock();
+	m_listeners.push_back(l);
+	m_lock->unlock();
+}
+
+
+void transportPool::removeListener(listener* l)
+{
+	m_lock->lock();
+	m_listeners.remove(l);
+	m_lock->unlock();
+}
+
+
+void transportPool::enqueue(ref <vmime::message> msg)
+{
+	enqueue(transport::messageToSend(msg));
+}
+
+
+void transportPool::enqueue(const transport::messageToSend& msg)
+{
+	m_lock->lock();
+
+	if (m_startTime == 0)
+		m_startTime = platform::getHandler()->getUnixTime();
+
+	m_queue.push_back(msg);
+
+	m_lock->unlock();
+}
+
+
+bool transportPool::processNext()
+{
+	m_lock->lock();
+	const bool queueEmpty = m_queue.empty();
+	m_lock->unlock();
+
+	if (queueEmpty)
+		return false;
+
+	connection cnt;
+
+	if (!acquireConnection(cnt))
+		return false;
+
+	// Take the next messages in the queue
+	unsigned int count = m_batchSize;
+
+	if (m_maxMessagesPerConnection != 0 && m_maxMessagesPerConnection - cnt.messageCount < count)
+		count = m_maxMessagesPerConnection - cnt.messageCount;
+
+	std::vector <transport::messageToSend> batch;
+
+	m_lock->lock();
+
+	while (batch.size() < count && !m_queue.empty())
+	{
+		batch.push_back(m_queue.front());
+		m_queue.pop_front();
+	}
+
+	m_lock->unlock();
+
+	// The queue may have been emptied by another thread
+	if (batch.empty())
+	{
+		releaseConnection(cnt);
+		return false;
+	}
+
+	std::vector <transport::messageToSend> retry;
+	bool failed = false;
+
+	try
+	{
+		cnt.tr->sendBatch(batch);
+	}
+	catch (vmime::exception& e)
+	{
+		failed = true;
+
+		// The connection has been lost: messages which have not been
+		// reached yet are queued again, the other ones are failed (they
+		// may or may not have been accepted by the server)
+		for (std::vector <transport::messageToSend>::iterator it = batch.begin() ; it != batch.end() ; )
+		{
+			if (!it->sent && it->error.empty() && it->recipientStatuses.empty())
+			{
+				retry.push_back(*it);
+				it = batch.erase(it);
+			}
+			else
+			{
+				if (!it->sent && it->error.empty())
+					it->error = e.what();
+
+				++it;
+			}
+		}
+	}
+	catch (...)
+	{
+		dropConnection(cnt);
+		throw;
+	}
+
+	cnt.messageCount += static_cast <unsigned int>(batch.size());
+
+	// The transport may have failed in the middle of a transaction
+	// (eg. while sending message data): never reuse it
+	if (failed)
+		dropConnection(cnt);
+	else
+		releaseConnection(cnt);
+
+	// Update statistics
+	unsigned long sentBytes = 0;
+	unsigned long sentCount = 0;
+
+	for (std::vector <transport::messageToSend>::const_iterator it = batch.begin() ; it != batch.end() ; ++it)
+	{
+		if (it->sent)
+		{
+			sentBytes += static_cast <unsigned long>(it->size);
+			++sentCount;
+		}
+	}
+
+	m_lock->lock();
+
+	m_queue.insert(m_queue.begin(), retry.begin(), retry.end());
+
+	m_stats.sentCount += sentCount;
+	m_stats.sentBytes += sentBytes;
+	m_stats.failedCount += static_cast <unsigned long>(batch.size()) - sentCount;
+
+	const std::list <listener*> listeners = m_listeners;
+
+	m_lock->unlock();
+
+	// Notify listeners
+	for (std::vector <transport::messageToSend>::const_iterator it = batch.begin() ; it != batch.end() ; ++it)
+	{
+		for (std::list <listener*>::const_iterator lit = listeners.begin() ; lit != listeners.end() ; ++lit)
+			(*lit)->messageProcessed(*it);
+	}
+
+	return true;
+}
+
+
+void transportPool::processQueue()
+{
+	while (processNext())
+		;
+}
+
+
+unsigned int transportPool::getQueueSize() const
+{
+	m_lock->lock();
+	const unsigned int size = static_cast <unsigned int>(m_queue.size());
+	m_lock->unlock();
+
+	return size;
+}
+
+
+unsigned int transportPool::getConnectionCount() const
+{
+	m_lock->lock();
+	const unsigned int count = m_openCount;
+	m_lock->unlock();
+
+	return count;
+}
+
+
+const transportPool::statistics transportPool::getStatistics() const
+{
+	m_lock->lock();
+
+	statistics stats = m_stats;
+
+	if (m_startTime != 0)
+		stats.elapsedTime = platform::getHandler()->getUnixTime() - m_startTime;
+
+	m_lock->unlock();
+
+	return stats;
+}
+
+
+void transportPool::disconnect()
+{
+	m_lock->lock();
+
+	std::vector <connection> idle;
+	idle.swap(m_idle);
+
+	m_openCount -= static_cast <unsigned int>(idle.size());
+
+	m_lock->unlock();
+
+	for (std::vector <connection>::iterator it = idle.begin() ; it != idle.end() ; ++it)
+	{
+		if (it->tr->isConnected())
+			it->tr->disconnect();
+	}
+}
+
+
+bool transportPool::acquireConnection(connection& cnt)
+{
+	m_lock->lock();
+
+	if (!m_idle.empty())
+	{
+		cnt = m_idle.back();
+		m_idle.pop_back();
+	}
+	else if (m_openCount < m_maxConnections)
+	{
+		cnt.tr = NULL;
+		cnt.messageCount = 0;
+
+		++m_openCount;
+	}
+	else
+	{
+		// All connections are in use
+		m_lock->unlock();
+		return false;
+	}
+
+	m_lock->unlock();
+
+	try
+	{
+		if (!cnt.tr)
+		{
+			cnt.tr = m_session->getTransport(m_url, m_auth);
+
+			if (m_socketFactory)
+				cnt.tr->setSocketFactory(m_socketFactory);
+			if (m_toHandlerFactory)
+				cnt.tr->setTimeoutHandlerFactory(m_toHandlerFactory);
+		}
+
+		// The server may have closed an idle connection
+		if (!cnt.tr->isConnected())
+		{
+			cnt.messageCount = 0;
+			cnt.tr->connect();
+
+			m_lock->lock();
+			++m_stats.connectionCount;
+			m_lock->unlock();
+		}
+	}
+	catch (...)
+	{
+		m_lock->lock();
+		--m_openCount;
+		m_lock->unlock();
+
+		throw;
+	}
+
+	return true;
+}
+
+
+void transportPool::releaseConnection(connection& cnt)
+{
+	if (cnt.tr->isConnected() &&
+	    (m_maxMessagesPerConnection == 0 || cnt.messageCount < m_maxMessagesPerConnection))
+	{
+		m_lock->lock();
+		m_idle.push_back(cnt);
+		m_lock->unlock();
+
+		return;
+	}
+
+	// Recycle the connection
+	dropConnection(cnt);
+}
+
+
+void transportPool::dropConnection(connection& cnt)
+{
+	if (cnt.tr->isConnected())
+	{
+		try
+		{
+			cnt.tr->disconnect();
+		}
+		catch (vmime::exception&)
+		{
+			// Ignore
+		}
+	}
+
+	m_lock->lock();
+	--m_openCount;
+	m_lock->unlock();
+}
+
+
+} // net
+} // vmime
+
+
+#endif // VMIME_HAVE_MESSAGING_FEATURES
@@ -35,6 +35,7 @@
 #include <arpa/inet.h>
 #include <sys/types.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <netdb.h>
 #include <fcntl.h>
 #include <errno.h>
@@ -432,6 +433,22 @@ posixSocket::size_type posixSocket::getBlockSize() const
 }
 
 
+void posixSocket::setCorked(const bool corked)
+{
+	if (m_desc == -1)
+		return;
+
+	// Errors are ignored: this is only an optimization
+#if defined(TCP_CORK)
+	int flag = (corked ? 1 : 0);
+	::setsockopt(m_desc, IPPROTO_TCP, TCP_CORK, &flag, sizeof(flag));
+#elif defined(TCP_NOPUSH)
+	int flag = (corked ? 1 : 0);
+	::setsockopt(m_desc, IPPROTO_TCP, TCP_NOPUSH, &flag, sizeof(flag));
+#endif
+}
+
+
 void posixSocket::receive(vmime::string& buffer)
 {
 	const size_type size = receiveRaw(m_buffer, sizeof(m_buffer));
@@ -563,6 +580,12 @@ void posixSocket::sendRaw(const char* buffer, const size_type count)
 }
 
 
+int posixSocket::getDescriptor() const
+{
+	return m_desc;
+}
+
+
 posixSocket::size_type posixSocket::sendRawNonBlocking(const char* buffer, const size_type count)
 {
 	m_status &= ~STATUS_WOULDBLOCK;
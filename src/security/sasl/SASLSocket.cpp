@@ -81,6 +81,12 @@ SASLSocket::size_type SASLSocket::getBlockSize() const
 }
 
 
+void SASLSocket::setCorked(const bool corked)
+{
+	m_wrapped->setCorked(corked);
+}
+
+
 const string SASLSocket::getPeerName() const
 {
 	return m_wrapped->getPeerName();
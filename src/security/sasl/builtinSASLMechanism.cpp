@@ -36,6 +36,8 @@
 
 #include "vmime/exception.hpp"
 
+#include "vmime/utility/stringUtils.hpp"
+
 #include <stdexcept>
 #include <new>
 
@@ -120,6 +122,16 @@ bool builtinSASLMechanism::isComplete() const
 }
 
 
+bool builtinSASLMechanism::hasInitialResponse() const
+{
+	// Client-first mechanisms
+	const string name = utility::stringUtils::toUpper(m_name);
+
+	return name == "PLAIN" || name == "EXTERNAL" || name == "ANONYMOUS" ||
+	       name == "XOAUTH2" || name == "OAUTHBEARER";
+}
+
+
 void builtinSASLMechanism::encode
 	(ref <SASLSession> sess, const byte_t* input, const long inputLen,
 	 byte_t** output, long* outputLen)
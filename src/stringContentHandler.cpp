@@ -33,26 +33,30 @@ namespace vmime
 
 
 stringContentHandler::stringContentHandler(const string& buffer, const vmime::encoding& enc)
-	: m_encoding(enc), m_string(buffer)
+	: m_encoding(enc), m_string(buffer),
+	  m_generatedSize(string::npos)
 {
 }
 
 
 stringContentHandler::stringContentHandler(const stringContentHandler& cts)
-	: contentHandler(), m_encoding(cts.m_encoding), m_string(cts.m_string)
+	: contentHandler(), m_encoding(cts.m_encoding), m_string(cts.m_string),
+	  m_generatedSize(string::npos)
 {
 }
 
 
 stringContentHandler::stringContentHandler(const utility::stringProxy& str, const vmime::encoding& enc)
-	: m_encoding(enc), m_string(str)
+	: m_encoding(enc), m_string(str),
+	  m_generatedSize(string::npos)
 {
 }
 
 
 stringContentHandler::stringContentHandler(const string& buffer, const string::size_type start,
 	const string::size_type end, const vmime::encoding& enc)
-	: m_encoding(enc), m_string(buffer, start, end)
+	: m_encoding(enc), m_string(buffer, start, end),
+	  m_generatedSize(string::npos)
 {
 }
 
@@ -72,6 +76,7 @@ stringContentHandler& stringContentHandler::operator=(const stringContentHandler
 {
 	m_encoding = cts.m_encoding;
 	m_string = cts.m_string;
+	m_generatedSize = string::npos;
 
 	return (*this);
 }
@@ -81,6 +86,7 @@ void stringContentHandler::setData(const utility::stringProxy& str, const vmime:
 {
 	m_encoding = enc;
 	m_string = str;
+	m_generatedSize = string::npos;
 }
 
 
@@ -88,6 +94,7 @@ void stringContentHandler::setData(const string& buffer, const vmime::encoding&
 {
 	m_encoding = enc;
 	m_string.set(buffer);
+	m_generatedSize = string::npos;
 }
 
 
@@ -96,6 +103,7 @@ void stringContentHandler::setData(const string& buffer, const string::size_type
 {
 	m_encoding = enc;
 	m_string.set(buffer, start, end);
+	m_generatedSize = string::npos;
 }
 
 
@@ -154,6 +162,24 @@ void stringContentHandler::generate(utility::outputStream& os,
 }
 
 
+utility::stream::size_type stringContentHandler::getGeneratedSize
+	(const vmime::encoding& enc, const string::size_type maxLineLength) const
+{
+	// Computing the size may require encoding the whole data (eg. for
+	// quoted-printable), so remember the result until data is changed
+	if (m_generatedSize == string::npos ||
+	    m_generatedSizeEncoding != enc ||
+	    m_generatedSizeMaxLineLength != maxLineLength)
+	{
+		m_generatedSize = contentHandler::getGeneratedSize(enc, maxLineLength);
+		m_generatedSizeEncoding = enc;
+		m_generatedSizeMaxLineLength = maxLineLength;
+	}
+
+	return (m_generatedSize);
+}
+
+
 void stringContentHandler::extract(utility::outputStream& os,
 	utility::progressListener* progress) const
 {
@@ -0,0 +1,111 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002-2013 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+
+#include "vmime/utility/bufferedOutputStream.hpp"
+
+#include <algorithm>
+
+
+namespace vmime {
+namespace utility {
+
+
+const stream::size_type bufferedOutputStream::DEFAULT_BUFFER_SIZE = 65536;
+
+
+bufferedOutputStream::bufferedOutputStream(outputStream& os, const size_type bufferSize)
+	: m_stream(os), m_buffer(std::max(bufferSize, static_cast <size_type>(1))), m_length(0)
+{
+}
+
+
+stream::size_type bufferedOutputStream::getPendingSize() const
+{
+	return m_length;
+}
+
+
+void bufferedOutputStream::write
+	(const value_type* const data, const size_type count)
+{
+	const size_type bufferSize = m_buffer.size();
+
+	// Data fits in the buffer
+	if (m_length + count < bufferSize)
+	{
+		std::copy(data, data + count, m_buffer.begin() + m_length);
+		m_length += count;
+
+		return;
+	}
+
+	const value_type* pos = data;
+	size_type remaining = count;
+
+	// Complete and write the buffer
+	if (m_length != 0)
+	{
+		const size_type n = bufferSize - m_length;
+
+		std::copy(pos, pos + n, m_buffer.begin() + m_length);
+		m_stream.write(&m_buffer[0], bufferSize);
+
+		m_length = 0;
+
+		pos += n;
+		remaining -= n;
+	}
+
+	// Large blocks are not copied
+	if (remaining >= bufferSize)
+	{
+		m_stream.write(pos, remaining);
+		return;
+	}
+
+	std::copy(pos, pos + remaining, m_buffer.begin());
+	m_length = remaining;
+}
+
+
+void bufferedOutputStream::flush()
+{
+	if (m_length != 0)
+	{
+		m_stream.write(&m_buffer[0], m_length);
+		m_length = 0;
+	}
+
+	m_stream.flush();
+}
+
+
+stream::size_type bufferedOutputStream::getBlockSize()
+{
+	return m_buffer.size();
+}
+
+
+} // utility
+} // vmime
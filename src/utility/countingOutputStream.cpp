@@ -0,0 +1,77 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002-2013 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+#include "vmime/utility/countingOutputStream.hpp"
+
+
+namespace vmime {
+namespace utility {
+
+
+countingOutputStream::countingOutputStream()
+	: m_stream(NULL), m_count(0), m_total(0), m_lastNotified(0), m_progress(NULL)
+{
+}
+
+
+countingOutputStream::countingOutputStream
+	(outputStream& os, const size_type total, progressListener* progress)
+	: m_stream(&os), m_count(0), m_total(total), m_lastNotified(0), m_progress(progress)
+{
+}
+
+
+stream::size_type countingOutputStream::getCount() const
+{
+	return m_count;
+}
+
+
+void countingOutputStream::write
+	(const value_type* const data, const size_type count)
+{
+	if (m_stream)
+		m_stream->write(data, count);
+
+	m_count += count;
+
+	// Do not notify for every (possibly tiny) write
+	if (m_progress && m_count - m_lastNotified >= getBlockSize())
+	{
+		m_progress->progress(static_cast <long>(m_count),
+			static_cast <long>(m_count > m_total ? m_count : m_total));
+
+		m_lastNotified = m_count;
+	}
+}
+
+
+void countingOutputStream::flush()
+{
+	if (m_stream)
+		m_stream->flush();
+}
+
+
+} // utility
+} // vmime
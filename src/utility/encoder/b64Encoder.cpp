@@ -191,6 +191,31 @@ utility::stream::size_type b64Encoder::encode(utility::inputStream& in,
 }
 
 
+utility::stream::size_type b64Encoder::getEncodedSize(const utility::stream::size_type n) const
+{
+	const string::size_type propMaxLineLength =
+		getProperties().getProperty <string::size_type>("maxlinelength", static_cast <string::size_type>(-1));
+
+	const bool cutLines = (propMaxLineLength != static_cast <string::size_type>(-1));
+	const string::size_type maxLineLength = std::min(propMaxLineLength, static_cast <string::size_type>(76));
+
+	// Each group of (up to) 3 input bytes gives 4 output bytes
+	const utility::stream::size_type groups = (n + 2) / 3;
+
+	if (!cutLines)
+		return (groups * 4);
+
+	// encode() breaks the line after the first group for which
+	// "column + CRLF + next group" reaches the maximum line length
+	utility::stream::size_type groupsPerLine = 1;
+
+	if (maxLineLength > 10)
+		groupsPerLine = (maxLineLength - 6 + 3) / 4;
+
+	return (groups * 4 + (groups / groupsPerLine) * 2);
+}
+
+
 utility::stream::size_type b64Encoder::decode(utility::inputStream& in,
 	utility::outputStream& out, utility::progressListener* progress)
 {
@@ -70,6 +70,12 @@ utility::stream::size_type defaultEncoder::decode(utility::inputStream& in,
 }
 
 
+utility::stream::size_type defaultEncoder::getEncodedSize(const utility::stream::size_type n) const
+{
+	return (n);
+}
+
+
 } // encoder
 } // utility
 } // vmime
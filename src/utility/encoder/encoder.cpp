@@ -71,6 +71,12 @@ const std::vector <string> encoder::getAvailableProperties() const
 }
 
 
+utility::stream::size_type encoder::getEncodedSize(const utility::stream::size_type /* n */) const
+{
+	return (string::npos);
+}
+
+
 } // encoder
 } // utility
 } // vmime
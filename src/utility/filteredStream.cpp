@@ -77,57 +77,244 @@ void dotFilteredInputStream::reset()
 
 stream::size_type dotFilteredInputStream::read(value_type* const data, const size_type count)
 {
-	const stream::size_type read = m_stream.read(data, count);
+	const size_type read = m_stream.read(data, count);
+
+	if (read == 0)
+		return 0;
+
+	const value_type* const end = data + read;
 
-	const value_type* readPtr = data;
+	// Last characters of unfiltered data, for the next buffer
+	const value_type last2 = (read >= 2 ? data[read - 2] : m_previousChar1);
+	const value_type last1 = data[read - 1];
+
+	// Replace "\n.." with "\n.": data between the dots to remove is
+	// moved in bulk, and only line beginnings are examined
 	value_type* writePtr = data;
+	const value_type* runStart = data;
+	const value_type* scan = data;
+	const value_type* dot = NULL;  // next dot to remove
+
+	// Sequence which has begun in the previous buffer
+	if (m_previousChar2 == '\n' && m_previousChar1 == '.' && data[0] == '.')
+		dot = data;
+	else if (m_previousChar1 == '\n' && read >= 2 && data[0] == '.' && data[1] == '.')
+		dot = data + 1;
+
+	while (true)
+	{
+		const value_type* lf;
+
+		while (dot == NULL && scan < end && (lf = static_cast <const value_type*>
+			(std::memchr(scan, '\n', static_cast <size_t>(end - scan)))) != NULL)
+		{
+			if (lf + 2 < end && lf[1] == '.' && lf[2] == '.')
+				dot = lf + 2;
+
+			scan = lf + 1;
+		}
+
+		if (dot == NULL)
+			break;
+
+		const size_type n = dot - runStart;
+
+		if (writePtr != runStart)
+			std::memmove(writePtr, runStart, n);
+
+		writePtr += n;
+		runStart = dot + 1;
+
+		scan = dot + 1;
+		dot = NULL;
+	}
+
+	const size_type n = end - runStart;
+
+	if (writePtr != runStart)
+		std::memmove(writePtr, runStart, n);
+
+	writePtr += n;
+
+	m_previousChar2 = last2;
+	m_previousChar1 = last1;
+
+	return (writePtr - data);
+}
+
+
+stream::size_type dotFilteredInputStream::skip(const size_type /* count */)
+{
+	// Skipping bytes is not supported
+	return 0;
+}
 
-	const value_type* end = data + read;
 
-	stream::size_type written = 0;
+// dotTerminatedFilteredInputStream
 
-	// Replace "\n.." with "\n."
-	while (readPtr < end)
+dotTerminatedFilteredInputStream::dotTerminatedFilteredInputStream(inputStream& is)
+	: m_stream(is), m_pendingLength(0), m_lineStart(true), m_eof(false)
+{
+}
+
+
+inputStream& dotTerminatedFilteredInputStream::getPreviousInputStream()
+{
+	return (m_stream);
+}
+
+
+bool dotTerminatedFilteredInputStream::eof() const
+{
+	return (m_eof || (m_stream.eof() && m_pendingLength == 0));
+}
+
+
+void dotTerminatedFilteredInputStream::reset()
+{
+	m_pendingLength = 0;
+	m_lineStart = true;
+	m_eof = false;
+	m_trailingData.clear();
+
+	m_stream.reset();
+}
+
+
+const string& dotTerminatedFilteredInputStream::getTrailingData() const
+{
+	return (m_trailingData);
+}
+
+
+stream::size_type dotTerminatedFilteredInputStream::read
+	(value_type* const data, const size_type count)
+{
+	if (m_eof || count <= static_cast <size_type>(sizeof(m_pending)))
+		return 0;
+
+	// Put back the end of the previous buffer
+	std::copy(m_pending, m_pending + m_pendingLength, data);
+
+	const size_type read = m_pendingLength
+		+ m_stream.read(data + m_pendingLength, count - m_pendingLength);
+
+	m_pendingLength = 0;
+
+	if (read == 0)
+		return 0;
+
+	const bool lastBuffer = m_stream.eof();
+
+	const value_type* const end = data + read;
+	const value_type* dataEnd = end;  // end of data to return
+
+	value_type* writePtr = data;
+	const value_type* runStart = data;
+	const value_type* pos = data;
+
+	bool lineStart = m_lineStart;
+
+	m_lineStart = false;
+
+	// Only the beginning of lines is examined: a line starting with
+	// a dot is either the terminator, or a dot-stuffed line
+	while (true)
 	{
-		if (*readPtr == '.')
+		const value_type* line;
+		const value_type* lineBreak;  // line break before the terminator is not part of data
+
+		if (lineStart)
+		{
+			line = data;
+			lineBreak = data;
+
+			lineStart = false;
+		}
+		else
 		{
-			const value_type prevChar2 =
-				(readPtr == data + 1 ? m_previousChar1 :
-				 readPtr == data ? m_previousChar2 : *(readPtr - 2));
-			const value_type prevChar1 =
-				(readPtr == data ? m_previousChar1 : *(readPtr - 1));
+			const value_type* lf = static_cast <const value_type*>
+				(std::memchr(pos, '\n', static_cast <size_t>(end - pos)));
+
+			if (lf == NULL)
+				break;
+
+			line = lf + 1;
+			lineBreak = (lf > data && lf[-1] == '\r') ? lf - 1 : lf;
+		}
 
-			if (prevChar2 == '\n' && prevChar1 == '.')
+		const size_type avail = end - line;
+
+		// Not enough data yet to know whether this is the terminator
+		if (!lastBuffer &&
+		    (avail == 0 || (line[0] == '.' && (avail == 1 || (avail == 2 && line[1] == '\r')))))
+		{
+			dataEnd = lineBreak;
+			m_lineStart = (line == data);
+
+			break;
+		}
+
+		if (avail >= 2 && line[0] == '.')
+		{
+			if (line[1] == '\n')
 			{
-				// Ignore last dot
+				dataEnd = (line == data ? data : line - 1);
+				m_trailingData.assign(line + 2, end);
+				m_eof = true;
+
+				break;
 			}
-			else
+			else if (line[1] == '\r' && avail >= 3 && line[2] == '\n')
 			{
-				*writePtr = *readPtr;
+				dataEnd = lineBreak;
+				m_trailingData.assign(line + 3, end);
+				m_eof = true;
 
-				++writePtr;
-				++written;
+				break;
 			}
-		}
-		else
-		{
-			*writePtr = *readPtr;
+			else if (line[1] == '.')
+			{
+				// Remove dot-stuffing
+				const size_type n = line - runStart;
 
-			++writePtr;
-			++written;
+				if (writePtr != runStart)
+					std::memmove(writePtr, runStart, n);
+
+				writePtr += n;
+				runStart = line + 1;
+
+				pos = line + 2;
+				continue;
+			}
 		}
 
-		++readPtr;
+		pos = line;
 	}
 
-	m_previousChar2 = (read >= 2 ? data[read - 2] : m_previousChar1);
-	m_previousChar1 = (read >= 1 ? data[read - 1] : '\0');
+	// A final CR may be the beginning of the terminator
+	if (!m_eof && !lastBuffer && dataEnd == end && end[-1] == '\r')
+		dataEnd = end - 1;
 
-	return (written);
+	// Keep undecided data for the next call
+	if (!m_eof)
+	{
+		m_pendingLength = end - dataEnd;
+		std::copy(dataEnd, end, m_pending);
+	}
+
+	const size_type n = dataEnd - runStart;
+
+	if (writePtr != runStart)
+		std::memmove(writePtr, runStart, n);
+
+	writePtr += n;
+
+	return (writePtr - data);
 }
 
 
-stream::size_type dotFilteredInputStream::skip(const size_type /* count */)
+stream::size_type dotTerminatedFilteredInputStream::skip(const size_type /* count */)
 {
 	// Skipping bytes is not supported
 	return 0;
@@ -137,7 +324,7 @@ stream::size_type dotFilteredInputStream::skip(const size_type /* count */)
 // dotFilteredOutputStream
 
 dotFilteredOutputStream::dotFilteredOutputStream(outputStream& os)
-	: m_stream(os), m_previousChar('\0'), m_start(true)
+	: m_stream(os), m_previousChar('\0'), m_start(true), m_startDot(false)
 {
 }
 
@@ -154,47 +341,51 @@ void dotFilteredOutputStream::write
 	if (count == 0)
 		return;
 
-	const value_type* pos = data;
-	const value_type* end = data + count;
+	const value_type* const end = data + count;
 	const value_type* start = data;
+	const value_type* pos = data;
 
-	if (m_previousChar == '.')
+	// Dot at the beginning of the buffer
+	if (m_start)
 	{
-		if (data[0] == '\n' || data[0] == '\r')
+		// <DOT><CR><LF> at the beginning of content
+		if (data[0] == '.')
 		{
+			if (count == 1)
+				m_startDot = true;
+			else if (data[1] == '\n' || data[1] == '\r')
+				m_stream.write(".", 1);  // extra <DOT>
+		}
+	}
+	else if (m_startDot)
+	{
+		if (data[0] == '\n' || data[0] == '\r')
 			m_stream.write(".", 1);  // extra <DOT>
-			m_stream.write(data, 1);
 
-			pos = data + 1;
-		}
+		m_startDot = false;
+	}
+	else if (m_previousChar == '\n' && data[0] == '.')
+	{
+		m_stream.write(".", 1);  // extra <DOT>
 	}
 
-	// Replace "\n." with "\n.."
-	while ((pos = std::find(pos, end, '.')) != end)
+	// Replace "\n." with "\n..": data between line breaks is written
+	// in bulk, and only line beginnings are examined
+	while ((pos = static_cast <const value_type*>
+		(std::memchr(pos, '\n', static_cast <size_t>(end - pos)))) != NULL)
 	{
-		const value_type previousChar =
-			(pos == data ? m_previousChar : *(pos - 1));
+		++pos;
 
-		if (previousChar == '\n')
-		{
-			m_stream.write(start, pos - start);
-			m_stream.write("..", 2);
+		if (pos == end)
+			break;
 
-			start = pos + 1;
-		}
-		else if (pos == data && m_start)  // <DOT><CR><LF> at the beginning of content
+		if (*pos == '.')
 		{
 			m_stream.write(start, pos - start);
+			m_stream.write(".", 1);  // extra <DOT>
 
-			if (pos + 1 < end && (*(pos + 1) == '\n' || *(pos + 1) == '\r'))
-				m_stream.write("..", 2);
-			else
-				m_stream.write(".", 1);
-
-			start = pos + 1;
+			start = pos;
 		}
-
-		++pos;
 	}
 
 	m_stream.write(start, end - start);
@@ -372,9 +563,10 @@ stream::size_type stopSequenceFilteredInputStream <1>::read
 	const size_type read = m_stream.read(data, count);
 	value_type* end = data + read;
 
-	value_type* pos = std::find(data, end, m_sequence[0]);
+	value_type* pos = static_cast <value_type*>
+		(std::memchr(data, m_sequence[0], static_cast <size_t>(end - data)));
 
-	if (pos == end)
+	if (pos == NULL)
 	{
 		return (read);
 	}
@@ -34,22 +34,39 @@ namespace vmime {
 namespace utility {
 
 
-outputStreamSocketAdapter::outputStreamSocketAdapter(net::socket& sok)
-	: m_socket(sok)
+outputStreamSocketAdapter::outputStreamSocketAdapter(net::socket& sok, const bool cork)
+	: m_socket(sok), m_cork(cork), m_corked(false)
 {
 }
 
 
+outputStreamSocketAdapter::~outputStreamSocketAdapter()
+{
+	if (m_corked)
+		m_socket.setCorked(false);
+}
+
+
 void outputStreamSocketAdapter::write
 	(const value_type* const data, const size_type count)
 {
+	if (m_cork && !m_corked)
+	{
+		m_socket.setCorked(true);
+		m_corked = true;
+	}
+
 	m_socket.sendRaw(data, count);
 }
 
 
 void outputStreamSocketAdapter::flush()
 {
-	// Do nothing
+	if (m_corked)
+	{
+		m_socket.setCorked(false);
+		m_corked = false;
+	}
 }
 
 
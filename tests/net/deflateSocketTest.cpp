@@ -0,0 +1,145 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002-2013 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+
+#include "tests/testUtils.hpp"
+
+#include "vmime/net/deflateSocket.hpp"
+
+
+#if VMIME_HAVE_COMPRESSION_SUPPORT
+
+
+static vmime::ref <vmime::net::deflateSocket> createDeflateSocket(vmime::ref <vmime::net::socket> sok)
+{
+	return vmime::create <vmime::net::deflateSocket>(sok);
+}
+
+
+VMIME_TEST_SUITE_BEGIN(deflateSocketTest)
+
+	VMIME_TEST_LIST_BEGIN
+		VMIME_TEST(testSendReceive)
+		VMIME_TEST(testLargeData)
+		VMIME_TEST(testMultipleChunks)
+	VMIME_TEST_LIST_END
+
+
+	// Compress data on one side and decompress it on the other side
+	static const vmime::string transfer(vmime::ref <testSocket> from,
+		vmime::ref <vmime::net::deflateSocket> to, const vmime::string& data)
+	{
+		vmime::ref <testSocket> dst = to->getWrappedSocket().dynamicCast <testSocket>();
+
+		vmime::ref <vmime::net::deflateSocket> src = createDeflateSocket(from);
+
+		src->send(data);
+
+		vmime::string compressed;
+		from->localReceive(compressed);
+
+		dst->localSend(compressed);
+
+		vmime::string result;
+		to->receive(result);
+
+		return result;
+	}
+
+	void testSendReceive()
+	{
+		vmime::ref <testSocket> sok = vmime::create <testSocket>();
+		vmime::ref <vmime::net::deflateSocket> dsok =
+			createDeflateSocket(sok);
+
+		dsok->send("a001 NOOP\r\n");
+
+		vmime::string compressed;
+		sok->localReceive(compressed);
+
+		VASSERT("Compressed", compressed != "a001 NOOP\r\n");
+		VASSERT("Sync flush", compressed.length() >= 4);
+		VASSERT_EQ("Sync marker", std::string("\x00\x00\xff\xff", 4),
+			compressed.substr(compressed.length() - 4));
+
+		// Decompress
+		vmime::ref <vmime::net::deflateSocket> peer =
+			createDeflateSocket(vmime::create <testSocket>());
+
+		vmime::ref <testSocket> peerSok =
+			peer->getWrappedSocket().dynamicCast <testSocket>();
+
+		peerSok->localSend(compressed);
+
+		vmime::string result;
+		peer->receive(result);
+
+		VASSERT_EQ("Data", std::string("a001 NOOP\r\n"), result);
+	}
+
+	void testLargeData()
+	{
+		vmime::string data;
+
+		for (unsigned int i = 0 ; i < 200000 ; ++i)
+			data += static_cast <char>('a' + (i * 7 + i / 13) % 26);
+
+		vmime::ref <vmime::net::deflateSocket> to =
+			createDeflateSocket(vmime::create <testSocket>());
+
+		VASSERT_EQ("Data", data, transfer(vmime::create <testSocket>(), to, data));
+	}
+
+	void testMultipleChunks()
+	{
+		vmime::ref <testSocket> from = vmime::create <testSocket>();
+		vmime::ref <vmime::net::deflateSocket> src = createDeflateSocket(from);
+
+		vmime::ref <testSocket> dst = vmime::create <testSocket>();
+		vmime::ref <vmime::net::deflateSocket> to =
+			createDeflateSocket(dst);
+
+		// The compression context is kept between successive sends
+		for (int i = 0 ; i < 3 ; ++i)
+		{
+			std::ostringstream oss;
+			oss << "a00" << (i + 1) << " NOOP\r\n";
+
+			src->send(oss.str());
+
+			vmime::string compressed;
+			from->localReceive(compressed);
+
+			dst->localSend(compressed);
+
+			vmime::string result;
+			to->receive(result);
+
+			VASSERT_EQ("Data", oss.str(), result);
+		}
+	}
+
+VMIME_TEST_SUITE_END
+
+
+#endif // VMIME_HAVE_COMPRESSION_SUPPORT
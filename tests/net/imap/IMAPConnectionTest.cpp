@@ -0,0 +1,412 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002-2013 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+
+#include "tests/testUtils.hpp"
+#include "tests/net/imap/IMAPTestUtils.hpp"
+
+#include "vmime/net/deflateSocket.hpp"
+
+#include <algorithm>
+
+
+class CAPABILITYIMAPTestSocket;
+class PIPELININGIMAPTestSocket;
+
+
+// Commands received by the session setup test servers, and number of
+// commands received before each read from the client
+static std::vector <vmime::string> setupCommands;
+static std::vector <int> setupBatches;
+
+
+#if VMIME_HAVE_COMPRESSION_SUPPORT
+
+
+class COMPRESSIMAPTestSocket;
+class noCOMPRESSIMAPTestSocket;
+
+
+static vmime::ref <vmime::net::deflateSocket> createDeflateSocket(vmime::ref <vmime::net::socket> sok)
+{
+	return vmime::create <vmime::net::deflateSocket>(sok);
+}
+
+
+// Number of compressed commands received by the test server
+static int compressedCommandCount = 0;
+
+
+#endif // VMIME_HAVE_COMPRESSION_SUPPORT
+
+
+VMIME_TEST_SUITE_BEGIN(IMAPConnectionTest)
+
+	VMIME_TEST_LIST_BEGIN
+		VMIME_TEST(testCapabilitiesFromResponses)
+		VMIME_TEST(testPipelinedLogin)
+#if VMIME_HAVE_COMPRESSION_SUPPORT
+		VMIME_TEST(testCompress)
+		VMIME_TEST(testCompressRefused)
+		VMIME_TEST(testCompressDisabled)
+#endif // VMIME_HAVE_COMPRESSION_SUPPORT
+	VMIME_TEST_LIST_END
+
+
+	void testCapabilitiesFromResponses()
+	{
+		setupCommands.clear();
+		setupBatches.clear();
+
+		vmime::ref <vmime::net::store> store = createIMAPTestStore <CAPABILITYIMAPTestSocket>();
+		store->connect();
+
+		// LIST-STATUS is only advertised once logged in
+		store.dynamicCast <vmime::net::imap::IMAPStore>()->getFoldersStatus();
+
+		VASSERT_EQ("Commands", 3, static_cast <int>(setupCommands.size()));
+		VASSERT_EQ("LOGIN", "LOGIN", setupCommands[0]);
+		VASSERT_EQ("LIST", "LIST", setupCommands[1]);
+		VASSERT_EQ("LIST-STATUS", "LIST-STATUS", setupCommands[2]);
+
+		// LOGIN and LIST were sent together
+		VASSERT_EQ("Batch", 2, setupBatches[0]);
+
+		store->disconnect();
+	}
+
+
+	void testPipelinedLogin()
+	{
+		setupCommands.clear();
+		setupBatches.clear();
+
+		vmime::ref <vmime::net::store> store = createIMAPTestStore <PIPELININGIMAPTestSocket>();
+		store->setProperty("options.compress", false);
+		store->connect();
+
+		// LOGIN, CAPABILITY and LIST were sent in one go
+		std::vector <vmime::string>::const_iterator login =
+			std::find(setupCommands.begin(), setupCommands.end(), "LOGIN");
+
+		VASSERT_TRUE("LOGIN", login != setupCommands.end());
+		VASSERT_EQ("CAPABILITY", "CAPABILITY", *(login + 1));
+		VASSERT_EQ("LIST", "LIST", *(login + 2));
+		VASSERT_EQ("Batch", 3, setupBatches.back());
+
+		store->disconnect();
+	}
+
+#if VMIME_HAVE_COMPRESSION_SUPPORT
+
+	void testCompress()
+	{
+		compressedCommandCount = 0;
+
+		vmime::ref <vmime::net::store> store = createIMAPTestStore <COMPRESSIMAPTestSocket>();
+		store->connect();
+
+		vmime::ref <vmime::net::folder> folder = store->getFolder(vmime::net::folder::path("INBOX"));
+		folder->open(vmime::net::folder::MODE_READ_WRITE);
+
+		VASSERT_EQ("Count", 2, folder->getMessageCount());
+
+		// SELECT was compressed (LIST, for the hierarchy separator, is
+		// pipelined with LOGIN, before compression is negotiated)
+		VASSERT("Compressed", compressedCommandCount >= 1);
+
+		folder->close(false);
+		store->disconnect();
+	}
+
+
+	void testCompressRefused()
+	{
+		vmime::ref <vmime::net::store> store = createIMAPTestStore <noCOMPRESSIMAPTestSocket>();
+		store->connect();
+
+		// The connection goes on without compression
+		vmime::ref <vmime::net::folder> folder = store->getFolder(vmime::net::folder::path("INBOX"));
+		folder->open(vmime::net::folder::MODE_READ_WRITE);
+
+		VASSERT_EQ("Count", 2, folder->getMessageCount());
+
+		folder->close(false);
+		store->disconnect();
+	}
+
+
+	void testCompressDisabled()
+	{
+		compressedCommandCount = 0;
+
+		vmime::ref <vmime::net::store> store = createIMAPTestStore <COMPRESSIMAPTestSocket>();
+		store->setProperty("options.compress", false);
+		store->connect();
+
+		vmime::ref <vmime::net::folder> folder = store->getFolder(vmime::net::folder::path("INBOX"));
+		folder->open(vmime::net::folder::MODE_READ_WRITE);
+
+		VASSERT_EQ("Count", 2, folder->getMessageCount());
+		VASSERT_EQ("Not compressed", 0, compressedCommandCount);
+
+		folder->close(false);
+		store->disconnect();
+	}
+
+#endif // VMIME_HAVE_COMPRESSION_SUPPORT
+
+VMIME_TEST_SUITE_END
+
+
+/** IMAP test server which records the commands received during
+  * session setup, and how many were received before each read.
+  */
+class PIPELININGIMAPTestSocket : public IMAPTestSocket
+{
+public:
+
+	PIPELININGIMAPTestSocket()
+		: m_pendingCount(0)
+	{
+	}
+
+	void receive(vmime::string& buffer)
+	{
+		if (m_pendingCount != 0)
+			setupBatches.push_back(m_pendingCount);
+
+		m_pendingCount = 0;
+
+		IMAPTestSocket::receive(buffer);
+	}
+
+	bool processIMAPCommand(const vmime::string& /* tag */,
+		const vmime::string& cmd, const vmime::string& /* line */)
+	{
+		if (cmd != "LOGOUT")
+		{
+			setupCommands.push_back(cmd);
+			++m_pendingCount;
+		}
+
+		return false;
+	}
+
+private:
+
+	int m_pendingCount;
+};
+
+
+/** IMAP test server which sends its capabilities in the greeting
+  * and in the response to LOGIN, but refuses the CAPABILITY command.
+  */
+class CAPABILITYIMAPTestSocket : public PIPELININGIMAPTestSocket
+{
+public:
+
+	CAPABILITYIMAPTestSocket()
+	{
+		m_capabilities = "IMAP4rev1 ID";
+	}
+
+	void onConnected()
+	{
+		localSend("* OK [CAPABILITY " + m_capabilities + "] server ready\r\n");
+	}
+
+	bool processIMAPCommand(const vmime::string& tag,
+		const vmime::string& cmd, const vmime::string& line)
+	{
+		PIPELININGIMAPTestSocket::processIMAPCommand(tag, cmd, line);
+
+		if (cmd == "LOGIN")
+		{
+			m_capabilities = "IMAP4rev1 ID LIST-STATUS";
+
+			localSend(tag + " OK [CAPABILITY " + m_capabilities + "] Logged in\r\n");
+			return true;
+		}
+		else if (cmd == "CAPABILITY")
+		{
+			localSend(tag + " BAD Capabilities already sent\r\n");
+			return true;
+		}
+		else if (cmd == "LIST" && line.find("RETURN (STATUS") != vmime::string::npos)
+		{
+			setupCommands.back() = "LIST-STATUS";
+
+			localSend(tag + " OK LIST completed\r\n");
+			return true;
+		}
+
+		return false;
+	}
+};
+
+
+#if VMIME_HAVE_COMPRESSION_SUPPORT
+
+
+
+/** IMAP test server which supports COMPRESS=DEFLATE.
+  *
+  * Once compression has been negotiated, data received from the
+  * client is decompressed before being processed, and responses
+  * are compressed before being sent to the client.
+  */
+class COMPRESSIMAPTestSocket : public IMAPTestSocket
+{
+public:
+
+	COMPRESSIMAPTestSocket()
+		: m_compressIn(false), m_compressOut(false)
+	{
+		m_capabilities = "IMAP4rev1 COMPRESS=DEFLATE";
+		m_messageCount = 2;
+
+		m_inflater = createDeflateSocket(vmime::create <testSocket>());
+		m_deflater = createDeflateSocket(vmime::create <testSocket>());
+	}
+
+	bool processIMAPCommand(const vmime::string& tag,
+		const vmime::string& cmd, const vmime::string& line)
+	{
+		if (cmd == "COMPRESS")
+		{
+			VASSERT_FALSE("Already compressing", m_compressIn);
+			VASSERT_EQ("Mechanism", tag + " COMPRESS DEFLATE", line);
+
+			localSend(tag + " OK DEFLATE active\r\n");
+
+			// Next data received from the client will be compressed
+			m_compressIn = true;
+
+			return true;
+		}
+		else if (m_compressIn)
+		{
+			++compressedCommandCount;
+		}
+
+		return false;
+	}
+
+	void send(const vmime::string& buffer)
+	{
+		if (m_compressIn)
+		{
+			testSocket& in = *m_inflater->getWrappedSocket().dynamicCast <testSocket>();
+			in.localSend(buffer);
+
+			vmime::string plain;
+			m_inflater->receive(plain);
+
+			// The client has read our response to COMPRESS:
+			// compress everything we send from now on
+			m_compressOut = true;
+
+			IMAPTestSocket::send(plain);
+		}
+		else
+		{
+			IMAPTestSocket::send(buffer);
+		}
+	}
+
+	size_type receiveRaw(char* buffer, const size_type count)
+	{
+		if (m_compressOut)
+		{
+			char plain[16384];
+			size_type n;
+
+			while ((n = IMAPTestSocket::receiveRaw(plain, sizeof(plain))) != 0)
+			{
+				m_deflater->sendRaw(plain, n);
+
+				vmime::string compressed;
+				m_deflater->getWrappedSocket().dynamicCast <testSocket>()->localReceive(compressed);
+
+				m_pending += compressed;
+			}
+
+			const size_type m = std::min(count, static_cast <size_type>(m_pending.size()));
+
+			std::copy(m_pending.begin(), m_pending.begin() + m, buffer);
+			m_pending.erase(m_pending.begin(), m_pending.begin() + m);
+
+			return m;
+		}
+
+		return IMAPTestSocket::receiveRaw(buffer, count);
+	}
+
+	void receive(vmime::string& buffer)
+	{
+		char chunk[16384];
+		const size_type n = receiveRaw(chunk, sizeof(chunk));
+
+		buffer = vmime::string(chunk, n);
+	}
+
+private:
+
+	bool m_compressIn;
+	bool m_compressOut;
+
+	vmime::ref <vmime::net::deflateSocket> m_inflater;
+	vmime::ref <vmime::net::deflateSocket> m_deflater;
+
+	vmime::string m_pending;
+};
+
+/** IMAP test server which advertises COMPRESS=DEFLATE, but
+  * refuses to enable it.
+  */
+class noCOMPRESSIMAPTestSocket : public IMAPTestSocket
+{
+public:
+
+	noCOMPRESSIMAPTestSocket()
+	{
+		m_capabilities = "IMAP4rev1 COMPRESS=DEFLATE";
+		m_messageCount = 2;
+	}
+
+	bool processIMAPCommand(const vmime::string& tag,
+		const vmime::string& cmd, const vmime::string& /* line */)
+	{
+		if (cmd == "COMPRESS")
+		{
+			localSend(tag + " NO Compression not available\r\n");
+			return true;
+		}
+
+		return false;
+	}
+};
+
+
+#endif // VMIME_HAVE_COMPRESSION_SUPPORT
@@ -0,0 +1,199 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002-2013 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+
+#include "tests/testUtils.hpp"
+
+#include "vmime/platform.hpp"
+
+#include "vmime/net/imap/IMAPContentCache.hpp"
+
+#include <ctime>
+
+
+typedef vmime::utility::file::path fspath;
+typedef vmime::utility::file::path::component fspathc;
+
+
+VMIME_TEST_SUITE_BEGIN(IMAPContentCacheTest)
+
+	VMIME_TEST_LIST_BEGIN
+		VMIME_TEST(testMemory)
+		VMIME_TEST(testEviction)
+		VMIME_TEST(testNotCacheable)
+		VMIME_TEST(testSpillToDisk)
+		VMIME_TEST(testReplace)
+	VMIME_TEST_LIST_END
+
+
+public:
+
+	IMAPContentCacheTest()
+	{
+		// Temporary directory
+		m_tempPath = fspath() / fspathc("tmp")   // Use /tmp
+			/ fspathc("vmime" + vmime::utility::stringUtils::toString(std::time(NULL))
+				+ vmime::utility::stringUtils::toString(std::rand()));
+	}
+
+	void tearDown()
+	{
+		vmime::ref <vmime::utility::fileSystemFactory> fsf =
+			vmime::platform::getHandler()->getFileSystemFactory();
+
+		vmime::ref <vmime::utility::file> dir = fsf->create(m_tempPath);
+
+		if (dir->exists())
+			dir->remove();
+	}
+
+
+	void testMemory()
+	{
+		vmime::ref <vmime::net::imap::IMAPContentCache> cache =
+			vmime::create <vmime::net::imap::IMAPContentCache>(100, 50, fspath(), 0);
+
+		VASSERT_EQ("Not found", "", get(cache, "a"));
+
+		cache->put("a", "contents of a");
+		cache->put("b", "contents of b");
+
+		VASSERT_EQ("A", "contents of a", get(cache, "a"));
+		VASSERT_EQ("B", "contents of b", get(cache, "b"));
+		VASSERT_EQ("Memory", 26, static_cast <int>(cache->getMemorySize()));
+		VASSERT_EQ("Disk", 0, static_cast <int>(cache->getDiskSize()));
+	}
+
+	void testEviction()
+	{
+		vmime::ref <vmime::net::imap::IMAPContentCache> cache =
+			vmime::create <vmime::net::imap::IMAPContentCache>(30, 30, fspath(), 0);
+
+		cache->put("a", vmime::string(10, 'a'));
+		cache->put("b", vmime::string(10, 'b'));
+		cache->put("c", vmime::string(10, 'c'));
+
+		// "a" becomes the most recently used
+		VASSERT_EQ("A", vmime::string(10, 'a'), get(cache, "a"));
+
+		cache->put("d", vmime::string(10, 'd'));
+
+		VASSERT_EQ("B evicted", "", get(cache, "b"));
+		VASSERT_EQ("A kept", vmime::string(10, 'a'), get(cache, "a"));
+		VASSERT_EQ("C kept", vmime::string(10, 'c'), get(cache, "c"));
+		VASSERT_EQ("D kept", vmime::string(10, 'd'), get(cache, "d"));
+		VASSERT_EQ("Memory", 30, static_cast <int>(cache->getMemorySize()));
+	}
+
+	void testNotCacheable()
+	{
+		vmime::ref <vmime::net::imap::IMAPContentCache> cache =
+			vmime::create <vmime::net::imap::IMAPContentCache>(100, 10, fspath(), 1000);
+
+		VASSERT_TRUE("Small", cache->isCacheable(10));
+		VASSERT_FALSE("Large, no spill directory", cache->isCacheable(11));
+
+		cache->put("a", vmime::string(20, 'a'));
+
+		VASSERT_EQ("Not cached", "", get(cache, "a"));
+		VASSERT_EQ("Memory", 0, static_cast <int>(cache->getMemorySize()));
+	}
+
+	void testSpillToDisk()
+	{
+		vmime::ref <vmime::net::imap::IMAPContentCache> cache =
+			vmime::create <vmime::net::imap::IMAPContentCache>(100, 10, m_tempPath, 50);
+
+		VASSERT_TRUE("Cacheable", cache->isCacheable(50));
+		VASSERT_FALSE("Too large", cache->isCacheable(51));
+
+		cache->put("a", vmime::string(30, 'a'));
+		cache->put("b", "small");
+
+		VASSERT_EQ("Disk", 30, static_cast <int>(cache->getDiskSize()));
+		VASSERT_EQ("Memory", 5, static_cast <int>(cache->getMemorySize()));
+		VASSERT_EQ("Files", 1, countFiles());
+
+		VASSERT_EQ("A", vmime::string(30, 'a'), get(cache, "a"));
+		VASSERT_EQ("B", "small", get(cache, "b"));
+
+		// Evicts "a" from the disk
+		cache->put("c", vmime::string(30, 'c'));
+
+		VASSERT_EQ("A evicted", "", get(cache, "a"));
+		VASSERT_EQ("C", vmime::string(30, 'c'), get(cache, "c"));
+		VASSERT_EQ("Files (2)", 1, countFiles());
+
+		cache->clear();
+
+		VASSERT_EQ("Files (3)", 0, countFiles());
+		VASSERT_EQ("Disk (2)", 0, static_cast <int>(cache->getDiskSize()));
+		VASSERT_EQ("Memory (2)", 0, static_cast <int>(cache->getMemorySize()));
+	}
+
+	void testReplace()
+	{
+		vmime::ref <vmime::net::imap::IMAPContentCache> cache =
+			vmime::create <vmime::net::imap::IMAPContentCache>(100, 50, fspath(), 0);
+
+		cache->put("a", "first");
+		cache->put("a", "second value");
+
+		VASSERT_EQ("A", "second value", get(cache, "a"));
+		VASSERT_EQ("Memory", 12, static_cast <int>(cache->getMemorySize()));
+	}
+
+private:
+
+	fspath m_tempPath;
+
+
+	static const vmime::string get
+		(vmime::ref <vmime::net::imap::IMAPContentCache> cache, const vmime::string& key)
+	{
+		std::ostringstream oss;
+		vmime::utility::outputStreamAdapter os(oss);
+
+		cache->get(key, os);
+
+		return oss.str();
+	}
+
+	int countFiles()
+	{
+		vmime::ref <vmime::utility::fileSystemFactory> fsf =
+			vmime::platform::getHandler()->getFileSystemFactory();
+
+		vmime::ref <vmime::utility::fileIterator> files = fsf->create(m_tempPath)->getFiles();
+		int count = 0;
+
+		while (files->hasMoreElements())
+		{
+			files->nextElement();
+			++count;
+		}
+
+		return count;
+	}
+
+VMIME_TEST_SUITE_END
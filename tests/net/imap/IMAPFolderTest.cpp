@@ -0,0 +1,1915 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002-2013 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+
+#include "tests/testUtils.hpp"
+#include "tests/net/imap/IMAPTestUtils.hpp"
+
+
+class IDLEIMAPTestSocket;
+class noIDLEIMAPTestSocket;
+class QRESYNCIMAPTestSocket;
+class CONDSTOREIMAPTestSocket;
+class MULTIAPPENDIMAPTestSocket;
+class APPENDIMAPTestSocket;
+class POOLIMAPTestSocket;
+class METADATAIMAPTestSocket;
+class SEARCHIMAPTestSocket;
+class ESEARCHIMAPTestSocket;
+class LISTSTATUSIMAPTestSocket;
+class STATUSIMAPTestSocket;
+class BADSTATUSIMAPTestSocket;
+class MOVEIMAPTestSocket;
+class UIDPLUSIMAPTestSocket;
+class NOUIDIMAPTestSocket;
+class BADSTOREIMAPTestSocket;
+class COPYIMAPTestSocket;
+class BATCHIMAPTestSocket;
+
+
+// Messages and commands received by the APPEND test servers
+static std::vector <vmime::string> appendedMessages;
+static int appendCommandCount = 0;
+
+// Whether the client closed the connection to the APPEND test servers
+// while they were waiting for literal data
+static bool appendAborted = false;
+
+// Number of connections which logged in to the pool test server
+static int poolLoginCount = 0;
+
+// Number of BODYSTRUCTURE items sent by the metadata cache test server
+static int structureFetchCount = 0;
+
+// Last command received by the search test servers (literals included)
+static vmime::string lastSearchCommand;
+
+// STATUS commands received by the folder status test servers, and maximum
+// number of STATUS commands received before the client read a response
+static int statusCommandCount = 0;
+static int maxPendingStatusCount = 0;
+
+// Commands received by the move test servers
+static std::vector <vmime::string> moveCommands;
+
+// Message sets requested by the batched fetch test server
+static std::vector <vmime::string> fetchSets;
+
+
+class IMAPFolderTestListener :
+	public vmime::net::events::messageCountListener,
+	public vmime::net::events::messageChangedListener
+{
+public:
+
+	IMAPFolderTestListener() : added(0), removed(0), changed(0) { }
+
+	void messagesAdded(const vmime::net::events::messageCountEvent& event)
+	{
+		added += static_cast <int>(event.getNumbers().size());
+	}
+
+	void messagesRemoved(const vmime::net::events::messageCountEvent& event)
+	{
+		removed += static_cast <int>(event.getNumbers().size());
+	}
+
+	void messageChanged(const vmime::net::events::messageChangedEvent& event)
+	{
+		changed += static_cast <int>(event.getNumbers().size());
+	}
+
+	int added, removed, changed;
+};
+
+
+class IMAPFolderTestFetchListener : public vmime::net::messageFetchListener
+{
+public:
+
+	IMAPFolderTestFetchListener() : count(0), lastNumber(0), inOrder(true) { }
+
+	void messageFetched(vmime::ref <vmime::net::message> msg)
+	{
+		if (msg->getNumber() <= lastNumber || msg->getFlags() == vmime::net::message::FLAG_UNDEFINED)
+			inOrder = false;
+
+		lastNumber = msg->getNumber();
+		++count;
+	}
+
+	int count, lastNumber;
+	bool inOrder;
+};
+
+
+VMIME_TEST_SUITE_BEGIN(IMAPFolderTest)
+
+	VMIME_TEST_LIST_BEGIN
+		VMIME_TEST(testIdle)
+		VMIME_TEST(testIdleNotSupported)
+		VMIME_TEST(testResyncQRESYNC)
+		VMIME_TEST(testResyncCONDSTORE)
+		VMIME_TEST(testResyncUIDValidityChanged)
+		VMIME_TEST(testAddMessagesMultiAppend)
+		VMIME_TEST(testAddMessagesSyncLiterals)
+		VMIME_TEST(testAddMessageShortStream)
+		VMIME_TEST(testAddGeneratedMessage)
+		VMIME_TEST(testAddUnbufferedMessage)
+		VMIME_TEST(testConnectionPool)
+		VMIME_TEST(testConnectionPoolDisabled)
+		VMIME_TEST(testConnectionPoolSelectError)
+		VMIME_TEST(testFetchMessagesMetadataCache)
+		VMIME_TEST(testSearch)
+		VMIME_TEST(testSearchLiteral)
+		VMIME_TEST(testSearchESEARCH)
+		VMIME_TEST(testFoldersStatusLISTSTATUS)
+		VMIME_TEST(testFoldersStatusPipelined)
+		VMIME_TEST(testFoldersStatusPipelinedBadResponse)
+		VMIME_TEST(testMoveMessagesMOVE)
+		VMIME_TEST(testMoveMessagesUIDPLUS)
+		VMIME_TEST(testMoveMessagesUIDPLUSMissingUID)
+		VMIME_TEST(testMoveMessagesUIDPLUSStoreFailed)
+		VMIME_TEST(testMoveMessagesCopy)
+		VMIME_TEST(testFetchMessageSet)
+	VMIME_TEST_LIST_END
+
+
+	void testIdle()
+	{
+		vmime::ref <vmime::net::store> store =
+			createIMAPTestStore <IDLEIMAPTestSocket>();
+
+		store->connect();
+
+		vmime::ref <vmime::net::imap::IMAPFolder> folder =
+			store->getFolder(vmime::net::folder::path("INBOX"))
+				.dynamicCast <vmime::net::imap::IMAPFolder>();
+
+		folder->open(vmime::net::folder::MODE_READ_WRITE);
+
+		VASSERT_EQ("Count", 3, folder->getMessageCount());
+
+		IMAPFolderTestListener listener;
+		folder->addMessageCountListener(&listener);
+		folder->addMessageChangedListener(&listener);
+
+		folder->startIdle();
+
+		VASSERT_TRUE("Idle", folder->isIdle());
+		VASSERT_TRUE("Poll", folder->pollIdle());
+		VASSERT_FALSE("Poll again", folder->pollIdle());
+
+		VASSERT_EQ("Added", 2, listener.added);
+		VASSERT_EQ("Removed", 1, listener.removed);
+		VASSERT_EQ("Changed", 1, listener.changed);
+		VASSERT_EQ("New count", 4, folder->getMessageCount());
+
+		// Any command ends the IDLE state
+		folder->getMessageNumbersStartingOnUID("1");
+
+		VASSERT_FALSE("Not idle", folder->isIdle());
+
+		// Response with a literal, completed after IDLE
+		VASSERT_EQ("Changed after IDLE", 2, listener.changed);
+
+		folder->removeMessageCountListener(&listener);
+		folder->removeMessageChangedListener(&listener);
+
+		folder->close(false);
+		store->disconnect();
+	}
+
+	void testIdleNotSupported()
+	{
+		vmime::ref <vmime::net::store> store =
+			createIMAPTestStore <noIDLEIMAPTestSocket>();
+
+		store->connect();
+
+		vmime::ref <vmime::net::imap::IMAPFolder> folder =
+			store->getFolder(vmime::net::folder::path("INBOX"))
+				.dynamicCast <vmime::net::imap::IMAPFolder>();
+
+		folder->open(vmime::net::folder::MODE_READ_WRITE);
+
+		VASSERT_THROW("Not supported", folder->startIdle(),
+			vmime::exceptions::operation_not_supported);
+
+		VASSERT_FALSE("Not idle", folder->isIdle());
+
+		folder->close(false);
+		store->disconnect();
+	}
+
+	void testResyncQRESYNC()
+	{
+		vmime::ref <vmime::net::store> store =
+			createIMAPTestStore <QRESYNCIMAPTestSocket>();
+
+		store->connect();
+
+		vmime::ref <vmime::net::imap::IMAPFolder> folder =
+			store->getFolder(vmime::net::folder::path("INBOX"))
+				.dynamicCast <vmime::net::imap::IMAPFolder>();
+
+		std::vector <vmime::ref <vmime::net::message> > changed;
+		std::vector <vmime::net::message::uid> vanished;
+
+		VASSERT_TRUE("Resync", folder->openAndResync
+			(vmime::net::folder::MODE_READ_WRITE, 42, "90", "", changed, vanished));
+
+		VASSERT_EQ("Highest mod-seq", std::string("100"), folder->getHighestModSequence());
+
+		VASSERT_EQ("Changed", 1, static_cast <int>(changed.size()));
+		VASSERT_EQ("Changed number", 2, changed[0]->getNumber());
+		VASSERT_EQ("Changed UID", std::string("42:12"), changed[0]->getUniqueId());
+		VASSERT_EQ("Changed flags", vmime::net::message::FLAG_SEEN, changed[0]->getFlags());
+		VASSERT_EQ("Changed mod-seq", std::string("95"), changed[0].dynamicCast
+			<vmime::net::imap::IMAPMessage>()->getModSequence());
+
+		VASSERT_EQ("Vanished", 3, static_cast <int>(vanished.size()));
+		VASSERT_EQ("Vanished 1", std::string("42:11"), vanished[0]);
+		VASSERT_EQ("Vanished 2", std::string("42:13"), vanished[1]);
+		VASSERT_EQ("Vanished 3", std::string("42:14"), vanished[2]);
+
+		folder->close(false);
+		store->disconnect();
+	}
+
+	void testResyncCONDSTORE()
+	{
+		vmime::ref <vmime::net::store> store =
+			createIMAPTestStore <CONDSTOREIMAPTestSocket>();
+
+		store->connect();
+
+		vmime::ref <vmime::net::imap::IMAPFolder> folder =
+			store->getFolder(vmime::net::folder::path("INBOX"))
+				.dynamicCast <vmime::net::imap::IMAPFolder>();
+
+		std::vector <vmime::ref <vmime::net::message> > changed;
+		std::vector <vmime::net::message::uid> vanished;
+
+		VASSERT_TRUE("Resync", folder->openAndResync
+			(vmime::net::folder::MODE_READ_WRITE, 42, "90", "10:13", changed, vanished));
+
+		VASSERT_EQ("Changed", 1, static_cast <int>(changed.size()));
+		VASSERT_EQ("Changed UID", std::string("42:12"), changed[0]->getUniqueId());
+
+		VASSERT_EQ("Vanished", 2, static_cast <int>(vanished.size()));
+		VASSERT_EQ("Vanished 1", std::string("42:11"), vanished[0]);
+		VASSERT_EQ("Vanished 2", std::string("42:13"), vanished[1]);
+
+		folder->close(false);
+		store->disconnect();
+	}
+
+	void testResyncUIDValidityChanged()
+	{
+		vmime::ref <vmime::net::store> store =
+			createIMAPTestStore <CONDSTOREIMAPTestSocket>();
+
+		store->connect();
+
+		vmime::ref <vmime::net::imap::IMAPFolder> folder =
+			store->getFolder(vmime::net::folder::path("INBOX"))
+				.dynamicCast <vmime::net::imap::IMAPFolder>();
+
+		std::vector <vmime::ref <vmime::net::message> > changed;
+		std::vector <vmime::net::message::uid> vanished;
+
+		VASSERT_FALSE("Resync", folder->openAndResync
+			(vmime::net::folder::MODE_READ_WRITE, 41, "90", "10:13", changed, vanished));
+
+		VASSERT_TRUE("Open", folder->isOpen());
+		VASSERT_EQ("UID validity", 42u, folder->getUIDValidity());
+		VASSERT_TRUE("Changed", changed.empty());
+		VASSERT_TRUE("Vanished", vanished.empty());
+
+		folder->close(false);
+		store->disconnect();
+	}
+
+	void testAddMessagesMultiAppend()
+	{
+		appendedMessages.clear();
+		appendCommandCount = 0;
+
+		vmime::ref <vmime::net::store> store =
+			createIMAPTestStore <MULTIAPPENDIMAPTestSocket>();
+
+		store->connect();
+
+		vmime::ref <vmime::net::imap::IMAPFolder> folder =
+			store->getFolder(vmime::net::folder::path("INBOX"))
+				.dynamicCast <vmime::net::imap::IMAPFolder>();
+
+		folder->open(vmime::net::folder::MODE_READ_WRITE);
+
+		IMAPFolderTestListener listener;
+		folder->addMessageCountListener(&listener);
+
+		const vmime::string msg1 = "Subject: first\r\n\r\nFirst message\r\n";
+		const vmime::string msg2 = "Subject: second\r\n\r\nSecond message\r\n";
+
+		vmime::utility::inputStreamStringAdapter is1(msg1);
+		vmime::utility::inputStreamStringAdapter is2(msg2);
+
+		std::vector <vmime::net::imap::IMAPFolder::messageToAdd> msgs;
+		msgs.push_back(vmime::net::imap::IMAPFolder::messageToAdd
+			(is1, static_cast <int>(msg1.length()), vmime::net::message::FLAG_SEEN));
+		msgs.push_back(vmime::net::imap::IMAPFolder::messageToAdd
+			(is2, static_cast <int>(msg2.length())));
+
+		const std::vector <vmime::net::message::uid> uids = folder->addMessages(msgs);
+
+		VASSERT_EQ("Commands", 1, appendCommandCount);
+		VASSERT_EQ("Messages", 2, static_cast <int>(appendedMessages.size()));
+		VASSERT_EQ("Message 1", msg1, appendedMessages[0]);
+		VASSERT_EQ("Message 2", msg2, appendedMessages[1]);
+
+		VASSERT_EQ("UIDs", 2, static_cast <int>(uids.size()));
+		VASSERT_EQ("UID 1", std::string("42:100"), uids[0]);
+		VASSERT_EQ("UID 2", std::string("42:101"), uids[1]);
+
+		VASSERT_EQ("Added", 2, listener.added);
+		VASSERT_EQ("Count", 2, folder->getMessageCount());
+
+		folder->removeMessageCountListener(&listener);
+
+		folder->close(false);
+		store->disconnect();
+	}
+
+	void testAddMessagesSyncLiterals()
+	{
+		appendedMessages.clear();
+		appendCommandCount = 0;
+
+		vmime::ref <vmime::net::store> store =
+			createIMAPTestStore <APPENDIMAPTestSocket>();
+
+		store->connect();
+
+		vmime::ref <vmime::net::imap::IMAPFolder> folder =
+			store->getFolder(vmime::net::folder::path("INBOX"))
+				.dynamicCast <vmime::net::imap::IMAPFolder>();
+
+		folder->open(vmime::net::folder::MODE_READ_WRITE);
+
+		const vmime::string msg1 = "Subject: first\r\n\r\nFirst message\r\n";
+		const vmime::string msg2 = "Subject: second\r\n\r\nSecond message\r\n";
+
+		vmime::utility::inputStreamStringAdapter is1(msg1);
+		vmime::utility::inputStreamStringAdapter is2(msg2);
+
+		std::vector <vmime::net::imap::IMAPFolder::messageToAdd> msgs;
+		msgs.push_back(vmime::net::imap::IMAPFolder::messageToAdd
+			(is1, static_cast <int>(msg1.length())));
+		msgs.push_back(vmime::net::imap::IMAPFolder::messageToAdd
+			(is2, static_cast <int>(msg2.length())));
+
+		const std::vector <vmime::net::message::uid> uids = folder->addMessages(msgs);
+
+		// One command per message, and no UIDs without UIDPLUS
+		VASSERT_EQ("Commands", 2, appendCommandCount);
+		VASSERT_EQ("Messages", 2, static_cast <int>(appendedMessages.size()));
+		VASSERT_EQ("Message 1", msg1, appendedMessages[0]);
+		VASSERT_EQ("Message 2", msg2, appendedMessages[1]);
+
+		VASSERT_EQ("UIDs", 2, static_cast <int>(uids.size()));
+		VASSERT_TRUE("UID 1", uids[0].empty());
+		VASSERT_TRUE("UID 2", uids[1].empty());
+
+		folder->close(false);
+		store->disconnect();
+	}
+
+	void testAddMessageShortStream()
+	{
+		appendedMessages.clear();
+		appendCommandCount = 0;
+		appendAborted = false;
+
+		vmime::ref <vmime::net::store> store =
+			createIMAPTestStore <APPENDIMAPTestSocket>();
+
+		store->connect();
+
+		vmime::ref <vmime::net::imap::IMAPFolder> folder =
+			store->getFolder(vmime::net::folder::path("INBOX"))
+				.dynamicCast <vmime::net::imap::IMAPFolder>();
+
+		folder->open(vmime::net::folder::MODE_READ_WRITE);
+
+		const vmime::string msg = "Subject: short\r\n\r\nShort message\r\n";
+		vmime::utility::inputStreamStringAdapter is(msg);
+
+		// The stream ends before the declared size
+		VASSERT_THROW("Short stream",
+			folder->addMessage(is, static_cast <int>(msg.length()) + 10),
+			vmime::exceptions::invalid_argument);
+
+		// The server is still waiting for literal data, so the
+		// connection must not be used anymore
+		VASSERT("Disconnected", appendAborted);
+	}
+
+	void testAddGeneratedMessage()
+	{
+		appendedMessages.clear();
+		appendCommandCount = 0;
+
+		vmime::ref <vmime::net::store> store =
+			createIMAPTestStore <APPENDIMAPTestSocket>();
+
+		store->connect();
+
+		vmime::ref <vmime::net::folder> folder =
+			store->getFolder(vmime::net::folder::path("INBOX"));
+
+		folder->open(vmime::net::folder::MODE_READ_WRITE);
+
+		vmime::ref <vmime::message> msg = vmime::create <vmime::message>();
+		msg->getHeader()->Subject()->setValue(vmime::text("generated"));
+		msg->getBody()->setContents(vmime::create <vmime::stringContentHandler>
+			("Generated message\r\n"));
+
+		// The literal size is computed, and the message is generated
+		// directly to the connection
+		folder->addMessage(msg);
+
+		VASSERT_EQ("Commands", 1, appendCommandCount);
+		VASSERT_EQ("Messages", 1, static_cast <int>(appendedMessages.size()));
+		VASSERT_EQ("Message", msg->generate(), appendedMessages[0]);
+
+		folder->close(false);
+		store->disconnect();
+	}
+
+	void testAddUnbufferedMessage()
+	{
+		appendedMessages.clear();
+		appendCommandCount = 0;
+
+		vmime::ref <vmime::net::store> store =
+			createIMAPTestStore <APPENDIMAPTestSocket>();
+
+		store->connect();
+
+		vmime::ref <vmime::net::folder> folder =
+			store->getFolder(vmime::net::folder::path("INBOX"));
+
+		folder->open(vmime::net::folder::MODE_READ_WRITE);
+
+		// Base64 data to be sent as 7bit, read from a stream which
+		// cannot be reset: "Unbuffered message\r\n"
+		const vmime::string data = "VW5idWZmZXJlZCBtZXNzYWdlDQo=";
+
+		vmime::ref <vmime::message> msg = vmime::create <vmime::message>();
+		msg->getHeader()->Subject()->setValue(vmime::text("unbuffered"));
+		msg->getBody()->setContents(vmime::create <vmime::streamContentHandler>
+			(vmime::create <testOneShotInputStream>(data).dynamicCast <vmime::utility::inputStream>(),
+			 data.length(), vmime::encoding(vmime::encodingTypes::BASE64)));
+		msg->getBody()->setEncoding(vmime::encoding(vmime::encodingTypes::SEVEN_BIT));
+
+		// The literal size cannot be computed without reading data: the
+		// message is generated before being sent
+		folder->addMessage(msg);
+
+		VASSERT_EQ("Messages", 1, static_cast <int>(appendedMessages.size()));
+		VASSERT("Message", appendedMessages[0].find("\r\n\r\nUnbuffered message\r\n") != vmime::string::npos);
+
+		folder->close(false);
+		store->disconnect();
+	}
+
+	void testConnectionPool()
+	{
+		poolLoginCount = 0;
+
+		vmime::ref <vmime::net::store> store =
+			createIMAPTestStore <POOLIMAPTestSocket>();
+
+		store->getSession()->getProperties()["store.imap.connection.pool.size"] = 2;
+
+		store->connect();
+
+		VASSERT_EQ("Store login", 1, poolLoginCount);
+
+		vmime::ref <vmime::net::folder> folder =
+			store->getFolder(vmime::net::folder::path("INBOX"));
+
+		folder->open(vmime::net::folder::MODE_READ_WRITE);
+		folder->close(false);
+
+		VASSERT_EQ("First open", 2, poolLoginCount);
+
+		// The connection released by close() is reused
+		folder->open(vmime::net::folder::MODE_READ_ONLY);
+		folder->close(false);
+
+		VASSERT_EQ("Second open", 2, poolLoginCount);
+
+		// STATUS on a closed folder runs on the pooled connection
+		int count = 0, unseen = 0;
+		folder->status(count, unseen);
+
+		VASSERT_EQ("Status login", 2, poolLoginCount);
+		VASSERT_EQ("Count", 3, count);
+		VASSERT_EQ("Unseen", 1, unseen);
+
+		store->disconnect();
+	}
+
+	void testConnectionPoolDisabled()
+	{
+		poolLoginCount = 0;
+
+		vmime::ref <vmime::net::store> store =
+			createIMAPTestStore <POOLIMAPTestSocket>();
+
+		store->connect();
+
+		vmime::ref <vmime::net::folder> folder =
+			store->getFolder(vmime::net::folder::path("INBOX"));
+
+		folder->open(vmime::net::folder::MODE_READ_WRITE);
+		folder->close(false);
+
+		folder->open(vmime::net::folder::MODE_READ_WRITE);
+		folder->close(false);
+
+		// One connection per open() when pooling is disabled
+		VASSERT_EQ("Logins", 3, poolLoginCount);
+
+		int count = 0, unseen = 0;
+		folder->status(count, unseen);
+
+		VASSERT_EQ("Status login", 3, poolLoginCount);
+		VASSERT_EQ("Count", 3, count);
+
+		store->disconnect();
+	}
+
+	void testConnectionPoolSelectError()
+	{
+		poolLoginCount = 0;
+
+		vmime::ref <vmime::net::store> store =
+			createIMAPTestStore <POOLIMAPTestSocket>();
+
+		store->getSession()->getProperties()["store.imap.connection.pool.size"] = 2;
+
+		store->connect();
+
+		vmime::ref <vmime::net::folder> rejected =
+			store->getFolder(vmime::net::folder::path("Rejected"));
+		vmime::ref <vmime::net::folder> invalid =
+			store->getFolder(vmime::net::folder::path("Invalid"));
+		vmime::ref <vmime::net::folder> folder =
+			store->getFolder(vmime::net::folder::path("INBOX"));
+
+		VASSERT_THROW("Rejected", rejected->open(vmime::net::folder::MODE_READ_WRITE),
+			vmime::exceptions::command_error);
+
+		// The connection is still usable after a rejected SELECT
+		folder->open(vmime::net::folder::MODE_READ_WRITE);
+		folder->close(false);
+
+		VASSERT_EQ("Reused", 2, poolLoginCount);
+
+		VASSERT_THROW("Invalid", invalid->open(vmime::net::folder::MODE_READ_WRITE),
+			vmime::exceptions::invalid_response);
+
+		// The connection is not given back to the pool after an
+		// invalid response
+		folder->open(vmime::net::folder::MODE_READ_WRITE);
+		folder->close(false);
+
+		VASSERT_EQ("Not reused", 3, poolLoginCount);
+
+		store->disconnect();
+	}
+
+	void testFetchMessagesMetadataCache()
+	{
+		const vmime::string cachePath = "/tmp/vmime"
+			+ vmime::utility::stringUtils::toString(std::time(NULL))
+			+ vmime::utility::stringUtils::toString(std::rand());
+
+		const int options = vmime::net::folder::FETCH_FLAGS |
+			vmime::net::folder::FETCH_STRUCTURE | vmime::net::folder::FETCH_SIZE |
+			vmime::net::folder::FETCH_ENVELOPE;
+
+		structureFetchCount = 0;
+
+		// First session: metadata is fetched from the server
+		{
+			vmime::ref <vmime::net::store> store =
+				createIMAPTestStore <METADATAIMAPTestSocket>();
+
+			store->getSession()->getProperties()["store.imap.cache.metadata.path"] = cachePath;
+			store->connect();
+
+			vmime::ref <vmime::net::folder> folder =
+				store->getFolder(vmime::net::folder::path("INBOX"));
+
+			folder->open(vmime::net::folder::MODE_READ_ONLY);
+
+			std::vector <vmime::ref <vmime::net::message> > msgs = folder->getMessages();
+			folder->fetchMessages(msgs, options);
+
+			VASSERT_EQ("Server structures", 2, structureFetchCount);
+
+			folder->close(false);
+			store->disconnect();
+		}
+
+		structureFetchCount = 0;
+
+		// Second session: only flags and UIDs are fetched
+		vmime::ref <vmime::net::store> store =
+			createIMAPTestStore <METADATAIMAPTestSocket>();
+
+		store->getSession()->getProperties()["store.imap.cache.metadata.path"] = cachePath;
+		store->connect();
+
+		vmime::ref <vmime::net::folder> folder =
+			store->getFolder(vmime::net::folder::path("INBOX"));
+
+		folder->open(vmime::net::folder::MODE_READ_ONLY);
+
+		std::vector <vmime::ref <vmime::net::message> > msgs = folder->getMessages();
+		folder->fetchMessages(msgs, options);
+
+		VASSERT_EQ("Cached structures", 0, structureFetchCount);
+
+		VASSERT_EQ("Flags 1", vmime::net::message::FLAG_SEEN, msgs[0]->getFlags());
+		VASSERT_EQ("Flags 2", 0, msgs[1]->getFlags());
+		VASSERT_EQ("Size", 1235, msgs[1]->getSize());
+		VASSERT_EQ("Subject", "Subject 2", msgs[1]->getHeader()->Subject()->getValue()
+			.dynamicCast <const vmime::text>()->getWholeBuffer());
+
+		vmime::ref <vmime::net::structure> str = msgs[1]->getStructure();
+
+		VASSERT_EQ("Parts", 1, static_cast <int>(str->getPartCount()));
+		VASSERT_EQ("Type", "multipart/mixed", str->getPartAt(0)->getType().generate());
+		VASSERT_EQ("Sub-parts", 2, static_cast <int>(str->getPartAt(0)->getStructure()->getPartCount()));
+		VASSERT_EQ("Sub-part size", 300, str->getPartAt(0)->getStructure()->getPartAt(1)->getSize());
+
+		folder->close(false);
+		store->disconnect();
+
+		// Clean up
+		vmime::ref <vmime::utility::fileSystemFactory> fsf =
+			vmime::platform::getHandler()->getFileSystemFactory();
+
+		vmime::ref <vmime::utility::file> dir = fsf->create(fsf->stringToPath(cachePath));
+		vmime::ref <vmime::utility::fileIterator> mboxes = dir->getFiles();
+
+		while (mboxes->hasMoreElements())
+		{
+			vmime::ref <vmime::utility::file> mbox = mboxes->nextElement();
+			vmime::ref <vmime::utility::fileIterator> files = mbox->getFiles();
+
+			while (files->hasMoreElements())
+				files->nextElement()->remove();
+
+			mbox->remove();
+		}
+
+		dir->remove();
+	}
+
+	void testSearch()
+	{
+		vmime::ref <vmime::net::store> store =
+			createIMAPTestStore <SEARCHIMAPTestSocket>();
+
+		store->connect();
+
+		vmime::ref <vmime::net::folder> folder =
+			store->getFolder(vmime::net::folder::path("INBOX"));
+
+		folder->open(vmime::net::folder::MODE_READ_ONLY);
+
+		typedef vmime::net::searchCriteria sc;
+
+		vmime::net::searchResult res = folder->search(sc::allOf
+			(sc::flagsUnset(vmime::net::message::FLAG_SEEN),
+			 sc::headerContains("From", "john")));
+
+		VASSERT_EQ("Command", "SEARCH UNSEEN FROM \"john\"", lastSearchCommand);
+
+		// Numbers are sorted, even if the server does not
+		VASSERT_EQ("Count", 4u, res.getCount());
+		VASSERT_EQ("Min", 2u, res.getMin());
+		VASSERT_EQ("Max", 9u, res.getMax());
+		VASSERT_EQ("Set", "2:3,8:9", res.getSet());
+
+		folder->close(false);
+		store->disconnect();
+	}
+
+	void testSearchLiteral()
+	{
+		vmime::ref <vmime::net::store> store =
+			createIMAPTestStore <SEARCHIMAPTestSocket>();
+
+		store->connect();
+
+		vmime::ref <vmime::net::folder> folder =
+			store->getFolder(vmime::net::folder::path("INBOX"));
+
+		folder->open(vmime::net::folder::MODE_READ_ONLY);
+
+		typedef vmime::net::searchCriteria sc;
+
+		vmime::net::searchResult res = folder->search(sc::anyOf
+			(sc::bodyContains("caf\xc3\xa9"), sc::sizeLarger(1024)));
+
+		VASSERT_EQ("Command", "SEARCH CHARSET UTF-8 OR BODY {5}\r\ncaf\xc3\xa9 LARGER 1024",
+			lastSearchCommand);
+		VASSERT_EQ("Count", 4u, res.getCount());
+
+		folder->close(false);
+		store->disconnect();
+	}
+
+	void testSearchESEARCH()
+	{
+		vmime::ref <vmime::net::store> store =
+			createIMAPTestStore <ESEARCHIMAPTestSocket>();
+
+		store->connect();
+
+		vmime::ref <vmime::net::imap::IMAPFolder> folder =
+			store->getFolder(vmime::net::folder::path("INBOX"))
+				.dynamicCast <vmime::net::imap::IMAPFolder>();
+
+		folder->open(vmime::net::folder::MODE_READ_ONLY);
+
+		typedef vmime::net::searchCriteria sc;
+		typedef vmime::net::searchResult sr;
+
+		// Only the requested items are returned
+		vmime::net::searchResult res = folder->searchUIDs
+			(sc::all(), sr::RETURN_MIN | sr::RETURN_COUNT);
+
+		VASSERT_EQ("Command", "UID SEARCH RETURN (MIN COUNT) ALL", lastSearchCommand);
+		VASSERT_EQ("Options", sr::RETURN_MIN | sr::RETURN_COUNT, res.getReturnOptions());
+		VASSERT_EQ("Count", 4u, res.getCount());
+		VASSERT_EQ("Min", 102u, res.getMin());
+		VASSERT_EQ("Ranges", 0, static_cast <int>(res.getRanges().size()));
+
+		// Numbers are returned as a compact set
+		res = folder->search(sc::flagsSet(vmime::net::message::FLAG_MARKED));
+
+		VASSERT_EQ("Command 2", "SEARCH RETURN (ALL) FLAGGED", lastSearchCommand);
+		VASSERT_EQ("Count 2", 4u, res.getCount());
+		VASSERT_EQ("Max 2", 9u, res.getMax());
+		VASSERT_EQ("Set 2", "2:3,8:9", res.getSet());
+
+		folder->close(false);
+		store->disconnect();
+	}
+
+	void testFoldersStatusLISTSTATUS()
+	{
+		vmime::ref <vmime::net::store> store =
+			createIMAPTestStore <LISTSTATUSIMAPTestSocket>();
+
+		store->connect();
+
+		statusCommandCount = 0;
+
+		const std::vector <vmime::net::imap::IMAPStore::folderStatus> v =
+			store.dynamicCast <vmime::net::imap::IMAPStore>()->getFoldersStatus();
+
+		VASSERT_EQ("Count", 3, static_cast <int>(v.size()));
+		VASSERT_EQ("STATUS commands", 0, statusCommandCount);
+
+		VASSERT_EQ("1.1", "INBOX", v[0].mailbox->getName().getBuffer());
+		VASSERT_TRUE("1.2", v[0].hasStatus);
+		VASSERT_EQ("1.3", 17, v[0].messageCount);
+		VASSERT_EQ("1.4", 2, v[0].unseenCount);
+		VASSERT_EQ("1.5", 351u, v[0].uidNext);
+
+		VASSERT_EQ("2.1", "Archive", v[1].mailbox->getName().getBuffer());
+		VASSERT_FALSE("2.2", v[1].hasStatus);
+
+		VASSERT_EQ("3.1", "2013", v[2].mailbox->getName().getBuffer());
+		VASSERT_TRUE("3.2", v[2].mailbox->getFullPath() ==
+			vmime::net::folder::path("Archive") / vmime::net::folder::path::component("2013"));
+		VASSERT_TRUE("3.3", v[2].hasStatus);
+		VASSERT_EQ("3.4", 5, v[2].messageCount);
+		VASSERT_EQ("3.5", 0, v[2].unseenCount);
+		VASSERT_EQ("3.6", 6u, v[2].uidNext);
+
+		store->disconnect();
+	}
+
+	void testFoldersStatusPipelined()
+	{
+		vmime::ref <vmime::net::store> store =
+			createIMAPTestStore <STATUSIMAPTestSocket>();
+
+		store->connect();
+
+		statusCommandCount = 0;
+		maxPendingStatusCount = 0;
+
+		const std::vector <vmime::net::imap::IMAPStore::folderStatus> v =
+			store.dynamicCast <vmime::net::imap::IMAPStore>()->getFoldersStatus();
+
+		VASSERT_EQ("Count", 3, static_cast <int>(v.size()));
+
+		// No STATUS for the folder which cannot be selected, and the
+		// other commands are sent without waiting for the responses
+		VASSERT_EQ("STATUS commands", 2, statusCommandCount);
+		VASSERT_EQ("Pipelined", 2, maxPendingStatusCount);
+
+		VASSERT_TRUE("1.1", v[0].hasStatus);
+		VASSERT_EQ("1.2", 17, v[0].messageCount);
+		VASSERT_EQ("1.3", 2, v[0].unseenCount);
+		VASSERT_EQ("1.4", 351u, v[0].uidNext);
+
+		VASSERT_FALSE("2", v[1].hasStatus);
+
+		VASSERT_TRUE("3.1", v[2].hasStatus);
+		VASSERT_EQ("3.2", 5, v[2].messageCount);
+		VASSERT_EQ("3.3", 6u, v[2].uidNext);
+
+		store->disconnect();
+	}
+
+	void testFoldersStatusPipelinedBadResponse()
+	{
+		vmime::ref <vmime::net::store> store =
+			createIMAPTestStore <BADSTATUSIMAPTestSocket>();
+
+		store->connect();
+
+		statusCommandCount = 0;
+
+		VASSERT_THROW("Bad response",
+			store.dynamicCast <vmime::net::imap::IMAPStore>()->getFoldersStatus(),
+			vmime::exceptions::invalid_response);
+
+		// The response to the second STATUS command has not been read,
+		// so the connection must not be used anymore
+		VASSERT_EQ("STATUS commands", 2, statusCommandCount);
+		VASSERT_FALSE("Disconnected", store->isConnected());
+	}
+
+	// Move messages 2 and 3 (of 5) and check the renumbering
+	template <typename T>
+	void doMoveMessages(const int expectedRemoved)
+	{
+		vmime::ref <vmime::net::store> store = createIMAPTestStore <T>();
+
+		store->connect();
+
+		vmime::ref <vmime::net::imap::IMAPFolder> folder =
+			store->getFolder(vmime::net::folder::path("INBOX"))
+				.dynamicCast <vmime::net::imap::IMAPFolder>();
+
+		folder->open(vmime::net::folder::MODE_READ_WRITE);
+
+		vmime::ref <vmime::net::message> msg4 = folder->getMessage(4);
+
+		IMAPFolderTestListener listener;
+		folder->addMessageCountListener(&listener);
+
+		moveCommands.clear();
+
+		std::vector <int> nums;
+		nums.push_back(3);
+		nums.push_back(2);
+
+		folder->moveMessages(vmime::net::folder::path("Archive"), nums);
+
+		VASSERT_EQ("Removed", expectedRemoved, listener.removed);
+		VASSERT_EQ("Count", 5 - expectedRemoved, folder->getMessageCount());
+		VASSERT_EQ("Renumbered", 2, msg4->getNumber());
+
+		folder->removeMessageCountListener(&listener);
+
+		folder->close(false);
+		store->disconnect();
+	}
+
+	void testMoveMessagesMOVE()
+	{
+		doMoveMessages <MOVEIMAPTestSocket>(2);
+
+		VASSERT_EQ("Commands", 1, static_cast <int>(moveCommands.size()));
+		VASSERT_EQ("MOVE", "MOVE 2:3 Archive", moveCommands[0]);
+	}
+
+	void testMoveMessagesUIDPLUS()
+	{
+		doMoveMessages <UIDPLUSIMAPTestSocket>(2);
+
+		// Only the moved messages are expunged
+		VASSERT_EQ("Commands", 4, static_cast <int>(moveCommands.size()));
+		VASSERT_EQ("FETCH", "FETCH 2:3 (UID)", moveCommands[0]);
+		VASSERT_EQ("COPY", "COPY 2:3 Archive", moveCommands[1]);
+		VASSERT_EQ("STORE", "STORE 2:3 +FLAGS.SILENT (\\Deleted)", moveCommands[2]);
+		VASSERT_EQ("UID EXPUNGE", "UID EXPUNGE 102,103", moveCommands[3]);
+	}
+
+	// Try to move messages 2 and 3 (of 5), which must fail
+	template <typename T>
+	void doMoveMessagesError()
+	{
+		vmime::ref <vmime::net::store> store = createIMAPTestStore <T>();
+
+		store->connect();
+
+		vmime::ref <vmime::net::imap::IMAPFolder> folder =
+			store->getFolder(vmime::net::folder::path("INBOX"))
+				.dynamicCast <vmime::net::imap::IMAPFolder>();
+
+		folder->open(vmime::net::folder::MODE_READ_WRITE);
+
+		moveCommands.clear();
+
+		VASSERT_THROW("Move",
+			folder->moveMessages(vmime::net::folder::path("Archive"), 2, 3),
+			vmime::exceptions::command_error);
+
+		VASSERT_EQ("Count", 5, folder->getMessageCount());
+
+		folder->close(false);
+		store->disconnect();
+	}
+
+	void testMoveMessagesUIDPLUSMissingUID()
+	{
+		doMoveMessagesError <NOUIDIMAPTestSocket>();
+
+		// No message is copied, nor marked as deleted
+		VASSERT_EQ("Commands", 1, static_cast <int>(moveCommands.size()));
+		VASSERT_EQ("FETCH", "FETCH 2:3 (UID)", moveCommands[0]);
+	}
+
+	void testMoveMessagesUIDPLUSStoreFailed()
+	{
+		doMoveMessagesError <BADSTOREIMAPTestSocket>();
+
+		// Nothing is expunged
+		VASSERT_EQ("Commands", 3, static_cast <int>(moveCommands.size()));
+		VASSERT_EQ("STORE", "STORE 2:3 +FLAGS.SILENT (\\Deleted)", moveCommands[2]);
+	}
+
+	void testMoveMessagesCopy()
+	{
+		// The whole folder is expunged, including message 5
+		doMoveMessages <COPYIMAPTestSocket>(3);
+
+		VASSERT_EQ("Commands", 3, static_cast <int>(moveCommands.size()));
+		VASSERT_EQ("COPY", "COPY 2:3 Archive", moveCommands[0]);
+		VASSERT_EQ("STORE", "STORE 2:3 +FLAGS.SILENT (\\Deleted)", moveCommands[1]);
+		VASSERT_EQ("EXPUNGE", "EXPUNGE", moveCommands[2]);
+	}
+
+	void testFetchMessageSet()
+	{
+		vmime::ref <vmime::net::store> store =
+			createIMAPTestStore <BATCHIMAPTestSocket>();
+
+		store->connect();
+
+		vmime::ref <vmime::net::folder> folder =
+			store->getFolder(vmime::net::folder::path("INBOX"));
+
+		folder->open(vmime::net::folder::MODE_READ_ONLY);
+
+		fetchSets.clear();
+
+		IMAPFolderTestFetchListener listener;
+		folder->fetchMessages(vmime::net::messageSet::byNumber(1, -1),
+			vmime::net::folder::FETCH_FLAGS, &listener);
+
+		// Messages are fetched by batches
+		VASSERT_EQ("Count", 2500, listener.count);
+		VASSERT_TRUE("Order", listener.inOrder);
+		VASSERT_EQ("Batches", 3, static_cast <int>(fetchSets.size()));
+		VASSERT_EQ("Batch 1", "1:1000", fetchSets[0]);
+		VASSERT_EQ("Batch 2", "1001:2000", fetchSets[1]);
+		VASSERT_EQ("Batch 3", "2001:2500", fetchSets[2]);
+
+		fetchSets.clear();
+
+		vmime::net::messageSet set = vmime::net::messageSet::byNumber(10, 20);
+		set.addRange(2490, 3000);
+
+		IMAPFolderTestFetchListener listener2;
+		folder->fetchMessages(set, vmime::net::folder::FETCH_FLAGS, &listener2);
+
+		// Out-of-range numbers are ignored
+		VASSERT_EQ("Count 2", 22, listener2.count);
+		VASSERT_EQ("Batches 2", 1, static_cast <int>(fetchSets.size()));
+		VASSERT_EQ("Batch 2.1", "10:20,2490:2500", fetchSets[0]);
+
+		folder->close(false);
+		store->disconnect();
+	}
+
+VMIME_TEST_SUITE_END
+
+
+/** IMAP test server which supports IDLE.
+  *
+  * Sends some mailbox updates as soon as the client enters
+  * the IDLE state.
+  */
+class IDLEIMAPTestSocket : public IMAPTestSocket
+{
+public:
+
+	IDLEIMAPTestSocket()
+	{
+		m_capabilities = "IMAP4rev1 IDLE";
+		m_messageCount = 3;
+	}
+
+	bool processIMAPCommand(const vmime::string& tag,
+		const vmime::string& cmd, const vmime::string& /* line */)
+	{
+		if (cmd == "IDLE")
+		{
+			VASSERT_TRUE("Not already idling", m_idleTag.empty());
+
+			m_idleTag = tag;
+
+			localSend("+ idling\r\n");
+			localSend("* 5 EXISTS\r\n");
+			localSend("* 2 EXPUNGE\r\n");
+			localSend("* 1 FETCH (FLAGS (\\Seen))\r\n");
+			// Literal data is not complete yet
+			localSend("* 3 FETCH (BODY[HEADER.FIELDS (SUBJECT)] {15}\r\nSubj");
+		}
+		else if (cmd == "DONE")
+		{
+			VASSERT_FALSE("Idling", m_idleTag.empty());
+
+			localSend("ect: test\r\n FLAGS (\\Flagged))\r\n");
+			localSend(m_idleTag + " OK IDLE terminated\r\n");
+			m_idleTag.clear();
+		}
+		else if (cmd == "SEARCH")
+		{
+			VASSERT_TRUE("IDLE terminated", m_idleTag.empty());
+
+			localSend("* SEARCH 1 2 3 4\r\n");
+			localSend(tag + " OK SEARCH completed\r\n");
+		}
+		else
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+private:
+
+	vmime::string m_idleTag;
+};
+
+
+/** IMAP test server which does not support IDLE.
+  */
+class noIDLEIMAPTestSocket : public IMAPTestSocket
+{
+};
+
+
+/** IMAP test server which supports QRESYNC.
+  */
+class QRESYNCIMAPTestSocket : public IMAPTestSocket
+{
+public:
+
+	QRESYNCIMAPTestSocket()
+		: m_enabled(false)
+	{
+		m_capabilities = "IMAP4rev1 CONDSTORE QRESYNC";
+		m_messageCount = 3;
+	}
+
+	bool processIMAPCommand(const vmime::string& tag,
+		const vmime::string& cmd, const vmime::string& line)
+	{
+		if (cmd == "ENABLE")
+		{
+			VASSERT_EQ("ENABLE", tag + " ENABLE QRESYNC", line);
+
+			m_enabled = true;
+
+			localSend("* ENABLED QRESYNC\r\n");
+			localSend(tag + " OK ENABLE completed\r\n");
+		}
+		else if (cmd == "SELECT")
+		{
+			VASSERT_TRUE("Enabled", m_enabled);
+			VASSERT_EQ("SELECT", tag + " SELECT INBOX (QRESYNC (42 90))", line);
+
+			sendSelectResponse(tag, cmd,
+				"* OK [HIGHESTMODSEQ 100] Highest\r\n"
+				"* VANISHED (EARLIER) 11,13:14\r\n"
+				"* 2 FETCH (UID 12 FLAGS (\\Seen) MODSEQ (95))\r\n");
+		}
+		else
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+private:
+
+	bool m_enabled;
+};
+
+
+/** IMAP test server which supports CONDSTORE, but not QRESYNC.
+  */
+class CONDSTOREIMAPTestSocket : public IMAPTestSocket
+{
+public:
+
+	CONDSTOREIMAPTestSocket()
+	{
+		m_capabilities = "IMAP4rev1 CONDSTORE";
+		m_messageCount = 3;
+	}
+
+	bool processIMAPCommand(const vmime::string& tag,
+		const vmime::string& cmd, const vmime::string& line)
+	{
+		if (cmd == "SELECT")
+		{
+			sendSelectResponse(tag, cmd, "* OK [HIGHESTMODSEQ 100] Highest\r\n");
+		}
+		else if (cmd == "UID" && line.find("UID FETCH") != vmime::string::npos)
+		{
+			VASSERT_EQ("UID FETCH", tag + " UID FETCH 1:* (FLAGS) (CHANGEDSINCE 90)", line);
+
+			localSend("* 2 FETCH (UID 12 FLAGS (\\Seen) MODSEQ (95))\r\n");
+			localSend(tag + " OK FETCH completed\r\n");
+		}
+		else if (cmd == "UID" && line.find("UID SEARCH") != vmime::string::npos)
+		{
+			VASSERT_EQ("UID SEARCH", tag + " UID SEARCH UID 10:13", line);
+
+			localSend("* SEARCH 10 12\r\n");
+			localSend(tag + " OK SEARCH completed\r\n");
+		}
+		else
+		{
+			return false;
+		}
+
+		return true;
+	}
+};
+
+
+/** IMAP test server which accepts APPEND commands, possibly with
+  * several messages (MULTIAPPEND) and non-synchronizing literals
+  * (LITERAL+), depending on the advertised capabilities.
+  */
+class APPENDIMAPTestSocket : public IMAPTestSocket
+{
+public:
+
+	APPENDIMAPTestSocket()
+		: m_literalRemaining(0), m_messagesInCommand(0)
+	{
+	}
+
+	bool processIMAPCommand(const vmime::string& tag,
+		const vmime::string& cmd, const vmime::string& line)
+	{
+		// Literal data
+		if (m_literalRemaining > 0)
+		{
+			m_literal += line + "\r\n";
+			m_literalRemaining -= static_cast <int>(line.length()) + 2;
+
+			VASSERT("Literal size", m_literalRemaining >= 0);
+
+			if (m_literalRemaining == 0)
+				appendedMessages.push_back(m_literal);
+
+			return true;
+		}
+		// End of APPEND command, or another message (MULTIAPPEND)
+		else if (!m_appendTag.empty())
+		{
+			if (line.empty())
+			{
+				std::ostringstream oss;
+				oss << m_appendTag << " OK ";
+
+				if (m_capabilities.find("UIDPLUS") != vmime::string::npos)
+				{
+					const int last = 100 + static_cast <int>(appendedMessages.size()) - 1;
+					const int first = last - m_messagesInCommand + 1;
+
+					oss << "[APPENDUID 42 " << first;
+
+					if (last != first)
+						oss << ":" << last;
+
+					oss << "] ";
+				}
+
+				oss << "APPEND completed\r\n";
+
+				localSend(oss.str());
+
+				m_messageCount += m_messagesInCommand;
+				m_appendTag.clear();
+			}
+			else
+			{
+				VASSERT("MULTIAPPEND", m_capabilities.find("MULTIAPPEND") != vmime::string::npos);
+
+				startLiteral(line);
+			}
+
+			return true;
+		}
+		else if (cmd == "APPEND")
+		{
+			VASSERT_EQ("Mailbox", 0, static_cast <int>(line.find(tag + " APPEND INBOX ")));
+
+			++appendCommandCount;
+
+			m_appendTag = tag;
+			m_messagesInCommand = 0;
+
+			startLiteral(line);
+
+			return true;
+		}
+
+		return false;
+	}
+
+	void disconnect()
+	{
+		if (m_literalRemaining > 0)
+			appendAborted = true;
+
+		IMAPTestSocket::disconnect();
+	}
+
+private:
+
+	void startLiteral(const vmime::string& line)
+	{
+		const vmime::string::size_type begin = line.rfind('{');
+		const vmime::string::size_type end = line.rfind('}');
+
+		VASSERT("Literal", begin != vmime::string::npos && end == line.length() - 1);
+
+		const bool nonSync = (line[end - 1] == '+');
+
+		std::istringstream iss(vmime::string(line.begin() + begin + 1, line.begin() + end));
+		iss >> m_literalRemaining;
+
+		m_literal.clear();
+		++m_messagesInCommand;
+
+		if (nonSync)
+			VASSERT("LITERAL+", m_capabilities.find("LITERAL+") != vmime::string::npos);
+		else
+			localSend("+ Ready for literal data\r\n");
+	}
+
+
+	vmime::string m_appendTag;
+	vmime::string m_literal;
+	int m_literalRemaining;
+	int m_messagesInCommand;
+};
+
+
+/** IMAP test server which supports MULTIAPPEND, LITERAL+ and UIDPLUS.
+  */
+class MULTIAPPENDIMAPTestSocket : public APPENDIMAPTestSocket
+{
+public:
+
+	MULTIAPPENDIMAPTestSocket()
+	{
+		m_capabilities = "IMAP4rev1 MULTIAPPEND LITERAL+ UIDPLUS";
+	}
+};
+
+
+class POOLIMAPTestSocket : public IMAPTestSocket
+{
+public:
+
+	POOLIMAPTestSocket()
+	{
+		m_capabilities = "IMAP4rev1 UNSELECT";
+	}
+
+	bool processIMAPCommand(const vmime::string& tag,
+		const vmime::string& cmd, const vmime::string& line)
+	{
+		if (cmd == "LOGIN")
+		{
+			++poolLoginCount;
+			return false;
+		}
+		else if (cmd == "SELECT" && line.find("Rejected") != vmime::string::npos)
+		{
+			localSend(tag + " NO No such mailbox\r\n");
+			return true;
+		}
+		else if (cmd == "SELECT" && line.find("Invalid") != vmime::string::npos)
+		{
+			localSend("* STATUS Invalid (MESSAGES seventeen)\r\n");
+			localSend(tag + " OK SELECT completed\r\n");
+			return true;
+		}
+		else if (cmd == "UNSELECT")
+		{
+			localSend(tag + " OK UNSELECT completed\r\n");
+			return true;
+		}
+		else if (cmd == "STATUS")
+		{
+			localSend("* STATUS INBOX (MESSAGES 3 UNSEEN 1)\r\n");
+			localSend(tag + " OK STATUS completed\r\n");
+			return true;
+		}
+
+		return false;
+	}
+};
+
+
+class METADATAIMAPTestSocket : public IMAPTestSocket
+{
+public:
+
+	METADATAIMAPTestSocket()
+	{
+		m_messageCount = 2;
+	}
+
+	bool processIMAPCommand(const vmime::string& tag,
+		const vmime::string& cmd, const vmime::string& line)
+	{
+		if (cmd != "FETCH")
+			return false;
+
+		// Message set: "n" or "n:m"
+		std::istringstream iss(line);
+		vmime::string dummy, set;
+		iss >> dummy >> dummy >> set;
+
+		int first = 0, last = 0;
+		char sep = 0;
+
+		std::istringstream setStream(set);
+		setStream >> first >> sep >> last;
+
+		if (sep != ':')
+			last = first;
+
+		for (int num = first ; num <= last ; ++num)
+		{
+			std::ostringstream oss;
+			oss << "* " << num << " FETCH (UID " << (100 + num);
+
+			if (line.find("FLAGS") != vmime::string::npos)
+				oss << (num == 1 ? " FLAGS (\\Seen)" : " FLAGS ()");
+
+			if (line.find("RFC822.SIZE") != vmime::string::npos)
+				oss << " RFC822.SIZE " << (1233 + num);
+
+			if (line.find("BODYSTRUCTURE") != vmime::string::npos)
+			{
+				oss << " BODYSTRUCTURE ((\"TEXT\" \"PLAIN\" (\"CHARSET\" \"us-ascii\") NIL NIL \"7BIT\" 12 1)"
+				    << "(\"IMAGE\" \"PNG\" NIL NIL NIL \"BASE64\" 300) \"MIXED\")";
+
+				++structureFetchCount;
+			}
+
+			if (line.find("ENVELOPE") != vmime::string::npos)
+			{
+				oss << " ENVELOPE (\"Mon, 7 Feb 1994 21:52:25 -0800\" \"Subject " << num << "\""
+				    << " ((\"Fred\" NIL \"fred\" \"example.com\"))"
+				    << " ((\"Fred\" NIL \"fred\" \"example.com\"))"
+				    << " ((\"Fred\" NIL \"fred\" \"example.com\"))"
+				    << " ((NIL NIL \"joe\" \"example.com\")) NIL NIL NIL \"<msg@example.com>\")";
+			}
+
+			oss << ")\r\n";
+
+			localSend(oss.str());
+		}
+
+		localSend(tag + " OK FETCH completed\r\n");
+
+		return true;
+	}
+};
+
+
+/** IMAP test server which supports SEARCH, with synchronizing literals.
+  *
+  * Matches messages 2, 3, 8 and 9 (UIDs 102, 103, 108 and 109)
+  * whatever the search keys.
+  */
+class SEARCHIMAPTestSocket : public IMAPTestSocket
+{
+public:
+
+	SEARCHIMAPTestSocket()
+		: m_literalRemaining(0)
+	{
+		m_messageCount = 10;
+	}
+
+	bool processIMAPCommand(const vmime::string& tag,
+		const vmime::string& cmd, const vmime::string& line)
+	{
+		// Continuation of a SEARCH command
+		if (!m_searchTag.empty())
+		{
+			return continueSearch(line);
+		}
+		else if (cmd == "SEARCH" || (cmd == "UID" && line.find(" SEARCH ") != vmime::string::npos))
+		{
+			m_searchTag = tag;
+			lastSearchCommand.clear();
+
+			return continueSearch(vmime::string(line.begin() + tag.length() + 1, line.end()));
+		}
+
+		return false;
+	}
+
+protected:
+
+	virtual void sendSearchResponse(const vmime::string& tag)
+	{
+		localSend("* SEARCH 9 2 3 8\r\n");
+		localSend(tag + " OK SEARCH completed\r\n");
+	}
+
+private:
+
+	bool continueSearch(const vmime::string& data)
+	{
+		vmime::string rest = data;
+
+		// Literal data
+		if (m_literalRemaining > 0)
+		{
+			lastSearchCommand += "\r\n";
+
+			const vmime::string::size_type n = std::min
+				(static_cast <vmime::string::size_type>(m_literalRemaining), rest.length());
+
+			lastSearchCommand += rest.substr(0, n);
+			rest.erase(0, n);
+
+			m_literalRemaining -= static_cast <int>(n);
+		}
+
+		lastSearchCommand += rest;
+
+		const vmime::string::size_type begin = rest.rfind('{');
+
+		if (!rest.empty() && rest[rest.length() - 1] == '}' && begin != vmime::string::npos)
+		{
+			const bool nonSync = (rest[rest.length() - 2] == '+');
+
+			std::istringstream iss(vmime::string(rest.begin() + begin + 1, rest.end() - 1));
+			iss >> m_literalRemaining;
+
+			if (!nonSync)
+				localSend("+ Ready for literal data\r\n");
+		}
+		else
+		{
+			const vmime::string tag = m_searchTag;
+			m_searchTag.clear();
+
+			sendSearchResponse(tag);
+		}
+
+		return true;
+	}
+
+
+	vmime::string m_searchTag;
+	int m_literalRemaining;
+};
+
+
+/** IMAP test server which supports ESEARCH.
+  */
+class ESEARCHIMAPTestSocket : public SEARCHIMAPTestSocket
+{
+public:
+
+	ESEARCHIMAPTestSocket()
+	{
+		m_capabilities = "IMAP4rev1 ESEARCH";
+	}
+
+protected:
+
+	void sendSearchResponse(const vmime::string& tag)
+	{
+		const bool uid = (lastSearchCommand.compare(0, 4, "UID ") == 0);
+
+		const vmime::string::size_type begin = lastSearchCommand.find("RETURN (");
+		const vmime::string items = lastSearchCommand.substr
+			(begin, lastSearchCommand.find(')', begin) - begin);
+
+		std::ostringstream oss;
+		oss << "* ESEARCH (TAG \"" << tag << "\")";
+
+		if (uid)
+			oss << " UID";
+
+		if (items.find("MIN") != vmime::string::npos)
+			oss << " MIN " << (uid ? 102 : 2);
+		if (items.find("MAX") != vmime::string::npos)
+			oss << " MAX " << (uid ? 109 : 9);
+		if (items.find("COUNT") != vmime::string::npos)
+			oss << " COUNT 4";
+		if (items.find("ALL") != vmime::string::npos)
+			oss << " ALL " << (uid ? "102:103,108:109" : "2:3,8:9");
+
+		oss << "\r\n";
+
+		localSend(oss.str());
+		localSend(tag + " OK SEARCH completed\r\n");
+	}
+};
+
+
+/** IMAP test server which supports the LIST-STATUS extension.
+  */
+class LISTSTATUSIMAPTestSocket : public IMAPTestSocket
+{
+public:
+
+	LISTSTATUSIMAPTestSocket()
+	{
+		m_capabilities = "IMAP4rev1 LIST-EXTENDED LIST-STATUS";
+	}
+
+	bool processIMAPCommand(const vmime::string& tag,
+		const vmime::string& cmd, const vmime::string& line)
+	{
+		if (cmd == "LIST" && line.find("\"\" *") != vmime::string::npos)
+		{
+			const bool withStatus = (line.find(" RETURN (STATUS (MESSAGES UNSEEN UIDNEXT))")
+				!= vmime::string::npos);
+
+			localSend("* LIST (\\HasNoChildren) \"/\" INBOX\r\n");
+
+			if (withStatus)
+				localSend("* STATUS INBOX (MESSAGES 17 UNSEEN 2 UIDNEXT 351)\r\n");
+
+			localSend("* LIST (\\Noselect \\HasChildren) \"/\" Archive\r\n");
+
+			// Servers may send STATUS after all LIST responses
+			localSend("* LIST (\\HasNoChildren) \"/\" \"Archive/2013\"\r\n");
+
+			if (withStatus)
+				localSend("* STATUS \"Archive/2013\" (MESSAGES 5 UNSEEN 0 UIDNEXT 6)\r\n");
+
+			localSend(tag + " OK LIST completed\r\n");
+
+			return true;
+		}
+		else if (cmd == "STATUS")
+		{
+			++statusCommandCount;
+
+			if (line.find("INBOX") != vmime::string::npos)
+				localSend("* STATUS INBOX (MESSAGES 17 UNSEEN 2 UIDNEXT 351)\r\n");
+			else if (line.find("Archive/2013") != vmime::string::npos)
+				localSend("* STATUS \"Archive/2013\" (MESSAGES 5 UNSEEN 0 UIDNEXT 6)\r\n");
+			else
+			{
+				localSend(tag + " NO Mailbox does not exist\r\n");
+				return true;
+			}
+
+			localSend(tag + " OK STATUS completed\r\n");
+
+			return true;
+		}
+
+		return false;
+	}
+};
+
+
+/** IMAP test server which does not support LIST-STATUS, and which
+  * counts the STATUS commands sent before a response is read.
+  */
+class STATUSIMAPTestSocket : public LISTSTATUSIMAPTestSocket
+{
+public:
+
+	STATUSIMAPTestSocket()
+		: m_pendingStatusCount(0)
+	{
+		m_capabilities = "IMAP4rev1";
+	}
+
+	void receive(vmime::string& buffer)
+	{
+		maxPendingStatusCount = std::max(maxPendingStatusCount, m_pendingStatusCount);
+		m_pendingStatusCount = 0;
+
+		LISTSTATUSIMAPTestSocket::receive(buffer);
+	}
+
+	bool processIMAPCommand(const vmime::string& tag,
+		const vmime::string& cmd, const vmime::string& line)
+	{
+		if (cmd == "STATUS")
+			++m_pendingStatusCount;
+
+		return LISTSTATUSIMAPTestSocket::processIMAPCommand(tag, cmd, line);
+	}
+
+private:
+
+	int m_pendingStatusCount;
+};
+
+
+/** IMAP test server which sends a malformed response to the
+  * first STATUS command.
+  */
+class BADSTATUSIMAPTestSocket : public STATUSIMAPTestSocket
+{
+public:
+
+	BADSTATUSIMAPTestSocket()
+		: m_statusCount(0)
+	{
+	}
+
+	bool processIMAPCommand(const vmime::string& tag,
+		const vmime::string& cmd, const vmime::string& line)
+	{
+		if (cmd == "STATUS" && m_statusCount++ == 0)
+		{
+			++statusCommandCount;
+
+			localSend("* STATUS INBOX (MESSAGES seventeen)\r\n");
+			localSend(tag + " OK STATUS completed\r\n");
+
+			return true;
+		}
+
+		return STATUSIMAPTestSocket::processIMAPCommand(tag, cmd, line);
+	}
+
+private:
+
+	int m_statusCount;
+};
+
+
+/** IMAP test server which supports the MOVE extension.
+  */
+class MOVEIMAPTestSocket : public IMAPTestSocket
+{
+public:
+
+	MOVEIMAPTestSocket()
+	{
+		m_capabilities = "IMAP4rev1 MOVE UIDPLUS";
+		m_messageCount = 5;
+	}
+
+	bool processIMAPCommand(const vmime::string& tag,
+		const vmime::string& cmd, const vmime::string& line)
+	{
+		const vmime::string command = (tag.empty() ? line : line.substr(tag.length() + 1));
+
+		if (cmd == "MOVE")
+		{
+			moveCommands.push_back(command);
+
+			localSend("* OK [COPYUID 42 102:103 1:2] Moved\r\n");
+			localSend("* 3 EXPUNGE\r\n");
+			localSend("* 2 EXPUNGE\r\n");
+			localSend(tag + " OK MOVE completed\r\n");
+
+			return true;
+		}
+		else if (cmd == "COPY" || cmd == "STORE")
+		{
+			moveCommands.push_back(command);
+			localSend(tag + " OK " + cmd + " completed\r\n");
+
+			return true;
+		}
+		else if (cmd == "FETCH")
+		{
+			moveCommands.push_back(command);
+
+			localSend("* 2 FETCH (UID 102)\r\n");
+			localSend("* 3 FETCH (UID 103)\r\n");
+			localSend(tag + " OK FETCH completed\r\n");
+
+			return true;
+		}
+		else if (cmd == "UID" || cmd == "EXPUNGE")
+		{
+			moveCommands.push_back(command);
+
+			// Message 5 was marked as deleted before: it is only
+			// expunged by EXPUNGE
+			if (cmd == "EXPUNGE")
+				localSend("* 5 EXPUNGE\r\n");
+
+			localSend("* 3 EXPUNGE\r\n");
+			localSend("* 2 EXPUNGE\r\n");
+			localSend(tag + " OK EXPUNGE completed\r\n");
+
+			return true;
+		}
+
+		return false;
+	}
+};
+
+
+/** IMAP test server which supports UIDPLUS, but not MOVE.
+  */
+class UIDPLUSIMAPTestSocket : public MOVEIMAPTestSocket
+{
+public:
+
+	UIDPLUSIMAPTestSocket()
+	{
+		m_capabilities = "IMAP4rev1 UIDPLUS";
+	}
+};
+
+
+/** IMAP test server which supports UIDPLUS, but does not send
+  * the UID of one of the messages to move.
+  */
+class NOUIDIMAPTestSocket : public UIDPLUSIMAPTestSocket
+{
+public:
+
+	bool processIMAPCommand(const vmime::string& tag,
+		const vmime::string& cmd, const vmime::string& line)
+	{
+		if (cmd == "FETCH")
+		{
+			moveCommands.push_back(line.substr(tag.length() + 1));
+
+			localSend("* 2 FETCH (UID 102)\r\n");
+			localSend("* 4 FETCH (UID 104)\r\n");
+			localSend(tag + " OK FETCH completed\r\n");
+
+			return true;
+		}
+
+		return UIDPLUSIMAPTestSocket::processIMAPCommand(tag, cmd, line);
+	}
+};
+
+
+/** IMAP test server which supports UIDPLUS, and which fails to
+  * mark the messages to move as deleted.
+  */
+class BADSTOREIMAPTestSocket : public UIDPLUSIMAPTestSocket
+{
+public:
+
+	bool processIMAPCommand(const vmime::string& tag,
+		const vmime::string& cmd, const vmime::string& line)
+	{
+		if (cmd == "STORE")
+		{
+			moveCommands.push_back(line.substr(tag.length() + 1));
+			localSend(tag + " NO STORE failed\r\n");
+
+			return true;
+		}
+
+		return UIDPLUSIMAPTestSocket::processIMAPCommand(tag, cmd, line);
+	}
+};
+
+
+/** IMAP test server which supports neither MOVE nor UIDPLUS.
+  */
+class COPYIMAPTestSocket : public MOVEIMAPTestSocket
+{
+public:
+
+	COPYIMAPTestSocket()
+	{
+		m_capabilities = "IMAP4rev1";
+	}
+};
+
+
+/** IMAP test server with a large folder, which records the
+  * message sets of the FETCH commands.
+  */
+class BATCHIMAPTestSocket : public IMAPTestSocket
+{
+public:
+
+	BATCHIMAPTestSocket()
+	{
+		m_messageCount = 2500;
+	}
+
+	bool processIMAPCommand(const vmime::string& tag,
+		const vmime::string& cmd, const vmime::string& line)
+	{
+		if (cmd != "FETCH")
+			return false;
+
+		std::istringstream iss(line);
+		vmime::string dummy, set;
+		iss >> dummy >> dummy >> set;
+
+		fetchSets.push_back(set);
+
+		// Set: comma-separated list of "n" or "n:m"
+		std::istringstream setStream(set);
+
+		while (setStream)
+		{
+			int first = 0, last = 0;
+			char sep = 0;
+
+			setStream >> first;
+
+			if (setStream.peek() == ':')
+				setStream >> sep >> last;
+			else
+				last = first;
+
+			setStream.ignore(1);
+
+			for (int num = first ; num >= 1 && num <= last ; ++num)
+			{
+				std::ostringstream oss;
+				oss << "* " << num << " FETCH (FLAGS (\\Seen))\r\n";
+
+				localSend(oss.str());
+			}
+		}
+
+		localSend(tag + " OK FETCH completed\r\n");
+
+		return true;
+	}
+};
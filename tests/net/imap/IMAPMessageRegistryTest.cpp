@@ -0,0 +1,248 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002-2013 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+
+#include "tests/testUtils.hpp"
+
+#include "vmime/net/imap/IMAPMessageRegistry.hpp"
+
+
+using vmime::net::imap::IMAPMessage;
+using vmime::net::imap::IMAPMessageRegistry;
+
+
+VMIME_TEST_SUITE_BEGIN(IMAPMessageRegistryTest)
+
+	VMIME_TEST_LIST_BEGIN
+		VMIME_TEST(testNumbers)
+		VMIME_TEST(testExpunge)
+		VMIME_TEST(testAddAfterExpunge)
+		VMIME_TEST(testFind)
+		VMIME_TEST(testRemove)
+		VMIME_TEST(testInvalidNumber)
+		VMIME_TEST(testManyMessages)
+	VMIME_TEST_LIST_END
+
+
+	// Return a distinct pointer for each number; the registry never
+	// dereferences message pointers
+	static IMAPMessage* msg(const int i)
+	{
+		static std::vector <int> storage(1000001);
+		return reinterpret_cast <IMAPMessage*>(&storage[i]);
+	}
+
+
+	void testNumbers()
+	{
+		IMAPMessageRegistry reg;
+
+		const IMAPMessageRegistry::slot s3 = reg.add(msg(3), 3);
+		const IMAPMessageRegistry::slot s1 = reg.add(msg(1), 1);
+		const IMAPMessageRegistry::slot s5 = reg.add(msg(5), 5);
+
+		VASSERT_EQ("Size", 3u, static_cast <unsigned int>(reg.size()));
+
+		VASSERT_EQ("1", 1, reg.getNumber(s1));
+		VASSERT_EQ("3", 3, reg.getNumber(s3));
+		VASSERT_EQ("5", 5, reg.getNumber(s5));
+
+		// Two objects for the same message
+		const IMAPMessageRegistry::slot s3b = reg.add(msg(6), 3);
+
+		VASSERT_EQ("Same slot", s3, s3b);
+	}
+
+	void testExpunge()
+	{
+		IMAPMessageRegistry reg;
+
+		std::vector <IMAPMessageRegistry::slot> slots;
+
+		for (int i = 1 ; i <= 5 ; ++i)
+			slots.push_back(reg.add(msg(i), i));
+
+		reg.expunge(3);
+
+		VASSERT_EQ("1.1", 1, reg.getNumber(slots[0]));
+		VASSERT_EQ("1.2", 2, reg.getNumber(slots[1]));
+		VASSERT_EQ("1.3", 3, reg.getNumber(slots[2]));
+		VASSERT_EQ("1.4", 3, reg.getNumber(slots[3]));
+		VASSERT_EQ("1.5", 4, reg.getNumber(slots[4]));
+
+		VASSERT_FALSE("2.1", reg.isExpunged(slots[1]));
+		VASSERT_TRUE("2.2", reg.isExpunged(slots[2]));
+		VASSERT_FALSE("2.3", reg.isExpunged(slots[3]));
+
+		// "* 1 EXPUNGE" then "* 3 EXPUNGE" (ie. message 4 before)
+		reg.expunge(1);
+		reg.expunge(3);
+
+		VASSERT_TRUE("3.1", reg.isExpunged(slots[0]));
+		VASSERT_EQ("3.2", 1, reg.getNumber(slots[1]));
+		VASSERT_EQ("3.3", 2, reg.getNumber(slots[3]));
+		VASSERT_TRUE("3.4", reg.isExpunged(slots[4]));
+
+		// Unknown message: ignored
+		reg.expunge(10);
+
+		VASSERT_EQ("4", 2, reg.getNumber(slots[3]));
+	}
+
+	void testAddAfterExpunge()
+	{
+		IMAPMessageRegistry reg;
+
+		const IMAPMessageRegistry::slot s2 = reg.add(msg(2), 2);
+
+		reg.expunge(1);
+
+		VASSERT_EQ("1", 1, reg.getNumber(s2));
+
+		// New messages are numbered after the expunge
+		const IMAPMessageRegistry::slot s4 = reg.add(msg(4), 4);
+		const IMAPMessageRegistry::slot s1 = reg.add(msg(1), 1);
+
+		VASSERT_EQ("2.1", 4, reg.getNumber(s4));
+		VASSERT_EQ("2.2", s2, s1);
+
+		reg.expunge(2);
+
+		VASSERT_EQ("3.1", 1, reg.getNumber(s2));
+		VASSERT_EQ("3.2", 3, reg.getNumber(s4));
+	}
+
+	void testFind()
+	{
+		IMAPMessageRegistry reg;
+
+		for (int i = 1 ; i <= 6 ; ++i)
+			reg.add(msg(i), i);
+
+		reg.expunge(2);
+
+		std::vector <IMAPMessage*> msgs;
+		reg.find(2, 3, msgs);
+
+		VASSERT_EQ("1.1", 2, static_cast <int>(msgs.size()));
+		VASSERT_EQ("1.2", msg(3), msgs[0]);
+		VASSERT_EQ("1.3", msg(4), msgs[1]);
+
+		msgs.clear();
+		reg.find(4, -1, msgs);
+
+		VASSERT_EQ("2.1", 2, static_cast <int>(msgs.size()));
+		VASSERT_EQ("2.2", msg(5), msgs[0]);
+		VASSERT_EQ("2.3", msg(6), msgs[1]);
+
+		msgs.clear();
+		reg.find(6, 10, msgs);
+
+		VASSERT_EQ("3", 0, static_cast <int>(msgs.size()));
+
+		// Expunged messages are only returned by getAll()
+		msgs.clear();
+		reg.getAll(msgs);
+
+		VASSERT_EQ("4", 6, static_cast <int>(msgs.size()));
+	}
+
+	void testRemove()
+	{
+		IMAPMessageRegistry reg;
+
+		const IMAPMessageRegistry::slot s1 = reg.add(msg(1), 1);
+		const IMAPMessageRegistry::slot s3 = reg.add(msg(3), 3);
+		const IMAPMessageRegistry::slot s3b = reg.add(msg(4), 3);
+
+		reg.remove(msg(4), s3b);
+
+		std::vector <IMAPMessage*> msgs;
+		reg.find(3, 3, msgs);
+
+		VASSERT_EQ("1.1", 1, static_cast <int>(msgs.size()));
+		VASSERT_EQ("1.2", msg(3), msgs[0]);
+
+		reg.expunge(1);
+
+		reg.remove(msg(1), s1);
+		reg.remove(msg(3), s3);
+
+		VASSERT_EQ("2", 0u, static_cast <unsigned int>(reg.size()));
+
+		// Numbering starts again when there is no message left
+		const IMAPMessageRegistry::slot s = reg.add(msg(1), 3);
+
+		VASSERT_EQ("3.1", 3u, s);
+		VASSERT_EQ("3.2", 3, reg.getNumber(s));
+	}
+
+	void testInvalidNumber()
+	{
+		IMAPMessageRegistry reg;
+
+		const IMAPMessageRegistry::slot s = reg.add(msg(1), 0);
+
+		VASSERT_EQ("Slot", 0u, s);
+		VASSERT_EQ("Size", 1u, static_cast <unsigned int>(reg.size()));
+		VASSERT_FALSE("Expunged", reg.isExpunged(s));
+
+		reg.remove(msg(1), s);
+
+		VASSERT_EQ("Removed", 0u, static_cast <unsigned int>(reg.size()));
+	}
+
+	void testManyMessages()
+	{
+		// One million handles, half of them expunged one by one from
+		// the top of the folder (each expunge renumbers all the others)
+		const int count = 1000000;
+
+		IMAPMessageRegistry reg;
+
+		std::vector <IMAPMessageRegistry::slot> slots;
+		slots.reserve(count);
+
+		for (int i = 1 ; i <= count ; ++i)
+			slots.push_back(reg.add(msg(i), i));
+
+		for (int i = 0 ; i < count / 2 ; ++i)
+			reg.expunge(1);
+
+		VASSERT_TRUE("1", reg.isExpunged(slots[count / 2 - 1]));
+		VASSERT_EQ("2", 1, reg.getNumber(slots[count / 2]));
+		VASSERT_EQ("3", count / 2, reg.getNumber(slots[count - 1]));
+
+		std::vector <IMAPMessage*> msgs;
+		reg.find(1000, 1999, msgs);
+
+		VASSERT_EQ("4.1", 1000, static_cast <int>(msgs.size()));
+		VASSERT_EQ("4.2", msg(count / 2 + 1000), msgs[0]);
+
+		for (int i = 1 ; i <= count ; ++i)
+			reg.remove(msg(i), slots[i - 1]);
+
+		VASSERT_EQ("5", 0u, static_cast <unsigned int>(reg.size()));
+	}
+
+VMIME_TEST_SUITE_END
@@ -0,0 +1,488 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002-2013 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+
+#include "tests/testUtils.hpp"
+#include "tests/net/imap/IMAPTestUtils.hpp"
+
+#include "vmime/net/imap/IMAPMessagePartContentHandler.hpp"
+
+
+class partialFetchIMAPTestSocket;
+class partContentIMAPTestSocket;
+class binaryPartContentIMAPTestSocket;
+class unknownCTEIMAPTestSocket;
+
+
+// Data and commands received by the test server
+static const vmime::string partialFetchMessage =
+	"Subject: test\r\n\r\nThis is a test message.\r\n";
+
+static std::vector <vmime::string> partialFetchCommands;
+
+// Number of part contents sent by the content cache test server
+static int partContentFetchCount = 0;
+
+// Number of BINARY fetches received by the BINARY test servers
+static int binaryFetchCount = 0;
+
+
+VMIME_TEST_SUITE_BEGIN(IMAPMessageTest)
+
+	VMIME_TEST_LIST_BEGIN
+		VMIME_TEST(testExtractChunked)
+		VMIME_TEST(testExtractChunkedResume)
+		VMIME_TEST(testExtractChunkedPrefetch)
+		VMIME_TEST(testPartContentCache)
+		VMIME_TEST(testPartContentNoCache)
+		VMIME_TEST(testPartContentBinary)
+		VMIME_TEST(testPartContentBinaryUnknownCTE)
+	VMIME_TEST_LIST_END
+
+
+	void testExtractChunked()
+	{
+		partialFetchCommands.clear();
+
+		vmime::ref <vmime::net::store> store =
+			createIMAPTestStore <partialFetchIMAPTestSocket>();
+
+		store->connect();
+
+		vmime::ref <vmime::net::folder> folder =
+			store->getFolder(vmime::net::folder::path("INBOX"));
+
+		folder->open(vmime::net::folder::MODE_READ_ONLY);
+
+		vmime::ref <vmime::net::imap::IMAPMessage> msg =
+			folder->getMessage(1).dynamicCast <vmime::net::imap::IMAPMessage>();
+
+		std::ostringstream oss;
+		vmime::utility::outputStreamAdapter os(oss);
+
+		const int size = msg->extractChunked(NULL, os, NULL, 0, 16, false, true);
+
+		VASSERT_EQ("Size", static_cast <int>(partialFetchMessage.length()), size);
+		VASSERT_EQ("Data", partialFetchMessage, oss.str());
+
+		VASSERT_EQ("Commands", 3, static_cast <int>(partialFetchCommands.size()));
+		VASSERT_EQ("Command 1", std::string("FETCH 1 BODY.PEEK[]<0.16>"), partialFetchCommands[0]);
+		VASSERT_EQ("Command 2", std::string("FETCH 1 BODY.PEEK[]<16.16>"), partialFetchCommands[1]);
+		VASSERT_EQ("Command 3", std::string("FETCH 1 BODY.PEEK[]<32.16>"), partialFetchCommands[2]);
+
+		folder->close(false);
+		store->disconnect();
+	}
+
+	void testExtractChunkedResume()
+	{
+		partialFetchCommands.clear();
+
+		vmime::ref <vmime::net::store> store =
+			createIMAPTestStore <partialFetchIMAPTestSocket>();
+
+		store->connect();
+
+		vmime::ref <vmime::net::folder> folder =
+			store->getFolder(vmime::net::folder::path("INBOX"));
+
+		folder->open(vmime::net::folder::MODE_READ_ONLY);
+
+		vmime::ref <vmime::net::imap::IMAPMessage> msg =
+			folder->getMessage(1).dynamicCast <vmime::net::imap::IMAPMessage>();
+
+		std::ostringstream oss;
+		vmime::utility::outputStreamAdapter os(oss);
+
+		const int size = msg->extractChunked(NULL, os, NULL, 20, 64);
+
+		VASSERT_EQ("Size", static_cast <int>(partialFetchMessage.length()), size);
+		VASSERT_EQ("Data", partialFetchMessage.substr(20), oss.str());
+
+		VASSERT_EQ("Commands", 1, static_cast <int>(partialFetchCommands.size()));
+		VASSERT_EQ("Command", std::string("FETCH 1 BODY[]<20.64>"), partialFetchCommands[0]);
+
+		folder->close(false);
+		store->disconnect();
+	}
+
+	void testExtractChunkedPrefetch()
+	{
+		partialFetchCommands.clear();
+
+		vmime::ref <vmime::net::store> store =
+			createIMAPTestStore <partialFetchIMAPTestSocket>();
+
+		store->connect();
+
+		vmime::ref <vmime::net::folder> folder =
+			store->getFolder(vmime::net::folder::path("INBOX"));
+
+		folder->open(vmime::net::folder::MODE_READ_ONLY);
+
+		vmime::ref <vmime::net::imap::IMAPMessage> msg =
+			folder->getMessage(1).dynamicCast <vmime::net::imap::IMAPMessage>();
+
+		std::ostringstream oss;
+		vmime::utility::outputStreamAdapter os(oss);
+
+		const int size = msg->extractChunked(NULL, os, NULL, 0, 20, true, true);
+
+		VASSERT_EQ("Size", static_cast <int>(partialFetchMessage.length()), size);
+		VASSERT_EQ("Data", partialFetchMessage, oss.str());
+
+		// The chunk following the last one has been requested in advance
+		VASSERT_EQ("Commands", 4, static_cast <int>(partialFetchCommands.size()));
+		VASSERT_EQ("Command 4", std::string("FETCH 1 BODY.PEEK[]<60.20>"), partialFetchCommands[3]);
+
+		// The connection is still usable
+		VASSERT_EQ("Count", 1, folder->getMessageCount());
+		VASSERT_NO_THROW("Status", folder->getMessageNumbersStartingOnUID("1"));
+
+		folder->close(false);
+		store->disconnect();
+	}
+
+	void testPartContentCache()
+	{
+		partContentFetchCount = 0;
+
+		vmime::ref <vmime::net::store> store =
+			createIMAPTestStore <partContentIMAPTestSocket>();
+
+		store->getSession()->getProperties()["store.imap.cache.content.size"] = 1000;
+		store->connect();
+
+		vmime::ref <vmime::net::folder> folder =
+			store->getFolder(vmime::net::folder::path("INBOX"));
+
+		folder->open(vmime::net::folder::MODE_READ_ONLY);
+
+		// The content handler does not hold references to the message
+		vmime::ref <vmime::net::imap::IMAPMessage> msg;
+		vmime::ref <vmime::contentHandler> cth = getPartContentHandler(folder, msg);
+
+		VASSERT_EQ("Extract", "hello", extract(cth, false));
+		VASSERT_EQ("Extract raw", "aGVsbG8=", extract(cth, true));
+		VASSERT_EQ("Extract again", "hello", extract(cth, false));
+
+		std::ostringstream oss;
+		vmime::utility::outputStreamAdapter os(oss);
+
+		cth->generate(os, vmime::encoding("base64"));
+
+		VASSERT_EQ("Generate", "aGVsbG8=", oss.str());
+
+		// Contents have been downloaded only once
+		VASSERT_EQ("Fetch count", 1, partContentFetchCount);
+
+		folder->close(false);
+		store->disconnect();
+	}
+
+	void testPartContentNoCache()
+	{
+		partContentFetchCount = 0;
+
+		vmime::ref <vmime::net::store> store =
+			createIMAPTestStore <partContentIMAPTestSocket>();
+
+		store->connect();
+
+		vmime::ref <vmime::net::folder> folder =
+			store->getFolder(vmime::net::folder::path("INBOX"));
+
+		folder->open(vmime::net::folder::MODE_READ_ONLY);
+
+		// The content handler does not hold references to the message
+		vmime::ref <vmime::net::imap::IMAPMessage> msg;
+		vmime::ref <vmime::contentHandler> cth = getPartContentHandler(folder, msg);
+
+		VASSERT_EQ("Extract", "hello", extract(cth, false));
+		VASSERT_EQ("Extract again", "hello", extract(cth, false));
+
+		VASSERT_EQ("Fetch count", 2, partContentFetchCount);
+
+		folder->close(false);
+		store->disconnect();
+	}
+
+	void testPartContentBinary()
+	{
+		partContentFetchCount = 0;
+		binaryFetchCount = 0;
+
+		vmime::ref <vmime::net::store> store =
+			createIMAPTestStore <binaryPartContentIMAPTestSocket>();
+
+		store->connect();
+
+		vmime::ref <vmime::net::folder> folder =
+			store->getFolder(vmime::net::folder::path("INBOX"));
+
+		folder->open(vmime::net::folder::MODE_READ_ONLY);
+
+		vmime::ref <vmime::net::imap::IMAPMessage> msg;
+		vmime::ref <vmime::contentHandler> cth = getPartContentHandler(folder, msg);
+
+		// Decoded by the server
+		VASSERT_EQ("Extract", "hello", extract(cth, false));
+		VASSERT_EQ("Binary fetch", 1, binaryFetchCount);
+		VASSERT_EQ("Body fetch", 0, partContentFetchCount);
+
+		VASSERT_EQ("Extract raw", "aGVsbG8=", extract(cth, true));
+		VASSERT_EQ("Body fetch 2", 1, partContentFetchCount);
+
+		// Re-encoding uses the decoded contents
+		std::ostringstream oss;
+		vmime::utility::outputStreamAdapter os(oss);
+
+		cth->generate(os, vmime::encoding("quoted-printable"));
+
+		VASSERT_EQ("Generate", "hello", oss.str());
+		VASSERT_EQ("Binary fetch 2", 2, binaryFetchCount);
+		VASSERT_EQ("Body fetch 3", 1, partContentFetchCount);
+
+		VASSERT_EQ("Decoded size", 5, msg->getDecodedPartSize
+			(msg->getStructure()->getPartAt(0)->getStructure()->getPartAt(1)));
+
+		folder->close(false);
+		store->disconnect();
+	}
+
+	void testPartContentBinaryUnknownCTE()
+	{
+		partContentFetchCount = 0;
+		binaryFetchCount = 0;
+
+		vmime::ref <vmime::net::store> store =
+			createIMAPTestStore <unknownCTEIMAPTestSocket>();
+
+		store->connect();
+
+		vmime::ref <vmime::net::folder> folder =
+			store->getFolder(vmime::net::folder::path("INBOX"));
+
+		folder->open(vmime::net::folder::MODE_READ_ONLY);
+
+		vmime::ref <vmime::net::imap::IMAPMessage> msg;
+		vmime::ref <vmime::contentHandler> cth = getPartContentHandler(folder, msg);
+
+		// The server cannot decode the part: decoded by the client
+		VASSERT_EQ("Extract", "hello", extract(cth, false));
+		VASSERT_EQ("Binary fetch", 1, binaryFetchCount);
+		VASSERT_EQ("Body fetch", 1, partContentFetchCount);
+
+		VASSERT_EQ("Decoded size", -1, msg->getDecodedPartSize
+			(msg->getStructure()->getPartAt(0)->getStructure()->getPartAt(1)));
+
+		folder->close(false);
+		store->disconnect();
+	}
+
+	static vmime::ref <vmime::contentHandler> getPartContentHandler
+		(vmime::ref <vmime::net::folder> folder, vmime::ref <vmime::net::imap::IMAPMessage>& msg)
+	{
+		msg = folder->getMessage(1).dynamicCast <vmime::net::imap::IMAPMessage>();
+
+		folder->fetchMessage(msg, vmime::net::folder::FETCH_STRUCTURE | vmime::net::folder::FETCH_UID);
+
+		// Second part of "multipart/mixed"
+		vmime::ref <vmime::net::part> part =
+			msg->getStructure()->getPartAt(0)->getStructure()->getPartAt(1);
+
+		return vmime::create <vmime::net::imap::IMAPMessagePartContentHandler>
+			(msg, part, vmime::encoding("base64"));
+	}
+
+	static const vmime::string extract(vmime::ref <vmime::contentHandler> cth, const bool raw)
+	{
+		std::ostringstream oss;
+		vmime::utility::outputStreamAdapter os(oss);
+
+		if (raw)
+			cth->extractRaw(os);
+		else
+			cth->extract(os);
+
+		return oss.str();
+	}
+
+VMIME_TEST_SUITE_END
+
+
+/** IMAP test server which supports partial fetch of a message.
+  */
+class partialFetchIMAPTestSocket : public IMAPTestSocket
+{
+public:
+
+	partialFetchIMAPTestSocket()
+	{
+		m_messageCount = 1;
+	}
+
+	bool processIMAPCommand(const vmime::string& tag,
+		const vmime::string& cmd, const vmime::string& line)
+	{
+		if (cmd == "FETCH")
+		{
+			partialFetchCommands.push_back(line.substr(tag.length() + 1));
+
+			// Eg. "FETCH 1 BODY.PEEK[]<16.16>"
+			const vmime::string::size_type begin = line.find('<');
+			const vmime::string::size_type dot = line.find('.', begin);
+
+			int offset = 0, length = 0;
+
+			std::istringstream(line.substr(begin + 1, dot - begin - 1)) >> offset;
+			std::istringstream(line.substr(dot + 1)) >> length;
+
+			vmime::string data;
+
+			if (offset < static_cast <int>(partialFetchMessage.length()))
+				data = partialFetchMessage.substr(offset, length);
+
+			std::ostringstream oss;
+			oss << "* 1 FETCH (BODY[]<" << offset << "> {" << data.length() << "}\r\n"
+			    << data << ")\r\n";
+			oss << tag << " OK FETCH completed\r\n";
+
+			localSend(oss.str());
+
+			return true;
+		}
+		else if (cmd == "SEARCH")
+		{
+			localSend("* SEARCH 1\r\n");
+			localSend(tag + " OK SEARCH completed\r\n");
+
+			return true;
+		}
+
+		return false;
+	}
+};
+
+
+class partContentIMAPTestSocket : public IMAPTestSocket
+{
+public:
+
+	partContentIMAPTestSocket()
+	{
+		m_messageCount = 1;
+	}
+
+	bool processIMAPCommand(const vmime::string& tag,
+		const vmime::string& cmd, const vmime::string& line)
+	{
+		if (cmd == "FETCH" && line.find("BODYSTRUCTURE") != vmime::string::npos)
+		{
+			localSend("* 1 FETCH (UID 7 BODYSTRUCTURE ((\"TEXT\" \"PLAIN\" (\"CHARSET\" \"us-ascii\")"
+				" NIL NIL \"7BIT\" 12 1)(\"IMAGE\" \"PNG\" NIL NIL NIL \"BASE64\" 8) \"MIXED\"))\r\n");
+			localSend(tag + " OK FETCH completed\r\n");
+
+			return true;
+		}
+		else if (cmd == "UID" && line.find("FETCH 7 BODY[2]") != vmime::string::npos)
+		{
+			++partContentFetchCount;
+
+			localSend("* 1 FETCH (UID 7 BODY[2] {8}\r\naGVsbG8=)\r\n");
+			localSend(tag + " OK FETCH completed\r\n");
+
+			return true;
+		}
+
+		return false;
+	}
+};
+
+
+/** IMAP test server which supports BINARY (RFC 3516).
+  */
+class binaryPartContentIMAPTestSocket : public partContentIMAPTestSocket
+{
+public:
+
+	binaryPartContentIMAPTestSocket(const bool canDecode = true)
+		: m_canDecode(canDecode)
+	{
+		m_capabilities = "IMAP4rev1 BINARY";
+	}
+
+	bool processIMAPCommand(const vmime::string& tag,
+		const vmime::string& cmd, const vmime::string& line)
+	{
+		if (cmd == "UID" && line.find("FETCH 7 BINARY[2]") != vmime::string::npos)
+		{
+			++binaryFetchCount;
+
+			if (m_canDecode)
+			{
+				localSend("* 1 FETCH (UID 7 BINARY[2] ~{5}\r\nhello)\r\n");
+				localSend(tag + " OK FETCH completed\r\n");
+			}
+			else
+			{
+				localSend(tag + " NO [UNKNOWN-CTE] Cannot decode part\r\n");
+			}
+
+			return true;
+		}
+		else if (cmd == "UID" && line.find("FETCH 7 BINARY.SIZE[2]") != vmime::string::npos)
+		{
+			if (m_canDecode)
+			{
+				localSend("* 1 FETCH (UID 7 BINARY.SIZE[2] 5)\r\n");
+				localSend(tag + " OK FETCH completed\r\n");
+			}
+			else
+			{
+				localSend(tag + " NO [UNKNOWN-CTE] Cannot decode part\r\n");
+			}
+
+			return true;
+		}
+
+		return partContentIMAPTestSocket::processIMAPCommand(tag, cmd, line);
+	}
+
+private:
+
+	const bool m_canDecode;
+};
+
+
+/** IMAP test server which supports BINARY, but cannot decode parts.
+  */
+class unknownCTEIMAPTestSocket : public binaryPartContentIMAPTestSocket
+{
+public:
+
+	unknownCTEIMAPTestSocket()
+		: binaryPartContentIMAPTestSocket(false)
+	{
+	}
+};
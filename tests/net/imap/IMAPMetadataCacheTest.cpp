@@ -0,0 +1,330 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002-2013 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+
+#include "tests/testUtils.hpp"
+
+#include "vmime/platform.hpp"
+
+#include "vmime/net/imap/IMAPMetadataCache.hpp"
+#include "vmime/net/imap/IMAPStructure.hpp"
+
+#include <ctime>
+
+
+typedef vmime::utility::file::path fspath;
+typedef vmime::utility::file::path::component fspathc;
+
+
+VMIME_TEST_SUITE_BEGIN(IMAPMetadataCacheTest)
+
+	VMIME_TEST_LIST_BEGIN
+		VMIME_TEST(testGetEntry)
+		VMIME_TEST(testPersistence)
+		VMIME_TEST(testUIDValidityChanged)
+		VMIME_TEST(testMergeEntries)
+		VMIME_TEST(testCompaction)
+		VMIME_TEST(testCovers)
+		VMIME_TEST(testStructure)
+		VMIME_TEST(testInvalidStructure)
+	VMIME_TEST_LIST_END
+
+
+public:
+
+	IMAPMetadataCacheTest()
+	{
+		// Temporary directory
+		m_tempPath = fspath() / fspathc("tmp")   // Use /tmp
+			/ fspathc("vmime" + vmime::utility::stringUtils::toString(std::time(NULL))
+				+ vmime::utility::stringUtils::toString(std::rand()));
+	}
+
+	void tearDown()
+	{
+		vmime::ref <vmime::utility::fileSystemFactory> fsf =
+			vmime::platform::getHandler()->getFileSystemFactory();
+
+		recursiveDelete(fsf->create(m_tempPath));
+	}
+
+
+	void testGetEntry()
+	{
+		vmime::ref <vmime::net::imap::IMAPMetadataCache> cache =
+			vmime::create <vmime::net::imap::IMAPMetadataCache>(m_tempPath);
+
+		vmime::net::imap::IMAPMetadataCache::entry e;
+
+		VASSERT_FALSE("Empty", cache->getEntry("INBOX", 42, 1, e));
+
+		cache->putEntry("INBOX", 42, 1, makeEntry(vmime::net::folder::FETCH_SIZE, 1234));
+
+		VASSERT_TRUE("Found", cache->getEntry("INBOX", 42, 1, e));
+		VASSERT_EQ("Size", 1234, e.size);
+		VASSERT_EQ("Options", vmime::net::folder::FETCH_SIZE, e.options);
+
+		VASSERT_FALSE("Other UID", cache->getEntry("INBOX", 42, 2, e));
+		VASSERT_FALSE("Other mailbox", cache->getEntry("Sent", 42, 1, e));
+	}
+
+	void testPersistence()
+	{
+		{
+			vmime::ref <vmime::net::imap::IMAPMetadataCache> cache =
+				vmime::create <vmime::net::imap::IMAPMetadataCache>(m_tempPath);
+
+			vmime::net::imap::IMAPMetadataCache::entry e =
+				makeEntry(vmime::net::folder::FETCH_SIZE | vmime::net::folder::FETCH_ENVELOPE, 100);
+
+			e.header = "Subject: test\r\n";
+
+			cache->putEntry("INBOX/Sub folder", 42, 7, e);
+			cache->putEntry("INBOX/Sub folder", 42, 8, makeEntry(vmime::net::folder::FETCH_SIZE, 200));
+			cache->flush();
+		}
+
+		vmime::ref <vmime::net::imap::IMAPMetadataCache> cache =
+			vmime::create <vmime::net::imap::IMAPMetadataCache>(m_tempPath);
+
+		vmime::net::imap::IMAPMetadataCache::entry e;
+
+		VASSERT_TRUE("Found 1", cache->getEntry("INBOX/Sub folder", 42, 7, e));
+		VASSERT_EQ("Size 1", 100, e.size);
+		VASSERT_EQ("Header 1", "Subject: test\r\n", e.header);
+
+		VASSERT_TRUE("Found 2", cache->getEntry("INBOX/Sub folder", 42, 8, e));
+		VASSERT_EQ("Size 2", 200, e.size);
+	}
+
+	void testUIDValidityChanged()
+	{
+		{
+			vmime::ref <vmime::net::imap::IMAPMetadataCache> cache =
+				vmime::create <vmime::net::imap::IMAPMetadataCache>(m_tempPath);
+
+			cache->putEntry("INBOX", 42, 1, makeEntry(vmime::net::folder::FETCH_SIZE, 100));
+			cache->flush();
+		}
+
+		vmime::ref <vmime::net::imap::IMAPMetadataCache> cache =
+			vmime::create <vmime::net::imap::IMAPMetadataCache>(m_tempPath);
+
+		vmime::net::imap::IMAPMetadataCache::entry e;
+
+		VASSERT_FALSE("New UIDVALIDITY", cache->getEntry("INBOX", 43, 1, e));
+
+		// Entries must have been removed from disk as well
+		VASSERT_FALSE("Old UIDVALIDITY", cache->getEntry("INBOX", 42, 1, e));
+
+		vmime::ref <vmime::net::imap::IMAPMetadataCache> cache2 =
+			vmime::create <vmime::net::imap::IMAPMetadataCache>(m_tempPath);
+
+		VASSERT_FALSE("Old UIDVALIDITY (reload)", cache2->getEntry("INBOX", 42, 1, e));
+	}
+
+	void testMergeEntries()
+	{
+		vmime::ref <vmime::net::imap::IMAPMetadataCache> cache =
+			vmime::create <vmime::net::imap::IMAPMetadataCache>(m_tempPath);
+
+		vmime::net::imap::IMAPMetadataCache::entry e1 =
+			makeEntry(vmime::net::folder::FETCH_SIZE | vmime::net::folder::FETCH_STRUCTURE, 100);
+
+		e1.structure = "structure";
+
+		vmime::net::imap::IMAPMetadataCache::entry e2 =
+			makeEntry(vmime::net::folder::FETCH_ENVELOPE, 0);
+
+		e2.header = "Subject: test\r\n";
+
+		cache->putEntry("INBOX", 42, 1, e1);
+		cache->putEntry("INBOX", 42, 1, e2);
+
+		vmime::net::imap::IMAPMetadataCache::entry e;
+
+		VASSERT_TRUE("Found", cache->getEntry("INBOX", 42, 1, e));
+		VASSERT_EQ("Options", vmime::net::folder::FETCH_SIZE |
+			vmime::net::folder::FETCH_STRUCTURE | vmime::net::folder::FETCH_ENVELOPE, e.options);
+		VASSERT_EQ("Size", 100, e.size);
+		VASSERT_EQ("Structure", "structure", e.structure);
+		VASSERT_EQ("Header", "Subject: test\r\n", e.header);
+	}
+
+	void testCompaction()
+	{
+		{
+			vmime::ref <vmime::net::imap::IMAPMetadataCache> cache =
+				vmime::create <vmime::net::imap::IMAPMetadataCache>(m_tempPath);
+
+			for (int i = 1 ; i <= 40 ; ++i)
+			{
+				cache->putEntry("INBOX", 42, i, makeEntry(vmime::net::folder::FETCH_SIZE, i * 10));
+				cache->flush();
+			}
+		}
+
+		// Check the number of segment files
+		vmime::ref <vmime::utility::fileSystemFactory> fsf =
+			vmime::platform::getHandler()->getFileSystemFactory();
+
+		vmime::ref <vmime::utility::fileIterator> dirs = fsf->create(m_tempPath)->getFiles();
+
+		VASSERT_TRUE("Mailbox dir", dirs->hasMoreElements());
+
+		vmime::ref <vmime::utility::fileIterator> files = dirs->nextElement()->getFiles();
+		int count = 0;
+
+		while (files->hasMoreElements())
+		{
+			files->nextElement();
+			++count;
+		}
+
+		VASSERT_TRUE("Segments", count <= 16);
+
+		vmime::ref <vmime::net::imap::IMAPMetadataCache> cache =
+			vmime::create <vmime::net::imap::IMAPMetadataCache>(m_tempPath);
+
+		for (int i = 1 ; i <= 40 ; ++i)
+		{
+			vmime::net::imap::IMAPMetadataCache::entry e;
+
+			VASSERT_TRUE("Found", cache->getEntry("INBOX", 42, i, e));
+			VASSERT_EQ("Size", i * 10, e.size);
+		}
+	}
+
+	void testCovers()
+	{
+		typedef vmime::net::folder folder;
+		typedef vmime::net::imap::IMAPMetadataCache cache;
+
+		const cache::entry e1 = makeEntry(folder::FETCH_SIZE | folder::FETCH_ENVELOPE, 0);
+
+		VASSERT_TRUE("1", cache::covers(e1, folder::FETCH_SIZE | folder::FETCH_FLAGS | folder::FETCH_UID));
+		VASSERT_TRUE("2", cache::covers(e1, folder::FETCH_ENVELOPE));
+		VASSERT_FALSE("3", cache::covers(e1, folder::FETCH_STRUCTURE));
+		VASSERT_FALSE("4", cache::covers(e1, folder::FETCH_FULL_HEADER));
+
+		const cache::entry e2 = makeEntry(folder::FETCH_FULL_HEADER, 0);
+
+		VASSERT_TRUE("5", cache::covers(e2, folder::FETCH_ENVELOPE | folder::FETCH_CONTENT_INFO));
+		VASSERT_FALSE("6", cache::covers(e2, folder::FETCH_SIZE));
+	}
+
+	void testStructure()
+	{
+		// multipart/mixed (text/plain, image/png)
+		vmime::string data;
+		appendInt(data, 1);
+		appendString(data, "multipart/mixed");
+		appendInt(data, 0);
+		appendInt(data, 2);
+		appendString(data, "text/plain");
+		appendInt(data, 12);
+		appendInt(data, 0);
+		appendString(data, "image/png");
+		appendInt(data, 300);
+		appendInt(data, 0);
+
+		vmime::ref <vmime::net::imap::IMAPStructure> str =
+			vmime::net::imap::IMAPMetadataCache::deserializeStructure(data);
+
+		VASSERT_NOT_NULL("Structure", str);
+		VASSERT_EQ("Count", 1, static_cast <int>(str->getPartCount()));
+
+		vmime::ref <vmime::net::part> root = str->getPartAt(0);
+
+		VASSERT_EQ("Root type", "multipart/mixed", root->getType().generate());
+		VASSERT_EQ("Root parts", 2, static_cast <int>(root->getStructure()->getPartCount()));
+
+		vmime::ref <vmime::net::part> part2 = root->getStructure()->getPartAt(1);
+
+		VASSERT_EQ("Part 2 type", "image/png", part2->getType().generate());
+		VASSERT_EQ("Part 2 size", 300, part2->getSize());
+		VASSERT_EQ("Part 2 number", 1, part2->getNumber());
+		VASSERT_EQ("Part 2 parts", 0, static_cast <int>(part2->getStructure()->getPartCount()));
+
+		VASSERT_EQ("Serialize", data, vmime::net::imap::IMAPMetadataCache::serializeStructure(str));
+	}
+
+	void testInvalidStructure()
+	{
+		vmime::string data;
+		appendInt(data, 3);
+		appendString(data, "text/plain");
+
+		VASSERT_NULL("Truncated", vmime::net::imap::IMAPMetadataCache::deserializeStructure(data));
+		VASSERT_NULL("Empty", vmime::net::imap::IMAPMetadataCache::deserializeStructure(""));
+	}
+
+private:
+
+	fspath m_tempPath;
+
+
+	static vmime::net::imap::IMAPMetadataCache::entry makeEntry(const int options, const int size)
+	{
+		vmime::net::imap::IMAPMetadataCache::entry e;
+		e.options = options;
+		e.size = size;
+
+		return e;
+	}
+
+	static void appendInt(vmime::string& data, const unsigned int n)
+	{
+		data += static_cast <char>((n >> 24) & 0xff);
+		data += static_cast <char>((n >> 16) & 0xff);
+		data += static_cast <char>((n >>  8) & 0xff);
+		data += static_cast <char>( n        & 0xff);
+	}
+
+	static void appendString(vmime::string& data, const vmime::string& str)
+	{
+		appendInt(data, static_cast <unsigned int>(str.length()));
+		data += str;
+	}
+
+	void recursiveDelete(vmime::ref <vmime::utility::file> dir)
+	{
+		if (!dir->exists() || !dir->isDirectory())
+			return;
+
+		vmime::ref <vmime::utility::fileIterator> files = dir->getFiles();
+
+		while (files->hasMoreElements())
+		{
+			vmime::ref <vmime::utility::file> file = files->nextElement();
+
+			if (file->isDirectory())
+				recursiveDelete(file);
+			else
+				file->remove();
+		}
+
+		dir->remove();
+	}
+
+VMIME_TEST_SUITE_END
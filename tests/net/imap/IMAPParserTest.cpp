@@ -31,6 +31,9 @@ VMIME_TEST_SUITE_BEGIN(IMAPParserTest)
 
 	VMIME_TEST_LIST_BEGIN
 		VMIME_TEST(testExtraSpaceInCapaResponse)
+		VMIME_TEST(testCondstoreResponses)
+		VMIME_TEST(testAppendUIDResponse)
+		VMIME_TEST(testESEARCHResponse)
 	VMIME_TEST_LIST_END
 
 
@@ -63,4 +66,119 @@ VMIME_TEST_SUITE_BEGIN(IMAPParserTest)
 		VASSERT_THROW("strict mode", parser->readResponse(/* literalHandler */ NULL), vmime::exceptions::invalid_response);
 	}
 
+	// CONDSTORE/QRESYNC (RFC 7162)
+	void testCondstoreResponses()
+	{
+		vmime::ref <testSocket> socket = vmime::create <testSocket>();
+		vmime::ref <vmime::net::timeoutHandler> toh = vmime::create <testTimeoutHandler>();
+
+		vmime::ref <vmime::net::imap::IMAPTag> tag =
+			vmime::create <vmime::net::imap::IMAPTag>();
+
+		socket->localSend(
+			"* OK [HIGHESTMODSEQ 20010715194045007] Highest\r\n"
+			"* VANISHED (EARLIER) 41,43:45\r\n"
+			"* 49 FETCH (UID 117 FLAGS (\\Seen) MODSEQ (90060115194045001))\r\n"
+			"a001 OK [READ-WRITE] SELECT completed.\r\n");
+
+		vmime::ref <vmime::net::imap::IMAPParser> parser =
+			vmime::create <vmime::net::imap::IMAPParser>(tag, socket.dynamicCast <vmime::net::socket>(), toh);
+
+		vmime::utility::auto_ptr <vmime::net::imap::IMAPParser::response> resp
+			(parser->readResponse(/* literalHandler */ NULL));
+
+		const std::vector <vmime::net::imap::IMAPParser::continue_req_or_response_data*>&
+			data = resp->continue_req_or_response_data();
+
+		VASSERT_EQ("Count", 3, static_cast <int>(data.size()));
+
+		// HIGHESTMODSEQ
+		const vmime::net::imap::IMAPParser::resp_text_code* code =
+			data[0]->response_data()->resp_cond_state()->resp_text()->resp_text_code();
+
+		VASSERT_EQ("HIGHESTMODSEQ", vmime::net::imap::IMAPParser::resp_text_code::HIGHESTMODSEQ, code->type());
+		VASSERT_EQ("HIGHESTMODSEQ value", std::string("20010715194045007"), code->mod_seq_value()->value());
+
+		// VANISHED
+		const vmime::net::imap::IMAPParser::mailbox_data* mbData =
+			data[1]->response_data()->mailbox_data();
+
+		VASSERT_EQ("VANISHED", vmime::net::imap::IMAPParser::mailbox_data::VANISHED, mbData->type());
+		VASSERT_TRUE("VANISHED earlier", mbData->earlier());
+		VASSERT_EQ("VANISHED set", std::string("41,43:45"), mbData->sequence_set()->value());
+
+		// MODSEQ
+		const std::vector <vmime::net::imap::IMAPParser::msg_att_item*>& items =
+			data[2]->response_data()->message_data()->msg_att()->items();
+
+		VASSERT_EQ("Items", 3, static_cast <int>(items.size()));
+		VASSERT_EQ("MODSEQ", vmime::net::imap::IMAPParser::msg_att_item::MODSEQ, items[2]->type());
+		VASSERT_EQ("MODSEQ value", std::string("90060115194045001"), items[2]->mod_seq_value()->value());
+	}
+
+	// UIDPLUS (RFC 4315)
+	void testAppendUIDResponse()
+	{
+		vmime::ref <testSocket> socket = vmime::create <testSocket>();
+		vmime::ref <vmime::net::timeoutHandler> toh = vmime::create <testTimeoutHandler>();
+
+		vmime::ref <vmime::net::imap::IMAPTag> tag =
+			vmime::create <vmime::net::imap::IMAPTag>();
+
+		socket->localSend("a001 OK [APPENDUID 38505 3955:3957] APPEND completed\r\n");
+
+		vmime::ref <vmime::net::imap::IMAPParser> parser =
+			vmime::create <vmime::net::imap::IMAPParser>(tag, socket.dynamicCast <vmime::net::socket>(), toh);
+
+		vmime::utility::auto_ptr <vmime::net::imap::IMAPParser::response> resp
+			(parser->readResponse(/* literalHandler */ NULL));
+
+		const vmime::net::imap::IMAPParser::resp_text_code* code =
+			resp->response_done()->response_tagged()->resp_cond_state()->resp_text()->resp_text_code();
+
+		VASSERT_EQ("APPENDUID", vmime::net::imap::IMAPParser::resp_text_code::APPENDUID, code->type());
+		VASSERT_EQ("UIDVALIDITY", 38505u, code->nz_number()->value());
+		VASSERT_EQ("UIDs", std::string("3955:3957"), code->uid_set()->value());
+	}
+
+	void testESEARCHResponse()
+	{
+		vmime::ref <testSocket> socket = vmime::create <testSocket>();
+		vmime::ref <vmime::net::timeoutHandler> toh = vmime::create <testTimeoutHandler>();
+
+		vmime::ref <vmime::net::imap::IMAPTag> tag =
+			vmime::create <vmime::net::imap::IMAPTag>();
+
+		socket->localSend("* ESEARCH (TAG \"a001\") UID MIN 2 MAX 47 COUNT 5 ALL 2,10:12,47\r\n");
+		socket->localSend("* ESEARCH (TAG \"a001\") COUNT 0\r\n");
+		socket->localSend("a001 OK SEARCH completed\r\n");
+
+		vmime::ref <vmime::net::imap::IMAPParser> parser =
+			vmime::create <vmime::net::imap::IMAPParser>(tag, socket.dynamicCast <vmime::net::socket>(), toh);
+
+		vmime::utility::auto_ptr <vmime::net::imap::IMAPParser::response> resp
+			(parser->readResponse(/* literalHandler */ NULL));
+
+		VASSERT_EQ("Count", 2, resp->continue_req_or_response_data().size());
+
+		const vmime::net::imap::IMAPParser::mailbox_data* data =
+			resp->continue_req_or_response_data()[0]->response_data()->mailbox_data();
+
+		VASSERT_EQ("Type", vmime::net::imap::IMAPParser::mailbox_data::ESEARCH, data->type());
+		VASSERT_EQ("Tag", std::string("a001"), data->esearch_tag());
+		VASSERT("UID", data->esearch_uid());
+		VASSERT_EQ("Min", 2u, data->esearch_min()->value());
+		VASSERT_EQ("Max", 47u, data->esearch_max()->value());
+		VASSERT_EQ("Count", 5u, data->esearch_count()->value());
+		VASSERT_EQ("All", std::string("2,10:12,47"), data->sequence_set()->value());
+
+		data = resp->continue_req_or_response_data()[1]->response_data()->mailbox_data();
+
+		VASSERT_EQ("Type 2", vmime::net::imap::IMAPParser::mailbox_data::ESEARCH, data->type());
+		VASSERT("UID 2", !data->esearch_uid());
+		VASSERT("Min 2", data->esearch_min() == NULL);
+		VASSERT("All 2", data->sequence_set() == NULL);
+		VASSERT_EQ("Count 2", 0u, data->esearch_count()->value());
+	}
+
 VMIME_TEST_SUITE_END
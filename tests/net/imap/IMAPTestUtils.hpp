@@ -0,0 +1,168 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002-2013 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+#include "vmime/net/imap/IMAPConnection.hpp"
+#include "vmime/net/imap/IMAPFolder.hpp"
+#include "vmime/net/imap/IMAPMessage.hpp"
+#include "vmime/net/imap/IMAPStore.hpp"
+
+
+/** Minimal IMAP test server.
+  *
+  * Handles greeting, LOGIN, LIST (hierarchy separator), CAPABILITY,
+  * SELECT/EXAMINE and LOGOUT. Commands are first passed to
+  * processIMAPCommand(), which can be overriden by the tests.
+  */
+class IMAPTestSocket : public lineBasedTestSocket
+{
+public:
+
+	IMAPTestSocket()
+		: m_capabilities("IMAP4rev1"), m_messageCount(0)
+	{
+	}
+
+	void onConnected()
+	{
+		localSend("* OK test.vmime.org IMAP4rev1 server ready\r\n");
+	}
+
+	void processCommand()
+	{
+		if (!haveMoreLines())
+			return;
+
+		const vmime::string line = getNextLine();
+
+		// Untagged command (eg. "DONE")
+		if (line.find(' ') == vmime::string::npos)
+		{
+			processIMAPCommand("", vmime::utility::stringUtils::toUpper(line), line);
+			processCommand();
+			return;
+		}
+
+		std::istringstream iss(line);
+
+		vmime::string tag, cmd;
+		iss >> tag >> cmd;
+
+		cmd = vmime::utility::stringUtils::toUpper(cmd);
+
+		if (processIMAPCommand(tag, cmd, line))
+		{
+			// Handled by the test
+		}
+		else if (cmd == "LOGIN")
+		{
+			localSend(tag + " OK LOGIN completed\r\n");
+		}
+		else if (cmd == "CAPABILITY")
+		{
+			localSend("* CAPABILITY " + m_capabilities + "\r\n");
+			localSend(tag + " OK CAPABILITY completed\r\n");
+		}
+		else if (cmd == "LIST" && line.find("\"\" \"\"") != vmime::string::npos)
+		{
+			localSend("* LIST (\\Noselect) \"/\" \"\"\r\n");
+			localSend(tag + " OK LIST completed\r\n");
+		}
+		else if (cmd == "SELECT" || cmd == "EXAMINE")
+		{
+			sendSelectResponse(tag, cmd);
+		}
+		else if (cmd == "LOGOUT")
+		{
+			localSend("* BYE test.vmime.org logging out\r\n");
+			localSend(tag + " OK LOGOUT completed\r\n");
+		}
+		else
+		{
+			localSend(tag + " BAD Command unrecognized\r\n");
+		}
+
+		processCommand();
+	}
+
+	/** Send a successful response to SELECT or EXAMINE.
+	  *
+	  * @param tag command tag
+	  * @param cmd "SELECT" or "EXAMINE"
+	  * @param extra additional untagged responses
+	  */
+	void sendSelectResponse(const vmime::string& tag, const vmime::string& cmd,
+		const vmime::string& extra = "")
+	{
+		std::ostringstream oss;
+		oss << "* " << m_messageCount << " EXISTS\r\n";
+
+		localSend(oss.str());
+		localSend("* 0 RECENT\r\n");
+		localSend("* OK [UIDVALIDITY 42] UIDs valid\r\n");
+		localSend("* FLAGS (\\Answered \\Flagged \\Deleted \\Seen \\Draft)\r\n");
+		localSend(extra);
+		localSend(tag + (cmd == "SELECT" ? " OK [READ-WRITE]" : " OK [READ-ONLY]")
+			+ " " + cmd + " completed\r\n");
+	}
+
+	/** Process a command. This is called before the base server
+	  * handles the command, so that tests can override its behaviour.
+	  *
+	  * @param tag command tag, or empty if the line is not tagged
+	  * @param cmd command name, in upper case
+	  * @param line full command line
+	  * @return true if the command has been handled, false otherwise
+	  */
+	virtual bool processIMAPCommand(const vmime::string& /* tag */,
+		const vmime::string& /* cmd */, const vmime::string& /* line */)
+	{
+		return false;
+	}
+
+protected:
+
+	vmime::string m_capabilities;
+	int m_messageCount;
+};
+
+
+/** Create a session with authentication properties set, and
+  * return an IMAP store which uses the specified test server.
+  */
+template <typename T>
+vmime::ref <vmime::net::store> createIMAPTestStore()
+{
+	vmime::ref <vmime::net::session> session =
+		vmime::create <vmime::net::session>();
+
+	session->getProperties()["store.imap.auth.username"] = "user";
+	session->getProperties()["store.imap.auth.password"] = "pass";
+
+	vmime::ref <vmime::net::store> store = session->getStore
+		(vmime::utility::url("imap://localhost"));
+
+	store->setSocketFactory(vmime::create <testSocketFactory <T> >());
+	store->setTimeoutHandlerFactory(vmime::create <testTimeoutHandlerFactory>());
+
+	return store;
+}
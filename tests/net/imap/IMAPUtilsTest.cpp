@@ -0,0 +1,143 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002-2013 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+
+#include "tests/testUtils.hpp"
+
+#include "vmime/net/imap/IMAPUtils.hpp"
+
+
+using namespace vmime::net::imap;
+
+
+VMIME_TEST_SUITE_BEGIN(IMAPUtilsTest)
+
+	VMIME_TEST_LIST_BEGIN
+		VMIME_TEST(testSetToList)
+		VMIME_TEST(testSetToRanges)
+		VMIME_TEST(testBuildSearchKeys)
+	VMIME_TEST_LIST_END
+
+
+	void testSetToList()
+	{
+		std::vector <unsigned int> list = IMAPUtils::setToList("1:3,7,10:9");
+
+		VASSERT_EQ("Size", 6, static_cast <int>(list.size()));
+		VASSERT_EQ("1", 1u, list[0]);
+		VASSERT_EQ("2", 2u, list[1]);
+		VASSERT_EQ("3", 3u, list[2]);
+		VASSERT_EQ("4", 7u, list[3]);
+		VASSERT_EQ("5", 9u, list[4]);
+		VASSERT_EQ("6", 10u, list[5]);
+
+		// Open ranges are ignored
+		list = IMAPUtils::setToList("4,5:*");
+
+		VASSERT_EQ("Open range", 1, static_cast <int>(list.size()));
+		VASSERT_EQ("Open range 1", 4u, list[0]);
+
+		// Overlapping ranges are merged
+		list = IMAPUtils::setToList("5,2:4,3");
+
+		VASSERT_EQ("Overlap", 4, static_cast <int>(list.size()));
+		VASSERT_EQ("Overlap 1", 2u, list[0]);
+		VASSERT_EQ("Overlap 4", 5u, list[3]);
+
+		// Range ending with the highest number
+		list = IMAPUtils::setToList("4294967295:4294967294");
+
+		VASSERT_EQ("Highest", 2, static_cast <int>(list.size()));
+		VASSERT_EQ("Highest 2", 4294967295u, list[1]);
+
+		VASSERT_EQ("Empty", 0, static_cast <int>(IMAPUtils::setToList("").size()));
+	}
+
+	void testSetToRanges()
+	{
+		std::vector <std::pair <unsigned int, unsigned int> > ranges =
+			IMAPUtils::setToRanges("9:10,1:3,4,7,6:2,20:*");
+
+		VASSERT_EQ("Size", 2, static_cast <int>(ranges.size()));
+		VASSERT_EQ("1 first", 1u, ranges[0].first);
+		VASSERT_EQ("1 last", 7u, ranges[0].second);
+		VASSERT_EQ("2 first", 9u, ranges[1].first);
+		VASSERT_EQ("2 last", 10u, ranges[1].second);
+
+		VASSERT_FALSE("0", IMAPUtils::isInRanges(ranges, 0));
+		VASSERT_TRUE("1", IMAPUtils::isInRanges(ranges, 1));
+		VASSERT_TRUE("7", IMAPUtils::isInRanges(ranges, 7));
+		VASSERT_FALSE("8", IMAPUtils::isInRanges(ranges, 8));
+		VASSERT_TRUE("10", IMAPUtils::isInRanges(ranges, 10));
+		VASSERT_FALSE("11", IMAPUtils::isInRanges(ranges, 11));
+
+		// Large ranges are not expanded
+		ranges = IMAPUtils::setToRanges("1:500000");
+
+		VASSERT_EQ("Large size", 1, static_cast <int>(ranges.size()));
+		VASSERT_TRUE("Large", IMAPUtils::isInRanges(ranges, 250000));
+
+		VASSERT_EQ("Empty", 0, static_cast <int>(IMAPUtils::setToRanges("").size()));
+	}
+
+	void testBuildSearchKeys()
+	{
+		typedef vmime::net::searchCriteria sc;
+		typedef vmime::net::message msg;
+
+		std::vector <vmime::string> parts;
+
+		IMAPUtils::buildSearchKeys(*sc::all(), parts);
+
+		VASSERT_EQ("All", 1, static_cast <int>(parts.size()));
+		VASSERT_EQ("All", "ALL", parts[0]);
+
+		IMAPUtils::buildSearchKeys(*sc::allOf
+			(sc::flagsUnset(msg::FLAG_SEEN | msg::FLAG_DELETED),
+			 sc::allOf(sc::headerContains("from", "john \"jd\""),
+			           sc::sentSince(vmime::datetime(2013, 4, 5, 10, 0, 0, 0)))), parts);
+
+		VASSERT_EQ("And", "UNSEEN UNDELETED FROM \"john \\\"jd\\\"\" SENTSINCE 5-Apr-2013", parts[0]);
+
+		IMAPUtils::buildSearchKeys(*sc::anyOf
+			(sc::flagsSet(msg::FLAG_MARKED | msg::FLAG_REPLIED),
+			 sc::anyOf(sc::sizeLarger(1000), sc::negate(sc::headerContains("X-Spam", "")))), parts);
+
+		VASSERT_EQ("Or", "OR (ANSWERED FLAGGED) OR LARGER 1000 NOT HEADER \"X-Spam\" \"\"", parts[0]);
+
+		// An empty alternative matches no message
+		IMAPUtils::buildSearchKeys(*vmime::create <sc>(sc::TYPE_OR), parts);
+
+		VASSERT_EQ("Empty OR", "NOT ALL", parts[0]);
+
+		// 8-bit strings are sent as literals
+		IMAPUtils::buildSearchKeys(*sc::allOf
+			(sc::bodyContains("caf\xc3\xa9"), sc::textContains("bar")), parts);
+
+		VASSERT_EQ("Literal count", 3, static_cast <int>(parts.size()));
+		VASSERT_EQ("Literal 1", "BODY ", parts[0]);
+		VASSERT_EQ("Literal 2", "caf\xc3\xa9", parts[1]);
+		VASSERT_EQ("Literal 3", " TEXT \"bar\"", parts[2]);
+	}
+
+VMIME_TEST_SUITE_END
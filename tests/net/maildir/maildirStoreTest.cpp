@@ -51,6 +51,47 @@ static const vmime::string TEST_MESSAGE_1 =
 	"\r\n"
 	"Hello, world!";
 
+static const vmime::string TEST_MESSAGE_2 =
+	"From: John Doe <john@vmime.org>\r\n"
+	"Subject: Meeting\r\n"
+	"Date: Mon, 15 Apr 2013 10:00:00 +0200\r\n"
+	"\r\n"
+	"See you tomorrow.";
+
+static const vmime::string TEST_MESSAGE_3 =
+	"From: Jane <jane@vmime.org>\r\n"
+	"Subject: =?utf-8?Q?R=C3=A9union?=\r\n"
+	"Date: Tue, 16 Apr 2013 10:00:00 +0200\r\n"
+	"\r\n"
+	"Tomorrow is fine.";
+
+static const vmime::string TEST_MESSAGE_BASE64 =
+	"From: <test@vmime.org>\r\n"
+	"Subject: Base64\r\n"
+	"Content-Type: text/plain; charset=utf-8\r\n"
+	"Content-Transfer-Encoding: base64\r\n"
+	"\r\n"
+	"TWVldCBtZSBhdCB0aGUgY2Fmw6kgdG9tb3Jyb3cu\r\n";
+
+static const vmime::string TEST_MESSAGE_QP =
+	"From: <test@vmime.org>\r\n"
+	"Subject: Quoted-printable\r\n"
+	"MIME-Version: 1.0\r\n"
+	"Content-Type: multipart/mixed; boundary=\"XYZ\"\r\n"
+	"\r\n"
+	"--XYZ\r\n"
+	"Content-Type: text/plain; charset=iso-8859-1\r\n"
+	"Content-Transfer-Encoding: quoted-printable\r\n"
+	"\r\n"
+	"The meeting is post=\r\n"
+	"poned to Fri=E9day.\r\n"
+	"--XYZ\r\n"
+	"Content-Type: application/octet-stream\r\n"
+	"Content-Transfer-Encoding: base64\r\n"
+	"\r\n"
+	"c2VjcmV0IGF0dGFjaG1lbnQgZGF0YQ==\r\n"
+	"--XYZ--\r\n";
+
 
 /** Maildir trees used in tests.
   * Structure:
@@ -98,6 +139,21 @@ static const vmime::string TEST_MAILDIRFILES_KMAIL[] =  // files to create and t
 	"*"  // end
 };
 
+static const vmime::string TEST_MAILDIRFILES_SEARCH[] =  // files to create and their contents
+{
+	"/Folder2/cur/1043236113.351.EmqD:S", TEST_MESSAGE_1,
+	"/Folder2/cur/1365782400.352.EmqD:2,", TEST_MESSAGE_2,
+	"/Folder2/cur/1365782400.353.EmqD:2,SF", TEST_MESSAGE_3,
+	"*"  // end
+};
+
+static const vmime::string TEST_MAILDIRFILES_SEARCH_ENCODED[] =  // files to create and their contents
+{
+	"/Folder2/cur/1365782400.354.EmqD:2,S", TEST_MESSAGE_BASE64,
+	"/Folder2/cur/1365782400.355.EmqD:2,S", TEST_MESSAGE_QP,
+	"*"  // end
+};
+
 // Courier format
 static const vmime::string TEST_MAILDIR_COURIER[] =  // directories to create
 {
@@ -164,6 +220,9 @@ VMIME_TEST_SUITE_BEGIN(maildirStoreTest)
 
 		VMIME_TEST(testCreateFolder_KMail)
 		VMIME_TEST(testCreateFolder_Courier)
+
+		VMIME_TEST(testSearch)
+		VMIME_TEST(testSearchEncodedBody)
 	VMIME_TEST_LIST_END
 
 
@@ -464,11 +523,134 @@ public:
 		destroyMaildir();
 	}
 
+	void testSearch()
+	{
+		createMaildir(TEST_MAILDIR_KMAIL, TEST_MAILDIRFILES_SEARCH);
+
+		vmime::ref <vmime::net::store> store = createAndConnectStore();
+
+		vmime::ref <vmime::net::folder> folder = store->getFolder(fpath() / "Folder2");
+		folder->open(vmime::net::folder::MODE_READ_ONLY);
+
+		typedef vmime::net::searchCriteria sc;
+
+		// Flags
+		vmime::net::searchResult res = folder->search
+			(sc::flagsUnset(vmime::net::message::FLAG_SEEN));
+
+		VASSERT_EQ("Unseen count", 1, res.getCount());
+		VASSERT_EQ("Unseen subject", "Meeting", getSubject(folder, res.getMin()));
+
+		res = folder->search(sc::flagsSet(vmime::net::message::FLAG_SEEN));
+
+		VASSERT_EQ("Seen count", 2, res.getCount());
+		VASSERT_EQ("Seen ranges", 2, res.getNumbers().size());
+
+		// Header (decoded, case-insensitive) and date
+		res = folder->search(sc::headerContains("subject", "R\xc3\xa9UNION"));
+
+		VASSERT_EQ("Subject count", 1, res.getCount());
+		VASSERT_EQ("Subject number", res.getMin(), res.getMax());
+
+		res = folder->search(sc::allOf
+			(sc::headerContains("From", "vmime.org"),
+			 sc::sentSince(vmime::datetime(2013, 4, 16, 23, 59, 59, 0))));
+
+		VASSERT_EQ("Since count", 1, res.getCount());
+		VASSERT_EQ("Since subject", "=?utf-8?Q?R=C3=A9union?=", getSubject(folder, res.getMin()));
+
+		res = folder->search(sc::sentBefore(vmime::datetime(2013, 4, 15, 0, 0, 0, 0)));
+
+		VASSERT_EQ("Before count", 1, res.getCount());
+		VASSERT_EQ("Before subject", "VMime Test", getSubject(folder, res.getMin()));
+
+		// Body and combinations
+		res = folder->search(sc::anyOf
+			(sc::bodyContains("TOMORROW"), sc::headerContains("Subject", "test")));
+
+		VASSERT_EQ("Any count", 3, res.getCount());
+		VASSERT_EQ("Any set", "1:3", res.getSet());
+
+		res = folder->search(sc::allOf
+			(sc::bodyContains("tomorrow"),
+			 sc::negate(sc::flagsSet(vmime::net::message::FLAG_MARKED))));
+
+		VASSERT_EQ("Not count", 1, res.getCount());
+		VASSERT_EQ("Not subject", "Meeting", getSubject(folder, res.getMin()));
+
+		res = folder->search(sc::bodyContains("Subject"));
+
+		VASSERT_EQ("Body only", 0, res.getCount());
+		VASSERT_EQ("Body only min", 0, res.getMin());
+
+		res = folder->search(sc::textContains("Subject: Meeting"));
+
+		VASSERT_EQ("Text count", 1, res.getCount());
+
+		folder->close(false);
+
+		destroyMaildir();
+	}
+
+	void testSearchEncodedBody()
+	{
+		createMaildir(TEST_MAILDIR_KMAIL, TEST_MAILDIRFILES_SEARCH_ENCODED);
+
+		vmime::ref <vmime::net::store> store = createAndConnectStore();
+
+		vmime::ref <vmime::net::folder> folder = store->getFolder(fpath() / "Folder2");
+		folder->open(vmime::net::folder::MODE_READ_ONLY);
+
+		typedef vmime::net::searchCriteria sc;
+
+		// Text parts are decoded, and converted to UTF-8
+		vmime::net::searchResult res = folder->search(sc::bodyContains("CAF\xc3\xa9 tomorrow"));
+
+		VASSERT_EQ("Base64 count", 1, res.getCount());
+		VASSERT_EQ("Base64 subject", "Base64", getSubject(folder, res.getMin()));
+
+		res = folder->search(sc::bodyContains("postponed to Fri\xc3\xa9" "day"));
+
+		VASSERT_EQ("QP count", 1, res.getCount());
+		VASSERT_EQ("QP subject", "Quoted-printable", getSubject(folder, res.getMin()));
+
+		res = folder->search(sc::textContains("postponed"));
+
+		VASSERT_EQ("Text count", 1, res.getCount());
+
+		// Encoded data is not searched, nor are non-text parts
+		res = folder->search(sc::bodyContains("TWVldCBt"));
+
+		VASSERT_EQ("Encoded count", 0, res.getCount());
+
+		res = folder->search(sc::bodyContains("secret"));
+
+		VASSERT_EQ("Attachment count", 0, res.getCount());
+
+		// An empty alternative matches no message
+		res = folder->search(vmime::create <sc>(sc::TYPE_OR));
+
+		VASSERT_EQ("Empty OR count", 0, res.getCount());
+
+		folder->close(false);
+
+		destroyMaildir();
+	}
+
 private:
 
 	vmime::utility::file::path m_tempPath;
 
 
+	const vmime::string getSubject(vmime::ref <vmime::net::folder> folder, const unsigned int num)
+	{
+		vmime::ref <vmime::net::message> msg = folder->getMessage(static_cast <int>(num));
+		folder->fetchMessage(msg, vmime::net::folder::FETCH_FULL_HEADER);
+
+		return msg->getHeader()->Subject()->getValue()->generate();
+	}
+
+
 	vmime::ref <vmime::net::store> createAndConnectStore()
 	{
 		vmime::ref <vmime::net::session> session =
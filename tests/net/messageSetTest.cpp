@@ -0,0 +1,147 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002-2013 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+
+#include "tests/testUtils.hpp"
+
+#include "vmime/net/messageSet.hpp"
+
+
+VMIME_TEST_SUITE_BEGIN(messageSetTest)
+
+	VMIME_TEST_LIST_BEGIN
+		VMIME_TEST(testByNumberList)
+		VMIME_TEST(testAddRange)
+		VMIME_TEST(testAddAscending)
+		VMIME_TEST(testOpenRange)
+		VMIME_TEST(testByNumberSearchResult)
+	VMIME_TEST_LIST_END
+
+
+	void testByNumberList()
+	{
+		std::vector <int> nums;
+		nums.push_back(9);
+		nums.push_back(3);
+		nums.push_back(4);
+		nums.push_back(5);
+		nums.push_back(4);
+		nums.push_back(11);
+		nums.push_back(12);
+
+		const vmime::net::messageSet set = vmime::net::messageSet::byNumber(nums);
+		const std::vector <vmime::net::messageSet::range>& ranges = set.getRanges();
+
+		VASSERT_EQ("Ranges", 3, static_cast <int>(ranges.size()));
+		VASSERT_EQ("Range 1 from", 3, ranges[0].first);
+		VASSERT_EQ("Range 1 to", 5, ranges[0].second);
+		VASSERT_EQ("Range 2 from", 9, ranges[1].first);
+		VASSERT_EQ("Range 2 to", 9, ranges[1].second);
+		VASSERT_EQ("Range 3 from", 11, ranges[2].first);
+		VASSERT_EQ("Range 3 to", 12, ranges[2].second);
+
+		VASSERT_EQ("Count", 6, set.getCount(100));
+		VASSERT_EQ("Count bounded", 4, set.getCount(10));
+
+		VASSERT_TRUE("Contains 4", set.contains(4));
+		VASSERT_FALSE("Contains 6", set.contains(6));
+		VASSERT_FALSE("Contains 13", set.contains(13));
+	}
+
+	void testAddRange()
+	{
+		vmime::net::messageSet set;
+
+		VASSERT_TRUE("Empty", set.isEmpty());
+
+		set.addRange(20, 30);
+		set.addRange(1, 5);
+		set.addRange(6, 10);
+		set.addRange(25, 40);
+		set.addRange(15, 12);  // reversed
+		set.addNumber(0);      // ignored
+
+		const std::vector <vmime::net::messageSet::range>& ranges = set.getRanges();
+
+		VASSERT_FALSE("Not empty", set.isEmpty());
+		VASSERT_EQ("Ranges", 3, static_cast <int>(ranges.size()));
+		VASSERT_EQ("Range 1 from", 1, ranges[0].first);
+		VASSERT_EQ("Range 1 to", 10, ranges[0].second);
+		VASSERT_EQ("Range 2 from", 12, ranges[1].first);
+		VASSERT_EQ("Range 2 to", 15, ranges[1].second);
+		VASSERT_EQ("Range 3 from", 20, ranges[2].first);
+		VASSERT_EQ("Range 3 to", 40, ranges[2].second);
+	}
+
+	void testAddAscending()
+	{
+		vmime::net::messageSet set;
+
+		for (int i = 1 ; i <= 100000 ; ++i)
+			set.addNumber(i);
+
+		set.addRange(50, 60);          // inside the last range
+		set.addRange(100000, 100002);  // overlapping the last range
+
+		const std::vector <vmime::net::messageSet::range>& ranges = set.getRanges();
+
+		VASSERT_EQ("Ranges", 1, static_cast <int>(ranges.size()));
+		VASSERT_EQ("Range from", 1, ranges[0].first);
+		VASSERT_EQ("Range to", 100002, ranges[0].second);
+
+		set.addRange(100003, -1);
+		set.addNumber(200000);
+
+		VASSERT_EQ("Open ranges", 1, static_cast <int>(set.getRanges().size()));
+		VASSERT_EQ("Open range to", -1, set.getRanges()[0].second);
+	}
+
+	void testOpenRange()
+	{
+		vmime::net::messageSet set = vmime::net::messageSet::byNumber(1000000);
+		set.addRange(5, 10);
+		set.addNumber(2000000);
+
+		const std::vector <vmime::net::messageSet::range>& ranges = set.getRanges();
+
+		VASSERT_EQ("Ranges", 2, static_cast <int>(ranges.size()));
+		VASSERT_EQ("Range 2 from", 1000000, ranges[1].first);
+		VASSERT_EQ("Range 2 to", -1, ranges[1].second);
+
+		VASSERT_TRUE("Contains", set.contains(2000001));
+		VASSERT_EQ("Count", 6, set.getCount(999999));
+		VASSERT_EQ("Count all", 6 + 500001, set.getCount(1500000));
+	}
+
+	void testByNumberSearchResult()
+	{
+		vmime::net::searchResult res;
+		res.setSet("2:4,8");
+
+		const vmime::net::messageSet set = vmime::net::messageSet::byNumber(res);
+
+		VASSERT_EQ("Ranges", 2, static_cast <int>(set.getRanges().size()));
+		VASSERT_EQ("Count", 4, set.getCount(10));
+	}
+
+VMIME_TEST_SUITE_END
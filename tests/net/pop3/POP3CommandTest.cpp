@@ -54,6 +54,8 @@ VMIME_TEST_SUITE_BEGIN(POP3CommandTest)
 		VMIME_TEST(testRSET)
 		VMIME_TEST(testQUIT)
 		VMIME_TEST(testWriteToSocket)
+		VMIME_TEST(testSendCommandsPipelining)
+		VMIME_TEST(testSendCommandsNoPipelining)
 	VMIME_TEST_LIST_END
 
 
@@ -225,4 +227,68 @@ VMIME_TEST_SUITE_BEGIN(POP3CommandTest)
 		VASSERT_EQ("Sent buffer", "MY_COMMAND param1 param2\r\n", response);
 	}
 
+	void testSendCommandsPipelining()
+	{
+		vmime::ref <testSocket> sok = vmime::create <testSocket>();
+		vmime::ref <POP3ConnectionTest> conn = vmime::create <POP3ConnectionTest>
+			(sok.dynamicCast <vmime::net::socket>(), vmime::null);
+
+		sok->localSend("+OK\r\nTOP\r\nPIPELINING\r\nUIDL\r\n.\r\n");
+
+		std::vector <vmime::ref <POP3Command> > commands;
+		commands.push_back(POP3Command::DELE(1));
+		commands.push_back(POP3Command::DELE(2));
+		commands.push_back(POP3Command::DELE(3));
+
+		size_t sent = 0;
+		conn->sendCommands(commands, sent, 0);
+
+		vmime::string response;
+		sok->localReceive(response);
+
+		VASSERT_EQ("Sent", 3, sent);
+		VASSERT_EQ("Sent buffer", "CAPA\r\nDELE 1\r\nDELE 2\r\nDELE 3\r\n", response);
+
+		// Capabilities are cached
+		VASSERT_TRUE("Capability", conn->hasCapability("pipelining"));
+		VASSERT_FALSE("Capability", conn->hasCapability("STLS"));
+
+		sok->localReceive(response);
+
+		VASSERT_EQ("Nothing sent", "", response);
+	}
+
+	void testSendCommandsNoPipelining()
+	{
+		vmime::ref <testSocket> sok = vmime::create <testSocket>();
+		vmime::ref <POP3ConnectionTest> conn = vmime::create <POP3ConnectionTest>
+			(sok.dynamicCast <vmime::net::socket>(), vmime::null);
+
+		sok->localSend("+OK\r\nTOP\r\nUIDL\r\n.\r\n");
+
+		std::vector <vmime::ref <POP3Command> > commands;
+		commands.push_back(POP3Command::DELE(1));
+		commands.push_back(POP3Command::DELE(2));
+
+		size_t sent = 0;
+		conn->sendCommands(commands, sent, 0);
+
+		vmime::string response;
+		sok->localReceive(response);
+
+		VASSERT_EQ("Sent 1", 1, sent);
+		VASSERT_EQ("Sent buffer 1", "CAPA\r\nDELE 1\r\n", response);
+
+		// Next command is not sent until the response has been read
+		conn->sendCommands(commands, sent, 0);
+
+		VASSERT_EQ("Sent 2", 1, sent);
+
+		conn->sendCommands(commands, sent, 1);
+		sok->localReceive(response);
+
+		VASSERT_EQ("Sent 3", 2, sent);
+		VASSERT_EQ("Sent buffer 3", "DELE 2\r\n", response);
+	}
+
 VMIME_TEST_SUITE_END
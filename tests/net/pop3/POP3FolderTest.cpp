@@ -0,0 +1,172 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002-2013 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+
+#include "tests/testUtils.hpp"
+#include "tests/net/pop3/POP3TestUtils.hpp"
+
+#include "vmime/platform.hpp"
+
+#include "vmime/net/pop3/POP3SeenUIDStore.hpp"
+
+#include <ctime>
+
+
+class SEENPOP3TestSocket;
+
+
+// Messages on the seen UID test server
+static std::vector <vmime::string> serverUIDs;
+
+
+VMIME_TEST_SUITE_BEGIN(POP3FolderTest)
+
+	VMIME_TEST_LIST_BEGIN
+		VMIME_TEST(testGetNewMessages)
+		VMIME_TEST(testGetNewMessagesDisabled)
+	VMIME_TEST_LIST_END
+
+
+	void testGetNewMessages()
+	{
+		const vmime::string seenPath = "/tmp/vmime"
+			+ vmime::utility::stringUtils::toString(std::time(NULL))
+			+ vmime::utility::stringUtils::toString(std::rand());
+
+		// First session: all messages are new
+		serverUIDs.clear();
+		serverUIDs.push_back("uid1");
+		serverUIDs.push_back("uid2");
+		serverUIDs.push_back("uid3");
+
+		{
+			vmime::ref <vmime::net::store> store =
+				createPOP3TestStore <SEENPOP3TestSocket>();
+
+			store->getSession()->getProperties()["store.pop3.seen.path"] = seenPath;
+			store->connect();
+
+			vmime::ref <vmime::net::pop3::POP3Folder> folder =
+				store->getDefaultFolder().dynamicCast <vmime::net::pop3::POP3Folder>();
+
+			folder->open(vmime::net::folder::MODE_READ_WRITE);
+
+			std::vector <vmime::ref <vmime::net::message> > msgs = folder->getNewMessages();
+
+			VASSERT_EQ("Count", 3, msgs.size());
+			VASSERT_EQ("Number", 2, msgs[1]->getNumber());
+			VASSERT_EQ("UID", "uid2", msgs[1]->getUniqueId());
+
+			msgs.pop_back();
+			folder->markMessagesSeen(msgs);
+
+			folder->close(false);
+			store->disconnect();
+		}
+
+		// Second session: "uid1" has been removed and "uid4" added
+		serverUIDs.clear();
+		serverUIDs.push_back("uid2");
+		serverUIDs.push_back("uid3");
+		serverUIDs.push_back("uid4");
+
+		{
+			vmime::ref <vmime::net::store> store =
+				createPOP3TestStore <SEENPOP3TestSocket>();
+
+			store->getSession()->getProperties()["store.pop3.seen.path"] = seenPath;
+			store->connect();
+
+			vmime::ref <vmime::net::pop3::POP3Folder> folder =
+				store->getDefaultFolder().dynamicCast <vmime::net::pop3::POP3Folder>();
+
+			folder->open(vmime::net::folder::MODE_READ_WRITE);
+
+			std::vector <vmime::ref <vmime::net::message> > msgs = folder->getNewMessages();
+
+			VASSERT_EQ("Count", 2, msgs.size());
+			VASSERT_EQ("Number 1", 2, msgs[0]->getNumber());
+			VASSERT_EQ("UID 1", "uid3", msgs[0]->getUniqueId());
+			VASSERT_EQ("Number 2", 3, msgs[1]->getNumber());
+			VASSERT_EQ("UID 2", "uid4", msgs[1]->getUniqueId());
+
+			folder->close(false);
+			store->disconnect();
+		}
+
+		// UIDs of removed messages are forgotten
+		vmime::ref <vmime::utility::fileSystemFactory> fsf =
+			vmime::platform::getHandler()->getFileSystemFactory();
+
+		vmime::ref <vmime::net::pop3::POP3SeenUIDStore> seen =
+			vmime::create <vmime::net::pop3::POP3SeenUIDStore>
+				(fsf->stringToPath(seenPath), "user@localhost:110");
+
+		VASSERT_EQ("Seen count", 1, seen->getCount());
+		VASSERT_TRUE("Seen", seen->isSeen("uid2"));
+
+		// Clean up
+		vmime::ref <vmime::utility::fileIterator> files =
+			fsf->create(fsf->stringToPath(seenPath))->getFiles();
+
+		while (files->hasMoreElements())
+			files->nextElement()->remove();
+
+		fsf->create(fsf->stringToPath(seenPath))->remove();
+	}
+
+	void testGetNewMessagesDisabled()
+	{
+		serverUIDs.clear();
+		serverUIDs.push_back("uid1");
+
+		vmime::ref <vmime::net::store> store =
+			createPOP3TestStore <SEENPOP3TestSocket>();
+
+		store->connect();
+
+		vmime::ref <vmime::net::pop3::POP3Folder> folder =
+			store->getDefaultFolder().dynamicCast <vmime::net::pop3::POP3Folder>();
+
+		folder->open(vmime::net::folder::MODE_READ_WRITE);
+
+		VASSERT_THROW("Disabled", folder->getNewMessages(),
+			vmime::exceptions::illegal_state);
+
+		folder->close(false);
+		store->disconnect();
+	}
+
+VMIME_TEST_SUITE_END
+
+
+
+class SEENPOP3TestSocket : public POP3TestSocket
+{
+public:
+
+	SEENPOP3TestSocket()
+	{
+		m_uids = serverUIDs;
+	}
+};
@@ -42,6 +42,9 @@ VMIME_TEST_SUITE_BEGIN(POP3ResponseTest)
 		VMIME_TEST(testMultiLineResponse)
 		VMIME_TEST(testMultiLineResponseLF)
 		VMIME_TEST(testLargeResponse)
+		VMIME_TEST(testPipelinedResponses)
+		VMIME_TEST(testPipelinedLargeResponses)
+		VMIME_TEST(testPipelinedLargeResponseERR)
 	VMIME_TEST_LIST_END
 
 
@@ -226,5 +229,91 @@ VMIME_TEST_SUITE_BEGIN(POP3ResponseTest)
 		VASSERT_EQ("Data Bytes", data.str(), receivedData);
 	}
 
+	void testPipelinedResponses()
+	{
+		vmime::ref <testSocket> socket = vmime::create <testSocket>();
+		vmime::ref <vmime::net::timeoutHandler> toh = vmime::create <testTimeoutHandler>();
+
+		vmime::ref <POP3ConnectionTest> conn = vmime::create <POP3ConnectionTest>
+			(socket.dynamicCast <vmime::net::socket>(), toh);
+
+		// All responses are received at once
+		socket->localSend("+OK First\r\n+OK Second\r\nLine 1\r\n..Line 2\r\n.\r\n-ERR Third\r\n");
+
+		vmime::ref <POP3Response> resp1 =
+			POP3Response::readResponse(conn);
+
+		VASSERT_EQ("First Line 1", "+OK First", resp1->getFirstLine());
+
+		vmime::ref <POP3Response> resp2 =
+			POP3Response::readMultilineResponse(conn);
+
+		VASSERT_EQ("First Line 2", "+OK Second", resp2->getFirstLine());
+		VASSERT_EQ("Lines 2", 2, resp2->getLineCount());
+		VASSERT_EQ("Line 2.1", "Line 1", resp2->getLineAt(0));
+		VASSERT_EQ("Line 2.2", ".Line 2", resp2->getLineAt(1));
+
+		vmime::ref <POP3Response> resp3 =
+			POP3Response::readResponse(conn);
+
+		VASSERT_EQ("Code 3", POP3Response::CODE_ERR, resp3->getCode());
+		VASSERT_EQ("First Line 3", "-ERR Third", resp3->getFirstLine());
+	}
+
+	void testPipelinedLargeResponses()
+	{
+		vmime::ref <testSocket> socket = vmime::create <testSocket>();
+		vmime::ref <vmime::net::timeoutHandler> toh = vmime::create <testTimeoutHandler>();
+
+		vmime::ref <POP3ConnectionTest> conn = vmime::create <POP3ConnectionTest>
+			(socket.dynamicCast <vmime::net::socket>(), toh);
+
+		socket->localSend("+OK\r\nSubject: 1\r\n\r\n.\r\n+OK\r\nSubject: 2\r\n\r\n.\r\n+OK Done\r\n");
+
+		for (int i = 1 ; i <= 2 ; ++i)
+		{
+			vmime::string receivedData;
+			vmime::utility::outputStreamStringAdapter receivedDataStream(receivedData);
+
+			vmime::ref <POP3Response> resp =
+				POP3Response::readLargeResponse(conn, receivedDataStream, NULL, 0);
+
+			std::ostringstream expected;
+			expected << "Subject: " << i << "\r\n";
+
+			VASSERT_TRUE("Success", resp->isSuccess());
+			VASSERT_EQ("Data", expected.str(), receivedData);
+		}
+
+		vmime::ref <POP3Response> resp =
+			POP3Response::readResponse(conn);
+
+		VASSERT_EQ("First Line", "+OK Done", resp->getFirstLine());
+	}
+
+	void testPipelinedLargeResponseERR()
+	{
+		vmime::ref <testSocket> socket = vmime::create <testSocket>();
+		vmime::ref <vmime::net::timeoutHandler> toh = vmime::create <testTimeoutHandler>();
+
+		vmime::ref <POP3ConnectionTest> conn = vmime::create <POP3ConnectionTest>
+			(socket.dynamicCast <vmime::net::socket>(), toh);
+
+		socket->localSend("-ERR No such message\r\n+OK\r\nSubject: 2\r\n\r\n.\r\n");
+
+		vmime::string receivedData;
+		vmime::utility::outputStreamStringAdapter receivedDataStream(receivedData);
+
+		VASSERT_THROW("Error",
+			POP3Response::readLargeResponse(conn, receivedDataStream, NULL, 0),
+			vmime::exceptions::command_error);
+
+		vmime::ref <POP3Response> resp =
+			POP3Response::readLargeResponse(conn, receivedDataStream, NULL, 0);
+
+		VASSERT_TRUE("Success", resp->isSuccess());
+		VASSERT_EQ("Data", "Subject: 2\r\n", receivedData);
+	}
+
 VMIME_TEST_SUITE_END
 
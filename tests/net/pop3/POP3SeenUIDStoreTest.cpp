@@ -0,0 +1,263 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002-2013 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+
+#include "tests/testUtils.hpp"
+
+#include "vmime/platform.hpp"
+
+#include "vmime/net/pop3/POP3SeenUIDStore.hpp"
+
+#include <ctime>
+
+
+typedef vmime::utility::file::path fspath;
+typedef vmime::utility::file::path::component fspathc;
+
+using vmime::net::pop3::POP3SeenUIDStore;
+
+
+VMIME_TEST_SUITE_BEGIN(POP3SeenUIDStoreTest)
+
+	VMIME_TEST_LIST_BEGIN
+		VMIME_TEST(testSeen)
+		VMIME_TEST(testPersistence)
+		VMIME_TEST(testAccounts)
+		VMIME_TEST(testRetain)
+		VMIME_TEST(testInterruptedFlush)
+		VMIME_TEST(testInvalidFile)
+	VMIME_TEST_LIST_END
+
+
+public:
+
+	POP3SeenUIDStoreTest()
+	{
+		// Temporary directory
+		m_tempPath = fspath() / fspathc("tmp")   // Use /tmp
+			/ fspathc("vmime" + vmime::utility::stringUtils::toString(std::time(NULL))
+				+ vmime::utility::stringUtils::toString(std::rand()));
+	}
+
+	void tearDown()
+	{
+		vmime::ref <vmime::utility::fileSystemFactory> fsf =
+			vmime::platform::getHandler()->getFileSystemFactory();
+
+		recursiveDelete(fsf->create(m_tempPath));
+	}
+
+
+	void testSeen()
+	{
+		vmime::ref <POP3SeenUIDStore> store =
+			vmime::create <POP3SeenUIDStore>(m_tempPath, "user@pop.example.com:110");
+
+		VASSERT_EQ("Empty", 0, store->getCount());
+		VASSERT_FALSE("Not seen", store->isSeen("whqtswO00WBw418f9t5JxYwZ"));
+
+		store->setSeen("whqtswO00WBw418f9t5JxYwZ");
+		store->setSeen("whqtswO00WBw418f9t5JxYwZ");
+
+		VASSERT_EQ("Count", 1, store->getCount());
+		VASSERT_TRUE("Seen", store->isSeen("whqtswO00WBw418f9t5JxYwZ"));
+		VASSERT_FALSE("Other", store->isSeen("QhdPYR:00WBw1Ph7x7"));
+	}
+
+	void testPersistence()
+	{
+		{
+			vmime::ref <POP3SeenUIDStore> store =
+				vmime::create <POP3SeenUIDStore>(m_tempPath, "user@pop.example.com:110");
+
+			store->setSeen("whqtswO00WBw418f9t5JxYwZ");
+			store->setSeen("QhdPYR:00WBw1Ph7x7");
+			store->flush();
+
+			// Not written until flush() is called
+			store->setSeen("unflushed");
+		}
+
+		{
+			vmime::ref <POP3SeenUIDStore> store =
+				vmime::create <POP3SeenUIDStore>(m_tempPath, "user@pop.example.com:110");
+
+			VASSERT_EQ("Count", 2, store->getCount());
+			VASSERT_TRUE("Seen 1", store->isSeen("whqtswO00WBw418f9t5JxYwZ"));
+			VASSERT_TRUE("Seen 2", store->isSeen("QhdPYR:00WBw1Ph7x7"));
+			VASSERT_FALSE("Unflushed", store->isSeen("unflushed"));
+
+			// Replace the existing file
+			store->setSeen("third");
+			store->flush();
+		}
+
+		vmime::ref <POP3SeenUIDStore> store =
+			vmime::create <POP3SeenUIDStore>(m_tempPath, "user@pop.example.com:110");
+
+		VASSERT_EQ("Count (reload)", 3, store->getCount());
+		VASSERT_TRUE("Seen 3", store->isSeen("third"));
+	}
+
+	void testAccounts()
+	{
+		{
+			vmime::ref <POP3SeenUIDStore> store =
+				vmime::create <POP3SeenUIDStore>(m_tempPath, "user@pop.example.com:110");
+
+			store->setSeen("uid1");
+			store->flush();
+		}
+
+		vmime::ref <POP3SeenUIDStore> store =
+			vmime::create <POP3SeenUIDStore>(m_tempPath, "other/user@pop.example.com:110");
+
+		VASSERT_FALSE("Other account", store->isSeen("uid1"));
+	}
+
+	void testRetain()
+	{
+		{
+			vmime::ref <POP3SeenUIDStore> store =
+				vmime::create <POP3SeenUIDStore>(m_tempPath, "user@pop.example.com:110");
+
+			store->setSeen("uid1");
+			store->setSeen("uid2");
+			store->setSeen("uid3");
+
+			std::vector <vmime::net::message::uid> uids;
+			uids.push_back("uid4");
+			uids.push_back("uid3");
+			uids.push_back("uid1");
+
+			store->retain(uids);
+
+			VASSERT_EQ("Count", 2, store->getCount());
+			VASSERT_TRUE("Seen 1", store->isSeen("uid1"));
+			VASSERT_FALSE("Seen 2", store->isSeen("uid2"));
+			VASSERT_TRUE("Seen 3", store->isSeen("uid3"));
+			VASSERT_FALSE("Seen 4", store->isSeen("uid4"));
+
+			store->flush();
+		}
+
+		vmime::ref <POP3SeenUIDStore> store =
+			vmime::create <POP3SeenUIDStore>(m_tempPath, "user@pop.example.com:110");
+
+		VASSERT_EQ("Count (reload)", 2, store->getCount());
+		VASSERT_FALSE("Seen 2 (reload)", store->isSeen("uid2"));
+	}
+
+	void testInterruptedFlush()
+	{
+		// The previous file was removed, but the temporary file
+		// was not renamed yet
+		writeFile(fspathc("a" + hexEncode("account") + ".tmp"), "VMIMEPU1\nuid1\nuid2\nui");
+
+		vmime::ref <POP3SeenUIDStore> store =
+			vmime::create <POP3SeenUIDStore>(m_tempPath, "account");
+
+		VASSERT_EQ("Count", 2, store->getCount());
+		VASSERT_TRUE("Seen 1", store->isSeen("uid1"));
+		VASSERT_TRUE("Seen 2", store->isSeen("uid2"));
+		VASSERT_FALSE("Incomplete line", store->isSeen("ui"));
+
+		// The temporary file is replaced
+		store->setSeen("uid3");
+		store->flush();
+
+		vmime::ref <POP3SeenUIDStore> store2 =
+			vmime::create <POP3SeenUIDStore>(m_tempPath, "account");
+
+		VASSERT_EQ("Count (reload)", 3, store2->getCount());
+	}
+
+	void testInvalidFile()
+	{
+		writeFile(fspathc("a" + hexEncode("account")), "uid1\nuid2\n");
+
+		vmime::ref <POP3SeenUIDStore> store =
+			vmime::create <POP3SeenUIDStore>(m_tempPath, "account");
+
+		VASSERT_EQ("Count", 0, store->getCount());
+	}
+
+private:
+
+	fspath m_tempPath;
+
+
+	static const vmime::string hexEncode(const vmime::string& str)
+	{
+		static const char hexChars[] = "0123456789abcdef";
+
+		vmime::string res;
+
+		for (vmime::string::const_iterator it = str.begin() ; it != str.end() ; ++it)
+		{
+			const unsigned char c = static_cast <unsigned char>(*it);
+
+			res += hexChars[c >> 4];
+			res += hexChars[c & 0xf];
+		}
+
+		return res;
+	}
+
+	void writeFile(const fspathc& name, const vmime::string& data)
+	{
+		vmime::ref <vmime::utility::fileSystemFactory> fsf =
+			vmime::platform::getHandler()->getFileSystemFactory();
+
+		fsf->create(m_tempPath)->createDirectory(true);
+
+		vmime::ref <vmime::utility::file> file = fsf->create(m_tempPath / name);
+		file->createFile();
+
+		vmime::ref <vmime::utility::outputStream> os = file->getFileWriter()->getOutputStream();
+
+		os->write(data.data(), data.length());
+		os->flush();
+	}
+
+	void recursiveDelete(vmime::ref <vmime::utility::file> dir)
+	{
+		if (!dir->exists() || !dir->isDirectory())
+			return;
+
+		vmime::ref <vmime::utility::fileIterator> files = dir->getFiles();
+
+		while (files->hasMoreElements())
+		{
+			vmime::ref <vmime::utility::file> file = files->nextElement();
+
+			if (file->isDirectory())
+				recursiveDelete(file);
+			else
+				file->remove();
+		}
+
+		dir->remove();
+	}
+
+VMIME_TEST_SUITE_END
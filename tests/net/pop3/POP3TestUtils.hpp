@@ -22,6 +22,7 @@
 //
 
 #include "vmime/net/pop3/POP3Connection.hpp"
+#include "vmime/net/pop3/POP3Folder.hpp"
 #include "vmime/net/pop3/POP3Store.hpp"
 
 
@@ -51,3 +52,120 @@ private:
 	vmime::ref <vmime::net::socket> m_socket;
 	vmime::ref <vmime::net::timeoutHandler> m_timeoutHandler;
 };
+
+
+/** Minimal POP3 test server.
+  *
+  * Handles greeting, CAPA, USER, PASS, STAT, UIDL and QUIT. Messages
+  * are identified by the UIDs in m_uids. Commands are first passed to
+  * processPOP3Command(), which can be overriden by the tests.
+  */
+class POP3TestSocket : public lineBasedTestSocket
+{
+public:
+
+	POP3TestSocket()
+		: m_capabilities("USER\r\nUIDL\r\n")
+	{
+	}
+
+	void onConnected()
+	{
+		localSend("+OK test.vmime.org POP3 server ready\r\n");
+	}
+
+	void processCommand()
+	{
+		if (!haveMoreLines())
+			return;
+
+		const vmime::string line = getNextLine();
+
+		std::istringstream iss(line);
+
+		vmime::string cmd;
+		iss >> cmd;
+
+		cmd = vmime::utility::stringUtils::toUpper(cmd);
+
+		if (processPOP3Command(cmd, line))
+		{
+			// Handled by the test
+		}
+		else if (cmd == "USER" || cmd == "PASS")
+		{
+			localSend("+OK\r\n");
+		}
+		else if (cmd == "CAPA")
+		{
+			localSend("+OK Capability list follows\r\n" + m_capabilities + ".\r\n");
+		}
+		else if (cmd == "STAT")
+		{
+			std::ostringstream oss;
+			oss << "+OK " << m_uids.size() << " " << (m_uids.size() * 100) << "\r\n";
+
+			localSend(oss.str());
+		}
+		else if (cmd == "UIDL")
+		{
+			std::ostringstream oss;
+			oss << "+OK\r\n";
+
+			for (unsigned int i = 0 ; i < m_uids.size() ; ++i)
+				oss << (i + 1) << " " << m_uids[i] << "\r\n";
+
+			oss << ".\r\n";
+
+			localSend(oss.str());
+		}
+		else if (cmd == "QUIT")
+		{
+			localSend("+OK test.vmime.org signing off\r\n");
+		}
+		else
+		{
+			localSend("-ERR Unknown command\r\n");
+		}
+	}
+
+	/** Process a command. This is called before the base server
+	  * handles the command, so that tests can override its behaviour.
+	  *
+	  * @param cmd command name, in upper case
+	  * @param line full command line
+	  * @return true if the command has been handled, false otherwise
+	  */
+	virtual bool processPOP3Command(const vmime::string& /* cmd */,
+		const vmime::string& /* line */)
+	{
+		return false;
+	}
+
+protected:
+
+	vmime::string m_capabilities;
+	std::vector <vmime::string> m_uids;
+};
+
+
+/** Create a session with authentication properties set, and
+  * return a POP3 store which uses the specified test server.
+  */
+template <typename T>
+vmime::ref <vmime::net::store> createPOP3TestStore()
+{
+	vmime::ref <vmime::net::session> session =
+		vmime::create <vmime::net::session>();
+
+	session->getProperties()["store.pop3.auth.username"] = "user";
+	session->getProperties()["store.pop3.auth.password"] = "pass";
+
+	vmime::ref <vmime::net::store> store = session->getStore
+		(vmime::utility::url("pop3://localhost"));
+
+	store->setSocketFactory(vmime::create <testSocketFactory <T> >());
+	store->setTimeoutHandlerFactory(vmime::create <testTimeoutHandlerFactory>());
+
+	return store;
+}
@@ -0,0 +1,106 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002-2013 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+
+#include "tests/testUtils.hpp"
+
+#include "vmime/net/searchCriteria.hpp"
+#include "vmime/net/folder.hpp"
+
+
+VMIME_TEST_SUITE_BEGIN(searchCriteriaTest)
+
+	VMIME_TEST_LIST_BEGIN
+		VMIME_TEST(testResultAppend)
+		VMIME_TEST(testResultSet)
+		VMIME_TEST(testFetchOptions)
+	VMIME_TEST_LIST_END
+
+
+	void testResultAppend()
+	{
+		vmime::net::searchResult res;
+
+		VASSERT_EQ("Empty count", 0u, res.getCount());
+		VASSERT_EQ("Empty min", 0u, res.getMin());
+		VASSERT_EQ("Empty set", "", res.getSet());
+
+		res.appendNumber(3);
+		res.appendNumber(4);
+		res.appendNumber(5);
+		res.appendNumber(9);
+		res.appendNumber(11);
+		res.appendNumber(12);
+
+		VASSERT_EQ("Count", 6u, res.getCount());
+		VASSERT_EQ("Min", 3u, res.getMin());
+		VASSERT_EQ("Max", 12u, res.getMax());
+		VASSERT_EQ("Ranges", 3, static_cast <int>(res.getRanges().size()));
+		VASSERT_EQ("Set", "3:5,9,11:12", res.getSet());
+
+		const std::vector <int> numbers = res.getNumbers();
+
+		VASSERT_EQ("Numbers", 6, static_cast <int>(numbers.size()));
+		VASSERT_EQ("Numbers 1", 3, numbers[0]);
+		VASSERT_EQ("Numbers 4", 9, numbers[3]);
+		VASSERT_EQ("Numbers 6", 12, numbers[5]);
+	}
+
+	void testResultSet()
+	{
+		vmime::net::searchResult res;
+
+		// Unordered, reversed and overlapping ranges are normalized
+		res.setSet("20,1:3,7:5,4,6:8,100000:1");
+
+		VASSERT_EQ("Count", 100000u, res.getCount());
+		VASSERT_EQ("Min", 1u, res.getMin());
+		VASSERT_EQ("Max", 100000u, res.getMax());
+		VASSERT_EQ("Set", "1:100000", res.getSet());
+
+		res.setSet("20,1:3,7:5,4");
+
+		VASSERT_EQ("Count 2", 8u, res.getCount());
+		VASSERT_EQ("Set 2", "1:7,20", res.getSet());
+
+		res.setSet("");
+
+		VASSERT_EQ("Empty count", 0u, res.getCount());
+		VASSERT_EQ("Empty max", 0u, res.getMax());
+	}
+
+	void testFetchOptions()
+	{
+		typedef vmime::net::searchCriteria sc;
+		typedef vmime::net::folder folder;
+
+		VASSERT_EQ("All", 0, sc::all()->getFetchOptions());
+		VASSERT_EQ("Body", 0, sc::bodyContains("x")->getFetchOptions());
+
+		VASSERT_EQ("Combined", folder::FETCH_FLAGS | folder::FETCH_FULL_HEADER | folder::FETCH_SIZE,
+			sc::anyOf(sc::flagsSet(vmime::net::message::FLAG_SEEN),
+			          sc::negate(sc::allOf(sc::sentBefore(vmime::datetime::now()),
+			                               sc::sizeSmaller(10))))->getFetchOptions());
+	}
+
+VMIME_TEST_SUITE_END
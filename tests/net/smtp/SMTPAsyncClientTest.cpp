@@ -0,0 +1,426 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002-2013 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+#include "tests/testUtils.hpp"
+
+#include "vmime/net/smtp/SMTPAsyncClient.hpp"
+
+
+using vmime::net::smtp::SMTPAsyncClient;
+
+
+class asyncSMTPTestSocket;
+
+
+// Commands and message data received by the test server
+static std::vector <vmime::string> receivedCommands;
+static vmime::string receivedData;
+
+
+/** Input stream which has no data available every other read.
+  */
+class slowInputStream : public vmime::utility::inputStreamStringAdapter
+{
+public:
+
+	slowInputStream(const vmime::string& data)
+		: vmime::utility::inputStreamStringAdapter(data), m_ready(false)
+	{
+	}
+
+	size_type read(value_type* const data, const size_type count)
+	{
+		m_ready = !m_ready;
+
+		if (!m_ready)
+			return 0;
+
+		return vmime::utility::inputStreamStringAdapter::read(data, count < 4 ? count : 4);
+	}
+
+private:
+
+	bool m_ready;
+};
+
+
+VMIME_TEST_SUITE_BEGIN(SMTPAsyncClientTest)
+
+	VMIME_TEST_LIST_BEGIN
+		VMIME_TEST(testPipelinedDelivery)
+		VMIME_TEST(testRun)
+		VMIME_TEST(testRunSlowStream)
+		VMIME_TEST(testGreetingError)
+		VMIME_TEST(testSendMessage)
+	VMIME_TEST_LIST_END
+
+
+	void testPipelinedDelivery()
+	{
+		vmime::ref <testSocket> sok = vmime::create <testSocket>();
+		vmime::ref <SMTPAsyncClient> client = vmime::create <SMTPAsyncClient>
+			(sok.staticCast <vmime::net::socket>(), vmime::string("localhost"));
+
+		VASSERT_TRUE("Wait for greeting", client->wantRead());
+		VASSERT_FALSE("Nothing to write", client->wantWrite());
+
+		vmime::mailboxList recips;
+		recips.appendMailbox(vmime::create <vmime::mailbox>("recipient1@test.vmime.org"));
+		recips.appendMailbox(vmime::create <vmime::mailbox>("recipient2@test.vmime.org"));
+
+		const vmime::string data = "Subject: test\r\n\r\n.Line 1\r\nLine 2";
+
+		vmime::ref <SMTPAsyncClient::delivery> d = client->send
+			(vmime::mailbox("expeditor@test.vmime.org"), recips,
+			 vmime::create <vmime::utility::inputStreamStringAdapter>(data), data.length());
+
+		// Partial response is not processed
+		sok->localSend("220 test.vmime.org Ser");
+		client->onReadable();
+
+		VASSERT_EQ("Greeting", SMTPAsyncClient::STATE_GREETING, client->getState());
+
+		sok->localSend("vice ready\r\n");
+		client->onReadable();
+
+		VASSERT_EQ("EHLO", SMTPAsyncClient::STATE_EHLO, client->getState());
+		VASSERT_TRUE("Want write EHLO", client->wantWrite());
+
+		vmime::string out;
+		client->onWritable();
+		sok->localReceive(out);
+
+		VASSERT_EQ("EHLO command", "EHLO localhost\r\n", out);
+		VASSERT_FALSE("EHLO written", client->wantWrite());
+
+		sok->localSend("250-test.vmime.org\r\n250-SIZE 1000000\r\n250 PIPELINING\r\n");
+		client->onReadable();
+
+		// Envelope is sent at once
+		VASSERT_EQ("Envelope", SMTPAsyncClient::STATE_ENVELOPE, client->getState());
+
+		client->onWritable();
+		sok->localReceive(out);
+
+		std::ostringstream expected;
+		expected << "MAIL FROM:<expeditor@test.vmime.org> SIZE=" << data.length() << "\r\n"
+		         << "RCPT TO:<recipient1@test.vmime.org>\r\n"
+		         << "RCPT TO:<recipient2@test.vmime.org>\r\n"
+		         << "DATA\r\n";
+
+		VASSERT_EQ("Envelope commands", expected.str(), out);
+
+		sok->localSend("250 OK\r\n250 OK\r\n550 No such user\r\n354 Go ahead\r\n");
+		client->onReadable();
+
+		VASSERT_EQ("Data", SMTPAsyncClient::STATE_DATA, client->getState());
+		VASSERT_FALSE("No read while sending data", client->wantRead());
+
+		client->onWritable();
+		sok->localReceive(out);
+
+		VASSERT_EQ("Data sent", "Subject: test\r\n\r\n..Line 1\r\nLine 2\r\n.\r\n", out);
+		VASSERT_EQ("Data end", SMTPAsyncClient::STATE_DATA_END, client->getState());
+		VASSERT_FALSE("Not done", d->done);
+
+		sok->localSend("250 Message accepted\r\n");
+		client->onReadable();
+
+		VASSERT_EQ("Ready", SMTPAsyncClient::STATE_READY, client->getState());
+		VASSERT_TRUE("Done", d->done);
+		VASSERT_TRUE("Sent", d->sent);
+		VASSERT_TRUE("Accepted 1", d->recipientStatuses[0].accepted);
+		VASSERT_FALSE("Accepted 2", d->recipientStatuses[1].accepted);
+		VASSERT_EQ("Response 2", "No such user", d->recipientStatuses[1].response);
+
+		VASSERT_FALSE("Idle read", client->wantRead());
+		VASSERT_FALSE("Idle write", client->wantWrite());
+	}
+
+	void testRun()
+	{
+		vmime::ref <vmime::net::socket> sok = vmime::create <asyncSMTPTestSocket>();
+		sok->connect("localhost", 25);
+
+		vmime::ref <SMTPAsyncClient> client = vmime::create <SMTPAsyncClient>(sok, vmime::string("localhost"));
+
+		receivedCommands.clear();
+		receivedData.clear();
+
+		vmime::mailboxList recips1;
+		recips1.appendMailbox(vmime::create <vmime::mailbox>("rejected@test.vmime.org"));
+
+		vmime::mailboxList recips2;
+		recips2.appendMailbox(vmime::create <vmime::mailbox>("recipient@test.vmime.org"));
+
+		vmime::ref <SMTPAsyncClient::delivery> d1 = client->send
+			(vmime::mailbox("expeditor@test.vmime.org"), recips1,
+			 vmime::create <vmime::utility::inputStreamStringAdapter>("Message 1\r\n"), 0);
+
+		vmime::ref <SMTPAsyncClient::delivery> d2 = client->send
+			(vmime::mailbox("expeditor@test.vmime.org"), recips2,
+			 vmime::create <vmime::utility::inputStreamStringAdapter>("Message 2\r\n"), 0);
+
+		client->quit();
+		client->run();
+
+		VASSERT_EQ("Closed", SMTPAsyncClient::STATE_CLOSED, client->getState());
+
+		VASSERT_TRUE("Done 1", d1->done);
+		VASSERT_FALSE("Sent 1", d1->sent);
+		VASSERT_FALSE("Error 1", d1->error.empty());
+
+		VASSERT_TRUE("Done 2", d2->done);
+		VASSERT_TRUE("Sent 2", d2->sent);
+
+		// Without pipelining, DATA is not sent if no recipient is accepted
+		VASSERT_EQ("Command count", 8, static_cast <int>(receivedCommands.size()));
+		VASSERT_EQ("Command 1", "EHLO localhost", receivedCommands[0]);
+		VASSERT_EQ("Command 2", "MAIL FROM:<expeditor@test.vmime.org>", receivedCommands[1]);
+		VASSERT_EQ("Command 3", "RCPT TO:<rejected@test.vmime.org>", receivedCommands[2]);
+		VASSERT_EQ("Command 4", "RSET", receivedCommands[3]);
+		VASSERT_EQ("Command 5", "MAIL FROM:<expeditor@test.vmime.org>", receivedCommands[4]);
+		VASSERT_EQ("Command 6", "RCPT TO:<recipient@test.vmime.org>", receivedCommands[5]);
+		VASSERT_EQ("Command 7", "DATA", receivedCommands[6]);
+		VASSERT_EQ("Command 8", "QUIT", receivedCommands[7]);
+
+		VASSERT_EQ("Data", "Message 2\r\n\r\n", receivedData);
+	}
+
+	void testRunSlowStream()
+	{
+		vmime::ref <vmime::net::socket> sok = vmime::create <asyncSMTPTestSocket>();
+		sok->connect("localhost", 25);
+
+		vmime::ref <SMTPAsyncClient> client = vmime::create <SMTPAsyncClient>(sok, vmime::string("localhost"));
+
+		receivedCommands.clear();
+		receivedData.clear();
+
+		vmime::mailboxList recips;
+		recips.appendMailbox(vmime::create <vmime::mailbox>("recipient@test.vmime.org"));
+
+		vmime::ref <SMTPAsyncClient::delivery> d = client->send
+			(vmime::mailbox("expeditor@test.vmime.org"), recips,
+			 vmime::create <slowInputStream>("Message\r\n"), 0);
+
+		client->quit();
+		client->run();
+
+		VASSERT_EQ("Closed", SMTPAsyncClient::STATE_CLOSED, client->getState());
+		VASSERT_TRUE("Sent", d->sent);
+		VASSERT_EQ("Data", "Message\r\n\r\n", receivedData);
+	}
+
+	void testGreetingError()
+	{
+		vmime::ref <testSocket> sok = vmime::create <testSocket>();
+		vmime::ref <SMTPAsyncClient> client = vmime::create <SMTPAsyncClient>
+			(sok.staticCast <vmime::net::socket>(), vmime::string("localhost"));
+
+		vmime::mailboxList recips;
+		recips.appendMailbox(vmime::create <vmime::mailbox>("recipient@test.vmime.org"));
+
+		vmime::ref <SMTPAsyncClient::delivery> d = client->send
+			(vmime::mailbox("expeditor@test.vmime.org"), recips,
+			 vmime::create <vmime::utility::inputStreamStringAdapter>("Message\r\n"), 0);
+
+		sok->localSend("554 Go away\r\n");
+		client->onReadable();
+
+		VASSERT_EQ("Error", SMTPAsyncClient::STATE_ERROR, client->getState());
+		VASSERT_TRUE("Finished", client->isFinished());
+		VASSERT_FALSE("Error message", client->getError().empty());
+
+		VASSERT_TRUE("Done", d->done);
+		VASSERT_FALSE("Sent", d->sent);
+		VASSERT_EQ("Delivery error", client->getError(), d->error);
+	}
+
+	void testSendMessage()
+	{
+		vmime::ref <testSocket> sok = vmime::create <testSocket>();
+		vmime::ref <SMTPAsyncClient> client = vmime::create <SMTPAsyncClient>
+			(sok.staticCast <vmime::net::socket>(), vmime::string("localhost"));
+
+		vmime::ref <vmime::message> msg1 = vmime::create <vmime::message>();
+		msg1->parse("Subject: test\r\n"
+		            "Content-Type: text/plain; charset=iso-8859-1\r\n"
+		            "Content-Transfer-Encoding: 8bit\r\n"
+		            "\r\nCaf\xe9\r\n");
+
+		vmime::ref <vmime::message> msg2 = vmime::create <vmime::message>();
+		msg2->parse("Subject: test\r\n\r\nHello\r\n");
+
+		std::ostringstream oss;
+		vmime::utility::outputStreamAdapter os(oss);
+		msg1->generate(os);
+
+		const vmime::string generated = oss.str();
+
+		vmime::mailboxList recips;
+		recips.appendMailbox(vmime::create <vmime::mailbox>("recipient@test.vmime.org"));
+
+		vmime::ref <SMTPAsyncClient::delivery> d1 = client->send
+			(msg1, vmime::mailbox("expeditor@test.vmime.org"), recips);
+		vmime::ref <SMTPAsyncClient::delivery> d2 = client->send
+			(msg2, vmime::mailbox("expeditor@test.vmime.org"), recips);
+
+		vmime::string out;
+
+		sok->localSend("220 test.vmime.org Service ready\r\n");
+		client->onReadable();
+		client->onWritable();
+		sok->localReceive(out);
+
+		sok->localSend("250-test.vmime.org\r\n250-SIZE 1000000\r\n250 8BITMIME\r\n");
+		client->onReadable();
+		client->onWritable();
+		sok->localReceive(out);
+
+		// Size is exact, and 8-bit content is declared
+		std::ostringstream expected;
+		expected << "MAIL FROM:<expeditor@test.vmime.org> SIZE="
+		         << generated.length() << " BODY=8BITMIME\r\n";
+
+		VASSERT_EQ("MAIL 1", expected.str(), out);
+
+		sok->localSend("250 OK\r\n");
+		client->onReadable();
+		client->onWritable();
+		sok->localReceive(out);
+
+		sok->localSend("250 OK\r\n");
+		client->onReadable();
+		client->onWritable();
+		sok->localReceive(out);
+
+		VASSERT_EQ("DATA 1", "DATA\r\n", out);
+
+		sok->localSend("354 Go ahead\r\n");
+		client->onReadable();
+		client->onWritable();
+		sok->localReceive(out);
+
+		VASSERT_EQ("Data 1", generated + "\r\n.\r\n", out);
+
+		sok->localSend("250 Message accepted\r\n");
+		client->onReadable();
+
+		VASSERT_TRUE("Sent 1", d1->sent);
+
+		client->onWritable();
+		sok->localReceive(out);
+
+		// 7-bit message has no body type
+		VASSERT_EQ("RSET", "RSET\r\n", out.substr(0, 6));
+		VASSERT_EQ("No BODY", vmime::string::npos, out.find("BODY="));
+		VASSERT_FALSE("Not sent 2", d2->done);
+	}
+
+VMIME_TEST_SUITE_END
+
+
+
+/** SMTP test server without PIPELINING, which rejects the recipient
+  * "rejected@test.vmime.org", and records commands and message data.
+  */
+class asyncSMTPTestSocket : public lineBasedTestSocket
+{
+public:
+
+	asyncSMTPTestSocket()
+		: m_inData(false)
+	{
+	}
+
+	void onConnected()
+	{
+		localSend("220 test.vmime.org Service ready\r\n");
+		processCommand();
+	}
+
+	void processCommand()
+	{
+		if (!haveMoreLines())
+			return;
+
+		const vmime::string line = getNextLine();
+
+		if (m_inData)
+		{
+			if (line == ".")
+			{
+				localSend("250 Message accepted for delivery\r\n");
+				m_inData = false;
+			}
+			else
+			{
+				receivedData += line + "\r\n";
+			}
+		}
+		else
+		{
+			receivedCommands.push_back(line);
+
+			std::istringstream iss(line);
+			vmime::string cmd;
+			iss >> cmd;
+
+			if (cmd == "EHLO")
+			{
+				localSend("250 test.vmime.org\r\n");
+			}
+			else if (cmd == "MAIL" || cmd == "RSET")
+			{
+				localSend("250 OK\r\n");
+			}
+			else if (cmd == "RCPT")
+			{
+				if (line.find("<rejected@") != vmime::string::npos)
+					localSend("550 No such user\r\n");
+				else
+					localSend("250 OK, recipient accepted\r\n");
+			}
+			else if (cmd == "DATA")
+			{
+				localSend("354 Ready to accept data; end with <CRLF>.<CRLF>\r\n");
+				m_inData = true;
+			}
+			else if (cmd == "QUIT")
+			{
+				localSend("221 test.vmime.org Service closing transmission channel\r\n");
+			}
+			else
+			{
+				localSend("502 Command not implemented\r\n");
+			}
+		}
+
+		processCommand();
+	}
+
+private:
+
+	bool m_inData;
+};
@@ -41,11 +41,14 @@ VMIME_TEST_SUITE_BEGIN(SMTPCommandTest)
 		VMIME_TEST(testMAIL)
 		VMIME_TEST(testMAIL_Encoded)
 		VMIME_TEST(testMAIL_UTF8)
+		VMIME_TEST(testMAIL_SIZE)
+		VMIME_TEST(testMAIL_BODY)
 		VMIME_TEST(testRCPT)
 		VMIME_TEST(testRCPT_Encoded)
 		VMIME_TEST(testRCPT_UTF8)
 		VMIME_TEST(testRSET)
 		VMIME_TEST(testDATA)
+		VMIME_TEST(testBDAT)
 		VMIME_TEST(testNOOP)
 		VMIME_TEST(testQUIT)
 		VMIME_TEST(testWriteToSocket)
@@ -126,6 +129,24 @@ VMIME_TEST_SUITE_BEGIN(SMTPCommandTest)
 		VASSERT_EQ("Text", "MAIL FROM:<mailtest@例え.テスト> SMTPUTF8", cmd->getText());
 	}
 
+	void testMAIL_SIZE()
+	{
+		vmime::ref <SMTPCommand> cmd = SMTPCommand::MAIL
+			(vmime::mailbox("me@vmime.org"), false, 123456789);
+
+		VASSERT_NOT_NULL("Not null", cmd);
+		VASSERT_EQ("Text", "MAIL FROM:<me@vmime.org> SIZE=123456789", cmd->getText());
+	}
+
+	void testMAIL_BODY()
+	{
+		vmime::ref <SMTPCommand> cmd = SMTPCommand::MAIL
+			(vmime::mailbox("me@vmime.org"), false, 42, "BINARYMIME");
+
+		VASSERT_NOT_NULL("Not null", cmd);
+		VASSERT_EQ("Text", "MAIL FROM:<me@vmime.org> SIZE=42 BODY=BINARYMIME", cmd->getText());
+	}
+
 	void testRCPT()
 	{
 		vmime::ref <SMTPCommand> cmd = SMTPCommand::RCPT(vmime::mailbox("someone@vmime.org"), false);
@@ -168,6 +189,19 @@ VMIME_TEST_SUITE_BEGIN(SMTPCommandTest)
 		VASSERT_EQ("Text", "DATA", cmd->getText());
 	}
 
+	void testBDAT()
+	{
+		vmime::ref <SMTPCommand> cmd1 = SMTPCommand::BDAT(12345, false);
+
+		VASSERT_NOT_NULL("Not null", cmd1);
+		VASSERT_EQ("Text", "BDAT 12345", cmd1->getText());
+
+		vmime::ref <SMTPCommand> cmd2 = SMTPCommand::BDAT(67890, true);
+
+		VASSERT_NOT_NULL("Not null", cmd2);
+		VASSERT_EQ("Text", "BDAT 67890 LAST", cmd2->getText());
+	}
+
 	void testNOOP()
 	{
 		vmime::ref <SMTPCommand> cmd = SMTPCommand::NOOP();
@@ -35,6 +35,7 @@ VMIME_TEST_SUITE_BEGIN(SMTPResponseTest)
 		VMIME_TEST(testMultiLineResponseDifferentCode)
 		VMIME_TEST(testIncompleteMultiLineResponse)
 		VMIME_TEST(testNoResponseText)
+		VMIME_TEST(testParseResponse)
 	VMIME_TEST_LIST_END
 
 
@@ -172,5 +173,35 @@ VMIME_TEST_SUITE_BEGIN(SMTPResponseTest)
 	}
 
 
+	void testParseResponse()
+	{
+		vmime::net::smtp::SMTPResponse::state responseState;
+		responseState.responseBuffer = "250-Line 1\r\n250-Line";
+
+		VASSERT_NULL("Incomplete response",
+			vmime::net::smtp::SMTPResponse::parseResponse(responseState));
+
+		responseState.responseBuffer += " 2\r\n250 Line 3\r\n354 Next";
+
+		vmime::ref <vmime::net::smtp::SMTPResponse> resp =
+			vmime::net::smtp::SMTPResponse::parseResponse(responseState);
+
+		VASSERT_NOT_NULL("Response", resp);
+		VASSERT_EQ("Code", 250, resp->getCode());
+		VASSERT_EQ("Lines", 3, resp->getLineCount());
+		VASSERT_EQ("Text", "Line 1\nLine 2\nLine 3", resp->getText());
+
+		// Next response is kept in the buffer
+		VASSERT_EQ("Buffer", "354 Next", responseState.responseBuffer);
+
+		responseState.responseBuffer += "\n";
+
+		resp = vmime::net::smtp::SMTPResponse::parseResponse(responseState);
+
+		VASSERT_NOT_NULL("Next response", resp);
+		VASSERT_EQ("Next code", 354, resp->getCode());
+		VASSERT_EQ("Empty buffer", "", responseState.responseBuffer);
+	}
+
 VMIME_TEST_SUITE_END
 
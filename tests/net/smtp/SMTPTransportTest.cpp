@@ -26,6 +26,33 @@
 
 class greetingErrorSMTPTestSocket;
 class MAILandRCPTSMTPTestSocket;
+class DATASMTPTestSocket;
+class CHUNKINGSMTPTestSocket;
+class BATCHSMTPTestSocket;
+
+
+// MAIL command and message data received by the DATA and BDAT test servers
+static vmime::string receivedMAILCommand;
+static vmime::string receivedData;
+
+// BDAT commands received by the BDAT test server
+static std::vector <vmime::string> receivedBDATCommands;
+
+// Messages and RSET commands received by the batch test server
+static std::vector <vmime::string> receivedMessages;
+static int receivedRSETCount;
+
+
+// Input stream which fails when it is read
+class failingInputStream : public vmime::utility::inputStream
+{
+public:
+
+	bool eof() const { return false; }
+	void reset() { }
+	size_type read(value_type* const /* data */, const size_type /* count */) { throw vmime::exception("Read error"); }
+	size_type skip(const size_type /* count */) { throw vmime::exception("Read error"); }
+};
 
 
 VMIME_TEST_SUITE_BEGIN(SMTPTransportTest)
@@ -33,6 +60,11 @@ VMIME_TEST_SUITE_BEGIN(SMTPTransportTest)
 	VMIME_TEST_LIST_BEGIN
 		VMIME_TEST(testGreetingError)
 		VMIME_TEST(testMAILandRCPT)
+		VMIME_TEST(testSendMessage)
+		VMIME_TEST(testSendMessageUnbuffered)
+		VMIME_TEST(testSendMessageChunking)
+		VMIME_TEST(testSendMessageGenerationError)
+		VMIME_TEST(testSendBatch)
 	VMIME_TEST_LIST_END
 
 
@@ -77,6 +109,269 @@ VMIME_TEST_SUITE_BEGIN(SMTPTransportTest)
 		tr->send(exp, recips, is, 0);
 	}
 
+	void testSendMessage()
+	{
+		vmime::ref <vmime::net::session> session =
+			vmime::create <vmime::net::session>();
+
+		vmime::ref <vmime::net::transport> tr = session->getTransport
+			(vmime::utility::url("smtp://localhost"));
+
+		tr->setSocketFactory(vmime::create <testSocketFactory <DATASMTPTestSocket> >());
+		tr->setTimeoutHandlerFactory(vmime::create <testTimeoutHandlerFactory>());
+
+		vmime::ref <vmime::message> msg = vmime::create <vmime::message>();
+		msg->parse("From: expeditor@test.vmime.org\r\n"
+		           "To: recipient@test.vmime.org\r\n"
+		           "Date: Mon, 7 Feb 1994 21:52:25 -0800\r\n"
+		           "Message-Id: <42@test.vmime.org>\r\n"
+		           "Mime-Version: 1.0\r\n"
+		           "\r\n"
+		           "Line 1\r\n"
+		           ".Line 2\r\n");
+
+		std::ostringstream oss;
+		vmime::utility::outputStreamAdapter os(oss);
+		msg->generate(os);
+
+		receivedMAILCommand.clear();
+		receivedData.clear();
+
+		tr->connect();
+		tr->send(msg);
+		tr->disconnect();
+
+		// Message size is declared, and data is dot-stuffed
+		std::ostringstream expectedMAIL;
+		expectedMAIL << "MAIL FROM:<expeditor@test.vmime.org> SIZE=" << oss.str().length();
+
+		VASSERT_EQ("MAIL", expectedMAIL.str(), receivedMAILCommand);
+		VASSERT_EQ("Data", oss.str() + "\r\n", receivedData);
+		VASSERT("Dot-stuffing", oss.str().find("\r\n.Line 2") != vmime::string::npos);
+	}
+
+	void testSendMessageUnbuffered()
+	{
+		vmime::ref <vmime::net::session> session =
+			vmime::create <vmime::net::session>();
+
+		vmime::ref <vmime::net::transport> tr = session->getTransport
+			(vmime::utility::url("smtp://localhost"));
+
+		tr->setSocketFactory(vmime::create <testSocketFactory <DATASMTPTestSocket> >());
+		tr->setTimeoutHandlerFactory(vmime::create <testTimeoutHandlerFactory>());
+
+		// Quoted-printable body, read from a stream which cannot be reset
+		const vmime::string data = "Caf\xe9\r\n";
+
+		vmime::ref <vmime::message> msg = vmime::create <vmime::message>();
+		msg->parse("From: expeditor@test.vmime.org\r\n"
+		           "To: recipient@test.vmime.org\r\n"
+		           "\r\n");
+		msg->getBody()->setContents(vmime::create <vmime::streamContentHandler>
+			(vmime::create <testOneShotInputStream>(data).dynamicCast <vmime::utility::inputStream>(),
+			 data.length()));
+		msg->getBody()->setEncoding(vmime::encoding(vmime::encodingTypes::QUOTED_PRINTABLE));
+
+		receivedMAILCommand.clear();
+		receivedData.clear();
+
+		tr->connect();
+		tr->send(msg);
+		tr->disconnect();
+
+		// Data is read only once, to be sent: its size is not declared
+		VASSERT_EQ("MAIL", "MAIL FROM:<expeditor@test.vmime.org>", receivedMAILCommand);
+		VASSERT("Data", receivedData.find("\r\n\r\nCaf=E9=0D=0A") != vmime::string::npos);
+	}
+
+	template <typename SERVER_SOCKET>
+	void doSendMessageGenerationError()
+	{
+		vmime::ref <vmime::net::session> session =
+			vmime::create <vmime::net::session>();
+
+		vmime::ref <vmime::net::transport> tr = session->getTransport
+			(vmime::utility::url("smtp://localhost"));
+
+		tr->setSocketFactory(vmime::create <testSocketFactory <SERVER_SOCKET> >());
+		tr->setTimeoutHandlerFactory(vmime::create <testTimeoutHandlerFactory>());
+
+		vmime::ref <vmime::message> msg = vmime::create <vmime::message>();
+		msg->parse("From: expeditor@test.vmime.org\r\n"
+		           "To: recipient@test.vmime.org\r\n"
+		           "\r\n");
+		msg->getBody()->setContents(vmime::create <vmime::streamContentHandler>
+			(vmime::create <failingInputStream>().template dynamicCast <vmime::utility::inputStream>(), 100));
+
+		tr->connect();
+
+		VASSERT_THROW("Send", tr->send(msg), vmime::exception);
+
+		// The server is still waiting for message data: the
+		// connection cannot be used any more
+		VASSERT_FALSE("Connected", tr->isConnected());
+	}
+
+	void testSendMessageGenerationError()
+	{
+		doSendMessageGenerationError <DATASMTPTestSocket>();
+		doSendMessageGenerationError <CHUNKINGSMTPTestSocket>();
+	}
+
+	void testSendMessageChunking()
+	{
+		vmime::ref <vmime::net::session> session =
+			vmime::create <vmime::net::session>();
+
+		vmime::ref <vmime::net::transport> tr = session->getTransport
+			(vmime::utility::url("smtp://localhost"));
+
+		tr->setSocketFactory(vmime::create <testSocketFactory <CHUNKINGSMTPTestSocket> >());
+		tr->setTimeoutHandlerFactory(vmime::create <testTimeoutHandlerFactory>());
+
+		// Binary body, bigger than a chunk, with lines starting with a dot
+		vmime::string data;
+
+		for (int i = 0 ; i < 70000 ; ++i)
+			data += static_cast <char>(i % 256);
+
+		data += "\r\n.\r\n";
+
+		vmime::ref <vmime::message> msg = vmime::create <vmime::message>();
+		msg->parse("From: expeditor@test.vmime.org\r\n"
+		           "To: recipient@test.vmime.org\r\n"
+		           "Date: Mon, 7 Feb 1994 21:52:25 -0800\r\n"
+		           "Message-Id: <43@test.vmime.org>\r\n"
+		           "Mime-Version: 1.0\r\n"
+		           "Content-Type: application/octet-stream\r\n"
+		           "Content-Transfer-Encoding: binary\r\n"
+		           "\r\n" + data);
+
+		std::ostringstream oss;
+		vmime::utility::outputStreamAdapter os(oss);
+		msg->generate(os);
+
+		const vmime::string generated = oss.str();
+
+		receivedMAILCommand.clear();
+		receivedData.clear();
+		receivedBDATCommands.clear();
+
+		tr->connect();
+		tr->send(msg);
+		tr->disconnect();
+
+		// Binary body is declared, and data is sent as is
+		std::ostringstream expectedMAIL;
+		expectedMAIL << "MAIL FROM:<expeditor@test.vmime.org> SIZE="
+		             << generated.length() << " BODY=BINARYMIME";
+
+		VASSERT_EQ("MAIL", expectedMAIL.str(), receivedMAILCommand);
+		VASSERT_EQ("Data", generated, receivedData);
+
+		std::ostringstream lastBDAT;
+		lastBDAT << "BDAT " << (generated.length() - 2 * 32768) << " LAST";
+
+		VASSERT_EQ("BDAT count", 3, static_cast <int>(receivedBDATCommands.size()));
+		VASSERT_EQ("BDAT 1", "BDAT 32768", receivedBDATCommands[0]);
+		VASSERT_EQ("BDAT 2", "BDAT 32768", receivedBDATCommands[1]);
+		VASSERT_EQ("BDAT 3", lastBDAT.str(), receivedBDATCommands[2]);
+	}
+
+	void testSendBatch()
+	{
+		vmime::ref <vmime::net::session> session =
+			vmime::create <vmime::net::session>();
+
+		vmime::ref <vmime::net::transport> tr = session->getTransport
+			(vmime::utility::url("smtp://localhost"));
+
+		tr->setSocketFactory(vmime::create <testSocketFactory <BATCHSMTPTestSocket> >());
+		tr->setTimeoutHandlerFactory(vmime::create <testTimeoutHandlerFactory>());
+
+		std::vector <vmime::net::transport::messageToSend> msgs;
+
+		// Envelope extracted from the message; one recipient is rejected
+		vmime::ref <vmime::message> msg1 = vmime::create <vmime::message>();
+		msg1->parse("From: expeditor@test.vmime.org\r\n"
+		            "To: recipient1@test.vmime.org, rejected@test.vmime.org\r\n"
+		            "Bcc: hidden@test.vmime.org\r\n"
+		            "Subject: Message 1\r\n"
+		            "\r\n"
+		            "Body 1\r\n");
+
+		msgs.push_back(vmime::net::transport::messageToSend(msg1));
+
+		// Expeditor is refused by the server
+		vmime::ref <vmime::message> msg2 = vmime::create <vmime::message>();
+		msg2->parse("Subject: Message 2\r\n\r\nBody 2\r\n");
+
+		vmime::mailboxList recips2;
+		recips2.appendMailbox(vmime::create <vmime::mailbox>("recipient2@test.vmime.org"));
+
+		msgs.push_back(vmime::net::transport::messageToSend
+			(msg2, vmime::mailbox("refused@test.vmime.org"), recips2));
+
+		// All recipients are rejected
+		vmime::ref <vmime::message> msg3 = vmime::create <vmime::message>();
+		msg3->parse("Subject: Message 3\r\n\r\nBody 3\r\n");
+
+		vmime::mailboxList recips3;
+		recips3.appendMailbox(vmime::create <vmime::mailbox>("rejected@test.vmime.org"));
+
+		msgs.push_back(vmime::net::transport::messageToSend
+			(msg3, vmime::mailbox("expeditor@test.vmime.org"), recips3));
+
+		// Explicit envelope
+		vmime::ref <vmime::message> msg4 = vmime::create <vmime::message>();
+		msg4->parse("Subject: Message 4\r\n\r\nBody 4\r\n");
+
+		vmime::mailboxList recips4;
+		recips4.appendMailbox(vmime::create <vmime::mailbox>("recipient4@test.vmime.org"));
+
+		msgs.push_back(vmime::net::transport::messageToSend
+			(msg4, vmime::mailbox("expeditor@test.vmime.org"), recips4));
+
+		receivedMessages.clear();
+		receivedRSETCount = 0;
+
+		tr->connect();
+		tr->sendBatch(msgs);
+
+		VASSERT_TRUE("Connected", tr->isConnected());
+
+		tr->disconnect();
+
+		VASSERT_TRUE("Sent 1", msgs[0].sent);
+		VASSERT_EQ("Recipients 1", 3, static_cast <int>(msgs[0].recipientStatuses.size()));
+		VASSERT_TRUE("Accepted 1.1", msgs[0].recipientStatuses[0].accepted);
+		VASSERT_FALSE("Accepted 1.2", msgs[0].recipientStatuses[1].accepted);
+		VASSERT_EQ("Response 1.2", "No such user", msgs[0].recipientStatuses[1].response);
+		VASSERT_TRUE("Accepted 1.3", msgs[0].recipientStatuses[2].accepted);
+
+		VASSERT_FALSE("Sent 2", msgs[1].sent);
+		VASSERT_EQ("Error 2", "Sender refused", msgs[1].error);
+		VASSERT_FALSE("Accepted 2.1", msgs[1].recipientStatuses[0].accepted);
+
+		VASSERT_FALSE("Sent 3", msgs[2].sent);
+		VASSERT_FALSE("Error 3", msgs[2].error.empty());
+
+		VASSERT_TRUE("Sent 4", msgs[3].sent);
+		VASSERT_TRUE("Error 4", msgs[3].error.empty());
+
+		// Only accepted messages are transferred, and the server state
+		// is reset between messages
+		VASSERT_EQ("Message count", 2, static_cast <int>(receivedMessages.size()));
+		VASSERT("Message 1", receivedMessages[0].find("Body 1") != vmime::string::npos);
+		VASSERT("Message 4", receivedMessages[1].find("Body 4") != vmime::string::npos);
+		VASSERT_EQ("RSET count", 3, receivedRSETCount);
+
+		// "Bcc" field is not transmitted, but the original header is restored
+		VASSERT("Bcc sent", receivedMessages[0].find("Bcc:") == vmime::string::npos);
+		VASSERT_TRUE("Bcc restored", msg1->getHeader()->hasField(vmime::fields::BCC));
+	}
+
 VMIME_TEST_SUITE_END
 
 
@@ -250,3 +545,324 @@ private:
 };
 
 
+/** SMTP test server which supports the SIZE extension, and
+  * records the MAIL command and the message data.
+  */
+class DATASMTPTestSocket : public lineBasedTestSocket
+{
+public:
+
+	DATASMTPTestSocket()
+		: m_inData(false)
+	{
+	}
+
+	void onConnected()
+	{
+		localSend("220 test.vmime.org Service ready\r\n");
+		processCommand();
+	}
+
+	void processCommand()
+	{
+		if (!haveMoreLines())
+			return;
+
+		const vmime::string line = getNextLine();
+
+		if (m_inData)
+		{
+			if (line == ".")
+			{
+				localSend("250 Message accepted for delivery\r\n");
+				m_inData = false;
+			}
+			else
+			{
+				VASSERT("Dot-stuffed", line.empty() || line[0] != '.' || line[1] == '.');
+
+				// Remove dot-stuffing
+				receivedData += (line.length() >= 2 && line[0] == '.' ? line.substr(1) : line) + "\r\n";
+			}
+		}
+		else
+		{
+			std::istringstream iss(line);
+			vmime::string cmd;
+			iss >> cmd;
+
+			if (cmd == "EHLO")
+			{
+				localSend("250-test.vmime.org\r\n");
+				localSend("250 SIZE 1000000\r\n");
+			}
+			else if (cmd == "MAIL")
+			{
+				receivedMAILCommand = line;
+				localSend("250 OK\r\n");
+			}
+			else if (cmd == "RCPT")
+			{
+				localSend("250 OK, recipient accepted\r\n");
+			}
+			else if (cmd == "DATA")
+			{
+				localSend("354 Ready to accept data; end with <CRLF>.<CRLF>\r\n");
+				m_inData = true;
+			}
+			else if (cmd == "QUIT")
+			{
+				localSend("221 test.vmime.org Service closing transmission channel\r\n");
+			}
+			else
+			{
+				localSend("502 Command not implemented\r\n");
+			}
+		}
+
+		processCommand();
+	}
+
+private:
+
+	bool m_inData;
+};
+
+
+/** SMTP test server which supports CHUNKING and BINARYMIME: message
+  * data is received with BDAT commands.
+  */
+class CHUNKINGSMTPTestSocket : public testSocket
+{
+public:
+
+	CHUNKINGSMTPTestSocket()
+		: m_chunkRemaining(0), m_lastChunk(false)
+	{
+	}
+
+	void onConnected()
+	{
+		localSend("220 test.vmime.org Service ready\r\n");
+	}
+
+	void onDataReceived()
+	{
+		vmime::string chunk;
+		localReceive(chunk);
+
+		m_buffer += chunk;
+
+		while (!m_buffer.empty())
+		{
+			// Chunk data
+			if (m_chunkRemaining > 0)
+			{
+				const vmime::string::size_type n = std::min(m_chunkRemaining, m_buffer.length());
+
+				receivedData += m_buffer.substr(0, n);
+				m_buffer.erase(0, n);
+
+				if ((m_chunkRemaining -= n) == 0)
+					acceptChunk();
+
+				continue;
+			}
+
+			const vmime::string::size_type eol = m_buffer.find("\r\n");
+
+			if (eol == vmime::string::npos)
+				break;
+
+			const vmime::string line = m_buffer.substr(0, eol);
+			m_buffer.erase(0, eol + 2);
+
+			processCommand(line);
+		}
+	}
+
+private:
+
+	void processCommand(const vmime::string& line)
+	{
+		std::istringstream iss(line);
+		vmime::string cmd;
+		iss >> cmd;
+
+		if (cmd == "EHLO")
+		{
+			localSend("250-test.vmime.org\r\n");
+			localSend("250-PIPELINING\r\n");
+			localSend("250-SIZE 1000000\r\n");
+			localSend("250-8BITMIME\r\n");
+			localSend("250-CHUNKING\r\n");
+			localSend("250 BINARYMIME\r\n");
+		}
+		else if (cmd == "MAIL")
+		{
+			receivedMAILCommand = line;
+			localSend("250 OK\r\n");
+		}
+		else if (cmd == "RCPT")
+		{
+			localSend("250 OK, recipient accepted\r\n");
+		}
+		else if (cmd == "BDAT")
+		{
+			receivedBDATCommands.push_back(line);
+
+			vmime::string last;
+			iss >> m_chunkRemaining >> last;
+
+			m_lastChunk = (last == "LAST");
+
+			if (m_chunkRemaining == 0)
+				acceptChunk();
+		}
+		else if (cmd == "QUIT")
+		{
+			localSend("221 test.vmime.org Service closing transmission channel\r\n");
+		}
+		else
+		{
+			localSend("502 Command not implemented\r\n");
+		}
+	}
+
+	void acceptChunk()
+	{
+		if (m_lastChunk)
+			localSend("250 Message accepted for delivery\r\n");
+		else
+			localSend("250 Chunk accepted\r\n");
+	}
+
+
+	vmime::string m_buffer;
+
+	vmime::string::size_type m_chunkRemaining;
+	bool m_lastChunk;
+};
+
+
+/** SMTP test server which supports PIPELINING, refuses the expeditor
+  * "refused@test.vmime.org" and the recipient "rejected@test.vmime.org",
+  * and records the received messages.
+  */
+class BATCHSMTPTestSocket : public lineBasedTestSocket
+{
+public:
+
+	BATCHSMTPTestSocket()
+		: m_inData(false), m_mailAccepted(false), m_acceptedRecipients(0)
+	{
+	}
+
+	void onConnected()
+	{
+		localSend("220 test.vmime.org Service ready\r\n");
+		processCommand();
+	}
+
+	void processCommand()
+	{
+		if (!haveMoreLines())
+			return;
+
+		const vmime::string line = getNextLine();
+
+		if (m_inData)
+		{
+			if (line == ".")
+			{
+				receivedMessages.push_back(m_msgData);
+				localSend("250 Message accepted for delivery\r\n");
+				m_inData = false;
+			}
+			else
+			{
+				m_msgData += line + "\r\n";
+			}
+		}
+		else
+		{
+			std::istringstream iss(line);
+			vmime::string cmd;
+			iss >> cmd;
+
+			if (cmd == "EHLO")
+			{
+				localSend("250-test.vmime.org\r\n");
+				localSend("250-SIZE 1000000\r\n");
+				localSend("250 PIPELINING\r\n");
+			}
+			else if (cmd == "RSET")
+			{
+				++receivedRSETCount;
+
+				m_mailAccepted = false;
+				m_acceptedRecipients = 0;
+
+				localSend("250 OK\r\n");
+			}
+			else if (cmd == "MAIL")
+			{
+				m_mailAccepted = (line.find("<refused@") == vmime::string::npos);
+				m_acceptedRecipients = 0;
+
+				if (m_mailAccepted)
+					localSend("250 OK\r\n");
+				else
+					localSend("550 Sender refused\r\n");
+			}
+			else if (cmd == "RCPT")
+			{
+				if (!m_mailAccepted)
+				{
+					localSend("503 Bad sequence of commands\r\n");
+				}
+				else if (line.find("<rejected@") != vmime::string::npos)
+				{
+					localSend("550 No such user\r\n");
+				}
+				else
+				{
+					++m_acceptedRecipients;
+					localSend("250 OK, recipient accepted\r\n");
+				}
+			}
+			else if (cmd == "DATA")
+			{
+				if (!m_mailAccepted || m_acceptedRecipients == 0)
+				{
+					localSend("554 No valid recipients\r\n");
+				}
+				else
+				{
+					localSend("354 Ready to accept data; end with <CRLF>.<CRLF>\r\n");
+
+					m_msgData.clear();
+					m_inData = true;
+				}
+			}
+			else if (cmd == "QUIT")
+			{
+				localSend("221 test.vmime.org Service closing transmission channel\r\n");
+			}
+			else
+			{
+				localSend("502 Command not implemented\r\n");
+			}
+		}
+
+		processCommand();
+	}
+
+private:
+
+	bool m_inData;
+	bool m_mailAccepted;
+	int m_acceptedRecipients;
+
+	vmime::string m_msgData;
+};
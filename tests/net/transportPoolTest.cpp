@@ -0,0 +1,342 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002-2013 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+#include "tests/testUtils.hpp"
+
+#include "vmime/net/transportPool.hpp"
+
+
+class poolSMTPTestSocket;
+
+
+// Number of connections, messages and bytes of message data
+// received by the test server
+static int serverConnectionCount;
+static int serverMessageCount;
+static int serverDataBytes;
+
+
+// Input stream which fails when it is read
+template <typename E>
+class failingInputStream : public vmime::utility::inputStream
+{
+public:
+
+	bool eof() const { return false; }
+	void reset() { }
+	size_type read(value_type* const /* data */, const size_type /* count */) { throw E("Read error"); }
+	size_type skip(const size_type /* count */) { throw E("Read error"); }
+};
+
+
+class testPoolListener : public vmime::net::transportPool::listener
+{
+public:
+
+	void messageProcessed(const vmime::net::transport::messageToSend& msg)
+	{
+		if (msg.sent)
+			sent.push_back(msg.msg);
+		else
+			errors.push_back(msg.error);
+	}
+
+	std::vector <vmime::ref <vmime::message> > sent;
+	std::vector <vmime::string> errors;
+};
+
+
+VMIME_TEST_SUITE_BEGIN(transportPoolTest)
+
+	VMIME_TEST_LIST_BEGIN
+		VMIME_TEST(testProcessQueue)
+		VMIME_TEST(testRecycleConnections)
+		VMIME_TEST(testFailedMessage)
+		VMIME_TEST(testFailedTransaction)
+		VMIME_TEST(testUnexpectedException)
+	VMIME_TEST_LIST_END
+
+
+	static vmime::ref <vmime::message> createMessage(const vmime::string& to)
+	{
+		vmime::ref <vmime::message> msg = vmime::create <vmime::message>();
+		msg->parse("From: expeditor@test.vmime.org\r\n"
+		           "To: " + to + "\r\n"
+		           "Date: Mon, 7 Feb 1994 21:52:25 -0800\r\n"
+		           "Message-Id: <42@test.vmime.org>\r\n"
+		           "\r\n"
+		           "Message body\r\n");
+
+		return msg;
+	}
+
+	// Create a message whose body cannot be read
+	template <typename E>
+	static vmime::ref <vmime::message> createFailingMessage()
+	{
+		vmime::ref <vmime::message> msg = createMessage("recipient@test.vmime.org");
+
+		msg->getBody()->setContents(vmime::create <vmime::streamContentHandler>
+			(vmime::create <failingInputStream <E> >().template dynamicCast <vmime::utility::inputStream>(), 100));
+
+		return msg;
+	}
+
+	static vmime::ref <vmime::net::transportPool> createPool(const unsigned int maxConnections)
+	{
+		vmime::ref <vmime::net::transportPool> pool = vmime::create <vmime::net::transportPool>
+			(vmime::create <vmime::net::session>(), vmime::utility::url("smtp://localhost"), maxConnections);
+
+		pool->setSocketFactory(vmime::create <testSocketFactory <poolSMTPTestSocket> >());
+		pool->setTimeoutHandlerFactory(vmime::create <testTimeoutHandlerFactory>());
+
+		return pool;
+	}
+
+	void testProcessQueue()
+	{
+		vmime::ref <vmime::net::transportPool> pool = createPool(2);
+
+		testPoolListener listener;
+		pool->addListener(&listener);
+
+		serverConnectionCount = 0;
+		serverMessageCount = 0;
+		serverDataBytes = 0;
+
+		for (int i = 0 ; i < 5 ; ++i)
+			pool->enqueue(createMessage("recipient@test.vmime.org"));
+
+		VASSERT_EQ("Queue size", 5, static_cast <int>(pool->getQueueSize()));
+
+		pool->processQueue();
+
+		VASSERT_EQ("Queue size", 0, static_cast <int>(pool->getQueueSize()));
+		VASSERT_EQ("Sent", 5, static_cast <int>(listener.sent.size()));
+		VASSERT_EQ("Errors", 0, static_cast <int>(listener.errors.size()));
+
+		// The same connection is used for all messages, and kept open
+		VASSERT_EQ("Server connections", 1, serverConnectionCount);
+		VASSERT_EQ("Server messages", 5, serverMessageCount);
+		VASSERT_EQ("Open connections", 1, static_cast <int>(pool->getConnectionCount()));
+
+		const vmime::net::transportPool::statistics stats = pool->getStatistics();
+
+		VASSERT_EQ("Sent count", 5, static_cast <int>(stats.sentCount));
+		VASSERT_EQ("Failed count", 0, static_cast <int>(stats.failedCount));
+		VASSERT_EQ("Connection count", 1, static_cast <int>(stats.connectionCount));
+		VASSERT_EQ("Sent bytes", serverDataBytes, static_cast <int>(stats.sentBytes));
+
+		pool->disconnect();
+
+		VASSERT_EQ("Open connections", 0, static_cast <int>(pool->getConnectionCount()));
+	}
+
+	void testRecycleConnections()
+	{
+		vmime::ref <vmime::net::transportPool> pool = createPool(2);
+		pool->setMaxMessagesPerConnection(2);
+
+		serverConnectionCount = 0;
+		serverMessageCount = 0;
+
+		for (int i = 0 ; i < 5 ; ++i)
+			pool->enqueue(createMessage("recipient@test.vmime.org"));
+
+		// At most two messages are sent on a connection
+		VASSERT_TRUE("Process 1", pool->processNext());
+		VASSERT_EQ("Queue size", 3, static_cast <int>(pool->getQueueSize()));
+
+		pool->processQueue();
+
+		VASSERT_EQ("Server connections", 3, serverConnectionCount);
+		VASSERT_EQ("Server messages", 5, serverMessageCount);
+		VASSERT_EQ("Connection count", 3, static_cast <int>(pool->getStatistics().connectionCount));
+		VASSERT_EQ("Open connections", 1, static_cast <int>(pool->getConnectionCount()));
+
+		VASSERT_FALSE("Process empty queue", pool->processNext());
+	}
+
+	void testFailedMessage()
+	{
+		vmime::ref <vmime::net::transportPool> pool = createPool(1);
+
+		testPoolListener listener;
+		pool->addListener(&listener);
+
+		serverConnectionCount = 0;
+		serverMessageCount = 0;
+
+		pool->enqueue(createMessage("rejected@test.vmime.org"));
+		pool->enqueue(createMessage("recipient@test.vmime.org"));
+
+		pool->processQueue();
+
+		VASSERT_EQ("Sent", 1, static_cast <int>(listener.sent.size()));
+		VASSERT_EQ("Errors", 1, static_cast <int>(listener.errors.size()));
+
+		const vmime::net::transportPool::statistics stats = pool->getStatistics();
+
+		VASSERT_EQ("Sent count", 1, static_cast <int>(stats.sentCount));
+		VASSERT_EQ("Failed count", 1, static_cast <int>(stats.failedCount));
+
+		// Connection is not lost on failure
+		VASSERT_EQ("Server connections", 1, serverConnectionCount);
+	}
+
+	void testFailedTransaction()
+	{
+		vmime::ref <vmime::net::transportPool> pool = createPool(1);
+
+		testPoolListener listener;
+		pool->addListener(&listener);
+
+		serverConnectionCount = 0;
+		serverMessageCount = 0;
+
+		pool->enqueue(createFailingMessage <vmime::exception>());
+		pool->enqueue(createMessage("recipient@test.vmime.org"));
+
+		pool->processQueue();
+
+		VASSERT_EQ("Sent", 1, static_cast <int>(listener.sent.size()));
+		VASSERT_EQ("Errors", 1, static_cast <int>(listener.errors.size()));
+
+		// The connection was in the middle of message data: it is not
+		// reused, and the next message is sent on a new connection
+		VASSERT_EQ("Server connections", 2, serverConnectionCount);
+		VASSERT_EQ("Server messages", 1, serverMessageCount);
+		VASSERT_EQ("Open connections", 1, static_cast <int>(pool->getConnectionCount()));
+	}
+
+	void testUnexpectedException()
+	{
+		vmime::ref <vmime::net::transportPool> pool = createPool(1);
+
+		pool->enqueue(createFailingMessage <std::runtime_error>());
+
+		VASSERT_THROW("Exception", pool->processQueue(), std::runtime_error);
+
+		// The connection is dropped, and its slot is released
+		VASSERT_EQ("Open connections", 0, static_cast <int>(pool->getConnectionCount()));
+
+		pool->enqueue(createMessage("recipient@test.vmime.org"));
+
+		VASSERT_TRUE("Process", pool->processNext());
+	}
+
+VMIME_TEST_SUITE_END
+
+
+
+/** SMTP test server which rejects the recipient "rejected@test.vmime.org",
+  * and counts connections and received messages.
+  */
+class poolSMTPTestSocket : public lineBasedTestSocket
+{
+public:
+
+	poolSMTPTestSocket()
+		: m_inData(false)
+	{
+	}
+
+	void onConnected()
+	{
+		++serverConnectionCount;
+
+		localSend("220 test.vmime.org Service ready\r\n");
+		processCommand();
+	}
+
+	void processCommand()
+	{
+		if (!haveMoreLines())
+			return;
+
+		const vmime::string line = getNextLine();
+
+		if (m_inData)
+		{
+			if (line == ".")
+			{
+				++serverMessageCount;
+
+				// The last CRLF belongs to the end-of-data sequence
+				serverDataBytes += static_cast <int>(m_data.length()) - 2;
+
+				localSend("250 Message accepted for delivery\r\n");
+				m_inData = false;
+			}
+			else
+			{
+				// Remove dot-stuffing
+				m_data += (!line.empty() && line[0] == '.' ? line.substr(1) : line) + "\r\n";
+			}
+		}
+		else
+		{
+			std::istringstream iss(line);
+			vmime::string cmd;
+			iss >> cmd;
+
+			if (cmd == "EHLO")
+			{
+				localSend("250-test.vmime.org\r\n");
+				localSend("250 PIPELINING\r\n");
+			}
+			else if (cmd == "MAIL" || cmd == "RSET")
+			{
+				localSend("250 OK\r\n");
+			}
+			else if (cmd == "RCPT")
+			{
+				if (line.find("<rejected@") != vmime::string::npos)
+					localSend("550 No such user\r\n");
+				else
+					localSend("250 OK, recipient accepted\r\n");
+			}
+			else if (cmd == "DATA")
+			{
+				localSend("354 Ready to accept data; end with <CRLF>.<CRLF>\r\n");
+				m_inData = true;
+				m_data.clear();
+			}
+			else if (cmd == "QUIT")
+			{
+				localSend("221 test.vmime.org Service closing transmission channel\r\n");
+			}
+			else
+			{
+				localSend("502 Command not implemented\r\n");
+			}
+		}
+
+		processCommand();
+	}
+
+private:
+
+	bool m_inData;
+	vmime::string m_data;
+};
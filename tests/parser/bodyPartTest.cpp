@@ -37,6 +37,8 @@ VMIME_TEST_SUITE_BEGIN(bodyPartTest)
 		VMIME_TEST(testGenerate7bit)
 		VMIME_TEST(testTextUsageForQPEncoding)
 		VMIME_TEST(testParseVeryBigMessage)
+		VMIME_TEST(testGeneratedSize)
+		VMIME_TEST(testGeneratedSizeUnbuffered)
 	VMIME_TEST_LIST_END
 
 
@@ -323,5 +325,91 @@ VMIME_TEST_SUITE_BEGIN(bodyPartTest)
 		VASSERT("2.2", body2Cts.dynamicCast <const vmime::streamContentHandler>() != NULL);
 	}
 
+	void testGeneratedSize()
+	{
+		vmime::generationContext ctx;
+		ctx.setPrologText("This is a multi-part message in MIME format.");
+		ctx.setEpilogText("End of message.");
+
+		// Built message: quoted-printable text and base64 attachment
+		vmime::ref <vmime::plainTextPart> part = vmime::create <vmime::plainTextPart>();
+		part->setText(vmime::create <vmime::stringContentHandler>("Line 1\r\nLine 2\r\n\x89\r\n"));
+
+		vmime::ref <vmime::message> msg = vmime::create <vmime::message>();
+		part->generateIn(msg, msg);
+
+		vmime::string data;
+
+		for (int i = 0 ; i < 1000 ; ++i)
+			data += static_cast <char>(i % 256);
+
+		vmime::ref <vmime::attachment> att = vmime::create <vmime::defaultAttachment>
+			(vmime::create <vmime::stringContentHandler>(data),
+				vmime::mediaType("application/octet-stream"));
+
+		vmime::attachmentHelper::addAttachment(msg, att);
+
+		std::ostringstream oss;
+		vmime::utility::outputStreamAdapter os(oss);
+		msg->generate(ctx, os);
+
+		VASSERT_EQ("1", oss.str().length(), msg->getGeneratedSize(ctx));
+
+		// Parsed message: contents are already encoded
+		vmime::ref <vmime::message> msg2 = vmime::create <vmime::message>();
+		msg2->parse(oss.str());
+
+		std::ostringstream oss2;
+		vmime::utility::outputStreamAdapter os2(oss2);
+		msg2->generate(ctx, os2);
+
+		VASSERT_EQ("2", oss2.str().length(), msg2->getGeneratedSize(ctx));
+
+		// Result is cached, but not beyond a change
+		VASSERT_EQ("3", oss2.str().length(), msg2->getGeneratedSize(ctx));
+
+		vmime::ref <vmime::body> body = msg2->getBody()->getPartAt(1)->getBody();
+		body->setContents(vmime::create <vmime::stringContentHandler>(data + data));
+
+		std::ostringstream oss3;
+		vmime::utility::outputStreamAdapter os3(oss3);
+		msg2->generate(ctx, os3);
+
+		VASSERT_EQ("4", oss3.str().length(), msg2->getGeneratedSize(ctx));
+	}
+
+	void testGeneratedSizeUnbuffered()
+	{
+		vmime::generationContext ctx;
+
+		// Quoted-printable encoded size depends on data
+		const vmime::string data = "Caf\xe9\r\nLine 2\r\n";
+
+		vmime::ref <testOneShotInputStream> is =
+			vmime::create <testOneShotInputStream>(data);
+
+		vmime::ref <vmime::message> msg = vmime::create <vmime::message>();
+		msg->getBody()->setContents(vmime::create <vmime::streamContentHandler>
+			(is.dynamicCast <vmime::utility::inputStream>(), data.length()));
+		msg->getBody()->setEncoding(vmime::encoding(vmime::encodingTypes::QUOTED_PRINTABLE));
+
+		// Data is not read, as it could not be read again
+		VASSERT_FALSE("Exact", msg->isGeneratedSizeExact(ctx));
+		VASSERT("Estimate", msg->getGeneratedSize(ctx) >= data.length());
+		VASSERT_EQ("Not read", 0, static_cast <int>(is->getPosition()));
+
+		std::ostringstream oss;
+		vmime::utility::outputStreamAdapter os(oss);
+		msg->generate(ctx, os);
+
+		// All data has been read during generation
+		VASSERT("Generated", oss.str().find("Caf=E9=0D=0ALine 2=0D=0A") != vmime::string::npos);
+
+		// Buffered data
+		msg->getBody()->setContents(vmime::create <vmime::stringContentHandler>(data));
+
+		VASSERT_TRUE("Exact buffered", msg->isGeneratedSizeExact(ctx));
+	}
+
 VMIME_TEST_SUITE_END
 
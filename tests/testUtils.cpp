@@ -214,6 +214,54 @@ vmime::ref <vmime::net::timeoutHandler> testTimeoutHandlerFactory::create()
 
 
 
+// testOneShotInputStream
+
+testOneShotInputStream::testOneShotInputStream(const vmime::string& data)
+	: m_data(data), m_pos(0)
+{
+}
+
+
+bool testOneShotInputStream::eof() const
+{
+	return m_pos >= m_data.length();
+}
+
+
+void testOneShotInputStream::reset()
+{
+	// Data cannot be read again
+}
+
+
+testOneShotInputStream::size_type testOneShotInputStream::read
+	(value_type* const data, const size_type count)
+{
+	const size_type n = std::min(count, m_data.length() - m_pos);
+
+	std::copy(m_data.begin() + m_pos, m_data.begin() + m_pos + n, data);
+	m_pos += n;
+
+	return n;
+}
+
+
+testOneShotInputStream::size_type testOneShotInputStream::skip(const size_type count)
+{
+	const size_type n = std::min(count, m_data.length() - m_pos);
+	m_pos += n;
+
+	return n;
+}
+
+
+testOneShotInputStream::size_type testOneShotInputStream::getPosition() const
+{
+	return m_pos;
+}
+
+
+
 // Exception helper
 std::ostream& operator<<(std::ostream& os, const vmime::exception& e)
 {
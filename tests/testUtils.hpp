@@ -347,6 +347,29 @@ public:
 };
 
 
+// Input stream which cannot be reset, like data read from a socket,
+// and which records how much data has been read.
+
+class testOneShotInputStream : public vmime::utility::inputStream
+{
+public:
+
+	testOneShotInputStream(const vmime::string& data);
+
+	bool eof() const;
+	void reset();
+	size_type read(value_type* const data, const size_type count);
+	size_type skip(const size_type count);
+
+	size_type getPosition() const;
+
+private:
+
+	vmime::string m_data;
+	vmime::string::size_type m_pos;
+};
+
+
 // Exception helper
 std::ostream& operator<<(std::ostream& os, const vmime::exception& e);
 
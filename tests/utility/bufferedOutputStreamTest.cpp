@@ -0,0 +1,140 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002-2013 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+
+#include "tests/testUtils.hpp"
+
+#include "vmime/utility/bufferedOutputStream.hpp"
+
+
+// Records the size of each write
+class bufferedOutputStreamTestStream : public vmime::utility::outputStream
+{
+public:
+
+	bufferedOutputStreamTestStream() : flushCount(0) { }
+
+	void write(const value_type* const data, const size_type count)
+	{
+		written.append(data, count);
+		writes.push_back(static_cast <int>(count));
+	}
+
+	void flush()
+	{
+		++flushCount;
+	}
+
+	vmime::string written;
+	std::vector <int> writes;
+	int flushCount;
+};
+
+
+VMIME_TEST_SUITE_BEGIN(bufferedOutputStreamTest)
+
+	VMIME_TEST_LIST_BEGIN
+		VMIME_TEST(testSmallWrites)
+		VMIME_TEST(testFullBuffer)
+		VMIME_TEST(testLargeWrite)
+		VMIME_TEST(testFlush)
+	VMIME_TEST_LIST_END
+
+
+	void testSmallWrites()
+	{
+		bufferedOutputStreamTestStream os;
+		vmime::utility::bufferedOutputStream stream(os, 16);
+
+		stream << "From: ";
+		stream << "me";
+		stream << "\r\n";
+
+		VASSERT_EQ("Pending", 10u, stream.getPendingSize());
+		VASSERT_EQ("Writes", 0, static_cast <int>(os.writes.size()));
+
+		stream.flush();
+
+		VASSERT_EQ("Pending 2", 0u, stream.getPendingSize());
+		VASSERT_EQ("Writes 2", 1, static_cast <int>(os.writes.size()));
+		VASSERT_EQ("Data", "From: me\r\n", os.written);
+	}
+
+	void testFullBuffer()
+	{
+		bufferedOutputStreamTestStream os;
+		vmime::utility::bufferedOutputStream stream(os, 8);
+
+		stream << "abcde";
+		stream << "fghij";  // fills the buffer
+
+		VASSERT_EQ("Writes", 1, static_cast <int>(os.writes.size()));
+		VASSERT_EQ("Write size", 8, os.writes[0]);
+		VASSERT_EQ("Pending", 2u, stream.getPendingSize());
+
+		stream << "klmnop";  // exactly fills the buffer
+
+		VASSERT_EQ("Writes 2", 2, static_cast <int>(os.writes.size()));
+		VASSERT_EQ("Write size 2", 8, os.writes[1]);
+		VASSERT_EQ("Pending 2", 0u, stream.getPendingSize());
+		VASSERT_EQ("Data", "abcdefghijklmnop", os.written);
+	}
+
+	void testLargeWrite()
+	{
+		bufferedOutputStreamTestStream os;
+		vmime::utility::bufferedOutputStream stream(os, 8);
+
+		stream << "abc";
+		stream << "0123456789abcdefghij";
+
+		// Buffer is completed and written, then the remaining
+		// data is written without being copied
+		VASSERT_EQ("Writes", 2, static_cast <int>(os.writes.size()));
+		VASSERT_EQ("Write size 1", 8, os.writes[0]);
+		VASSERT_EQ("Write size 2", 15, os.writes[1]);
+		VASSERT_EQ("Pending", 0u, stream.getPendingSize());
+		VASSERT_EQ("Data", "abc0123456789abcdefghij", os.written);
+	}
+
+	void testFlush()
+	{
+		bufferedOutputStreamTestStream os;
+		vmime::utility::bufferedOutputStream stream(os, 8);
+
+		stream.flush();
+
+		VASSERT_EQ("Writes", 0, static_cast <int>(os.writes.size()));
+		VASSERT_EQ("Flush", 1, os.flushCount);
+
+		stream << "abc";
+		stream.flush();
+		stream << "def";
+		stream.flush();
+
+		VASSERT_EQ("Writes 2", 2, static_cast <int>(os.writes.size()));
+		VASSERT_EQ("Flush 2", 3, os.flushCount);
+		VASSERT_EQ("Data", "abcdef", os.written);
+	}
+
+VMIME_TEST_SUITE_END
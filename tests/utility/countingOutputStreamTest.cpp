@@ -0,0 +1,106 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002-2013 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+
+#include "tests/testUtils.hpp"
+
+#include "vmime/utility/countingOutputStream.hpp"
+#include "vmime/utility/outputStreamStringAdapter.hpp"
+
+
+class countingOutputStreamTestListener : public vmime::utility::progressListener
+{
+public:
+
+	countingOutputStreamTestListener() : count(0), current(0), total(0) { }
+
+	bool cancel() const { return false; }
+	void start(const long /* predictedTotal */) { }
+	void stop(const long /* total */) { }
+
+	void progress(const long current_, const long currentTotal)
+	{
+		++count;
+		current = current_;
+		total = currentTotal;
+	}
+
+	int count;
+	long current, total;
+};
+
+
+VMIME_TEST_SUITE_BEGIN(countingOutputStreamTest)
+
+	VMIME_TEST_LIST_BEGIN
+		VMIME_TEST(testDiscard)
+		VMIME_TEST(testForward)
+		VMIME_TEST(testProgress)
+	VMIME_TEST_LIST_END
+
+
+	void testDiscard()
+	{
+		vmime::utility::countingOutputStream stream;
+		stream << "some data";
+		stream.write("more data", 9);
+		stream.flush();
+
+		VASSERT_EQ("Count", 18u, stream.getCount());
+	}
+
+	void testForward()
+	{
+		vmime::string str;
+		vmime::utility::outputStreamStringAdapter os(str);
+
+		vmime::utility::countingOutputStream stream(os);
+		stream << "some data";
+		stream.write("more data", 9);
+		stream.flush();
+
+		VASSERT_EQ("Count", 18u, stream.getCount());
+		VASSERT_EQ("Data", "some datamore data", str);
+	}
+
+	void testProgress()
+	{
+		vmime::string str;
+		vmime::utility::outputStreamStringAdapter os(str);
+
+		countingOutputStreamTestListener listener;
+		vmime::utility::countingOutputStream stream(os, 100000, &listener);
+
+		const vmime::string line(100, 'x');
+
+		for (int i = 0 ; i < 1000 ; ++i)
+			stream << line;
+
+		// Not notified for each write
+		VASSERT("Notified", listener.count >= 1 && listener.count < 10);
+		VASSERT("Current", listener.current <= 100000);
+		VASSERT_EQ("Total", 100000, listener.total);
+		VASSERT_EQ("Count", 100000u, stream.getCount());
+	}
+
+VMIME_TEST_SUITE_END
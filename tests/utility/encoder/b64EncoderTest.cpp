@@ -30,6 +30,7 @@ VMIME_TEST_SUITE_BEGIN(b64EncoderTest)
 
 	VMIME_TEST_LIST_BEGIN
 		VMIME_TEST(testBase64)
+		VMIME_TEST(testEncodedSize)
 	VMIME_TEST_LIST_END
 
 
@@ -141,5 +142,32 @@ VMIME_TEST_SUITE_BEGIN(b64EncoderTest)
 		}
 	}
 
+	void testEncodedSize()
+	{
+		static const int maxLineLengths[] = { 0, 76, 100, 20, 10, 5 };
+
+		vmime::ref <vmime::utility::encoder::encoder> enc =
+			vmime::utility::encoder::encoderFactory::getInstance()->create("base64");
+
+		for (unsigned int l = 0 ; l < sizeof(maxLineLengths) / sizeof(maxLineLengths[0]) ; ++l)
+		{
+			enc->getProperties().removeAllProperties();
+
+			if (maxLineLengths[l] != 0)
+				enc->getProperties()["maxlinelength"] = maxLineLengths[l];
+
+			for (unsigned int n = 0 ; n < 300 ; ++n)
+			{
+				const vmime::string decoded(n, 'x');
+
+				std::ostringstream oss;
+				oss << "[Base64] Size " << n << ", max line length " << maxLineLengths[l];
+
+				VASSERT_EQ(oss.str(), encode("base64", decoded, maxLineLengths[l]).length(),
+					enc->getEncodedSize(n));
+			}
+		}
+	}
+
 VMIME_TEST_SUITE_END
 
@@ -31,6 +31,7 @@ VMIME_TEST_SUITE_BEGIN(filteredStreamTest)
 	VMIME_TEST_LIST_BEGIN
 		VMIME_TEST(testDotFilteredInputStream)
 		VMIME_TEST(testDotFilteredOutputStream)
+		VMIME_TEST(testDotTerminatedFilteredInputStream)
 		VMIME_TEST(testCRLFToLFFilteredOutputStream)
 		VMIME_TEST(testStopSequenceFilteredInputStream1)
 		VMIME_TEST(testStopSequenceFilteredInputStreamN_2)
@@ -128,6 +129,58 @@ VMIME_TEST_SUITE_BEGIN(filteredStreamTest)
 		testDotFilteredInputStreamHelper("4", "foo\n.bar", "foo\n..", "bar");
 		testDotFilteredInputStreamHelper("5", "foo\n.bar", "foo\n", ".", ".bar");
 		testDotFilteredInputStreamHelper("6", "foo\n.bar", "foo\n", ".", ".", "bar");
+		testDotFilteredInputStreamHelper("7", "a\n.b\n.c\n..d", "a\n..b\n..c\n...d");
+		testDotFilteredInputStreamHelper("8", "a\n.b\n.c", "a\n..b\n.", ".c");
+	}
+
+	// dotTerminatedFilteredInputStream
+
+	void testDotTerminatedFISHelper
+		(const std::string& number, const std::string& expected,
+		 const std::string& c1, const std::string& c2 = "",
+		 const std::string& c3 = "", const std::string& c4 = "")
+	{
+		chunkInputStream cis;
+		cis.addChunk(c1);
+		if (!c2.empty()) cis.addChunk(c2);
+		if (!c3.empty()) cis.addChunk(c3);
+		if (!c4.empty()) cis.addChunk(c4);
+
+		vmime::utility::dotTerminatedFilteredInputStream is(cis);
+
+		VASSERT_EQ(number, expected, readWhole(is));
+	}
+
+	void testDotTerminatedFilteredInputStream()
+	{
+		testDotTerminatedFISHelper("1", "foo\r\nbar", "foo\r\nbar\r\n.\r\n");
+		testDotTerminatedFISHelper("2", "foo\nbar", "foo\nbar\n.\n");
+		testDotTerminatedFISHelper("3", "foo\r\n.bar", "foo\r\n..bar\r\n.\r\nignored");
+		testDotTerminatedFISHelper("4", "foo\r\n.bar\r\n.b", "foo\r\n..bar\r\n..b\r\n.\r\n");
+
+		testDotTerminatedFISHelper("5", "foo\r\nbar", "foo\r\nbar\r", "\n.\r\n");
+		testDotTerminatedFISHelper("6", "foo\r\nbar", "foo\r\nbar\r\n", ".\r\n");
+		testDotTerminatedFISHelper("7", "foo\r\nbar", "foo\r\nbar\r\n.", "\r\n");
+		testDotTerminatedFISHelper("8", "foo\r\nbar", "foo\r\nbar\r\n.\r", "\n");
+		testDotTerminatedFISHelper("9", "foo\r\nbar", "foo\r", "\n", "bar\r\n.", "\r\n");
+
+		testDotTerminatedFISHelper("10", "foo\r\n.bar", "foo\r\n.", ".bar\r\n.\r\n");
+		testDotTerminatedFISHelper("11", "foo\r\n.\rbar", "foo\r\n.\r", "bar\r\n.\r\n");
+		testDotTerminatedFISHelper("12", "foo\r\n", "foo\r\n", "\r\n.\r\n");
+		testDotTerminatedFISHelper("13", "+OK", "+OK\r\n.\r\n");
+		testDotTerminatedFISHelper("14", "", ".\r\n");
+		testDotTerminatedFISHelper("15", "", ".", "\r\n");
+		testDotTerminatedFISHelper("16", ".foo", "..foo\r\n.\r\n");
+
+		// Data following the terminator
+		chunkInputStream cis;
+		cis.addChunk("foo\r\n.\r\n+OK");
+		cis.addChunk("bar");
+
+		vmime::utility::dotTerminatedFilteredInputStream is(cis);
+
+		VASSERT_EQ("Trailing data", "foo", readWhole(is));
+		VASSERT_EQ("Trailing data 2", "+OK", is.getTrailingData());
 	}
 
 	// dotFilteredOutputStream
@@ -167,6 +220,9 @@ VMIME_TEST_SUITE_BEGIN(filteredStreamTest)
 		testFilteredOutputStreamHelper<FILTER>("8", "..\r\nfoobar", ".\r", "\nfoobar");
 		testFilteredOutputStreamHelper<FILTER>("9", ".foobar", ".foobar");
 		testFilteredOutputStreamHelper<FILTER>("10", ".foobar", ".", "foobar");
+		testFilteredOutputStreamHelper<FILTER>("11", "..\r\nfoobar", ".", "\r\nfoobar");
+		testFilteredOutputStreamHelper<FILTER>("12", "a\n..b\n..c\n...", "a\n.b\n.c\n..");
+		testFilteredOutputStreamHelper<FILTER>("13", "a\n..b\n..c", "a\n.b\n", ".c");
 	}
 
 	void testCRLFToLFFilteredOutputStream()
@@ -26,12 +26,27 @@
 #include "vmime/utility/outputStreamSocketAdapter.hpp"
 
 
+// Records calls to setCorked()
+class corkTestSocket : public testSocket
+{
+public:
+
+	void setCorked(const bool corked)
+	{
+		calls += (corked ? "C" : "U");
+	}
+
+	vmime::string calls;
+};
+
+
 VMIME_TEST_SUITE_BEGIN(outputStreamSocketAdapterTest)
 
 	VMIME_TEST_LIST_BEGIN
 		VMIME_TEST(testWrite)
 		VMIME_TEST(testWriteBinary)
 		VMIME_TEST(testWriteCRLF)
+		VMIME_TEST(testCork)
 	VMIME_TEST_LIST_END
 
 
@@ -84,5 +99,36 @@ VMIME_TEST_SUITE_BEGIN(outputStreamSocketAdapterTest)
 		VASSERT_EQ("Write", "some data\nmore\r\ndata\r", buffer);
 	}
 
+	void testCork()
+	{
+		vmime::ref <corkTestSocket> socket = vmime::create <corkTestSocket>();
+
+		{
+			vmime::utility::outputStreamSocketAdapter stream(*socket, /* cork */ true);
+			stream << "some data";
+			stream << "more data";
+			stream.flush();
+
+			VASSERT_EQ("Flush", "CU", socket->calls);
+
+			stream << "data";
+		}
+
+		// Uncorked when destroyed
+		VASSERT_EQ("Destroy", "CUCU", socket->calls);
+
+		vmime::string buffer;
+		socket->localReceive(buffer);
+
+		VASSERT_EQ("Write", "some datamore datadata", buffer);
+
+		// No corking by default
+		vmime::utility::outputStreamSocketAdapter stream2(*socket);
+		stream2 << "data";
+		stream2.flush();
+
+		VASSERT_EQ("Default", "CUCU", socket->calls);
+	}
+
 VMIME_TEST_SUITE_END
 
@@ -274,6 +274,16 @@ public:
 	  */
 	static bool isValidBoundary(const string& boundary);
 
+	utility::stream::size_type getGeneratedSize(const generationContext& ctx) const;
+
+	/** Indicates whether getGeneratedSize() returns the exact size of
+	  * this body, or only an estimate (see contentHandler::isGeneratedSizeExact()).
+	  *
+	  * @param ctx generation context
+	  * @return true if the generated size is exact, false otherwise
+	  */
+	bool isGeneratedSizeExact(const generationContext& ctx) const;
+
 	ref <component> clone() const;
 	void copyFrom(const component& other);
 	body& operator=(const body& other);
@@ -297,6 +307,10 @@ private:
 
 	bool isRootPart() const;
 
+	const string getGenerationBoundary() const;
+	const string getGenerationPrologText(const generationContext& ctx) const;
+	const string getGenerationEpilogText(const generationContext& ctx) const;
+
 	void initNewPart(ref <bodyPart> part);
 
 protected:
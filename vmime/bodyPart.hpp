@@ -97,6 +97,16 @@ public:
 	ref <const bodyPart> getParentPart() const;
 
 
+	utility::stream::size_type getGeneratedSize(const generationContext& ctx) const;
+
+	/** Indicates whether getGeneratedSize() returns the exact size of
+	  * this part, or only an estimate (see body::isGeneratedSizeExact()).
+	  *
+	  * @param ctx generation context
+	  * @return true if the generated size is exact, false otherwise
+	  */
+	bool isGeneratedSizeExact(const generationContext& ctx) const;
+
 	ref <component> clone() const;
 	void copyFrom(const component& other);
 	bodyPart& operator=(const bodyPart& other);
@@ -172,6 +172,16 @@ public:
 		 const string::size_type curLinePos = 0,
 		 string::size_type* newLinePos = NULL) const;
 
+	/** Return the number of bytes generate() would write for this
+	  * component, starting at the beginning of a line, without
+	  * storing the generated data. Bodies compute the size of their
+	  * contents from the length of the data where possible.
+	  *
+	  * @param ctx generation context
+	  * @return size of generated data, in bytes
+	  */
+	virtual utility::stream::size_type getGeneratedSize(const generationContext& ctx) const;
+
 	/** Clone this component.
 	  *
 	  * @return a copy of this component
@@ -65,6 +65,32 @@ public:
 	  */
 	virtual void generate(utility::outputStream& os, const vmime::encoding& enc, const string::size_type maxLineLength = lineLengthLimits::infinite) const = 0;
 
+	/** Return the number of bytes generate() would write for the
+	  * specified encoding. When the length of data is known, and the
+	  * encoded length does not depend on the data itself (eg. base64),
+	  * it is computed without reading data; otherwise, data is encoded
+	  * and counted, but not stored.
+	  *
+	  * Unbuffered data (see isBuffered()) is never read, as it could
+	  * not be read again by generate(): in this case, the size may only
+	  * be an estimate (see isGeneratedSizeExact()).
+	  *
+	  * @param enc encoding for output
+	  * @param maxLineLength maximum line length for output
+	  * @return number of bytes generate() would write
+	  */
+	virtual utility::stream::size_type getGeneratedSize(const vmime::encoding& enc, const string::size_type maxLineLength = lineLengthLimits::infinite) const;
+
+	/** Indicates whether getGeneratedSize() returns the exact number
+	  * of bytes generate() would write for the specified encoding, or
+	  * only an estimate.
+	  *
+	  * @param enc encoding for output
+	  * @param maxLineLength maximum line length for output
+	  * @return true if the generated size is exact, false otherwise
+	  */
+	virtual bool isGeneratedSizeExact(const vmime::encoding& enc, const string::size_type maxLineLength = lineLengthLimits::infinite) const;
+
 	/** Extract the contents into the specified stream. If needed, data
 	  * will be decoded before being written into the stream.
 	  *
@@ -0,0 +1,110 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002-2013 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+#ifndef VMIME_NET_DEFLATESOCKET_HPP_INCLUDED
+#define VMIME_NET_DEFLATESOCKET_HPP_INCLUDED
+
+
+#include "vmime/config.hpp"
+
+
+#if VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_COMPRESSION_SUPPORT
+
+
+#include "vmime/types.hpp"
+
+#include "vmime/net/socket.hpp"
+
+
+struct z_stream_s;
+
+
+namespace vmime {
+namespace net {
+
+
+/** A socket which compresses data sent and decompresses data received
+  * using the DEFLATE algorithm (as used by the IMAP COMPRESS extension,
+  * RFC 4978).
+  *
+  * The output stream is flushed (Z_SYNC_FLUSH) after each call to send
+  * functions, so that the peer can process the data immediately.
+  */
+class VMIME_EXPORT deflateSocket : public socket
+{
+public:
+
+	deflateSocket(ref <socket> wrapped);
+	~deflateSocket();
+
+	void connect(const string& address, const port_t port);
+	void disconnect();
+
+	bool isConnected() const;
+
+	void receive(string& buffer);
+	size_type receiveRaw(char* buffer, const size_type count);
+
+	void send(const string& buffer);
+	void sendRaw(const char* buffer, const size_type count);
+
+	/** Compressed data must be sent in whole, so this
+	  * function blocks until all data has been sent.
+	  */
+	size_type sendRawNonBlocking(const char* buffer, const size_type count);
+
+	size_type getBlockSize() const;
+
+	void setCorked(const bool corked);
+
+	unsigned int getStatus() const;
+
+	const string getPeerName() const;
+	const string getPeerAddress() const;
+
+	/** Return the socket wrapped by this socket.
+	  *
+	  * @return underlying socket
+	  */
+	ref <socket> getWrappedSocket();
+
+private:
+
+	ref <socket> m_wrapped;
+
+	z_stream_s* m_deflate;
+	z_stream_s* m_inflate;
+	bool m_inflatePending;
+
+	char m_recvBuffer[65536];
+	char m_sendBuffer[65536];
+};
+
+
+} // net
+} // vmime
+
+
+#endif // VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_COMPRESSION_SUPPORT
+
+#endif // VMIME_NET_DEFLATESOCKET_HPP_INCLUDED
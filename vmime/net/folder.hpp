@@ -39,6 +39,8 @@
 #include "vmime/message.hpp"
 #include "vmime/net/message.hpp"
 #include "vmime/net/events.hpp"
+#include "vmime/net/searchCriteria.hpp"
+#include "vmime/net/messageSet.hpp"
 
 #include "vmime/utility/path.hpp"
 #include "vmime/utility/stream.hpp"
@@ -52,6 +54,27 @@ namespace net {
 class store;
 
 
+/** Receive messages as they are fetched by
+  * folder::fetchMessages(const messageSet&, ...).
+  */
+
+class VMIME_EXPORT messageFetchListener
+{
+protected:
+
+	virtual ~messageFetchListener() { }
+
+public:
+
+	/** Called for each message, once the requested objects
+	  * have been fetched.
+	  *
+	  * @param msg fetched message
+	  */
+	virtual void messageFetched(ref <message> msg) = 0;
+};
+
+
 /** Abstract representation of a folder in a message store.
   */
 
@@ -333,6 +356,35 @@ public:
 	  */
 	virtual void copyMessages(const folder::path& dest, const std::vector <int>& nums) = 0;
 
+	/** Move a message from this folder to another folder.
+	  *
+	  * The default implementation copies the message, marks it as
+	  * deleted and expunges the folder. Protocols which can move messages
+	  * in one operation (eg. IMAP) override it.
+	  *
+	  * @param dest destination folder path
+	  * @param num sequence number of the message to move
+	  * @throw net_exception if an error occurs
+	  */
+	virtual void moveMessage(const folder::path& dest, const int num);
+
+	/** Move messages from this folder to another folder.
+	  *
+	  * @param dest destination folder path
+	  * @param from sequence number of the first message to move
+	  * @param to sequence number of the last message to move
+	  * @throw net_exception if an error occurs
+	  */
+	virtual void moveMessages(const folder::path& dest, const int from = 1, const int to = -1);
+
+	/** Move messages from this folder to another folder.
+	  *
+	  * @param dest destination folder path
+	  * @param nums sequence numbers of the messages to move
+	  * @throw net_exception if an error occurs
+	  */
+	virtual void moveMessages(const folder::path& dest, const std::vector <int>& nums);
+
 	/** Request folder status without opening it.
 	  *
 	  * @param count will receive the number of messages in the folder
@@ -390,6 +442,22 @@ public:
 	  */
 	virtual void fetchMessages(std::vector <ref <message> >& msg, const int options, utility::progressListener* progress = NULL) = 0;
 
+	/** Fetch objects for a set of messages, and pass each message to
+	  * a listener as soon as it has been fetched.
+	  *
+	  * Message objects are only created for the batch being fetched and
+	  * are released once the listener has been called (unless it keeps a
+	  * reference on them), so this can be used on very large folders.
+	  *
+	  * @param msgs sequence numbers of the messages to fetch
+	  * @param options objects to fetch (combination of folder::FetchOptions flags)
+	  * @param listener listener to notify for each fetched message
+	  * @param progress progress listener, or NULL if not used
+	  * @throw net_exception if an error occurs
+	  */
+	virtual void fetchMessages(const messageSet& msgs, const int options,
+		messageFetchListener* listener, utility::progressListener* progress = NULL);
+
 	/** Fetch objects for the specified message.
 	  *
 	  * @param msg the message
@@ -412,6 +480,20 @@ public:
  	  */
 	virtual std::vector <int> getMessageNumbersStartingOnUID(const message::uid& uid) = 0;
 
+	/** Search for messages matching the specified criteria.
+	  *
+	  * The default implementation fetches, for every message, the objects
+	  * needed to evaluate the criteria and matches them locally. Protocols
+	  * which can search on the server side (eg. IMAP) override it.
+	  *
+	  * @param criteria search criteria
+	  * @param options items to return (combination of
+	  * searchResult::ReturnOptions flags); more items may be returned
+	  * @return sequence numbers of the matching messages
+	  * @throw net_exception if an error occurs
+	  */
+	virtual const searchResult search(ref <const searchCriteria> criteria, const int options = searchResult::RETURN_ALL);
+
 	// Event listeners
 	void addMessageChangedListener(events::messageChangedListener* l);
 	void removeMessageChangedListener(events::messageChangedListener* l);
@@ -40,6 +40,8 @@
 
 #include "vmime/security/authenticator.hpp"
 
+#include <deque>
+
 
 namespace vmime {
 namespace net {
@@ -48,6 +50,7 @@ namespace imap {
 
 class IMAPTag;
 class IMAPStore;
+class IMAPFolder;
 
 
 class VMIME_EXPORT IMAPConnection : public object
@@ -82,6 +85,14 @@ public:
 	void send(bool tag, const string& what, bool end);
 	void sendRaw(const char* buffer, const int count);
 
+	/** Send a tagged command without waiting for the responses to
+	  * the previous commands (pipelining). The responses must then be
+	  * read in the order the commands were sent, with readResponse().
+	  *
+	  * @param what command line, without tag and CRLF
+	  */
+	void sendPipelined(const string& what);
+
 	IMAPParser::response* readResponse(IMAPParser::literalHandler* lh = NULL);
 
 
@@ -93,14 +104,60 @@ public:
 
 	ref <session> getSession();
 
+	/** Return the capabilities advertised by the server. The list is
+	  * taken from the "[CAPABILITY ...]" response codes when the server
+	  * sends them, or requested once, and cached until the connection
+	  * state changes (eg. after STARTTLS or login).
+	  *
+	  * @return list of capabilities
+	  */
 	const std::vector <string> getCapabilities();
 
+	/** Test whether the server advertises the specified capability
+	  * (see getCapabilities()).
+	  *
+	  * @param capa capability name (case-insensitive)
+	  * @return true if the capability is supported, false otherwise
+	  */
+	bool hasCapability(const string& capa);
+
+	void setCurrentFolder(ref <IMAPFolder> folder);
+	ref <IMAPFolder> getCurrentFolder();
+
+	/** Enter the IDLE state (RFC 2177). The connection stays in this
+	  * state until stopIdle() is called, or until a new command is sent.
+	  */
+	void startIdle();
+
+	/** Leave the IDLE state. Untagged responses received in the meantime
+	  * are processed by the current folder, if any.
+	  */
+	void stopIdle();
+
+	bool isIdle() const;
+
+	/** Read an untagged response sent by the server while the connection
+	  * is in the IDLE state.
+	  *
+	  * @return untagged response (to be deleted by the caller), or NULL
+	  * if no complete response is available yet
+	  */
+	IMAPParser::response_data* readIdleResponse();
+
 	ref <security::authenticator> getAuthenticator();
 
+	/** Test whether data exchanged with the server is compressed
+	  * (COMPRESS=DEFLATE extension, RFC 4978).
+	  *
+	  * @return true if compression is active, false otherwise
+	  */
+	bool isCompressed() const;
+
 	bool isSecuredConnection() const;
 	ref <connectionInfos> getConnectionInfos() const;
 
 	ref <const socket> getSocket() const;
+	ref <socket> getSocket();
 
 private:
 
@@ -113,6 +170,10 @@ private:
 	void startTLS();
 #endif // VMIME_HAVE_TLS_SUPPORT
 
+#if VMIME_HAVE_COMPRESSION_SUPPORT
+	void startCompression();
+#endif // VMIME_HAVE_COMPRESSION_SUPPORT
+
 
 	weak_ref <IMAPStore> m_store;
 
@@ -135,10 +196,50 @@ private:
 
 	bool m_firstTag;
 
+	/** Tags of the commands whose responses have not been read yet. */
+	std::deque <string> m_pendingTags;
+
+	std::vector <string> m_capabilities;
+	bool m_capabilitiesFetched;
+
+	/** Whether the server sends its capabilities in the greeting and
+	  * in the response to LOGIN, so that CAPABILITY is not needed. */
+	bool m_capabilitiesInResponses;
+
+	weak_ref <IMAPFolder> m_currentFolder;
+
+	bool m_idle;
+
+	bool m_compressed;
+
 
 	void internalDisconnect();
 
-	void initHierarchySeparator();
+	void sendImpl(bool tag, const string& what, bool end, bool pipelined);
+
+	void fetchCapabilities();
+	void setCapabilities(const std::vector <IMAPParser::capability*>& caps);
+
+	/** Update the cached capabilities from the CAPABILITY responses or
+	  * the "[CAPABILITY ...]" response codes found in a response.
+	  */
+	void processCapabilityResponseData(const IMAPParser::response* resp);
+	void processCapabilityResponseData(const IMAPParser::resp_text* text);
+
+	/** Send the commands needed once authenticated: CAPABILITY (if
+	  * requested) and LIST, to get the hierarchy separator.
+	  *
+	  * @param pipelined if true, do not discard the pending commands
+	  * @param capability whether to request the capabilities
+	  * @return true if CAPABILITY has been sent, false otherwise
+	  */
+	bool sendPostLoginCommands(const bool pipelined, const bool capability);
+
+	/** Read the responses to the commands sent by sendPostLoginCommands().
+	  *
+	  * @param capabilitySent value returned by sendPostLoginCommands()
+	  */
+	void readPostLoginResponses(const bool capabilitySent);
 };
 
 
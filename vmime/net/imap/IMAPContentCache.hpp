@@ -0,0 +1,160 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002-2013 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+
+#ifndef VMIME_NET_IMAP_IMAPCONTENTCACHE_HPP_INCLUDED
+#define VMIME_NET_IMAP_IMAPCONTENTCACHE_HPP_INCLUDED
+
+
+#include "vmime/config.hpp"
+
+
+#if VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_IMAP
+
+
+#include "vmime/base.hpp"
+
+#include "vmime/utility/file.hpp"
+#include "vmime/utility/outputStream.hpp"
+#include "vmime/utility/sync/criticalSection.hpp"
+
+#include <list>
+#include <map>
+
+
+namespace vmime {
+namespace net {
+namespace imap {
+
+
+/** Bounded cache for the contents of message parts, so that extracting
+  * the same part several times does not download it again.
+  *
+  * Small contents are kept in memory. Contents larger than the spill
+  * threshold are written to temporary files, if a spill directory has
+  * been specified. When the memory or disk limit is reached, the least
+  * recently used contents are discarded.
+  */
+
+class VMIME_EXPORT IMAPContentCache : public object
+{
+public:
+
+	/** Construct a new cache.
+	  *
+	  * @param maxMemorySize maximum number of bytes kept in memory
+	  * @param spillThreshold contents larger than this number of bytes
+	  * are written to disk instead of being kept in memory
+	  * @param spillDir directory in which large contents are written,
+	  * or an empty path to keep only small contents in memory
+	  * @param maxDiskSize maximum number of bytes written to disk
+	  */
+	IMAPContentCache(const size_t maxMemorySize, const size_t spillThreshold,
+		const utility::file::path& spillDir, const size_t maxDiskSize);
+
+	~IMAPContentCache();
+
+	/** Test whether contents of the specified size can be cached.
+	  *
+	  * @param size contents size, in bytes
+	  * @return true if the contents can be cached, false otherwise
+	  */
+	bool isCacheable(const size_t size) const;
+
+	/** Write the cached contents for the specified key.
+	  *
+	  * @param key cache key
+	  * @param os output stream in which to write the contents
+	  * @return true if the contents were found in the cache,
+	  * false otherwise (nothing is written)
+	  */
+	bool get(const string& key, utility::outputStream& os);
+
+	/** Add contents to the cache. Nothing is done if the contents
+	  * are too large to be cached.
+	  *
+	  * @param key cache key
+	  * @param data contents
+	  */
+	void put(const string& key, const string& data);
+
+	/** Remove all the contents from the cache.
+	  */
+	void clear();
+
+	/** Return the number of bytes currently kept in memory.
+	  *
+	  * @return memory usage
+	  */
+	size_t getMemorySize() const;
+
+	/** Return the number of bytes currently written to disk.
+	  *
+	  * @return disk usage
+	  */
+	size_t getDiskSize() const;
+
+private:
+
+	struct item
+	{
+		std::list <string>::iterator lruPos;
+		bool onDisk;
+		size_t size;
+		string data;
+		ref <utility::file> file;
+	};
+
+	void removeItem(std::map <string, item>::iterator it);
+	void evict(const bool onDisk, const size_t size);
+
+
+	const size_t m_maxMemorySize;
+	const size_t m_spillThreshold;
+	const utility::file::path m_spillDir;
+	const size_t m_maxDiskSize;
+
+	std::map <string, item> m_items;
+
+	// Keys, from the most recently used to the least recently used
+	std::list <string> m_memoryLRU;
+	std::list <string> m_diskLRU;
+
+	size_t m_memorySize;
+	size_t m_diskSize;
+
+	string m_filePrefix;
+	unsigned int m_fileCounter;
+
+	ref <utility::sync::criticalSection> m_lock;
+};
+
+
+} // imap
+} // net
+} // vmime
+
+
+#endif // VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_IMAP
+
+#endif // VMIME_NET_IMAP_IMAPCONTENTCACHE_HPP_INCLUDED
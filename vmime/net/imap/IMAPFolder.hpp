@@ -38,6 +38,9 @@
 
 #include "vmime/net/folder.hpp"
 
+#include "vmime/net/imap/IMAPParser.hpp"
+#include "vmime/net/imap/IMAPMessageRegistry.hpp"
+
 
 namespace vmime {
 namespace net {
@@ -58,6 +61,7 @@ private:
 
 	friend class IMAPStore;
 	friend class IMAPMessage;
+	friend class IMAPConnection;
 	friend class vmime::creator;  // vmime::create <IMAPFolder>
 
 
@@ -96,6 +100,29 @@ public:
 
 	std::vector <int> getMessageNumbersStartingOnUID(const message::uid& uid);
 
+	/** Search for messages matching the specified criteria. The search
+	  * is done by the server; if it supports ESEARCH (RFC 4731), only the
+	  * requested items are returned, and the numbers are returned as a
+	  * compact set.
+	  *
+	  * @param criteria search criteria
+	  * @param options items to return (combination of
+	  * searchResult::ReturnOptions flags)
+	  * @return sequence numbers of the matching messages
+	  */
+	const searchResult search(ref <const searchCriteria> criteria, const int options = searchResult::RETURN_ALL);
+
+	/** Search for messages matching the specified criteria, and
+	  * return their UIDs instead of their sequence numbers (the UIDs
+	  * are not prefixed with the UID validity, see getUIDValidity()).
+	  *
+	  * @param criteria search criteria
+	  * @param options items to return (combination of
+	  * searchResult::ReturnOptions flags)
+	  * @return UIDs of the matching messages
+	  */
+	const searchResult searchUIDs(ref <const searchCriteria> criteria, const int options = searchResult::RETURN_ALL);
+
 	int getMessageCount();
 
 	ref <folder> getFolder(const folder::path::component& name);
@@ -113,10 +140,67 @@ public:
 	void addMessage(ref <vmime::message> msg, const int flags = message::FLAG_UNDEFINED, vmime::datetime* date = NULL, utility::progressListener* progress = NULL);
 	void addMessage(utility::inputStream& is, const int size, const int flags = message::FLAG_UNDEFINED, vmime::datetime* date = NULL, utility::progressListener* progress = NULL);
 
+	/** A message to be added to the folder with addMessages().
+	  */
+	struct messageToAdd
+	{
+		messageToAdd(utility::inputStream& is, const int size,
+			const int flags = message::FLAG_UNDEFINED, vmime::datetime* date = NULL);
+
+		/** The message is generated directly to the connection when it
+		  * is sent; its size is computed with getGeneratedSize(). If this
+		  * size is not exact (eg. unbuffered data), the message is
+		  * generated here instead.
+		  */
+		messageToAdd(ref <vmime::message> msg,
+			const int flags = message::FLAG_UNDEFINED, vmime::datetime* date = NULL);
+
+		utility::inputStream* stream;  /**< message data (not owned), or NULL */
+		ref <vmime::message> msg;      /**< message to generate, if stream is NULL */
+		int size;                      /**< size of the message data, in bytes */
+		int flags;                     /**< initial flags, or message::FLAG_UNDEFINED */
+		vmime::datetime* date;         /**< internal date, or NULL */
+
+		ref <utility::inputStream> buffer;  /**< message generated in advance, or NULL */
+	};
+
+	/** Add several messages to this folder, using as few round trips
+	  * as possible.
+	  *
+	  * If the server supports MULTIAPPEND (RFC 3502), all messages are
+	  * sent in a single APPEND command. If it supports non-synchronizing
+	  * literals (LITERAL+ or LITERAL-, RFC 7888), message data is sent
+	  * without waiting for the server to be ready. Message data is read
+	  * from the input streams while it is sent, and is never buffered.
+	  *
+	  * @param msgs messages to add
+	  * @param progress progress listener, or NULL if not used
+	  * @return UIDs of the new messages, in the same order as msgs, as
+	  * reported by the server (UIDPLUS extension, RFC 4315); the UIDs are
+	  * empty if the server does not report them
+	  */
+	std::vector <message::uid> addMessages(const std::vector <messageToAdd>& msgs,
+		utility::progressListener* progress = NULL);
+
 	void copyMessage(const folder::path& dest, const int num);
 	void copyMessages(const folder::path& dest, const int from = 1, const int to = -1);
 	void copyMessages(const folder::path& dest, const std::vector <int>& nums);
 
+	/** Move messages from this folder to another folder.
+	  *
+	  * If the server supports the MOVE extension (RFC 6851), this is done
+	  * in one command. Otherwise, the messages are copied and marked as
+	  * deleted; then, if the server supports UIDPLUS (RFC 4315), only the
+	  * moved messages are expunged with UID EXPUNGE; if it does not, the
+	  * whole folder is expunged.
+	  *
+	  * Messages which have been moved are notified as removed from this
+	  * folder, and the remaining messages are renumbered.
+	  */
+	void moveMessage(const folder::path& dest, const int num);
+	void moveMessages(const folder::path& dest, const int from = 1, const int to = -1);
+	void moveMessages(const folder::path& dest, const std::vector <int>& nums);
+
 	void status(int& count, int& unseen);
 
 	void expunge();
@@ -127,26 +211,167 @@ public:
 	ref <store> getStore();
 
 
+	using folder::fetchMessages;
 	void fetchMessages(std::vector <ref <message> >& msg, const int options, utility::progressListener* progress = NULL);
 	void fetchMessage(ref <message> msg, const int options);
 
 	int getFetchCapabilities() const;
 
+	/** Return the UID validity of this folder, as reported by the
+	  * server when the folder was opened.
+	  *
+	  * @return UID validity, or 0 if the folder is not open
+	  */
+	unsigned int getUIDValidity() const;
+
+	/** Return the highest mod-sequence of this folder, as reported by
+	  * the server when the folder was opened (CONDSTORE, RFC 7162).
+	  * The client should save it, along with the UID validity, to
+	  * resynchronize the folder in a later session.
+	  *
+	  * @return highest mod-sequence, or an empty string if the server
+	  * does not support mod-sequences for this folder
+	  */
+	const string getHighestModSequence() const;
+
+	/** Open this folder and retrieve the changes which occured since
+	  * the state saved by the client in a previous session.
+	  *
+	  * If the server supports QRESYNC, the changes are sent in response
+	  * to the SELECT command. Otherwise, if the server supports CONDSTORE,
+	  * changed flags are fetched with CHANGEDSINCE and expunged messages
+	  * are found among the known UIDs.
+	  *
+	  * @param mode open mode (see folder::Modes)
+	  * @param uidValidity UID validity saved by the client
+	  * @param modSeq highest mod-sequence saved by the client
+	  * @param knownUIDs UIDs known by the client, as an IMAP set (eg.
+	  * "1:100,105"); may be empty if the server supports QRESYNC
+	  * @param changed will receive the messages whose flags have changed
+	  * (or which are new) since the saved state; flags and UID are fetched
+	  * @param vanished will receive the UIDs of the messages which have
+	  * been expunged since the saved state
+	  * @return true if the folder has been resynchronized, or false if
+	  * the client must do a full resynchronization (UID validity changed,
+	  * or the server does not support the needed extensions); the folder
+	  * is open in both cases
+	  */
+	bool openAndResync(const int mode, const unsigned int uidValidity,
+		const string& modSeq, const string& knownUIDs,
+		std::vector <ref <message> >& changed, std::vector <message::uid>& vanished);
+
+	/** Retrieve the messages whose flags changed since the specified
+	  * mod-sequence (CONDSTORE, RFC 7162). If the folder has been opened
+	  * with QRESYNC, the UIDs of expunged messages are also retrieved.
+	  *
+	  * @param modSeq mod-sequence
+	  * @param changed will receive the changed messages (flags and UID
+	  * are fetched)
+	  * @param vanished will receive the UIDs of the expunged messages
+	  * @throw exceptions::operation_not_supported if the server does not
+	  * support mod-sequences for this folder
+	  */
+	void fetchChangesSince(const string& modSeq,
+		std::vector <ref <message> >& changed, std::vector <message::uid>& vanished);
+
+	/** Put the folder connection in the IDLE state (RFC 2177), so that
+	  * the server can notify of mailbox changes as they happen. The folder
+	  * must be open, and the server must support the IDLE extension.
+	  *
+	  * While idling, call pollIdle() periodically to dispatch the changes
+	  * to the folder listeners. Servers may drop an idling client after
+	  * 30 minutes, so IDLE should be re-issued before this delay expires.
+	  *
+	  * Any other operation on this folder automatically ends the IDLE state.
+	  *
+	  * @throw exceptions::operation_not_supported if the server does not
+	  * support the IDLE extension
+	  */
+	void startIdle();
+
+	/** Process the notifications received from the server while in the
+	  * IDLE state. This does not block if no notification is pending.
+	  * Message count and flag changes are reported to the listeners.
+	  *
+	  * @return true if at least one notification has been processed,
+	  * false otherwise
+	  */
+	bool pollIdle();
+
+	/** End the IDLE state and process the pending notifications.
+	  */
+	void stopIdle();
+
+	/** Test whether the folder connection is in the IDLE state.
+	  *
+	  * @return true if idling, false otherwise
+	  */
+	bool isIdle() const;
+
 private:
 
 	void registerMessage(IMAPMessage* msg);
 	void unregisterMessage(IMAPMessage* msg);
 
+	void openImpl(const int mode, const bool failIfModeIsNotAvailable,
+		const string& qresyncParams, std::vector <ref <message> >* changed,
+		std::vector <message::uid>* vanished);
+
 	void onStoreDisconnected();
 
 	void onClose();
 
+	/** Return the connection to use for a command which does not
+	  * require this folder to be selected (eg. STATUS or LIST): an idle
+	  * connection from the store pool if the folder is not open and
+	  * pooling is enabled, or the current connection otherwise.
+	  */
+	ref <IMAPConnection> acquireCommandConnection();
+	void releaseCommandConnection(ref <IMAPConnection> cnt);
+
 	int testExistAndGetType();
 
+	/** Fetch the specified items from the server, without using
+	  * the metadata cache.
+	  */
+	void fetchMessagesImpl(std::vector <ref <message> >& msg, const int options,
+		utility::progressListener* progress);
+
 	void setMessageFlags(const string& set, const int flags, const int mode);
 
 	void copyMessages(const string& set, const folder::path& dest);
 
+	const searchResult searchImpl(ref <const searchCriteria> criteria, const int options, const bool uid);
+
+	/** Process untagged status responses (EXISTS, EXPUNGE, FETCH FLAGS)
+	  * sent by the server and notify the listeners.
+	  */
+	void processStatusUpdate(const IMAPParser::response* resp);
+	void processStatusUpdate(const IMAPParser::response_data* respData);
+
+	/** Send an event to all the folders of the store which have the
+	  * specified path (including this one), and update their message
+	  * count.
+	  *
+	  * @param path path of the folders to notify
+	  * @param event event to send; each folder receives a copy whose
+	  * source is the folder itself
+	  * @param count new message count, or -1 to add the number of
+	  * messages in the event to the current count
+	  */
+	void notifyFolders(const folder::path& path,
+		const events::messageCountEvent& event, const int count);
+
+	/** Send an event to all the folders of the store which have the
+	  * specified path (including this one).
+	  *
+	  * @param path path of the folders to notify
+	  * @param event event to send; each folder receives a copy whose
+	  * source is the folder itself
+	  */
+	void notifyFolders(const folder::path& path,
+		const events::messageChangedEvent& event);
+
 
 	weak_ref <IMAPStore> m_store;
 	ref <IMAPConnection> m_connection;
@@ -163,8 +388,11 @@ private:
 	int m_messageCount;
 
 	unsigned int m_uidValidity;
+	string m_highestModSeq;
+	bool m_qresync;
+	bool m_pooled;
 
-	std::vector <IMAPMessage*> m_messages;
+	IMAPMessageRegistry m_messages;
 };
 
 
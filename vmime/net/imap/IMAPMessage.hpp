@@ -35,6 +35,8 @@
 #include "vmime/net/folder.hpp"
 
 #include "vmime/net/imap/IMAPParser.hpp"
+#include "vmime/net/imap/IMAPMetadataCache.hpp"
+#include "vmime/net/imap/IMAPMessageRegistry.hpp"
 
 
 namespace vmime {
@@ -80,9 +82,52 @@ public:
 	int getFlags() const;
 	void setFlags(const int flags, const int mode = FLAG_MODE_SET);
 
+	/** Return the mod-sequence of this message, as last reported by
+	  * the server (CONDSTORE, RFC 7162).
+	  *
+	  * @return mod-sequence, or an empty string if not known
+	  */
+	const string getModSequence() const;
+
 	void extract(utility::outputStream& os, utility::progressListener* progress = NULL, const int start = 0, const int length = -1, const bool peek = false) const;
 	void extractPart(ref <const part> p, utility::outputStream& os, utility::progressListener* progress = NULL, const int start = 0, const int length = -1, const bool peek = false) const;
 
+	/** Extract the whole message, or the contents of a part, in chunks
+	  * of the specified size (partial fetch: BODY[section]<offset.size>).
+	  * Data is written to the output stream as it is received, so
+	  * memory usage is bounded by the chunk size.
+	  *
+	  * If the extraction is interrupted (eg. the connection is lost),
+	  * it can be resumed later by passing the number of bytes already
+	  * written to the output stream as the offset.
+	  *
+	  * @param p part to extract, or NULL to extract the whole message
+	  * (header and body)
+	  * @param os output stream in which to write data
+	  * @param progress progress listener, or NULL if not used
+	  * @param offset position from which to start extracting
+	  * @param chunkSize number of bytes to fetch in each request
+	  * @param prefetch if true, the next chunk is requested before the
+	  * current one is received (pipelining), so that the server can send
+	  * it without waiting for a new request
+	  * @param peek if true, do not set the \Seen flag on the message
+	  * @return position after the last byte extracted (ie. the size of
+	  * the message or part, if offset is not greater than it)
+	  */
+	int extractChunked(ref <const part> p, utility::outputStream& os,
+		utility::progressListener* progress = NULL, const int offset = 0,
+		const int chunkSize = 262144, const bool prefetch = false,
+		const bool peek = false) const;
+
+	/** Return the size of the contents of a part once decoded,
+	  * as computed by the server (BINARY extension, RFC 3516).
+	  *
+	  * @param p part
+	  * @return decoded size of the part contents, or -1 if the server
+	  * does not support BINARY or cannot decode the part
+	  */
+	int getDecodedPartSize(ref <const part> p) const;
+
 	void fetchPartHeader(ref <part> p);
 
 	ref <vmime::message> getParsedMessage();
@@ -93,6 +138,20 @@ private:
 
 	void processFetchResponse(const int options, const IMAPParser::message_data* msgData);
 
+	/** Fill in the message with metadata found in the cache.
+	  *
+	  * @param options fetch items to take from the entry
+	  * @param entry cache entry for this message
+	  */
+	void processCacheEntry(const int options, const IMAPMetadataCache::entry& entry);
+
+	/** Build a cache entry from the metadata fetched for this message.
+	  *
+	  * @param options fetch items which have been fetched
+	  * @return cache entry
+	  */
+	const IMAPMetadataCache::entry makeCacheEntry(const int options) const;
+
 	/** Recursively fetch part header for all parts in the structure.
 	  *
 	  * @param str structure for which to fetch parts headers
@@ -113,12 +172,48 @@ private:
 	{
 		EXTRACT_HEADER = 0x1,
 		EXTRACT_BODY = 0x2,
-		EXTRACT_PEEK = 0x10
+		EXTRACT_PEEK = 0x10,
+		EXTRACT_BINARY = 0x20   /**< let the server decode the contents (BINARY) */
 	};
 
 	void extractImpl(ref <const part> p, utility::outputStream& os, utility::progressListener* progress,
 		const int start, const int length, const int extractFlags) const;
 
+	const string makeExtractRequest(ref <const part> p,
+		const int start, const int length, const int extractFlags) const;
+
+	/** Return the section identifier of a part (eg. "1.2"), or an
+	  * empty string for the whole message.
+	  */
+	static const string makeSection(ref <const part> p);
+
+	/** Extract the contents of a part (without its header), using
+	  * the content cache of the store if it is enabled.
+	  *
+	  * @param p part to extract
+	  * @param os output stream in which to write contents
+	  * @param progress progress listener, or NULL if not used
+	  */
+	void extractPartContents(ref <const part> p, utility::outputStream& os,
+		utility::progressListener* progress) const;
+
+	/** Extract the decoded contents of a part, if the server can
+	  * decode them (BINARY extension, RFC 3516). The content cache
+	  * of the store is used if it is enabled.
+	  *
+	  * @param p part to extract
+	  * @param os output stream in which to write contents
+	  * @param progress progress listener, or NULL if not used
+	  * @return true if the decoded contents have been extracted, or
+	  * false if the server does not support BINARY or cannot decode
+	  * the part (nothing has been written to the stream)
+	  */
+	bool extractDecodedPartContents(ref <const part> p, utility::outputStream& os,
+		utility::progressListener* progress) const;
+
+	void extractPartContentsImpl(ref <const part> p, utility::outputStream& os,
+		utility::progressListener* progress, const int extractFlags) const;
+
 
 	ref <header> getOrCreateHeader();
 
@@ -127,11 +222,13 @@ private:
 
 	weak_ref <IMAPFolder> m_folder;
 
-	int m_num;
+	int m_num;  // only valid when the folder is closed
+	IMAPMessageRegistry::slot m_slot;
 	int m_size;
 	int m_flags;
-	bool m_expunged;
+	bool m_expunged;  // only valid when the folder is closed
 	uid m_uid;
+	string m_modseq;
 
 	ref <header> m_header;
 	ref <structure> m_structure;
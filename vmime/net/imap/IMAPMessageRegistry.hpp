@@ -0,0 +1,158 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002-2013 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+
+#ifndef VMIME_NET_IMAP_IMAPMESSAGEREGISTRY_HPP_INCLUDED
+#define VMIME_NET_IMAP_IMAPMESSAGEREGISTRY_HPP_INCLUDED
+
+
+#include "vmime/config.hpp"
+
+
+#if VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_IMAP
+
+
+#include "vmime/types.hpp"
+
+#include <vector>
+#include <map>
+
+
+namespace vmime {
+namespace net {
+namespace imap {
+
+
+class IMAPMessage;
+
+
+/** Keeps track of the message objects of a folder, and of their sequence
+  * numbers as messages are expunged.
+  *
+  * Each message number is associated with a slot, which does not change
+  * when messages are expunged. Sequence numbers are computed from a
+  * binary indexed tree (Fenwick tree) holding which slots are still
+  * alive, so that registering, unregistering and looking up a message,
+  * and processing an expunge, are all done in logarithmic time.
+  */
+class VMIME_EXPORT IMAPMessageRegistry
+{
+public:
+
+	typedef unsigned int slot;
+
+	IMAPMessageRegistry();
+
+	/** Register a message object.
+	  *
+	  * @param msg message object
+	  * @param num current sequence number of the message
+	  * @return slot of the message, to be given to the other functions
+	  */
+	slot add(IMAPMessage* msg, const int num);
+
+	/** Unregister a message object.
+	  *
+	  * @param msg message object
+	  * @param s slot returned by add()
+	  */
+	void remove(IMAPMessage* msg, const slot s);
+
+	/** Remove all message objects and reset the numbering.
+	  */
+	void clear();
+
+	/** Notify that a message has been expunged. The numbers of the
+	  * messages which follow it are decremented.
+	  *
+	  * @param num sequence number of the expunged message
+	  */
+	void expunge(const int num);
+
+	/** Return the current sequence number of a message. For an expunged
+	  * message, this is the number it would have if it was still in the
+	  * folder.
+	  *
+	  * @param s slot of the message
+	  * @return sequence number
+	  */
+	int getNumber(const slot s) const;
+
+	/** Test whether a message has been expunged.
+	  *
+	  * @param s slot of the message
+	  * @return true if the message has been expunged, false otherwise
+	  */
+	bool isExpunged(const slot s) const;
+
+	/** Return the message objects whose number is in the specified
+	  * range; expunged messages are not returned.
+	  *
+	  * @param from first sequence number
+	  * @param to last sequence number, or -1 for the last message
+	  * @param msgs will receive the message objects, in number order
+	  */
+	void find(const int from, const int to, std::vector <IMAPMessage*>& msgs) const;
+
+	/** Return all the message objects, including expunged messages.
+	  *
+	  * @param msgs will receive the message objects, in number order
+	  */
+	void getAll(std::vector <IMAPMessage*>& msgs) const;
+
+	/** Return the number of registered message objects.
+	  *
+	  * @return number of message objects
+	  */
+	size_t size() const;
+
+private:
+
+	/** Append slots until the specified number has one. */
+	void grow(const int num);
+
+	/** Return the number of alive slots up to the specified one. */
+	int prefixCount(const slot s) const;
+
+	/** Return the slot which has the specified number. */
+	slot findSlot(const int num) const;
+
+
+	// Binary indexed tree of alive slots (index 0 is not used)
+	std::vector <int> m_tree;
+	std::vector <bool> m_alive;
+
+	int m_aliveCount;
+
+	std::multimap <slot, IMAPMessage*> m_messages;
+};
+
+
+} // imap
+} // net
+} // vmime
+
+
+#endif // VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_IMAP
+
+#endif // VMIME_NET_IMAP_IMAPMESSAGEREGISTRY_HPP_INCLUDED
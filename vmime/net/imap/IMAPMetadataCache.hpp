@@ -0,0 +1,182 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002-2013 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+
+#ifndef VMIME_NET_IMAP_IMAPMETADATACACHE_HPP_INCLUDED
+#define VMIME_NET_IMAP_IMAPMETADATACACHE_HPP_INCLUDED
+
+
+#include "vmime/config.hpp"
+
+
+#if VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_IMAP
+
+
+#include "vmime/net/message.hpp"
+
+#include "vmime/utility/file.hpp"
+#include "vmime/utility/sync/criticalSection.hpp"
+
+#include <map>
+
+
+namespace vmime {
+namespace net {
+namespace imap {
+
+
+class IMAPStructure;
+class IMAPPart;
+
+
+/** Persistent cache for message metadata which never changes for a
+  * given message (envelope, structure, size and header fields).
+  *
+  * Entries are keyed by mailbox name, UIDVALIDITY and UID. Each mailbox
+  * is stored in its own directory as a set of append-only segment files
+  * made of compact binary records; all the entries of a mailbox are
+  * loaded in memory the first time it is accessed. When UIDVALIDITY
+  * changes, all the entries of the mailbox are discarded.
+  */
+
+class VMIME_EXPORT IMAPMetadataCache : public object
+{
+public:
+
+	/** Fetch items (folder::FETCH_* flags) which can be cached. */
+	static const int CACHEABLE_OPTIONS;
+
+	/** Metadata stored for a message.
+	  */
+	struct entry
+	{
+		entry();
+
+		int options;       /**< fetch items covered by this entry */
+		int size;          /**< message size (FETCH_SIZE) */
+		string header;     /**< generated header fields, or empty */
+		string structure;  /**< serialized structure (FETCH_STRUCTURE) */
+	};
+
+
+	/** Construct a new cache.
+	  *
+	  * @param dir directory in which the cache files are stored
+	  * (it will be created if it does not exist)
+	  */
+	IMAPMetadataCache(const utility::file::path& dir);
+
+	/** Find the cached metadata for a message.
+	  *
+	  * @param mailbox mailbox name
+	  * @param uidValidity UIDVALIDITY of the mailbox
+	  * @param uid message UID
+	  * @param e will receive the entry, if found
+	  * @return true if the entry was found, false otherwise
+	  */
+	bool getEntry(const string& mailbox, const unsigned int uidValidity,
+		const unsigned int uid, entry& e);
+
+	/** Store the metadata for a message. The entry is merged with
+	  * the existing one, if any. It is not written to disk until
+	  * flush() is called.
+	  *
+	  * @param mailbox mailbox name
+	  * @param uidValidity UIDVALIDITY of the mailbox
+	  * @param uid message UID
+	  * @param e entry to store
+	  */
+	void putEntry(const string& mailbox, const unsigned int uidValidity,
+		const unsigned int uid, const entry& e);
+
+	/** Write the new entries to disk.
+	  *
+	  * @throw exceptions::filesystem_exception if an error occurs
+	  */
+	void flush();
+
+	/** Test whether an entry contains all the requested fetch items.
+	  *
+	  * @param e cache entry
+	  * @param options fetch items (folder::FETCH_* flags)
+	  * @return true if the entry can be used instead of fetching
+	  * the items from the server, false otherwise
+	  */
+	static bool covers(const entry& e, const int options);
+
+	/** Serialize a message structure into a compact binary form.
+	  *
+	  * @param str structure to serialize
+	  * @return serialized structure
+	  */
+	static const string serializeStructure(ref <const structure> str);
+
+	/** Rebuild a message structure serialized by serializeStructure().
+	  *
+	  * @param data serialized structure
+	  * @return structure, or NULL if the data is invalid
+	  */
+	static ref <IMAPStructure> deserializeStructure(const string& data);
+
+private:
+
+	struct mailboxEntries
+	{
+		mailboxEntries();
+
+		unsigned int uidValidity;
+		std::map <unsigned int, entry> entries;
+		std::map <unsigned int, entry> dirty;
+		unsigned int nextSegment;
+		unsigned int segmentCount;
+	};
+
+	mailboxEntries& getMailbox(const string& mailbox, const unsigned int uidValidity);
+
+	void loadMailbox(const string& mailbox, mailboxEntries& mbox);
+	void clearMailbox(const string& mailbox, mailboxEntries& mbox);
+	void writeSegment(const string& mailbox, mailboxEntries& mbox,
+		const std::map <unsigned int, entry>& entries);
+
+	const utility::file::path getMailboxPath(const string& mailbox) const;
+
+	static ref <IMAPStructure> deserializeStructureImpl(const string& data,
+		string::size_type& pos, ref <IMAPPart> parent, const int level);
+
+
+	utility::file::path m_dir;
+
+	std::map <string, mailboxEntries> m_mailboxes;
+
+	ref <utility::sync::criticalSection> m_lock;
+};
+
+
+} // imap
+} // net
+} // vmime
+
+
+#endif // VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_IMAP
+
+#endif // VMIME_NET_IMAP_IMAPMETADATACACHE_HPP_INCLUDED
@@ -154,6 +154,30 @@ public:
 		return m_tag.acquire();
 	}
 
+	/** Set the tag expected in the next tagged response. This is needed
+	  * when several commands have been sent without waiting for their
+	  * responses (pipelining).
+	  *
+	  * @param tag expected tag, or an empty string to expect the tag
+	  * of the last command sent (the default)
+	  */
+	void setExpectedTag(const string& tag)
+	{
+		m_expectedTag = tag;
+	}
+
+	/** Return the tag expected in the next tagged response.
+	  *
+	  * @return expected tag
+	  */
+	const string getExpectedTag() const
+	{
+		if (m_expectedTag.empty())
+			return string(*getTag());
+
+		return m_expectedTag;
+	}
+
 	void setSocket(ref <socket> sok)
 	{
 		m_socket = sok;
@@ -483,7 +507,7 @@ public:
 				}
 			}
 
-			if (tagString == string(*parser.getTag()))
+			if (tagString == parser.getExpectedTag())
 			{
 				*currentPos = pos;
 			}
@@ -576,6 +600,96 @@ public:
 	};
 
 
+	//
+	// mod_seq_value  ::= 1*DIGIT
+	//                    ;; Positive unsigned 64-bit integer (RFC 7162)
+	//
+	// The value is kept as a string, as it may not fit in 32 bits.
+	//
+
+	class mod_seq_value : public component
+	{
+	public:
+
+		void go(IMAPParser& /* parser */, string& line, string::size_type* currentPos)
+		{
+			DEBUG_ENTER_COMPONENT("mod_seq_value");
+
+			string::size_type pos = *currentPos;
+
+			while (pos < line.length() && line[pos] >= '0' && line[pos] <= '9')
+				++pos;
+
+			if (pos != *currentPos)
+			{
+				m_value = string(line.begin() + *currentPos, line.begin() + pos);
+				*currentPos = pos;
+			}
+			else
+			{
+				throw exceptions::invalid_response("", makeResponseLine("mod_seq_value", line, pos));
+			}
+		}
+
+	private:
+
+		string m_value;
+
+	public:
+
+		const string& value() const { return (m_value); }
+	};
+
+
+	//
+	// sequence_set  ::= (seq_number / seq_range) *("," sequence_set)
+	// seq_range     ::= seq_number ":" seq_number
+	// seq_number    ::= nz_number / "*"
+	//
+	// The set is kept in its textual form.
+	//
+
+	class sequence_set : public component
+	{
+	public:
+
+		void go(IMAPParser& /* parser */, string& line, string::size_type* currentPos)
+		{
+			DEBUG_ENTER_COMPONENT("sequence_set");
+
+			string::size_type pos = *currentPos;
+
+			while (pos < line.length())
+			{
+				const char c = line[pos];
+
+				if ((c >= '0' && c <= '9') || c == ':' || c == ',' || c == '*')
+					++pos;
+				else
+					break;
+			}
+
+			if (pos != *currentPos)
+			{
+				m_value = string(line.begin() + *currentPos, line.begin() + pos);
+				*currentPos = pos;
+			}
+			else
+			{
+				throw exceptions::invalid_response("", makeResponseLine("sequence_set", line, pos));
+			}
+		}
+
+	private:
+
+		string m_value;
+
+	public:
+
+		const string& value() const { return (m_value); }
+	};
+
+
 	//
 	// text       ::= 1*TEXT_CHAR
 	//
@@ -939,8 +1053,10 @@ public:
 					DEBUG_FOUND("string[quoted]", "<length=" << m_value.length() << ", value='" << m_value << "'>");
 				}
 				// literal ::= "{" number "}" CRLF *CHAR8
+				// literal8 ::= "~{" number "}" CRLF *OCTET  (RFC 3516)
 				else
 				{
+					parser.check <one_char <'~'> >(line, &pos, true);
 					parser.check <one_char <'{'> >(line, &pos);
 
 					number* num = parser.get <number>(line, &pos);
@@ -1671,19 +1787,35 @@ public:
 	//                    "READ-ONLY" / "READ-WRITE" / "TRYCREATE" /
 	//                    "UIDVALIDITY" SPACE nz_number /
 	//                    "UNSEEN" SPACE nz_number /
+	//                    "HIGHESTMODSEQ" SPACE mod_seq_value /
+	//                    "NOMODSEQ" /
+	//                    "APPENDUID" SPACE nz_number SPACE uid_set /
 	//                    atom [SPACE 1*<any TEXT_CHAR except "]">]
+	//
+	// uid_set         ::= sequence_set   ;; without "*"
+
+	class capability;
 
 	class resp_text_code : public component
 	{
 	public:
 
 		resp_text_code()
-			: m_nz_number(NULL), m_atom(NULL), m_flag_list(NULL), m_text(NULL)
+			: m_nz_number(NULL), m_atom(NULL), m_flag_list(NULL), m_text(NULL),
+			  m_mod_seq_value(NULL), m_uid_set(NULL)
 		{
 		}
 
 		~resp_text_code()
 		{
+			for (std::vector <IMAPParser::capability*>::iterator it = m_capabilities.begin() ;
+			     it != m_capabilities.end() ; ++it)
+			{
+				delete (*it);
+			}
+
+			delete (m_uid_set);
+			delete (m_mod_seq_value);
 			delete (m_nz_number);
 			delete (m_atom);
 			delete (m_flag_list);
@@ -1746,6 +1878,45 @@ public:
 				parser.check <SPACE>(line, &pos);
 				m_nz_number = parser.get <IMAPParser::nz_number>(line, &pos);
 			}
+			// "HIGHESTMODSEQ" SPACE mod_seq_value
+			else if (parser.checkWithArg <special_atom>(line, &pos, "highestmodseq", true))
+			{
+				m_type = HIGHESTMODSEQ;
+
+				parser.check <SPACE>(line, &pos);
+				m_mod_seq_value = parser.get <IMAPParser::mod_seq_value>(line, &pos);
+			}
+			// "NOMODSEQ"
+			else if (parser.checkWithArg <special_atom>(line, &pos, "nomodseq", true))
+			{
+				m_type = NOMODSEQ;
+			}
+			// "APPENDUID" SPACE nz_number SPACE uid_set
+			else if (parser.checkWithArg <special_atom>(line, &pos, "appenduid", true))
+			{
+				m_type = APPENDUID;
+
+				parser.check <SPACE>(line, &pos);
+				m_nz_number = parser.get <IMAPParser::nz_number>(line, &pos);
+
+				parser.check <SPACE>(line, &pos);
+				m_uid_set = parser.get <IMAPParser::sequence_set>(line, &pos);
+			}
+			// "CAPABILITY" SPACE capability *(SPACE capability)  ;; RFC 3501
+			else if (parser.checkWithArg <special_atom>(line, &pos, "capability", true))
+			{
+				m_type = CAPABILITY;
+
+				while (parser.check <SPACE>(line, &pos, true))
+				{
+					IMAPParser::capability* cap =
+						parser.get <IMAPParser::capability>(line, &pos, /* noThrow */ true);
+
+					if (cap == NULL) break;
+
+					m_capabilities.push_back(cap);
+				}
+			}
 			// atom [SPACE 1*<any TEXT_CHAR except "]">]
 			else
 			{
@@ -1771,6 +1942,10 @@ public:
 			TRYCREATE,
 			UIDVALIDITY,
 			UNSEEN,
+			HIGHESTMODSEQ,
+			NOMODSEQ,
+			APPENDUID,
+			CAPABILITY,
 			OTHER
 		};
 
@@ -1782,6 +1957,9 @@ public:
 		IMAPParser::atom* m_atom;
 		IMAPParser::flag_list* m_flag_list;
 		IMAPParser::text* m_text;
+		IMAPParser::mod_seq_value* m_mod_seq_value;
+		IMAPParser::sequence_set* m_uid_set;
+		std::vector <IMAPParser::capability*> m_capabilities;
 
 	public:
 
@@ -1791,6 +1969,9 @@ public:
 		const IMAPParser::atom* atom() const { return (m_atom); }
 		const IMAPParser::flag_list* flag_list() const { return (m_flag_list); }
 		const IMAPParser::text* text() const { return (m_text); }
+		const IMAPParser::mod_seq_value* mod_seq_value() const { return (m_mod_seq_value); }
+		const IMAPParser::sequence_set* uid_set() const { return (m_uid_set); }
+		const std::vector <IMAPParser::capability*>& capabilities() const { return (m_capabilities); }
 	};
 
 
@@ -2087,11 +2268,19 @@ public:
 	//                     ;; compatibility MUST list "IMAP4" as the first
 	//                     ;; capability.
 	//
+	// enable_data ::= "ENABLED" *(SPACE capability)
+	//                 ;; RFC 5161, parsed as capability_data
+	//
 
 	class capability_data : public component
 	{
 	public:
 
+		capability_data()
+			: m_enabled(false)
+		{
+		}
+
 		~capability_data()
 		{
 			for (std::vector <capability*>::iterator it = m_capabilities.begin() ;
@@ -2107,7 +2296,10 @@ public:
 
 			string::size_type pos = *currentPos;
 
-			parser.checkWithArg <special_atom>(line, &pos, "capability");
+			if (parser.checkWithArg <special_atom>(line, &pos, "enabled", true))
+				m_enabled = true;
+			else
+				parser.checkWithArg <special_atom>(line, &pos, "capability");
 
 			while (parser.check <SPACE>(line, &pos, true))
 			{
@@ -2129,10 +2321,12 @@ public:
 	private:
 
 		std::vector <capability*> m_capabilities;
+		bool m_enabled;
 
 	public:
 
 		const std::vector <capability*>& capabilities() const { return (m_capabilities); }
+		bool enabled() const { return (m_enabled); }
 	};
 
 
@@ -3829,6 +4023,9 @@ public:
 	//                  "RFC822.SIZE" SPACE number /
 	//                  "BODY" ["STRUCTURE"] SPACE body /
 	//                  "BODY" section ["<" number ">"] SPACE nstring /
+	//                  "BINARY" section ["<" number ">"] SPACE (nstring / literal8) /
+	//                  "BINARY.SIZE" section SPACE number /
+	//                  "MODSEQ" SPACE "(" mod_seq_value ")" /
 	//                  "UID" SPACE uniqueid
 	//
 
@@ -3839,7 +4036,7 @@ public:
 		msg_att_item()
 			: m_date_time(NULL), m_number(NULL), m_envelope(NULL),
 			  m_uniqueid(NULL), m_nstring(NULL), m_body(NULL), m_flag_list(NULL),
-			  m_section(NULL)
+			  m_section(NULL), m_mod_seq_value(NULL)
 
 		{
 		}
@@ -3854,6 +4051,7 @@ public:
 			delete (m_body);
 			delete (m_flag_list);
  			delete (m_section);
+			delete (m_mod_seq_value);
 		}
 
 		void go(IMAPParser& parser, string& line, string::size_type* currentPos)
@@ -3964,6 +4162,46 @@ public:
 					m_body = parser.get <IMAPParser::body>(line, &pos);
 				}
 			}
+			// "BINARY.SIZE" section_binary SPACE number
+			else if (parser.checkWithArg <special_atom>(line, &pos, "binary.size", true))
+			{
+				m_type = BINARY_SIZE;
+
+				m_section = parser.get <IMAPParser::section>(line, &pos);
+
+				parser.check <SPACE>(line, &pos);
+				m_number = parser.get <IMAPParser::number>(line, &pos);
+			}
+			// "BINARY" section_binary ["<" number ">"] SPACE (nstring / literal8)
+			else if (parser.checkWithArg <special_atom>(line, &pos, "binary", true))
+			{
+				m_type = BINARY_SECTION;
+
+				m_section = parser.get <IMAPParser::section>(line, &pos);
+
+				if (parser.check <one_char <'<'> >(line, &pos, true))
+				{
+					m_number = parser.get <IMAPParser::number>(line, &pos);
+					parser.check <one_char <'>'> >(line, &pos);
+				}
+
+				parser.check <SPACE>(line, &pos);
+
+				m_nstring = parser.getWithArgs <IMAPParser::nstring>
+					(line, &pos, this, BINARY_SECTION);
+			}
+			// "MODSEQ" SPACE "(" mod_seq_value ")"
+			else if (parser.checkWithArg <special_atom>(line, &pos, "modseq", true))
+			{
+				m_type = MODSEQ;
+
+				parser.check <SPACE>(line, &pos);
+				parser.check <one_char <'('> >(line, &pos);
+
+				m_mod_seq_value = parser.get <IMAPParser::mod_seq_value>(line, &pos);
+
+				parser.check <one_char <')'> >(line, &pos);
+			}
 			// "UID" SPACE uniqueid
 			else
 			{
@@ -3991,6 +4229,9 @@ public:
 			BODY,
 			BODY_SECTION,
 			BODY_STRUCTURE,
+			BINARY_SECTION,
+			BINARY_SIZE,
+			MODSEQ,
 			UID
 		};
 
@@ -4006,6 +4247,7 @@ public:
 		IMAPParser::xbody* m_body;
 		IMAPParser::flag_list* m_flag_list;
 		IMAPParser::section* m_section;
+		IMAPParser::mod_seq_value* m_mod_seq_value;
 
 	public:
 
@@ -4019,6 +4261,7 @@ public:
 		const IMAPParser::xbody* body() const { return (m_body); }
 		const IMAPParser::flag_list* flag_list() const { return (m_flag_list); }
 		const IMAPParser::section* section() const { return (m_section); }
+		const IMAPParser::mod_seq_value* mod_seq_value() const { return (m_mod_seq_value); }
 	};
 
 
@@ -4361,7 +4604,14 @@ public:
 	//                  "STATUS" SPACE mailbox SPACE
 	//                    "(" #<status_att number ")" /
 	//                  number SPACE "EXISTS" /
-	//                  number SPACE "RECENT"
+	//                  number SPACE "RECENT" /
+	//                  "VANISHED" [SPACE "(EARLIER)"] SPACE sequence_set /
+	//                  "ESEARCH" [SPACE "(" "TAG" SPACE string ")"] [SPACE "UID"]
+	//                    *(SPACE search_return_data)
+	//
+	// search_return_data ::= "MIN" SPACE nz_number / "MAX" SPACE nz_number /
+	//                        "ALL" SPACE sequence_set / "COUNT" SPACE number /
+	//                        atom SPACE atom
 	//
 
 	class mailbox_data : public component
@@ -4370,13 +4620,19 @@ public:
 
 		mailbox_data()
 			: m_number(NULL), m_mailbox_flag_list(NULL), m_mailbox_list(NULL),
-			  m_mailbox(NULL), m_text(NULL)
+			  m_mailbox(NULL), m_text(NULL), m_sequence_set(NULL), m_earlier(false),
+			  m_esearch_uid(false), m_esearch_min(NULL), m_esearch_max(NULL),
+			  m_esearch_count(NULL)
 		{
 		}
 
 		~mailbox_data()
 		{
 			delete (m_number);
+			delete (m_esearch_min);
+			delete (m_esearch_max);
+			delete (m_esearch_count);
+			delete (m_sequence_set);
 			delete (m_mailbox_flag_list);
 			delete (m_mailbox_list);
 			delete (m_mailbox);
@@ -4473,6 +4729,83 @@ public:
 
 					m_type = SEARCH;
 				}
+				// "ESEARCH" [SPACE "(" "TAG" SPACE string ")"] [SPACE "UID"]
+				//   *(SPACE search_return_data)
+				else if (parser.checkWithArg <special_atom>(line, &pos, "esearch", true))
+				{
+					while (parser.check <SPACE>(line, &pos, true))
+					{
+						if (parser.check <one_char <'('> >(line, &pos, true))
+						{
+							parser.checkWithArg <special_atom>(line, &pos, "tag");
+							parser.check <SPACE>(line, &pos);
+
+							utility::auto_ptr <xstring> tag(parser.get <xstring>(line, &pos));
+							m_esearch_tag = tag->value();
+
+							parser.check <one_char <')'> >(line, &pos);
+						}
+						else if (parser.checkWithArg <special_atom>(line, &pos, "uid", true))
+						{
+							m_esearch_uid = true;
+						}
+						else if (parser.checkWithArg <special_atom>(line, &pos, "min", true))
+						{
+							parser.check <SPACE>(line, &pos);
+
+							delete (m_esearch_min);
+							m_esearch_min = parser.get <nz_number>(line, &pos);
+						}
+						else if (parser.checkWithArg <special_atom>(line, &pos, "max", true))
+						{
+							parser.check <SPACE>(line, &pos);
+
+							delete (m_esearch_max);
+							m_esearch_max = parser.get <nz_number>(line, &pos);
+						}
+						else if (parser.checkWithArg <special_atom>(line, &pos, "count", true))
+						{
+							parser.check <SPACE>(line, &pos);
+
+							delete (m_esearch_count);
+							m_esearch_count = parser.get <IMAPParser::number>(line, &pos);
+						}
+						else if (parser.checkWithArg <special_atom>(line, &pos, "all", true))
+						{
+							parser.check <SPACE>(line, &pos);
+
+							delete (m_sequence_set);
+							m_sequence_set = parser.get <IMAPParser::sequence_set>(line, &pos);
+						}
+						else
+						{
+							// Unknown return data (eg. "MODSEQ"): ignore it
+							utility::auto_ptr <atom> name(parser.get <atom>(line, &pos));
+							parser.check <SPACE>(line, &pos);
+							utility::auto_ptr <atom> value(parser.get <atom>(line, &pos));
+						}
+					}
+
+					m_type = ESEARCH;
+				}
+				// "VANISHED" [SPACE "(EARLIER)"] SPACE sequence_set
+				else if (parser.checkWithArg <special_atom>(line, &pos, "vanished", true))
+				{
+					parser.check <SPACE>(line, &pos);
+
+					if (parser.check <one_char <'('> >(line, &pos, true))
+					{
+						parser.checkWithArg <special_atom>(line, &pos, "earlier");
+						parser.check <one_char <')'> >(line, &pos);
+						parser.check <SPACE>(line, &pos);
+
+						m_earlier = true;
+					}
+
+					m_sequence_set = parser.get <IMAPParser::sequence_set>(line, &pos);
+
+					m_type = VANISHED;
+				}
 				// "STATUS" SPACE mailbox SPACE
 				// "(" #<status_att number)] ")"
 				//
@@ -4512,7 +4845,9 @@ public:
 			SEARCH,
 			STATUS,
 			EXISTS,
-			RECENT
+			RECENT,
+			VANISHED,
+			ESEARCH
 		};
 
 	private:
@@ -4524,6 +4859,13 @@ public:
 		IMAPParser::mailbox_list* m_mailbox_list;
 		IMAPParser::mailbox* m_mailbox;
 		IMAPParser::text* m_text;
+		IMAPParser::sequence_set* m_sequence_set;
+		bool m_earlier;
+		string m_esearch_tag;
+		bool m_esearch_uid;
+		IMAPParser::nz_number* m_esearch_min;
+		IMAPParser::nz_number* m_esearch_max;
+		IMAPParser::number* m_esearch_count;
 		std::vector <nz_number*> m_search_nz_number_list;
 		std::vector <status_info*> m_status_info_list;
 
@@ -4538,6 +4880,13 @@ public:
 		const IMAPParser::text* text() const { return (m_text); }
 		const std::vector <nz_number*>& search_nz_number_list() const { return (m_search_nz_number_list); }
 		const std::vector <status_info*>& status_info_list() const { return (m_status_info_list); }
+		const IMAPParser::sequence_set* sequence_set() const { return (m_sequence_set); }
+		bool earlier() const { return (m_earlier); }
+		const string& esearch_tag() const { return (m_esearch_tag); }
+		bool esearch_uid() const { return (m_esearch_uid); }
+		const IMAPParser::nz_number* esearch_min() const { return (m_esearch_min); }
+		const IMAPParser::nz_number* esearch_max() const { return (m_esearch_max); }
+		const IMAPParser::number* esearch_count() const { return (m_esearch_count); }
 	};
 
 
@@ -4956,6 +5305,15 @@ public:
 	}
 
 
+	response_data* readResponseData()
+	{
+		string::size_type pos = 0;
+		string line = readLine();
+
+		return get <response_data>(line, &pos);
+	}
+
+
 	//
 	// Get a token and advance
 	//
@@ -5072,6 +5430,7 @@ public:
 private:
 
 	weak_ref <IMAPTag> m_tag;
+	string m_expectedTag;
 	weak_ref <socket> m_socket;
 
 	utility::progressListener* m_progress;
@@ -5118,6 +5477,74 @@ public:
 	}
 
 
+	//
+	// Check whether a full response line, along with the literals
+	// it contains, can be read without waiting for more data than
+	// what the socket currently has available
+	//
+
+	bool isResponseDataAvailable()
+	{
+		if (isResponseDataBuffered())
+			return true;
+
+		string receiveBuffer;
+		m_socket.acquire()->receive(receiveBuffer);
+
+		m_buffer += receiveBuffer;
+
+		return isResponseDataBuffered();
+	}
+
+
+	//
+	// Check whether a full response line has been received: each
+	// line ending with a literal ("{" number "}" CRLF) continues
+	// after the literal data
+	//
+
+	bool isResponseDataBuffered() const
+	{
+		string::size_type pos = 0;
+
+		while (true)
+		{
+			const string::size_type eol = m_buffer.find('\n', pos);
+
+			if (eol == string::npos)
+				return false;
+
+			string::size_type end = eol;
+
+			if (end > pos && m_buffer[end - 1] == '\r')
+				--end;
+
+			if (end == pos || m_buffer[end - 1] != '}')
+				return true;
+
+			const string::size_type open = m_buffer.rfind('{', end - 1);
+
+			if (open == string::npos || open < pos || open + 2 >= end)
+				return true;
+
+			string::size_type length = 0;
+
+			for (string::size_type i = open + 1 ; i < end - 1 ; ++i)
+			{
+				if (m_buffer[i] < '0' || m_buffer[i] > '9')
+					return true;
+
+				length = length * 10 + (m_buffer[i] - '0');
+			}
+
+			pos = eol + 1 + length;
+
+			if (pos > m_buffer.length())
+				return false;
+		}
+	}
+
+
 	//
 	// Read available data from socket stream
 	//
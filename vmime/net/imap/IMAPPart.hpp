@@ -49,9 +49,11 @@ class VMIME_EXPORT IMAPPart : public part
 private:
 
 	friend class vmime::creator;
+	friend class IMAPMetadataCache;
 
 	IMAPPart(ref <IMAPPart> parent, const int number, const IMAPParser::body_type_mpart* mpart);
 	IMAPPart(ref <IMAPPart> parent, const int number, const IMAPParser::body_type_1part* part);
+	IMAPPart(ref <IMAPPart> parent, const int number, const mediaType& type, const int size);
 
 public:
 
@@ -55,6 +55,15 @@ public:
 		serviceInfos::property PROPERTY_OPTIONS_SASL;
 		serviceInfos::property PROPERTY_OPTIONS_SASL_FALLBACK;
 #endif // VMIME_HAVE_SASL_SUPPORT
+#if VMIME_HAVE_COMPRESSION_SUPPORT
+		serviceInfos::property PROPERTY_OPTIONS_COMPRESS;
+#endif // VMIME_HAVE_COMPRESSION_SUPPORT
+		serviceInfos::property PROPERTY_CONNECTION_POOL_SIZE;
+		serviceInfos::property PROPERTY_CACHE_METADATA_PATH;
+		serviceInfos::property PROPERTY_CACHE_CONTENT_SIZE;
+		serviceInfos::property PROPERTY_CACHE_CONTENT_THRESHOLD;
+		serviceInfos::property PROPERTY_CACHE_CONTENT_PATH;
+		serviceInfos::property PROPERTY_CACHE_CONTENT_DISK_SIZE;
 
 		// Common properties
 		serviceInfos::property PROPERTY_AUTH_USERNAME;
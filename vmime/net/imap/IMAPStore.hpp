@@ -37,6 +37,10 @@
 
 #include "vmime/net/imap/IMAPServiceInfos.hpp"
 #include "vmime/net/imap/IMAPConnection.hpp"
+#include "vmime/net/imap/IMAPMetadataCache.hpp"
+#include "vmime/net/imap/IMAPContentCache.hpp"
+
+#include "vmime/utility/sync/criticalSection.hpp"
 
 
 namespace vmime {
@@ -87,6 +91,49 @@ public:
 	bool isSecuredConnection() const;
 	ref <connectionInfos> getConnectionInfos() const;
 
+	/** Status of a folder, as returned by getFoldersStatus().
+	  */
+	struct folderStatus
+	{
+		folderStatus();
+
+		/** Folder (not open). */
+		ref <folder> mailbox;
+
+		/** Whether the counters below are valid. This is false
+		  * for folders which cannot contain messages. */
+		bool hasStatus;
+
+		/** Number of messages in the folder. */
+		int messageCount;
+
+		/** Number of messages without the \Seen flag. */
+		int unseenCount;
+
+		/** Next UID which will be assigned, or 0 if unknown. */
+		unsigned int uidNext;
+	};
+
+	/** List the folders under the specified path along with their
+	  * message counts, in a single round-trip if the server supports
+	  * the LIST-STATUS extension (RFC 5819). Otherwise, the STATUS
+	  * commands are pipelined after the LIST command.
+	  *
+	  * @param path path of the parent folder (root folder if empty)
+	  * @param recursive if true, list all sub-folders; otherwise,
+	  * list only the direct children of the folder
+	  * @return folders and their status
+	  */
+	const std::vector <folderStatus> getFoldersStatus
+		(const folder::path& path = folder::path(), const bool recursive = true);
+
+	/** Return the maximum number of idle connections kept by this
+	  * store for reuse ("connection.pool.size" property).
+	  *
+	  * @return pool size, or 0 if connection pooling is disabled
+	  */
+	int getConnectionPoolSize() const;
+
 protected:
 
 	// Connection
@@ -96,10 +143,56 @@ protected:
 
 	ref <IMAPConnection> connection();
 
+	/** Take an idle connection from the pool, or open a new one
+	  * if the pool is empty.
+	  *
+	  * @return authenticated connection, to be given back with
+	  * releaseConnection() when it is not needed anymore
+	  */
+	ref <IMAPConnection> acquireConnection();
+
+	/** Give back a connection obtained with acquireConnection().
+	  * The connection is kept in the pool if it is still usable and
+	  * the pool is not full; otherwise, it is closed.
+	  *
+	  * @param cnt connection to release
+	  */
+	void releaseConnection(ref <IMAPConnection> cnt);
+
+	/** Return the metadata cache used by this store.
+	  *
+	  * @return metadata cache, or NULL if caching is disabled
+	  */
+	ref <IMAPMetadataCache> getMetadataCache();
+
+	ref <IMAPMetadataCache> m_metadataCache;
+
+	/** Return the content cache used by this store.
+	  *
+	  * @return content cache, or NULL if caching is disabled
+	  */
+	ref <IMAPContentCache> getContentCache();
+
+	ref <IMAPContentCache> m_contentCache;
+
+	// Idle connections
+	std::vector <ref <IMAPConnection> > m_pool;
+
+	// Protects the pool and the list of folders
+	ref <utility::sync::criticalSection> m_lock;
+
 
 	void registerFolder(IMAPFolder* folder);
 	void unregisterFolder(IMAPFolder* folder);
 
+	/** Return the folders of this store which are in use. The list
+	  * is copied with the lock held, so that the folders can then be
+	  * notified while other threads create or release folders.
+	  *
+	  * @param folders will receive the folders
+	  */
+	void getFolders(std::vector <ref <IMAPFolder> >& folders);
+
 	std::list <IMAPFolder*> m_folders;
 
 	const bool m_isIMAPS;  // Use IMAPS
@@ -51,6 +51,7 @@ public:
 	IMAPStructure();
 	IMAPStructure(const IMAPParser::body* body);
 	IMAPStructure(ref <IMAPPart> parent, const std::vector <IMAPParser::body*>& list);
+	IMAPStructure(const std::vector <ref <IMAPPart> >& parts);
 
 	ref <const part> getPartAt(const size_t x) const;
 	ref <part> getPartAt(const size_t x);
@@ -95,6 +95,44 @@ public:
 	  */
 	static const string listToSet(const std::vector <message::uid>& list);
 
+	/** Expand an "IMAP set" into the list of numbers it contains.
+	  * Ranges containing "*" are ignored. The set is parsed with
+	  * setToRanges(), which should be preferred when the set may
+	  * contain large ranges.
+	  *
+	  * Example:
+	  *    IN  = "9:10,1:3,7"
+	  *    OUT = "1,2,3,7,9,10"
+	  *
+	  * @param set IMAP set
+	  * @return list of message numbers or UIDs, in ascending order
+	  * and without duplicates
+	  */
+	static const std::vector <unsigned int> setToList(const string& set);
+
+	/** Parse an "IMAP set" into a list of ranges, without expanding
+	  * them. Ranges are sorted, and overlapping or adjacent ranges are
+	  * merged. Ranges containing "*" are ignored.
+	  *
+	  * Example:
+	  *    IN  = "9:10,1:3,4,7"
+	  *    OUT = "[1,4],[7,7],[9,10]"
+	  *
+	  * @param set IMAP set
+	  * @return sorted list of (first, last) ranges
+	  */
+	static const std::vector <std::pair <unsigned int, unsigned int> > setToRanges(const string& set);
+
+	/** Test whether a number is in a list of ranges returned by
+	  * setToRanges(). This is done in logarithmic time.
+	  *
+	  * @param ranges sorted list of ranges
+	  * @param n number to find
+	  * @return true if the number is in one of the ranges, false otherwise
+	  */
+	static bool isInRanges(const std::vector <std::pair <unsigned int, unsigned int> >& ranges,
+		const unsigned int n);
+
 	/** Format a date/time to IMAP date/time format.
 	  *
 	  * @param date date/time to format
@@ -102,6 +140,19 @@ public:
 	  */
 	static const string dateTime(const vmime::datetime& date);
 
+	/** Build the IMAP search keys corresponding to the specified criteria.
+	  *
+	  * Strings which cannot be sent as quoted strings (8-bit data, CR or LF)
+	  * must be sent as literals. The output alternates text and literal
+	  * data: parts[0] is text, parts[1] is a literal to send after
+	  * parts[0], parts[2] is text, and so on. The number of parts is
+	  * always odd.
+	  *
+	  * @param criteria search criteria
+	  * @param parts will receive the search keys
+	  */
+	static void buildSearchKeys(const searchCriteria& criteria, std::vector <string>& parts);
+
 	/** Construct a fetch request for the specified messages, designated by their sequence numbers.
 	  *
 	  * @param list list of message numbers
@@ -144,6 +195,11 @@ private:
 
 	static const string buildFetchRequestImpl
 		(const string& mode, const string& set, const int options);
+
+	static void buildSearchKeysImpl
+		(const searchCriteria& criteria, const bool topLevel, std::vector <string>& parts);
+
+	static void appendSearchString(const string& str, std::vector <string>& parts);
 };
 
 
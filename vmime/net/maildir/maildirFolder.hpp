@@ -126,6 +126,7 @@ public:
 	ref <store> getStore();
 
 
+	using folder::fetchMessages;
 	void fetchMessages(std::vector <ref <message> >& msg, const int options, utility::progressListener* progress = NULL);
 	void fetchMessage(ref <message> msg, const int options);
 
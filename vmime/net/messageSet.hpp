@@ -0,0 +1,147 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002-2013 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+#ifndef VMIME_NET_MESSAGESET_HPP_INCLUDED
+#define VMIME_NET_MESSAGESET_HPP_INCLUDED
+
+
+#include "vmime/config.hpp"
+
+
+#if VMIME_HAVE_MESSAGING_FEATURES
+
+
+#include <vector>
+
+#include "vmime/types.hpp"
+
+#include "vmime/net/searchCriteria.hpp"
+
+
+namespace vmime {
+namespace net {
+
+
+/** A set of message sequence numbers.
+  *
+  * Numbers are kept as a sorted list of disjoint ranges, so that a set
+  * covering a whole mailbox costs a few bytes, whatever the number of
+  * messages. Unlike folder::getMessages(), building a set does not create
+  * any message object: see folder::fetchMessages(const messageSet&, ...).
+  */
+
+class VMIME_EXPORT messageSet
+{
+public:
+
+	/** A range of consecutive numbers, bounds included. An upper
+	  * bound of -1 stands for the last message in the folder.
+	  */
+	typedef std::pair <int, int> range;
+
+
+	/** Construct an empty set.
+	  */
+	messageSet();
+
+	/** Create a set from a range of sequence numbers.
+	  *
+	  * @param from sequence number of the first message
+	  * @param to sequence number of the last message, or -1 for
+	  * the last message in the folder
+	  * @return a new set
+	  */
+	static const messageSet byNumber(const int from, const int to = -1);
+
+	/** Create a set from a list of sequence numbers.
+	  *
+	  * @param nums sequence numbers, in any order
+	  * @return a new set
+	  */
+	static const messageSet byNumber(const std::vector <int>& nums);
+
+	/** Create a set from the numbers matched by a search.
+	  *
+	  * @param result search result (see folder::search())
+	  * @return a new set
+	  */
+	static const messageSet byNumber(const searchResult& result);
+
+
+	/** Add a sequence number to this set.
+	  *
+	  * @param num sequence number
+	  */
+	void addNumber(const int num);
+
+	/** Add a range of sequence numbers to this set.
+	  *
+	  * @param from sequence number of the first message
+	  * @param to sequence number of the last message, or -1 for
+	  * the last message in the folder
+	  */
+	void addRange(const int from, const int to);
+
+	/** Test whether this set is empty.
+	  *
+	  * @return true if the set contains no number, false otherwise
+	  */
+	bool isEmpty() const;
+
+	/** Test whether this set contains the specified number.
+	  *
+	  * @param num sequence number
+	  * @return true if the number is in the set, false otherwise
+	  */
+	bool contains(const int num) const;
+
+	/** Return the number of messages in this set.
+	  *
+	  * @param messageCount number of messages in the folder, used
+	  * to bound the set
+	  * @return number of messages in the set, between 0 and messageCount
+	  */
+	int getCount(const int messageCount) const;
+
+	/** Return the numbers in this set, as a list of ranges
+	  * in ascending order.
+	  *
+	  * @return list of ranges
+	  */
+	const std::vector <range>& getRanges() const;
+
+private:
+
+	void normalize();
+
+	std::vector <range> m_ranges;
+};
+
+
+} // net
+} // vmime
+
+
+#endif // VMIME_HAVE_MESSAGING_FEATURES
+
+#endif // VMIME_NET_MESSAGESET_HPP_INCLUDED
@@ -63,6 +63,7 @@ class POP3Store;
 class VMIME_EXPORT POP3Connection : public object
 {
 	friend class vmime::creator;
+	friend class POP3Response;
 
 public:
 
@@ -83,6 +84,29 @@ public:
 	virtual ref <security::authenticator> getAuthenticator();
 	virtual ref <session> getSession();
 
+	/** Return whether the server advertises the specified capability
+	  * in response to the CAPA command. The list of capabilities is
+	  * cached until it may change (STLS, authentication).
+	  *
+	  * @param capa capability name (eg. "PIPELINING")
+	  * @return true if the capability is supported, false otherwise
+	  */
+	bool hasCapability(const string& capa);
+
+	/** Send commands from a list, ahead of reading the responses to
+	  * previous commands if the server supports pipelining (PIPELINING
+	  * capability); otherwise, only the next command is sent. Commands
+	  * sent together are written to the socket at once. Responses must
+	  * then be read in the same order.
+	  *
+	  * @param commands list of commands to send
+	  * @param sent number of commands of the list which have already
+	  * been sent; updated to count commands sent by this call
+	  * @param received number of responses which have already been read
+	  */
+	void sendCommands(const std::vector <ref <POP3Command> >& commands,
+		size_t& sent, const size_t received);
+
 private:
 
 	void authenticate(const messageId& randomMID);
@@ -109,6 +133,12 @@ private:
 	bool m_secured;
 
 	ref <connectionInfos> m_cntInfos;
+
+	std::vector <string> m_capabilities;
+	bool m_capabilitiesFetched;
+
+	// Data received, but not read yet by POP3Response
+	string m_receiveBuffer;
 };
 
 
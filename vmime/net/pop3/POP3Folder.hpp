@@ -123,6 +123,7 @@ public:
 	ref <store> getStore();
 
 
+	using folder::fetchMessages;
 	void fetchMessages(std::vector <ref <message> >& msg, const int options, utility::progressListener* progress = NULL);
 	void fetchMessage(ref <message> msg, const int options);
 
@@ -130,6 +131,31 @@ public:
 
 	std::vector <int> getMessageNumbersStartingOnUID(const message::uid& uid);
 
+	/** Return the messages which have not been marked as seen with
+	  * markMessagesSeen(), in this session or in a previous one. Only
+	  * one UIDL command is issued, and the UID of the returned messages
+	  * is already set. The UIDs of the messages which are no longer on
+	  * the server are removed from the seen UID store.
+	  *
+	  * The seen UID store must be enabled with the "seen.path" property.
+	  *
+	  * @return messages which have not been seen yet
+	  * @throw exceptions::illegal_state if the seen UID store is disabled
+	  * @throw exceptions::command_error if the UIDL command fails
+	  */
+	std::vector <ref <message> > getNewMessages();
+
+	/** Mark messages as seen, so that they are not returned anymore
+	  * by getNewMessages(), and write the seen UID store to disk. As the
+	  * whole store is written, mark the messages by batches rather than
+	  * one by one.
+	  *
+	  * @param msgs messages to mark (their UID must have been fetched)
+	  * @throw exceptions::illegal_state if the seen UID store is disabled
+	  * @throw exceptions::unfetched_object if the UID of a message is unknown
+	  */
+	void markMessagesSeen(const std::vector <ref <message> >& msgs);
+
 private:
 
 	void registerMessage(POP3Message* msg);
@@ -139,6 +165,8 @@ private:
 
 	void onClose();
 
+	void deleteMessagesImpl(ref <POP3Store> store, const std::vector <int>& nums);
+
 
 	weak_ref <POP3Store> m_store;
 
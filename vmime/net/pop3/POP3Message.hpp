@@ -41,6 +41,7 @@ namespace pop3 {
 
 
 class POP3Folder;
+class POP3Connection;
 
 
 /** POP3 message implementation.
@@ -87,6 +88,23 @@ private:
 
 	void fetch(ref <POP3Folder> folder, const int options);
 
+	/** Check whether the message can be fetched with the specified
+	  * options, and whether its header must be fetched.
+	  *
+	  * @param folder folder being fetched
+	  * @param options fetch options
+	  * @return true if the header must be fetched (TOP command),
+	  * false if there is nothing to fetch
+	  */
+	bool isHeaderFetchRequired(ref <POP3Folder> folder, const int options);
+
+	/** Read the response to the "TOP n 0" command, and set the header
+	  * of this message.
+	  *
+	  * @param conn connection from which to read
+	  */
+	void readHeader(ref <POP3Connection> conn);
+
 	void onFolderClosed();
 
 	weak_ref <POP3Folder> m_folder;
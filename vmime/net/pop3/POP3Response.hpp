@@ -145,13 +145,17 @@ public:
 
 private:
 
-	POP3Response(ref <socket> sok, ref <timeoutHandler> toh);
+	POP3Response(ref <socket> sok, ref <timeoutHandler> toh, string* receiveBuffer);
 
 	void readResponseImpl(string& buffer, const bool multiLine);
 	void readResponseImpl
 		(string& firstLine, utility::outputStream& os,
 		 utility::progressListener* progress, const long predictedSize);
 
+	void receive(string& buffer);
+
+	static string::size_type findResponseEnd
+		(const string& buffer, const bool multiLine, string::size_type& scanPos);
 
 	static bool stripFirstLine(const string& buffer, string& result, string* firstLine);
 
@@ -166,6 +170,10 @@ private:
 	ref <socket> m_socket;
 	ref <timeoutHandler> m_timeoutHandler;
 
+	// Data received from the server, but not read yet (it may
+	// include responses to pipelined commands); owned by connection
+	string* m_receiveBuffer;
+
 	string m_firstLine;
 	ResponseCode m_code;
 	string m_text;
@@ -0,0 +1,127 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002-2013 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+
+#ifndef VMIME_NET_POP3_POP3SEENUIDSTORE_HPP_INCLUDED
+#define VMIME_NET_POP3_POP3SEENUIDSTORE_HPP_INCLUDED
+
+
+#include "vmime/config.hpp"
+
+
+#if VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_POP3
+
+
+#include "vmime/net/message.hpp"
+
+#include "vmime/utility/file.hpp"
+
+#include <set>
+
+
+namespace vmime {
+namespace net {
+namespace pop3 {
+
+
+/** Persistent set of the UIDs (as returned by the UIDL command) of the
+  * messages which have already been downloaded from a POP3 account.
+  *
+  * This allows to leave messages on the server and download only the
+  * new ones at each session. Each account is stored in its own file,
+  * which contains the sorted list of UIDs; the whole set is loaded in
+  * memory the first time it is accessed.
+  */
+
+class VMIME_EXPORT POP3SeenUIDStore : public object
+{
+public:
+
+	/** Construct a new store.
+	  *
+	  * @param dir directory in which the files are stored (it will
+	  * be created if it does not exist)
+	  * @param account string which identifies the account (eg.
+	  * "user@pop.example.com:110"), used to name the file
+	  */
+	POP3SeenUIDStore(const utility::file::path& dir, const string& account);
+
+	/** Test whether a message has already been seen.
+	  *
+	  * @param uid message UID
+	  * @return true if the UID is in the store, false otherwise
+	  */
+	bool isSeen(const message::uid& uid);
+
+	/** Add a message UID to the store. It is not written to disk
+	  * until flush() is called.
+	  *
+	  * @param uid message UID
+	  */
+	void setSeen(const message::uid& uid);
+
+	/** Remove from the store the UIDs of the messages which are no
+	  * longer on the server, so that the store does not grow forever.
+	  *
+	  * @param uids UIDs of all the messages on the server
+	  */
+	void retain(const std::vector <message::uid>& uids);
+
+	/** Return the number of UIDs in the store.
+	  *
+	  * @return number of UIDs
+	  */
+	int getCount();
+
+	/** Write the store to disk, if it has been modified.
+	  *
+	  * @throw exceptions::filesystem_exception if an error occurs
+	  */
+	void flush();
+
+private:
+
+	void load();
+
+	const utility::file::path getFilePath() const;
+	const utility::file::path getTempFilePath() const;
+
+
+	utility::file::path m_dir;
+	string m_account;
+
+	std::set <message::uid> m_uids;
+
+	bool m_loaded;
+	bool m_modified;
+};
+
+
+} // pop3
+} // net
+} // vmime
+
+
+#endif // VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_POP3
+
+#endif // VMIME_NET_POP3_POP3SEENUIDSTORE_HPP_INCLUDED
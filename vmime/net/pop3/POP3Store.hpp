@@ -35,6 +35,7 @@
 
 #include "vmime/net/pop3/POP3ServiceInfos.hpp"
 #include "vmime/net/pop3/POP3Connection.hpp"
+#include "vmime/net/pop3/POP3SeenUIDStore.hpp"
 
 #include "vmime/utility/stream.hpp"
 
@@ -89,7 +90,15 @@ public:
 
 private:
 
+	/** Return the store of seen message UIDs for this account.
+	  *
+	  * @return seen UID store, or NULL if it is disabled
+	  */
+	ref <POP3SeenUIDStore> getSeenUIDStore();
+
+
 	ref <POP3Connection> m_connection;
+	ref <POP3SeenUIDStore> m_seenUIDStore;
 
 
 	void registerFolder(POP3Folder* folder);
@@ -0,0 +1,390 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002-2013 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+
+#ifndef VMIME_NET_SEARCHCRITERIA_HPP_INCLUDED
+#define VMIME_NET_SEARCHCRITERIA_HPP_INCLUDED
+
+
+#include "vmime/config.hpp"
+
+
+#if VMIME_HAVE_MESSAGING_FEATURES
+
+
+#include <vector>
+
+#include "vmime/types.hpp"
+#include "vmime/dateTime.hpp"
+
+#include "vmime/net/message.hpp"
+
+
+namespace vmime {
+namespace net {
+
+
+/** A condition on messages, used for searching in a folder
+  * (see folder::search()).
+  *
+  * Criteria are built using the static factory functions, and can
+  * be combined with allOf(), anyOf() and negate(). For example, to
+  * search for unseen messages sent by "john" since a date:
+  *
+  * <pre>
+  *    ref <searchCriteria> c = searchCriteria::allOf
+  *        (searchCriteria::flagsUnset(message::FLAG_SEEN),
+  *         searchCriteria::allOf
+  *            (searchCriteria::headerContains("From", "john"),
+  *             searchCriteria::sentSince(date)));
+  * </pre>
+  *
+  * String comparisons are case-insensitive substring matches;
+  * strings are expected to be encoded in UTF-8.
+  */
+
+class VMIME_EXPORT searchCriteria : public object
+{
+	friend class vmime::creator;
+
+public:
+
+	/** Criterion types.
+	  */
+	enum Types
+	{
+		TYPE_ALL,            /**< Matches all messages. */
+		TYPE_AND,            /**< All sub-criteria must match. */
+		TYPE_OR,             /**< At least one sub-criterion must match. */
+		TYPE_NOT,            /**< The sub-criterion must not match. */
+		TYPE_FLAGS_SET,      /**< All the specified flags are set. */
+		TYPE_FLAGS_UNSET,    /**< None of the specified flags is set. */
+		TYPE_HEADER,         /**< A header field contains a string. */
+		TYPE_BODY,           /**< The message body contains a string. */
+		TYPE_TEXT,           /**< The header or the body contains a string. */
+		TYPE_SENT_SINCE,     /**< The "Date" field is on or after a date. */
+		TYPE_SENT_BEFORE,    /**< The "Date" field is before a date. */
+		TYPE_LARGER,         /**< The message is larger than a size. */
+		TYPE_SMALLER         /**< The message is smaller than a size. */
+	};
+
+
+	/** Match all messages.
+	  *
+	  * @return a new criterion
+	  */
+	static ref <searchCriteria> all();
+
+	/** Match messages for which both criteria match.
+	  *
+	  * @param a first criterion
+	  * @param b second criterion
+	  * @return a new criterion
+	  */
+	static ref <searchCriteria> allOf(ref <const searchCriteria> a, ref <const searchCriteria> b);
+
+	/** Match messages for which all the specified criteria match.
+	  *
+	  * @param list criteria (if empty, all messages match)
+	  * @return a new criterion
+	  */
+	static ref <searchCriteria> allOf(const std::vector <ref <const searchCriteria> >& list);
+
+	/** Match messages for which at least one of the criteria matches.
+	  *
+	  * @param a first criterion
+	  * @param b second criterion
+	  * @return a new criterion
+	  */
+	static ref <searchCriteria> anyOf(ref <const searchCriteria> a, ref <const searchCriteria> b);
+
+	/** Match messages for which the specified criterion does not match.
+	  *
+	  * @param c criterion
+	  * @return a new criterion
+	  */
+	static ref <searchCriteria> negate(ref <const searchCriteria> c);
+
+	/** Match messages which have all the specified flags set.
+	  *
+	  * @param flags combination of message::Flags
+	  * @return a new criterion
+	  */
+	static ref <searchCriteria> flagsSet(const int flags);
+
+	/** Match messages which have none of the specified flags set.
+	  *
+	  * @param flags combination of message::Flags
+	  * @return a new criterion
+	  */
+	static ref <searchCriteria> flagsUnset(const int flags);
+
+	/** Match messages having a header field whose (decoded)
+	  * value contains the specified string.
+	  *
+	  * @param fieldName name of the header field (eg. "From")
+	  * @param value string to search for; if empty, only the
+	  * presence of the field is checked
+	  * @return a new criterion
+	  */
+	static ref <searchCriteria> headerContains(const string& fieldName, const string& value);
+
+	/** Match messages whose body contains the specified string.
+	  * Only text parts are searched, after they have been decoded.
+	  *
+	  * @param value string to search for
+	  * @return a new criterion
+	  */
+	static ref <searchCriteria> bodyContains(const string& value);
+
+	/** Match messages whose header or body contains the specified string.
+	  * The body is searched the same way as with bodyContains().
+	  *
+	  * @param value string to search for
+	  * @return a new criterion
+	  */
+	static ref <searchCriteria> textContains(const string& value);
+
+	/** Match messages whose "Date" field is on or after the
+	  * specified day (time and zone are ignored).
+	  *
+	  * @param date date
+	  * @return a new criterion
+	  */
+	static ref <searchCriteria> sentSince(const datetime& date);
+
+	/** Match messages whose "Date" field is before the specified
+	  * day (time and zone are ignored).
+	  *
+	  * @param date date
+	  * @return a new criterion
+	  */
+	static ref <searchCriteria> sentBefore(const datetime& date);
+
+	/** Match messages whose size is larger than the specified size.
+	  *
+	  * @param size size, in bytes
+	  * @return a new criterion
+	  */
+	static ref <searchCriteria> sizeLarger(const int size);
+
+	/** Match messages whose size is smaller than the specified size.
+	  *
+	  * @param size size, in bytes
+	  * @return a new criterion
+	  */
+	static ref <searchCriteria> sizeSmaller(const int size);
+
+
+	/** Return the type of this criterion.
+	  *
+	  * @return criterion type (see searchCriteria::Types)
+	  */
+	Types getType() const;
+
+	/** Return the sub-criteria of a TYPE_AND, TYPE_OR or TYPE_NOT criterion.
+	  *
+	  * @return sub-criteria
+	  */
+	const std::vector <ref <const searchCriteria> >& getChildren() const;
+
+	/** Return the flags of a TYPE_FLAGS_SET or TYPE_FLAGS_UNSET criterion.
+	  *
+	  * @return combination of message::Flags
+	  */
+	int getFlags() const;
+
+	/** Return the header field name of a TYPE_HEADER criterion.
+	  *
+	  * @return field name
+	  */
+	const string& getFieldName() const;
+
+	/** Return the string to search for.
+	  *
+	  * @return string value
+	  */
+	const string& getValue() const;
+
+	/** Return the date of a TYPE_SENT_SINCE or TYPE_SENT_BEFORE criterion.
+	  *
+	  * @return date
+	  */
+	const datetime& getDate() const;
+
+	/** Return the size of a TYPE_LARGER or TYPE_SMALLER criterion.
+	  *
+	  * @return size, in bytes
+	  */
+	int getSize() const;
+
+
+	/** Return the objects which must have been fetched on a
+	  * message before matches() can be called on it.
+	  *
+	  * @return combination of folder::FetchOptions flags
+	  */
+	int getFetchOptions() const;
+
+	/** Test whether this criterion matches the specified message.
+	  * The objects returned by getFetchOptions() must have been
+	  * fetched; the message contents are extracted if the criterion
+	  * contains body or text conditions.
+	  *
+	  * @param msg message to test
+	  * @return true if the message matches, false otherwise
+	  */
+	bool matches(ref <const message> msg) const;
+
+private:
+
+	searchCriteria(const Types type);
+
+	bool matchesImpl(ref <const message> msg, ref <vmime::message>& contents) const;
+
+	static bool headerContains(const header& hdr, const string& fieldName, const string& value);
+	static bool bodyContains(const bodyPart& part, const string& value);
+
+	static bool containsNoCase(const string& str, const string& what);
+
+
+	Types m_type;
+	std::vector <ref <const searchCriteria> > m_children;
+	int m_flags;
+	string m_fieldName;
+	string m_value;
+	datetime m_date;
+	int m_size;
+};
+
+
+/** Result of a search in a folder (see folder::search()).
+  *
+  * Matching message numbers (or UIDs) are kept as a list of ranges,
+  * so that large results stay compact.
+  */
+
+class VMIME_EXPORT searchResult
+{
+public:
+
+	/** Items to return from a search.
+	  */
+	enum ReturnOptions
+	{
+		RETURN_MIN = (1 << 0),     /**< Lowest matching number. */
+		RETURN_MAX = (1 << 1),     /**< Highest matching number. */
+		RETURN_COUNT = (1 << 2),   /**< Number of matching messages. */
+		RETURN_ALL = (1 << 3)      /**< All matching numbers. */
+	};
+
+	/** A range of consecutive numbers, bounds included.
+	  */
+	typedef std::pair <unsigned int, unsigned int> range;
+
+
+	searchResult();
+
+	/** Return which items are available in this result. This may
+	  * include more items than requested.
+	  *
+	  * @return combination of searchResult::ReturnOptions flags
+	  */
+	int getReturnOptions() const;
+
+	/** Return the number of matching messages.
+	  *
+	  * @return number of matching messages
+	  */
+	unsigned int getCount() const;
+
+	/** Return the lowest matching number.
+	  *
+	  * @return lowest matching number, or 0 if nothing matched
+	  */
+	unsigned int getMin() const;
+
+	/** Return the highest matching number.
+	  *
+	  * @return highest matching number, or 0 if nothing matched
+	  */
+	unsigned int getMax() const;
+
+	/** Return the matching numbers, as a list of ranges in
+	  * ascending order. Only available with RETURN_ALL.
+	  *
+	  * @return list of ranges
+	  */
+	const std::vector <range>& getRanges() const;
+
+	/** Return the matching numbers, expanded. Only available
+	  * with RETURN_ALL.
+	  *
+	  * @return list of numbers, in ascending order
+	  */
+	const std::vector <int> getNumbers() const;
+
+	/** Return the matching numbers as an IMAP-style set
+	  * (eg. "1:5,7,10:12"). Only available with RETURN_ALL.
+	  *
+	  * @return set of numbers
+	  */
+	const string getSet() const;
+
+
+	/** Add a number to the result. Numbers must be added in ascending
+	  * order; minimum, maximum and count are updated accordingly.
+	  *
+	  * @param num number to add
+	  */
+	void appendNumber(const unsigned int num);
+
+	/** Set the result from an IMAP-style set (eg. "1:5,7,10:12").
+	  * Minimum, maximum and count are updated accordingly.
+	  *
+	  * @param set set of numbers
+	  */
+	void setSet(const string& set);
+
+	void setReturnOptions(const int options);
+	void setCount(const unsigned int count);
+	void setMin(const unsigned int min);
+	void setMax(const unsigned int max);
+
+private:
+
+	int m_options;
+	unsigned int m_count;
+	unsigned int m_min;
+	unsigned int m_max;
+	std::vector <range> m_ranges;
+};
+
+
+} // net
+} // vmime
+
+
+#endif // VMIME_HAVE_MESSAGING_FEATURES
+
+#endif // VMIME_NET_SEARCHCRITERIA_HPP_INCLUDED
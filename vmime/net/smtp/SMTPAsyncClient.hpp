@@ -0,0 +1,269 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002-2013 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+#ifndef VMIME_NET_SMTP_SMTPASYNCCLIENT_HPP_INCLUDED
+#define VMIME_NET_SMTP_SMTPASYNCCLIENT_HPP_INCLUDED
+
+
+#include "vmime/config.hpp"
+
+
+#if VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_SMTP
+
+
+#include <deque>
+#include <map>
+#include <vector>
+
+#include "vmime/mailbox.hpp"
+#include "vmime/mailboxList.hpp"
+#include "vmime/message.hpp"
+
+#include "vmime/net/socket.hpp"
+#include "vmime/net/transport.hpp"
+
+#include "vmime/net/smtp/SMTPResponse.hpp"
+
+#include "vmime/utility/inputStream.hpp"
+#include "vmime/utility/outputStreamStringAdapter.hpp"
+#include "vmime/utility/filteredStream.hpp"
+
+
+namespace vmime {
+namespace net {
+namespace smtp {
+
+
+class SMTPCommand;
+
+
+/** A SMTP client which never blocks, to be driven by an event loop.
+  *
+  * The client does not wait for the socket: the event loop asks it
+  * whether it wants to read (wantRead()) or write (wantWrite()), waits
+  * until the socket is ready (eg. with poll or epoll), and then calls
+  * onReadable() or onWritable(). This way, many deliveries can run
+  * concurrently in a single thread. The socket must be connected, and
+  * must not block when no data can be read or written.
+  *
+  * Messages are sent with the same commands as SMTPTransport, and their
+  * size and 8-bit content are declared the same way (SIZE and 8BITMIME
+  * extensions). Commands are pipelined when the server supports it.
+  * Authentication, STARTTLS and CHUNKING are not supported.
+  */
+class VMIME_EXPORT SMTPAsyncClient : public object
+{
+public:
+
+	/** State of the client.
+	  */
+	enum State
+	{
+		STATE_GREETING,     /**< Waiting for the server greeting. */
+		STATE_EHLO,         /**< Waiting for the response to EHLO. */
+		STATE_HELO,         /**< Waiting for the response to HELO. */
+		STATE_READY,        /**< Waiting for a message to send. */
+		STATE_ENVELOPE,     /**< Waiting for responses to MAIL, RCPT and DATA. */
+		STATE_DATA,         /**< Sending message data. */
+		STATE_DATA_END,     /**< Waiting for the server to accept message data. */
+		STATE_QUIT,         /**< Waiting for the response to QUIT. */
+		STATE_CLOSED,       /**< Session has been closed. */
+		STATE_ERROR         /**< Session has been aborted (see getError()). */
+	};
+
+	/** A message to send, and the result of sending it.
+	  */
+	struct VMIME_EXPORT delivery : public object
+	{
+		delivery(const mailbox& expeditor, const mailboxList& recipients,
+			ref <utility::inputStream> is, const utility::stream::size_type size);
+
+		mailbox expeditor;
+		mailboxList recipients;
+		ref <utility::inputStream> stream;
+		utility::stream::size_type size;
+		/** Whether message data has 8bit or binary parts. */
+		bool eightBit;
+
+		/** Whether the delivery is finished (successfully or not). */
+		bool done;
+		/** Whether the message has been accepted by the server. */
+		bool sent;
+		/** Reason why the message has not been accepted. */
+		string error;
+		/** Status for each recipient, in the same order as 'recipients'. */
+		std::vector <transport::recipientStatus> recipientStatuses;
+	};
+
+	/** Construct a new client. The server greeting is expected
+	  * as the first data received on the socket.
+	  *
+	  * @param sok connected socket
+	  * @param hostName name sent in EHLO/HELO commands, or empty
+	  * to use the name of the local host
+	  */
+	SMTPAsyncClient(ref <socket> sok, const string& hostName = "");
+
+	~SMTPAsyncClient();
+
+	/** Queue a message. It is sent once the previous messages have
+	  * been sent.
+	  *
+	  * @param expeditor expeditor mailbox
+	  * @param recipients list of recipient mailboxes
+	  * @param is input stream providing message data (header + body),
+	  * which must not block
+	  * @param size size of the message data, or 0 if unknown
+	  * @return object in which the result will be stored
+	  */
+	ref <delivery> send(const mailbox& expeditor, const mailboxList& recipients,
+		ref <utility::inputStream> is, const utility::stream::size_type size);
+
+	/** Queue a message. It is sent once the previous messages have
+	  * been sent. The message is generated in memory immediately, so
+	  * that sending it never blocks; its size is always declared if
+	  * the server supports the SIZE extension.
+	  *
+	  * @param msg message to send
+	  * @param expeditor expeditor mailbox
+	  * @param recipients list of recipient mailboxes
+	  * @return object in which the result will be stored
+	  */
+	ref <delivery> send(ref <vmime::message> msg,
+		const mailbox& expeditor, const mailboxList& recipients);
+
+	/** Close the session once all queued messages have been sent.
+	  */
+	void quit();
+
+	/** Return whether the client waits for data from the server.
+	  *
+	  * @return true if onReadable() should be called when data
+	  * is available on the socket
+	  */
+	bool wantRead() const;
+
+	/** Return whether the client has data to send to the server.
+	  *
+	  * @return true if onWritable() should be called when data
+	  * can be written to the socket
+	  */
+	bool wantWrite() const;
+
+	/** Read available data from the socket, and process the
+	  * responses received.
+	  */
+	void onReadable();
+
+	/** Send as much pending data as the socket accepts.
+	  */
+	void onWritable();
+
+	/** Drive the session until all queued messages have been sent
+	  * (or the session has been closed, if quit() has been called),
+	  * waiting for the socket when needed. This is the blocking way
+	  * of using the client.
+	  */
+	void run();
+
+	/** Return the current state of the client.
+	  *
+	  * @return client state
+	  */
+	State getState() const;
+
+	/** Return whether the session is over (closed or aborted).
+	  *
+	  * @return true if no more message can be sent
+	  */
+	bool isFinished() const;
+
+	/** Return the reason why the session has been aborted.
+	  *
+	  * @return error message, or empty string if no error occurred
+	  */
+	const string getError() const;
+
+	/** Return whether the server supports the specified extension,
+	  * as advertised in its response to EHLO.
+	  *
+	  * @param name extension name (eg. "PIPELINING")
+	  * @return true if the extension is supported, false otherwise
+	  */
+	bool hasExtension(const string& name) const;
+
+private:
+
+	void processResponse(ref <SMTPResponse> resp);
+	void processEnvelopeResponse(ref <SMTPResponse> resp);
+
+	ref <delivery> queueDelivery(ref <delivery> d);
+
+	void startDelivery();
+	void finishDelivery();
+
+	void writeCommand(ref <SMTPCommand> cmd);
+	void fillData();
+
+	void fail(const string& error);
+
+
+	ref <socket> m_socket;
+	string m_hostName;
+
+	State m_state;
+	string m_error;
+
+	std::map <string, std::vector <string> > m_extensions;
+
+	SMTPResponse::state m_responseState;
+
+	// Data waiting to be sent
+	string m_output;
+
+	std::deque <ref <delivery> > m_deliveries;
+	bool m_quitRequested;
+	bool m_needReset;
+
+	// Envelope of the current delivery
+	std::vector <ref <SMTPCommand> > m_commands;
+	size_t m_commandsWritten;
+	size_t m_responsesRead;
+	bool m_resetSent;
+	bool m_mailAccepted;
+	unsigned int m_acceptedCount;
+
+	// Data of the current delivery
+	utility::outputStreamStringAdapter m_outputAdapter;
+	utility::dotFilteredOutputStream* m_dataFilter;
+};
+
+
+} // smtp
+} // net
+} // vmime
+
+
+#endif // VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_SMTP
+
+#endif // VMIME_NET_SMTP_SMTPASYNCCLIENT_HPP_INCLUDED
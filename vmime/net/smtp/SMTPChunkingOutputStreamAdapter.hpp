@@ -0,0 +1,108 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002-2013 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+#ifndef VMIME_NET_SMTP_SMTPCHUNKINGOUTPUTSTREAMADAPTER_HPP_INCLUDED
+#define VMIME_NET_SMTP_SMTPCHUNKINGOUTPUTSTREAMADAPTER_HPP_INCLUDED
+
+
+#include "vmime/config.hpp"
+
+
+#if VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_SMTP
+
+
+#include "vmime/utility/outputStream.hpp"
+
+#include <vector>
+
+
+namespace vmime {
+namespace net {
+namespace smtp {
+
+
+class SMTPTransport;
+
+
+/** An output stream which sends message data to a SMTP server in
+  * chunks, using the BDAT command (CHUNKING extension, RFC 3030).
+  *
+  * Data is sent as is: unlike with the DATA command, there is no need
+  * to dot-stuff the data, and binary data may be sent (BINARYMIME).
+  * If the server supports pipelining, the responses to the chunks are
+  * only read when needed, instead of waiting for them after each chunk.
+  */
+class VMIME_EXPORT SMTPChunkingOutputStreamAdapter : public utility::outputStream
+{
+public:
+
+	/** Construct a new stream.
+	  *
+	  * @param transport SMTP transport through which data is sent
+	  * @param pipelining set to true if the server supports pipelining
+	  */
+	SMTPChunkingOutputStreamAdapter(SMTPTransport& transport, const bool pipelining);
+
+	/** Send the remaining data as the last chunk, and read the
+	  * responses to the chunks.
+	  *
+	  * @throw exceptions::command_error if the server rejected a chunk;
+	  * in this case, the connection is closed
+	  * @param readLastResponse if false, the response to the last chunk
+	  * (which tells whether the message is accepted) is not read, and
+	  * is left to the caller
+	  */
+	void finish(const bool readLastResponse = true);
+
+	void write(const value_type* const data, const size_type count);
+	void flush();
+
+	size_type getBlockSize();
+
+private:
+
+	SMTPChunkingOutputStreamAdapter(const SMTPChunkingOutputStreamAdapter&);
+	SMTPChunkingOutputStreamAdapter& operator=(const SMTPChunkingOutputStreamAdapter&);
+
+	void sendChunk(const value_type* const data, const size_type count, const bool last);
+	void readChunkResponse();
+
+	SMTPTransport& m_transport;
+	const bool m_pipelining;
+
+	std::vector <value_type> m_buffer;
+	size_type m_bufferUsed;
+
+	// Number of chunks for which the response has not been read yet
+	unsigned int m_pendingResponses;
+};
+
+
+} // smtp
+} // net
+} // vmime
+
+
+#endif // VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_SMTP
+
+#endif // VMIME_NET_SMTP_SMTPCHUNKINGOUTPUTSTREAMADAPTER_HPP_INCLUDED
@@ -63,10 +63,11 @@ public:
 	static ref <SMTPCommand> EHLO(const string& hostname);
 	static ref <SMTPCommand> AUTH(const string& mechName);
 	static ref <SMTPCommand> STARTTLS();
-	static ref <SMTPCommand> MAIL(const mailbox& mbox, const bool utf8);
+	static ref <SMTPCommand> MAIL(const mailbox& mbox, const bool utf8, const string::size_type size = 0, const string& bodyType = "");
 	static ref <SMTPCommand> RCPT(const mailbox& mbox, const bool utf8);
 	static ref <SMTPCommand> RSET();
 	static ref <SMTPCommand> DATA();
+	static ref <SMTPCommand> BDAT(const string::size_type chunkSize, const bool last);
 	static ref <SMTPCommand> NOOP();
 	static ref <SMTPCommand> QUIT();
 
@@ -91,6 +91,18 @@ public:
 	  */
 	static ref <SMTPResponse> readResponse(ref <socket> sok, ref <timeoutHandler> toh, const state& st);
 
+	/** Parse a SMTP response from data already received, without
+	  * waiting for more data. This is used to drive a connection
+	  * from an event loop (see SMTPAsyncClient).
+	  *
+	  * @param st state of response parser, to which received data
+	  * must have been appended; the data of the response returned
+	  * is removed from it
+	  * @return SMTP response, or NULL if the data received so far
+	  * does not contain a complete response
+	  */
+	static ref <SMTPResponse> parseResponse(state& st);
+
 	/** Return the SMTP response code.
 	  *
 	  * @return response code
@@ -134,11 +146,6 @@ private:
 	SMTPResponse(ref <socket> sok, ref <timeoutHandler> toh, const state& st);
 	SMTPResponse(const SMTPResponse&);
 
-	void readResponse();
-
-	const string readResponseLine();
-	const responseLine getNextResponse();
-
 	static int extractResponseCode(const string& response);
 
 
@@ -148,7 +155,6 @@ private:
 	ref <timeoutHandler> m_timeoutHandler;
 
 	string m_responseBuffer;
-	bool m_responseContinues;
 };
 
 
@@ -52,6 +52,7 @@ public:
 	{
 		// SMTP-specific options
 		serviceInfos::property PROPERTY_OPTIONS_NEEDAUTH;
+		serviceInfos::property PROPERTY_OPTIONS_CHUNKING;
 #if VMIME_HAVE_SASL_SUPPORT
 		serviceInfos::property PROPERTY_OPTIONS_SASL;
 		serviceInfos::property PROPERTY_OPTIONS_SASL_FALLBACK;
@@ -40,11 +40,15 @@
 
 
 namespace vmime {
+
+class bodyPart;
+
 namespace net {
 namespace smtp {
 
 
 class SMTPCommand;
+class SMTPChunkingOutputStreamAdapter;
 
 
 /** SMTP transport service.
@@ -52,6 +56,9 @@ class SMTPCommand;
 
 class VMIME_EXPORT SMTPTransport : public transport
 {
+	friend class SMTPChunkingOutputStreamAdapter;
+	friend class SMTPAsyncClient;
+
 public:
 
 	SMTPTransport(ref <session> sess, ref <security::authenticator> auth, const bool secured = false);
@@ -68,6 +75,8 @@ public:
 
 	void noop();
 
+	using transport::send;
+
 	void send
 		(const mailbox& expeditor,
 		 const mailboxList& recipients,
@@ -76,15 +85,101 @@ public:
 		 utility::progressListener* progress = NULL,
 		 const mailbox& sender = mailbox());
 
+	void send
+		(ref <vmime::message> msg,
+		 const mailbox& expeditor,
+		 const mailboxList& recipients,
+		 utility::progressListener* progress = NULL,
+		 const mailbox& sender = mailbox());
+
+	void sendBatch(std::vector <messageToSend>& msgs,
+		utility::progressListener* progress = NULL);
+
 	bool isSecuredConnection() const;
 	ref <connectionInfos> getConnectionInfos() const;
 
 private:
 
+	/** Send the envelope (MAIL and RCPT commands) and, unless message
+	  * data is to be sent in chunks, the DATA command.
+	  *
+	  * @param expeditor expeditor mailbox
+	  * @param recipients list of recipient mailboxes
+	  * @param sender envelope sender (if empty, expeditor will be used)
+	  * @param size size of the message data, declared to the server if it
+	  * supports the SIZE extension, or 0 if the size is not known
+	  * @param bodyType body type declared in the MAIL command ("8BITMIME"
+	  * or "BINARYMIME"), or empty if none
+	  * @param chunking set to true if message data will be sent with
+	  * BDAT commands instead of DATA
+	  */
+	void sendEnvelope(const mailbox& expeditor, const mailboxList& recipients,
+		const mailbox& sender, const utility::stream::size_type size,
+		const string& bodyType, const bool chunking);
+
+	/** Read the responses to envelope commands which have already been
+	  * sent, after MAIL or RCPT has been rejected. The connection is kept,
+	  * unless the server accepted a DATA command which has been pipelined.
+	  *
+	  * @param count number of responses to read
+	  * @param dataSent true if the last command sent is DATA
+	  */
+	void cancelEnvelope(const unsigned int count, const bool dataSent);
+
+	/** Send a message as part of sendBatch(), but do not wait for the
+	  * final response to it: the message is stored in 'pending' instead.
+	  */
+	void sendBatchMessage(messageToSend& msg, const mailbox& expeditor,
+		const mailboxList& recipients, const mailbox& sender,
+		messageToSend*& pending);
+
+	/** Read the final response to a message sent with sendBatchMessage().
+	  */
+	void readBatchResponse(messageToSend& msg);
+
+	bool hasExtension(const string& name) const;
+	bool canUseChunking();
+	const string getBodyType(ref <const vmime::message> msg, const bool chunking) const;
+
+	/** Find whether a message contains parts with 8bit or binary
+	  * encoding, which must be declared in the MAIL command.
+	  *
+	  * @param part message or body part to examine
+	  * @param has8Bit set to true if a part has 8bit encoding
+	  * @param hasBinary set to true if a part has binary encoding
+	  */
+	static void findEncodings(ref <const bodyPart> part, bool& has8Bit, bool& hasBinary);
+
+	/** Get the extensions advertised by the server in its response
+	  * to EHLO (one per line, format is: EXT PARAM1 PARAM2...).
+	  * Extension names and parameters are converted to upper case.
+	  *
+	  * @param resp response to EHLO
+	  * @param extensions will receive the parameters of each extension
+	  */
+	static void parseExtensions(ref <SMTPResponse> resp,
+		std::map <string, std::vector <string> >& extensions);
+
+	/** Process the response to a RCPT command.
+	  *
+	  * @param resp response to RCPT
+	  * @param mailAccepted whether the MAIL command has been accepted;
+	  * if not, the recipient is never accepted
+	  * @param status status of the recipient, updated with the response
+	  * @return true if the recipient has been accepted, false otherwise
+	  */
+	static bool processRecipientResponse(ref <SMTPResponse> resp,
+		const bool mailAccepted, recipientStatus& status);
+
 	void sendRequest(ref <SMTPCommand> cmd);
 	ref <SMTPResponse> readResponse();
 
-	void internalDisconnect();
+	/** Close the connection.
+	  *
+	  * @param sendQuit whether to send the QUIT command first; must be
+	  * false if the server may still be reading message data
+	  */
+	void internalDisconnect(const bool sendQuit = true);
 
 	void helo();
 	void authenticate();
@@ -121,6 +121,16 @@ public:
 	  */
 	virtual size_type getBlockSize() const = 0;
 
+	/** Tell the socket whether more data is about to be sent, so that
+	  * partial packets are held back until it is uncorked (TCP_CORK
+	  * on Linux). Uncorking sends pending data immediately.
+	  * The default implementation does nothing.
+	  *
+	  * @param corked true to hold back partial packets, false to
+	  * send pending data
+	  */
+	virtual void setCorked(const bool /* corked */) { }
+
 	/** Return the current status of this socket.
 	  *
 	  * @return status flags for this socket
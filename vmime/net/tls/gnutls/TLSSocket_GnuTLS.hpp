@@ -74,6 +74,8 @@ public:
 
 	size_type getBlockSize() const;
 
+	void setCorked(const bool corked);
+
 	unsigned int getStatus() const;
 
 	const string getPeerName() const;
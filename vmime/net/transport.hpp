@@ -84,11 +84,120 @@ public:
 		 utility::progressListener* progress = NULL,
 		 const mailbox& sender = mailbox()) = 0;
 
+	/** Send a message over this transport service, using the specified
+	  * envelope. The message header is sent as is.
+	  *
+	  * The default implementation generates the whole message into a
+	  * buffer, and sends it with send(expeditor, recipients, is, ...).
+	  * Protocols which can write the message directly to the destination
+	  * (eg. SMTP) override it, to avoid buffering the message.
+	  *
+	  * @param msg message to send
+	  * @param expeditor expeditor mailbox
+	  * @param recipients list of recipient mailboxes
+	  * @param progress progress listener, or NULL if not used
+	  * @param sender envelope sender (if empty, expeditor will be used)
+	  */
+	virtual void send
+		(ref <vmime::message> msg,
+		 const mailbox& expeditor,
+		 const mailboxList& recipients,
+		 utility::progressListener* progress = NULL,
+		 const mailbox& sender = mailbox());
+
+	/** Status of a message sent with sendBatch(), for one recipient.
+	  */
+	struct recipientStatus
+	{
+		recipientStatus(const mailbox& recipient);
+
+		mailbox recipient;  /**< recipient mailbox */
+		bool accepted;      /**< true if the recipient was accepted by the server */
+		string response;    /**< server response to the recipient, if known */
+	};
+
+	/** A message to be sent with sendBatch(), and the result of
+	  * sending it.
+	  */
+	struct messageToSend
+	{
+		/** The envelope is extracted from the message header, and the
+		  * header is prepared before sending, as with send(msg).
+		  */
+		messageToSend(ref <vmime::message> msg);
+
+		/** The specified envelope is used, and the header is sent as is.
+		  */
+		messageToSend(ref <vmime::message> msg, const mailbox& expeditor,
+			const mailboxList& recipients, const mailbox& sender = mailbox());
+
+		ref <vmime::message> msg;  /**< message to send */
+		mailbox expeditor;         /**< expeditor, or empty to use the message header */
+		mailboxList recipients;    /**< recipients, if expeditor is not empty */
+		mailbox sender;            /**< envelope sender, or empty to use expeditor */
+
+		bool sent;                 /**< set to true if the message was accepted */
+		utility::stream::size_type size;  /**< size of the message data sent, in bytes */
+		string error;              /**< reason why the message was not accepted */
+		std::vector <recipientStatus> recipientStatuses;  /**< result for each recipient */
+	};
+
+	/** Send several messages over this transport service.
+	  *
+	  * A message which is rejected (or some of its recipients) does not
+	  * stop the sending of the following messages: results are reported
+	  * for each message and each recipient in the messageToSend objects.
+	  * If the connection is lost, an exception is thrown; messages for
+	  * which 'sent' is false have not been sent.
+	  *
+	  * The default implementation sends the messages one at a time. SMTP
+	  * overrides it to keep the connection busy: if the server supports
+	  * pipelining, the envelope of a message is sent while the server has
+	  * not yet acknowledged the data of the previous one.
+	  *
+	  * @param msgs messages to send; results are stored in them
+	  * @param progress progress listener, or NULL if not used (progress
+	  * is expressed in number of messages)
+	  */
+	virtual void sendBatch(std::vector <messageToSend>& msgs,
+		utility::progressListener* progress = NULL);
+
 
 	Type getType() const;
 
 protected:
 
+	/** Extract the envelope of a message from its header (From, Sender,
+	  * To, Cc and Bcc fields).
+	  *
+	  * @throw exceptions::no_expeditor if the message has no From field
+	  * @param msg message
+	  * @param expeditor will receive the expeditor
+	  * @param recipients will receive the recipients
+	  * @param sender will receive the sender (or the expeditor if the
+	  * message has no Sender field)
+	  */
+	static void extractEnvelope(ref <const vmime::message> msg,
+		mailbox& expeditor, mailboxList& recipients, mailbox& sender);
+
+	/** Replaces the header of a message with a copy prepared by
+	  * processHeader() during the time the message is being sent,
+	  * and reverts it back to the original header when destroyed.
+	  * This avoids cloning the message body.
+	  */
+	class headerExchanger
+	{
+	public:
+
+		headerExchanger(transport& tr, ref <vmime::message> msg);
+		~headerExchanger();
+
+	private:
+
+		ref <vmime::message> m_msg;
+		ref <vmime::header> m_header;
+	};
+
 	/** Called by processHeader().
 	  * Decides what to do with the specified header field.
 	  *
@@ -0,0 +1,245 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002-2013 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+#ifndef VMIME_NET_TRANSPORTPOOL_HPP_INCLUDED
+#define VMIME_NET_TRANSPORTPOOL_HPP_INCLUDED
+
+
+#include "vmime/config.hpp"
+
+
+#if VMIME_HAVE_MESSAGING_FEATURES
+
+
+#include <deque>
+#include <list>
+#include <vector>
+
+#include "vmime/net/session.hpp"
+#include "vmime/net/transport.hpp"
+
+#include "vmime/utility/url.hpp"
+#include "vmime/utility/sync/criticalSection.hpp"
+
+
+namespace vmime {
+namespace net {
+
+
+/** A pool of transport connections to the same server, which sends
+  * queued messages.
+  *
+  * The pool does not create threads: messages can be queued from any
+  * thread with enqueue(), and each thread calling processQueue() works
+  * as a sender, using its own connection taken from the pool. At most
+  * getMaxConnections() connections are open at the same time; they are
+  * kept open between calls and reused.
+  */
+
+class VMIME_EXPORT transportPool : public object
+{
+public:
+
+	/** Receives notifications when a queued message has been processed.
+	  * Notifications are sent from the thread which processed the message.
+	  */
+	class VMIME_EXPORT listener
+	{
+	public:
+
+		virtual ~listener() { }
+
+		/** Called when a message has been sent, or has failed.
+		  *
+		  * @param msg message, with the result of sending it
+		  * (see transport::messageToSend)
+		  */
+		virtual void messageProcessed(const transport::messageToSend& msg) = 0;
+	};
+
+	/** Counters on the activity of the pool.
+	  */
+	struct VMIME_EXPORT statistics
+	{
+		statistics();
+
+		/** Number of messages sent successfully. */
+		unsigned long sentCount;
+		/** Number of messages which could not be sent. */
+		unsigned long failedCount;
+		/** Total size of the messages sent successfully. */
+		unsigned long sentBytes;
+		/** Number of connections opened by the pool. */
+		unsigned long connectionCount;
+		/** Time elapsed since the first message was queued, in seconds. */
+		unsigned long elapsedTime;
+	};
+
+	/** Construct a new pool.
+	  *
+	  * @param sess session used to create transport services
+	  * @param url URL of the server (eg. "smtp://relay.example.com")
+	  * @param maxConnections maximum number of connections open at
+	  * the same time
+	  * @param auth authenticator object to use for the connections; if
+	  * NULL, the default one is used (see session::getTransport())
+	  */
+	transportPool(ref <session> sess, const utility::url& url,
+		const unsigned int maxConnections,
+		ref <security::authenticator> auth = NULL);
+
+	~transportPool();
+
+	/** Return the maximum number of connections open at the same time.
+	  *
+	  * @return maximum number of connections
+	  */
+	unsigned int getMaxConnections() const;
+
+	/** Set the number of messages after which a connection is closed
+	  * and replaced by a new one. Some servers limit the number of
+	  * messages accepted per connection.
+	  *
+	  * @param count number of messages, or 0 for no limit (default)
+	  */
+	void setMaxMessagesPerConnection(const unsigned int count);
+
+	/** Set the maximum number of messages sent at once on a connection
+	  * (see transport::sendBatch()). Larger batches allow more commands
+	  * to be pipelined, but share the queue less evenly between senders.
+	  *
+	  * @param count number of messages (default is 16)
+	  */
+	void setBatchSize(const unsigned int count);
+
+	/** Set the socket factory used by the connections of the pool.
+	  *
+	  * @param sf socket factory
+	  */
+	void setSocketFactory(ref <socketFactory> sf);
+
+	/** Set the timeout handler factory used by the connections of the pool.
+	  *
+	  * @param thf timeout handler factory
+	  */
+	void setTimeoutHandlerFactory(ref <timeoutHandlerFactory> thf);
+
+	void addListener(listener* l);
+	void removeListener(listener* l);
+
+	/** Queue a message. The envelope is extracted from the message header.
+	  *
+	  * @param msg message to send
+	  */
+	void enqueue(ref <vmime::message> msg);
+
+	/** Queue a message.
+	  *
+	  * @param msg message to send, with its envelope
+	  */
+	void enqueue(const transport::messageToSend& msg);
+
+	/** Send the next messages in the queue, using a connection taken
+	  * from the pool. A connection is opened (or re-opened, if it has been
+	  * closed by the server) if needed.
+	  *
+	  * @return false if the queue is empty, or if all connections are
+	  * in use by other threads; true otherwise
+	  * @throw exceptions::net_exception if the connection cannot be
+	  * established (queued messages are left in the queue)
+	  */
+	bool processNext();
+
+	/** Send queued messages until the queue is empty, or until no
+	  * connection is available.
+	  *
+	  * @throw exceptions::net_exception if a connection cannot be
+	  * established (queued messages are left in the queue)
+	  */
+	void processQueue();
+
+	/** Return the number of messages waiting in the queue.
+	  *
+	  * @return number of queued messages
+	  */
+	unsigned int getQueueSize() const;
+
+	/** Return the number of open connections, either idle or in use.
+	  *
+	  * @return number of open connections
+	  */
+	unsigned int getConnectionCount() const;
+
+	/** Return activity counters.
+	  *
+	  * @return statistics
+	  */
+	const statistics getStatistics() const;
+
+	/** Close all idle connections.
+	  */
+	void disconnect();
+
+private:
+
+	struct connection
+	{
+		ref <transport> tr;
+		unsigned int messageCount;
+	};
+
+	bool acquireConnection(connection& cnt);
+	void releaseConnection(connection& cnt);
+	void dropConnection(connection& cnt);
+
+	ref <session> m_session;
+	utility::url m_url;
+	ref <security::authenticator> m_auth;
+
+	ref <socketFactory> m_socketFactory;
+	ref <timeoutHandlerFactory> m_toHandlerFactory;
+
+	const unsigned int m_maxConnections;
+	unsigned int m_maxMessagesPerConnection;
+	unsigned int m_batchSize;
+
+	mutable ref <utility::sync::criticalSection> m_lock;
+
+	std::deque <transport::messageToSend> m_queue;
+	std::vector <connection> m_idle;
+	unsigned int m_openCount;
+
+	statistics m_stats;
+	unsigned long m_startTime;
+
+	std::list <listener*> m_listeners;
+};
+
+
+} // net
+} // vmime
+
+
+#endif // VMIME_HAVE_MESSAGING_FEATURES
+
+#endif // VMIME_NET_TRANSPORTPOOL_HPP_INCLUDED
@@ -59,11 +59,20 @@ public:
 
 	size_type getBlockSize() const;
 
+	void setCorked(const bool corked);
+
 	unsigned int getStatus() const;
 
 	const string getPeerName() const;
 	const string getPeerAddress() const;
 
+	/** Return the underlying socket descriptor, for example to
+	  * register it in an event loop (see SMTPAsyncClient).
+	  *
+	  * @return socket descriptor, or -1 if not connected
+	  */
+	int getDescriptor() const;
+
 protected:
 
 	static void throwSocketError(const int err);
@@ -84,6 +84,20 @@ public:
 	  */
 	virtual bool isComplete() const = 0;
 
+	/** Check whether this mechanism is client-first, ie. whether the
+	  * client sends data (the initial response) before receiving any
+	  * challenge from the server. If the protocol allows it (eg. SASL-IR
+	  * for IMAP, RFC 4959), the initial response can then be sent along
+	  * with the authentication command.
+	  *
+	  * The default implementation returns false, which is always safe:
+	  * the server then asks for the initial response with an empty
+	  * challenge.
+	  *
+	  * @return true if the client sends data first, or false otherwise
+	  */
+	virtual bool hasInitialResponse() const { return false; }
+
 	/** Encode data according to negotiated SASL mechanism. This
 	  * might mean that data is integrity or privacy protected.
 	  *
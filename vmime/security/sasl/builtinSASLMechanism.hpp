@@ -61,6 +61,8 @@ public:
 
 	bool isComplete() const;
 
+	bool hasInitialResponse() const;
+
 	void encode(ref <SASLSession> sess,
 		const byte_t* input, const long inputLen,
 		byte_t** output, long* outputLen);
@@ -69,6 +69,8 @@ public:
 
 	void generate(utility::outputStream& os, const vmime::encoding& enc, const string::size_type maxLineLength = lineLengthLimits::infinite) const;
 
+	utility::stream::size_type getGeneratedSize(const vmime::encoding& enc, const string::size_type maxLineLength = lineLengthLimits::infinite) const;
+
 	void extract(utility::outputStream& os, utility::progressListener* progress = NULL) const;
 	void extractRaw(utility::outputStream& os, utility::progressListener* progress = NULL) const;
 
@@ -90,6 +92,11 @@ private:
 
 	// The actual data
 	utility::stringProxy m_string;
+
+	// Last result of getGeneratedSize(), reset when data is changed
+	mutable utility::stream::size_type m_generatedSize;
+	mutable vmime::encoding m_generatedSizeEncoding;
+	mutable string::size_type m_generatedSizeMaxLineLength;
 };
 
 
@@ -0,0 +1,93 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002-2013 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+
+#ifndef VMIME_UTILITY_BUFFEREDOUTPUTSTREAM_HPP_INCLUDED
+#define VMIME_UTILITY_BUFFEREDOUTPUTSTREAM_HPP_INCLUDED
+
+
+#include "vmime/utility/outputStream.hpp"
+
+#include <vector>
+
+
+namespace vmime {
+namespace utility {
+
+
+/** An output stream which collects small writes into a buffer
+  * before passing them to another stream.
+  *
+  * Component generation issues many small writes (a few bytes for
+  * each header field name, separator and line break); this avoids
+  * a system call for each of them when writing to a socket or a pipe.
+  * Buffered data is written when the buffer is full, or when flush()
+  * is called; it is NOT written when the stream is destroyed.
+  */
+
+class VMIME_EXPORT bufferedOutputStream : public outputStream
+{
+public:
+
+	/** Default size of the buffer, in bytes. */
+	static const size_type DEFAULT_BUFFER_SIZE;
+
+	/** Construct a stream which passes data to another stream.
+	  *
+	  * @param os stream into which write data
+	  * @param bufferSize size of the buffer, in bytes; writes
+	  * larger than this are passed directly to the stream
+	  */
+	bufferedOutputStream(outputStream& os,
+		const size_type bufferSize = DEFAULT_BUFFER_SIZE);
+
+	/** Return the number of bytes waiting in the buffer.
+	  *
+	  * @return number of bytes not written yet
+	  */
+	size_type getPendingSize() const;
+
+	void write(const value_type* const data, const size_type count);
+
+	/** Write buffered data, then flush the underlying stream.
+	  */
+	void flush();
+
+	size_type getBlockSize();
+
+private:
+
+	bufferedOutputStream(const bufferedOutputStream&);
+
+	outputStream& m_stream;
+
+	std::vector <value_type> m_buffer;
+	size_type m_length;
+};
+
+
+} // utility
+} // vmime
+
+
+#endif // VMIME_UTILITY_BUFFEREDOUTPUTSTREAM_HPP_INCLUDED
@@ -0,0 +1,86 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002-2013 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+#ifndef VMIME_UTILITY_COUNTINGOUTPUTSTREAM_HPP_INCLUDED
+#define VMIME_UTILITY_COUNTINGOUTPUTSTREAM_HPP_INCLUDED
+
+
+#include "vmime/utility/outputStream.hpp"
+#include "vmime/utility/progressListener.hpp"
+
+
+namespace vmime {
+namespace utility {
+
+
+/** An output stream which counts the bytes written to it.
+  *
+  * Data is either discarded (eg. to compute the size of some data
+  * without storing it), or passed to another stream; in the latter
+  * case, a progress listener can be notified as data is written.
+  */
+
+class VMIME_EXPORT countingOutputStream : public outputStream
+{
+public:
+
+	/** Construct a stream which discards data.
+	  */
+	countingOutputStream();
+
+	/** Construct a stream which passes data to another stream.
+	  *
+	  * @param os stream into which write data
+	  * @param total predicted number of bytes, for progress notification
+	  * @param progress listener to notify, or NULL if not used (start()
+	  * and stop() are left to the caller)
+	  */
+	countingOutputStream(outputStream& os, const size_type total = 0,
+		progressListener* progress = NULL);
+
+	/** Return the number of bytes written to this stream.
+	  *
+	  * @return number of bytes written
+	  */
+	size_type getCount() const;
+
+	void write(const value_type* const data, const size_type count);
+	void flush();
+
+private:
+
+	outputStream* m_stream;
+
+	size_type m_count;
+	size_type m_total;
+	size_type m_lastNotified;
+
+	progressListener* m_progress;
+};
+
+
+} // utility
+} // vmime
+
+
+#endif // VMIME_UTILITY_COUNTINGOUTPUTSTREAM_HPP_INCLUDED
@@ -45,6 +45,8 @@ public:
 	utility::stream::size_type encode(utility::inputStream& in, utility::outputStream& out, utility::progressListener* progress = NULL);
 	utility::stream::size_type decode(utility::inputStream& in, utility::outputStream& out, utility::progressListener* progress = NULL);
 
+	utility::stream::size_type getEncodedSize(const utility::stream::size_type n) const;
+
 	const std::vector <string> getAvailableProperties() const;
 
 protected:
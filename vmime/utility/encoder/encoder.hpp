@@ -66,6 +66,17 @@ public:
 	  */
 	virtual utility::stream::size_type decode(utility::inputStream& in, utility::outputStream& out, utility::progressListener* progress = NULL) = 0;
 
+	/** Compute the length of the data encode() would produce from
+	  * the specified number of input bytes, without encoding anything.
+	  * This is only possible if the encoded length does not depend on
+	  * the data itself (eg. base64).
+	  *
+	  * @param n length of input data (decoded), in bytes
+	  * @return length of encoded data, in bytes, or string::npos if
+	  * it cannot be determined without encoding the data
+	  */
+	virtual utility::stream::size_type getEncodedSize(const utility::stream::size_type n) const;
+
 	/** Return the properties of the encoder.
 	  *
 	  * @return properties of the encoder
@@ -26,6 +26,7 @@
 
 
 #include <algorithm>
+#include <cstring>
 
 #include "vmime/utility/inputStream.hpp"
 #include "vmime/utility/outputStream.hpp"
@@ -102,6 +103,61 @@ private:
 };
 
 
+/** A filtered input stream which reads dot-terminated data, as sent
+  * in POP3 multi-line responses: it replaces "\n.." sequences with
+  * "\n." sequences, and stops at the "<CRLF>.<CRLF>" terminator (or
+  * "<LF>.<LF>"), which is not returned. This does the same work as a
+  * dotFilteredInputStream over stopSequenceFilteredInputStream objects,
+  * in a single pass which only looks at the beginning of lines.
+  *
+  * The beginning of the stream is the beginning of a line, so data
+  * may consist of the terminator alone.
+  */
+
+class VMIME_EXPORT dotTerminatedFilteredInputStream : public filteredInputStream
+{
+public:
+
+	/** Construct a new filter for the specified input stream.
+	  *
+	  * @param is stream from which to read data to be filtered
+	  */
+	dotTerminatedFilteredInputStream(inputStream& is);
+
+	inputStream& getPreviousInputStream();
+
+	bool eof() const;
+
+	void reset();
+
+	/** Read filtered data. Read buffer must be larger than 4 bytes.
+	  */
+	size_type read(value_type* const data, const size_type count);
+
+	size_type skip(const size_type count);
+
+	/** Return the data which has been read from the underlying stream
+	  * after the terminator (eg. responses to pipelined commands).
+	  *
+	  * @return data following the terminator
+	  */
+	const string& getTrailingData() const;
+
+private:
+
+	inputStream& m_stream;
+
+	// End of previous buffer which may be part of the terminator
+	value_type m_pending[4];
+	size_type m_pendingLength;
+
+	bool m_lineStart;
+	bool m_eof;
+
+	string m_trailingData;
+};
+
+
 /** A filtered output stream which replaces "\n."
   * sequences with "\n.." sequences.
   */
@@ -126,6 +182,7 @@ private:
 	outputStream& m_stream;
 	value_type m_previousChar;
 	bool m_start;
+	bool m_startDot;  // content is a single dot, so far
 };
 
 
@@ -281,9 +338,10 @@ stream::size_type stopSequenceFilteredInputStream <COUNT>::read
 		{
 			while (pos < end)
 			{
-				pos = std::find(pos, end, m_sequence[0]);
+				pos = static_cast <value_type*>
+					(std::memchr(pos, m_sequence[0], static_cast <size_t>(end - pos)));
 
-				if (pos == end)
+				if (pos == NULL)
 					return (read);
 
 				m_found = 1;
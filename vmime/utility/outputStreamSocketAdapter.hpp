@@ -43,13 +43,24 @@ namespace utility {
 
 
 /** An output stream that is connected to a socket.
+  *
+  * In "cork" mode, the socket is corked when data is written, and
+  * uncorked by flush(): when used under a bufferedOutputStream, the
+  * last partial packet of each buffer is held back until the next
+  * buffer or the end of data is sent (see net::socket::setCorked()).
   */
 
 class VMIME_EXPORT outputStreamSocketAdapter : public outputStream
 {
 public:
 
-	outputStreamSocketAdapter(net::socket& sok);
+	/** Construct a stream which writes data to the specified socket.
+	  *
+	  * @param sok socket into which write data
+	  * @param cork if true, cork the socket until flush() is called
+	  */
+	outputStreamSocketAdapter(net::socket& sok, const bool cork = false);
+	~outputStreamSocketAdapter();
 
 	void write(const value_type* const data, const size_type count);
 	void flush();
@@ -61,6 +72,9 @@ private:
 	outputStreamSocketAdapter(const outputStreamSocketAdapter&);
 
 	net::socket& m_socket;
+
+	bool m_cork;
+	bool m_corked;
 };
 
 
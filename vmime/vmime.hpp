@@ -111,6 +111,7 @@
 
 // Utilities
 #include "vmime/utility/datetimeUtils.hpp"
+#include "vmime/utility/bufferedOutputStream.hpp"
 #include "vmime/utility/filteredStream.hpp"
 #include "vmime/charsetConverter.hpp"
 
@@ -136,11 +137,14 @@
 	#include "vmime/net/serviceFactory.hpp"
 	#include "vmime/net/store.hpp"
 	#include "vmime/net/transport.hpp"
+	#include "vmime/net/transportPool.hpp"
 
 	#include "vmime/net/session.hpp"
 
 	#include "vmime/net/folder.hpp"
 	#include "vmime/net/message.hpp"
+	#include "vmime/net/searchCriteria.hpp"
+	#include "vmime/net/messageSet.hpp"
 #endif // VMIME_HAVE_MESSAGING_FEATURES
 
 // Net/TLS